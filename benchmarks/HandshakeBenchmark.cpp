@@ -0,0 +1,76 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <frnetlib/Sha1.h>
+#include <frnetlib/Base64.h>
+
+//The character at a time encoder which Base64 used to use, for comparison
+static std::string append_encode(const std::string &input)
+{
+    static const std::string base64_table = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    out.reserve(input.size() + (input.size() / 3) + 1);
+    size_t a;
+    for(a = 0; a + 2 < input.size(); a += 3)
+    {
+        out += base64_table[(input[a] >> 2) & 0x3F];
+        out += base64_table[((input[a] & 0x3) << 4) | (input[a + 1] & 0xF0) >> 4];
+        out += base64_table[((input[a + 1] & 0xF) << 2) | (input[a + 2] & 0xC0) >> 6];
+        out += base64_table[input[a + 2] & 0x3F];
+    }
+    return out;
+}
+
+template<typename Function>
+static void run(const std::string &name, size_t bytes_per_iteration, size_t iterations, Function &&function)
+{
+    size_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(size_t a = 0; a < iterations; ++a)
+        checksum += function(a);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    double bytes = (double)bytes_per_iteration * iterations;
+    std::cout << name << ": " << bytes / elapsed.count() / 1e9 << " GB/s, " << iterations / elapsed.count()
+              << " per second (checksum " << checksum << ")" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    size_t payload_size = argc > 1 ? std::stoul(argv[1]) : 64 * 1024;
+    size_t iterations = argc > 2 ? std::stoul(argv[2]) : 10000;
+    std::cout << "Hashing and encoding " << iterations << " payloads of " << payload_size << " bytes" << std::endl;
+
+    std::string payload(payload_size, 'a');
+    for(size_t a = 0; a < payload.size(); ++a)
+        payload[a] = static_cast<char>(a * 7 + 3);
+
+    run("Sha1::sha1_digest", payload.size(), iterations, [&](size_t) {
+        char digest[fr::Sha1::DIGEST_SIZE];
+        fr::Sha1::sha1_digest(payload.data(), payload.size(), digest);
+        return (size_t)(uint8_t)digest[0];
+    });
+    run("append encode", payload.size(), iterations, [&](size_t) {
+        return append_encode(payload).size();
+    });
+    run("Base64::encode", payload.size(), iterations, [&](size_t) {
+        return fr::Base64::encode(payload).size();
+    });
+    std::string encoded = fr::Base64::encode(payload);
+    run("Base64::decode", encoded.size(), iterations, [&](size_t) {
+        std::string decoded;
+        fr::Base64::decode(encoded, decoded);
+        return decoded.size();
+    });
+
+    //What a server does for each handshake
+    std::string key = "dGhlIHNhbXBsZSBub25jZQ==";
+    run("Sec-WebSocket-Accept", key.size(), iterations * 10, [&](size_t) {
+        return fr::Base64::encode(fr::Sha1::sha1_digest(key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11")).size();
+    });
+    return 0;
+}
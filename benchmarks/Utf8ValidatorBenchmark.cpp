@@ -0,0 +1,41 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <frnetlib/Utf8Validator.h>
+
+static void run(const std::string &name, const std::string &text, size_t iterations)
+{
+    size_t valid = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(size_t a = 0; a < iterations; ++a)
+        valid += fr::Utf8Validator::validate(text.data(), text.size());
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    double bytes = (double)text.size() * iterations;
+    std::cout << name << ": " << bytes / elapsed.count() / 1e9 << " GB/s (" << valid << " valid)" << std::endl;
+}
+
+//Repeats a piece of text until it's at least 'size' bytes
+static std::string repeat(const std::string &piece, size_t size)
+{
+    std::string text;
+    while(text.size() < size)
+        text += piece;
+    return text;
+}
+
+int main(int argc, char **argv)
+{
+    size_t payload_size = argc > 1 ? std::stoul(argv[1]) : 1024 * 1024;
+    size_t iterations = argc > 2 ? std::stoul(argv[2]) : 1000;
+    std::cout << "Validating " << iterations << " payloads of " << payload_size << " bytes" << std::endl;
+
+    run("ASCII", repeat("{\"symbol\":\"FRN\",\"price\":101,\"volume\":25}\n", payload_size), iterations);
+    run("mostly ASCII", repeat("{\"name\":\"Caf\xC3\xA9 M\xC3\xBCller\",\"price\":\"\xE2\x82\xAC" "5\"}\n", payload_size), iterations);
+    run("Greek", repeat("\xCE\xBA\xE1\xBD\xB9\xCF\x83\xCE\xBC\xCE\xB5 ", payload_size), iterations);
+    return 0;
+}
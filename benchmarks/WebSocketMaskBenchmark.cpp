@@ -0,0 +1,49 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <frnetlib/WebFrame.h>
+
+//The byte at a time loop which WebFrame used to use, for comparison
+static void byte_mask(char *data, size_t size, uint32_t mask_key)
+{
+    union
+    {
+        uint32_t mask_key;
+        char str_mask_key[4];
+    } mask_union{};
+    mask_union.mask_key = mask_key;
+    for(size_t a = 0; a < size; ++a)
+    {
+        data[a] = data[a] ^ mask_union.str_mask_key[a % 4];
+    }
+}
+
+template<typename Mask>
+static void run(const std::string &name, std::string &data, size_t iterations, Mask &&mask)
+{
+    auto start = std::chrono::steady_clock::now();
+    for(size_t a = 0; a < iterations; ++a)
+        mask(&data[a % 8], data.size() - 8, 0x12345678 + (uint32_t)a);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    double bytes = (double)(data.size() - 8) * iterations;
+    std::cout << name << ": " << bytes / elapsed.count() / 1e9 << " GB/s (checksum " << (int)data[data.size() / 2] << ")" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    size_t payload_size = argc > 1 ? std::stoul(argv[1]) : 1024 * 1024;
+    size_t iterations = argc > 2 ? std::stoul(argv[2]) : 1000;
+    std::cout << "Masking " << iterations << " payloads of " << payload_size << " bytes" << std::endl;
+
+    std::string data(payload_size + 8, 'a');
+    run("byte at a time", data, iterations, byte_mask);
+    run("WebFrame::apply_mask", data, iterations, [](char *data, size_t size, uint32_t mask_key) {
+        fr::WebFrame::apply_mask(data, size, mask_key);
+    });
+    return 0;
+}
@@ -0,0 +1,99 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#ifndef FRNETLIB_ADDRESS_H
+#define FRNETLIB_ADDRESS_H
+
+#include <string>
+#include <cstdint>
+#include "NetworkEncoding.h"
+
+namespace fr
+{
+    /*!
+     * An IPv4 or IPv6 address, and optionally a port, as a socket address which can be connected to directly.
+     */
+    class Address
+    {
+    public:
+        Address();
+
+        /*!
+         * Constructs the address from a socket address, such as one from getaddrinfo().
+         *
+         * @param address The socket address to copy. Must be an AF_INET or AF_INET6 address.
+         * @param length The size of address in bytes
+         */
+        Address(const sockaddr *address, socklen_t length);
+
+        /*!
+         * Parses a numeric IPv4 or IPv6 address, such as '127.0.0.1' or '::1'.
+         * Host names aren't looked up.
+         *
+         * @param ip The address to parse
+         * @param address Where to store the parsed address. Its port is 0.
+         * @return True if ip was a valid address, false otherwise.
+         */
+        static bool parse(const std::string &ip, Address &address);
+
+        /*!
+         * Gets the address family.
+         *
+         * @return AF_INET, AF_INET6, or AF_UNSPEC if the address is empty.
+         */
+        inline int get_family() const
+        {
+            return storage.ss_family;
+        }
+
+        /*!
+         * Gets the port.
+         *
+         * @return The port, in host byte order
+         */
+        uint16_t get_port() const;
+
+        /*!
+         * Sets the port.
+         *
+         * @param port The port, in host byte order
+         */
+        void set_port(uint16_t port);
+
+        /*!
+         * Gets the address in its printable form, without the port.
+         *
+         * @return The address, such as '127.0.0.1' or '::1'. Empty if the address is empty.
+         */
+        std::string to_string() const;
+
+        /*!
+         * Gets the underlying socket address, to pass to connect() and the like.
+         */
+        inline const sockaddr *get() const
+        {
+            return reinterpret_cast<const sockaddr*>(&storage);
+        }
+
+        /*!
+         * Gets the size of the underlying socket address in bytes.
+         */
+        inline socklen_t get_length() const
+        {
+            return length;
+        }
+
+        bool operator==(const Address &other) const;
+        inline bool operator!=(const Address &other) const
+        {
+            return !(*this == other);
+        }
+
+    private:
+        sockaddr_storage storage;
+        socklen_t length;
+    };
+}
+
+#endif //FRNETLIB_ADDRESS_H
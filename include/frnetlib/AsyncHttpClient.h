@@ -0,0 +1,183 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#ifndef FRNETLIB_ASYNCHTTPCLIENT_H
+#define FRNETLIB_ASYNCHTTPCLIENT_H
+
+#include <string>
+#include <memory>
+#include <deque>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <unordered_map>
+#include "TcpSocket.h"
+#include "SocketSelector.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "URL.h"
+
+namespace fr
+{
+    /*!
+     * An HTTP/1.1 client which runs any number of requests at once from a single thread.
+     *
+     * Each host gets one keep-alive connection, on which requests are pipelined: up to
+     * set_max_pipeline_depth() requests are written back to back without waiting for
+     * their responses, which the server sends back in the same order. Responses are
+     * matched to requests in that order, and handed to each request's callback.
+     *
+     * Nothing happens in the background. Requests are only sent, and callbacks only called,
+     * from within poll() or run(), on the thread calling them. Callbacks may queue more requests.
+     * The client isn't thread safe, so should only be used by one thread at a time.
+     *
+     * Connections are opened without blocking, so a slow host doesn't hold up the others. Host
+     * names are still looked up with getaddrinfo(), which does block.
+     *
+     * Only plain http URLs are supported.
+     */
+    class AsyncHttpClient
+    {
+    public:
+        /*!
+         * Called when a request completes.
+         *
+         * @param status 'Success' if the response was received. A socket or parse error otherwise.
+         * @param response The response. Only valid if status is 'Success', and only for the duration of the call.
+         */
+        using Callback = std::function<void(Socket::Status status, HttpResponse &response)>;
+
+        AsyncHttpClient();
+        AsyncHttpClient(AsyncHttpClient &&)=delete;
+        AsyncHttpClient(const AsyncHttpClient &)=delete;
+        void operator=(AsyncHttpClient &&)=delete;
+        void operator=(const AsyncHttpClient &)=delete;
+
+        /*!
+         * Queues a request. It's sent by the next call to poll(), and the callback
+         * is called from whichever call to poll() completes it.
+         *
+         * If the server closes the connection before answering a request, then the request
+         * is sent again once on a new connection, as long as it's a GET, PUT or DELETE. POST and
+         * PATCH requests can't be safely repeated, so they're failed, and are never pipelined
+         * behind other requests.
+         *
+         * @param url The URL to request. Its path and query (if it has any) replace the request's URI.
+         * @param request The request to send. A host header is added if it doesn't have one.
+         * @param callback Called with the response, or the reason the request failed. An 'Error'
+         * status means that the URL isn't http, 'SSLError' that it's https.
+         */
+        void request(const URL &url, HttpRequest request, Callback callback);
+
+        /*!
+         * Sends what can be sent, receives what has arrived, and calls the callbacks
+         * of any requests which have completed.
+         *
+         * @param timeout The maximum time to wait for activity, if no requests have completed yet. Default/-1
+         * for no timeout. poll() returns immediately if there are no requests outstanding.
+         * @return The number of requests which are still outstanding
+         */
+        size_t poll(std::chrono::milliseconds timeout = std::chrono::milliseconds(-1));
+
+        /*!
+         * Calls poll() until every request, including any queued by callbacks, has completed.
+         */
+        void run();
+
+        /*!
+         * Sets how many requests can be waiting for a response on a connection at once. Defaults to 8.
+         * 1 disables pipelining.
+         *
+         * @param depth The maximum number of requests in flight on a connection. Must be at least 1.
+         */
+        void set_max_pipeline_depth(size_t depth);
+
+        /*!
+         * Sets how long to wait for a new connection to be opened, before failing its requests with 'Timeout'.
+         *
+         * @param timeout The connect timeout. Pass {} for the default.
+         */
+        void set_connect_timeout(std::chrono::seconds timeout);
+
+        /*!
+         * Gets the number of connections which are currently open.
+         *
+         * @return The number of open connections, across all hosts.
+         */
+        size_t get_connection_count() const;
+
+    private:
+        struct Pending
+        {
+            HttpRequest request;
+            Callback callback;
+            bool retried = false;
+        };
+
+        struct Connection
+        {
+            URL url;
+            std::shared_ptr<TcpSocket> socket;
+            std::deque<Pending> queued; //Waiting to be sent
+            std::deque<Pending> in_flight; //Sent, and waiting for a response, oldest first
+            HttpResponse response; //The response to the front of in_flight, as it's received
+            std::string output; //Requests which have been constructed but not yet fully sent
+            size_t output_sent = 0;
+            bool want_write = false; //If the selector is waiting for the socket to be writable
+            std::chrono::steady_clock::time_point connect_expiry; //When to give up on connecting
+        };
+
+        struct Completion
+        {
+            Callback callback;
+            Socket::Status status;
+            HttpResponse response;
+        };
+
+        /*!
+         * Opens the connection if needed, moves queued requests into the pipeline, and sends what it can.
+         */
+        void flush(Connection &connection);
+
+        /*!
+         * Continues opening a connection, once the selector says that it's ready.
+         */
+        void finish_connect(Connection &connection);
+
+        /*!
+         * Gives up on opening a connection, failing every request queued for it with the given status.
+         */
+        void fail_connect(Connection &connection, Socket::Status status);
+
+        /*!
+         * Receives everything that's waiting on the connection, and completes the requests that it answers.
+         */
+        void receive(Connection &connection);
+
+        /*!
+         * Feeds received data to the pending responses, completing each one as it ends.
+         *
+         * @return False if the connection can't be used any more, true otherwise.
+         */
+        bool feed(Connection &connection, const char *data, size_t size);
+
+        /*!
+         * Closes a connection. Requests which were sent on it and never answered are either
+         * queued to be sent again, or failed with the given status.
+         *
+         * @param graceful True if the server said that it was closing the connection, in which case
+         * it didn't act on the unanswered requests, and they can all be sent again.
+         */
+        void close(Connection &connection, Socket::Status status, bool graceful);
+
+        SocketSelector selector;
+        std::unordered_map<std::string, std::unique_ptr<Connection>> connections;
+        std::vector<Completion> completions;
+        size_t outstanding;
+        size_t max_pipeline_depth;
+        std::chrono::seconds connect_timeout;
+    };
+}
+
+#endif //FRNETLIB_ASYNCHTTPCLIENT_H
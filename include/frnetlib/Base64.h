@@ -19,9 +19,33 @@ namespace fr
          */
         static std::string encode(const std::string &input);
 
-        //There's no decode function at the moment. Maybe I'll write one eventually. Sorry.
-    private:
+        /*!
+         * Encodes data into Base64
+         *
+         * @param data The data to encode
+         * @param size The number of bytes of data
+         * @return The resulting encoded string
+         */
+        static std::string encode(const char *data, size_t size);
 
+        /*!
+         * Decodes Base64, which must be padded, and can't contain whitespace.
+         *
+         * @param data The Base64 to decode
+         * @param size The number of bytes of data
+         * @param out Where to append the decoded data. Only appended to on success.
+         * @return True on success, false if the input isn't valid Base64.
+         */
+        static bool decode(const char *data, size_t size, std::string &out);
+
+        /*!
+         * Decodes a Base64 string, which must be padded, and can't contain whitespace.
+         *
+         * @param input The Base64 to decode
+         * @param out Where to append the decoded data. Only appended to on success.
+         * @return True on success, false if the input isn't valid Base64.
+         */
+        static bool decode(const std::string &input, std::string &out);
     };
 }
 
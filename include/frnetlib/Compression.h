@@ -0,0 +1,131 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#ifndef FRNETLIB_COMPRESSION_H
+#define FRNETLIB_COMPRESSION_H
+
+#include <string>
+#include <memory>
+#include "Socket.h"
+
+struct z_stream_s;
+
+namespace fr
+{
+    class Inflater
+    {
+    public:
+        enum class Format
+        {
+            Zlib = 0, //RFC 1950 wrapped deflate ('deflate' content encoding)
+            Gzip = 1, //RFC 1952 wrapped deflate ('gzip' content encoding)
+            Raw = 2,  //Unwrapped RFC 1951 deflate
+            Auto = 3, //Detect Zlib or Gzip from the stream header
+        };
+
+        /*!
+         * Constructs an Inflater.
+         *
+         * @throws An std::runtime_error if zlib fails to initialise.
+         * @param format The wrapping used by the compressed stream.
+         * @param window_bits The base two logarithm of the window size, from 8 to 15. Must be at least
+         * as large as the one the data was compressed with. Uses (1 << window_bits) bytes, plus about 7KiB.
+         */
+        explicit Inflater(Format format = Format::Auto, uint8_t window_bits = 15);
+        ~Inflater();
+        Inflater(Inflater &&)=delete;
+        void operator=(Inflater &&)=delete;
+
+        /*!
+         * Copies another Inflater, including how far through its stream it is.
+         *
+         * @throws An std::runtime_error if zlib fails to copy the stream.
+         * @param other The Inflater to copy
+         */
+        Inflater(const Inflater &other);
+        void operator=(const Inflater &)=delete;
+
+        /*!
+         * Decompresses the next part of the stream, appending the output to 'out'.
+         * Can be called repeatedly as more compressed data arrives.
+         *
+         * @param data The compressed data to process
+         * @param datasz The number of bytes of compressed data
+         * @param out Where to append the decompressed data
+         * @param max_out The maximum number of bytes which may be appended to 'out'. Guards against decompression bombs.
+         * @return Status of the operation:
+         * 'NotEnoughData' if all input was consumed, and the stream expects more.
+         * 'Success' if the end of the compressed stream has been reached.
+         * 'MaxPacketSizeExceeded' if more than 'max_out' bytes would have been produced.
+         * 'ParseError' if the stream is corrupt.
+         */
+        Socket::Status inflate(const char *data, size_t datasz, std::string &out, size_t max_out);
+
+        /*!
+         * Checks if the end of the compressed stream has been reached.
+         *
+         * @return True if it has, false otherwise.
+         */
+        inline bool finished() const
+        {
+            return stream_ended;
+        }
+
+    private:
+        std::unique_ptr<z_stream_s> stream;
+        bool stream_ended;
+    };
+
+    class Deflater
+    {
+    public:
+        enum class Format
+        {
+            Zlib = 0, //RFC 1950 wrapped deflate ('deflate' content encoding)
+            Gzip = 1, //RFC 1952 wrapped deflate ('gzip' content encoding)
+            Raw = 2,  //Unwrapped RFC 1951 deflate
+        };
+
+        enum class Flush
+        {
+            None = 0,   //Let zlib decide how much output to produce
+            Sync = 1,   //Output everything so far, ending on a byte boundary with an empty stored block
+            Finish = 2, //Output everything, and end the stream
+        };
+
+        /*!
+         * Constructs a Deflater.
+         *
+         * @throws An std::runtime_error if zlib fails to initialise.
+         * @param format The wrapping to give the compressed stream.
+         * @param level The compression level, from 0 (none) to 9 (best). -1 for zlib's default.
+         * @param window_bits The base two logarithm of the window size, from 9 to 15.
+         * @param memory_level How much memory to use for the compression state, from 1 to 9.
+         * Together with window_bits, uses (1 << (window_bits + 2)) + (1 << (memory_level + 9)) bytes.
+         */
+        explicit Deflater(Format format = Format::Gzip, int level = -1, uint8_t window_bits = 15, uint8_t memory_level = 8);
+        ~Deflater();
+        Deflater(Deflater &&)=delete;
+        Deflater(const Deflater &)=delete;
+        void operator=(Deflater &&)=delete;
+        void operator=(const Deflater &)=delete;
+
+        /*!
+         * Compresses the next part of the stream, appending the output to 'out'.
+         * Can be called repeatedly as more data becomes available.
+         *
+         * @param data The data to compress
+         * @param datasz The number of bytes of data
+         * @param out Where to append the compressed data
+         * @param flush How much of the compressed data to output before returning
+         * @return 'Success' on success, 'Error' if the stream has already been finished.
+         */
+        Socket::Status deflate(const char *data, size_t datasz, std::string &out, Flush flush = Flush::None);
+
+    private:
+        std::unique_ptr<z_stream_s> stream;
+    };
+}
+
+#endif //FRNETLIB_COMPRESSION_H
@@ -0,0 +1,206 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#ifndef FRNETLIB_HPACK_H
+#define FRNETLIB_HPACK_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <cstdint>
+
+namespace fr
+{
+    /*!
+     * HPACK (RFC 7541) header compression, as used by HTTP/2.
+     * Holds the parts shared by HpackEncoder and HpackDecoder.
+     */
+    class Hpack
+    {
+    public:
+        typedef std::pair<std::string, std::string> Header;
+        typedef std::vector<Header> HeaderList;
+
+        static constexpr uint32_t DEFAULT_TABLE_SIZE = 4096; //The initial dynamic table size of both peers
+        static constexpr uint32_t ENTRY_OVERHEAD = 32; //Bytes added to the size of each dynamic table entry
+
+        /*!
+         * Appends an integer encoded with an N-bit prefix.
+         *
+         * @param value The value to encode
+         * @param prefix_bits The number of bits available in the first byte (1-8)
+         * @param flags The bits to set above the prefix in the first byte
+         * @param out Where to append the encoded integer
+         */
+        static void encode_integer(uint64_t value, uint8_t prefix_bits, uint8_t flags, std::string &out);
+
+        /*!
+         * Decodes an integer encoded with an N-bit prefix.
+         *
+         * @param pos The position to read from. Advanced past the integer on success.
+         * @param end The end of the input
+         * @param prefix_bits The number of bits used by the integer in the first byte (1-8)
+         * @param value Where to store the value
+         * @return True on success, false if the input is truncated or the value overflows.
+         */
+        static bool decode_integer(const uint8_t *&pos, const uint8_t *end, uint8_t prefix_bits, uint64_t &value);
+
+        /*!
+         * Appends the Huffman encoding of a string.
+         *
+         * @param data The string to encode
+         * @param size The length of the string
+         * @param out Where to append the encoded data
+         */
+        static void huffman_encode(const char *data, size_t size, std::string &out);
+
+        /*!
+         * Gets the number of bytes that huffman_encode() would produce.
+         *
+         * @param data The string to measure
+         * @param size The length of the string
+         * @return The encoded size in bytes
+         */
+        static size_t huffman_encoded_size(const char *data, size_t size);
+
+        /*!
+         * Decodes a Huffman encoded string.
+         *
+         * @param data The encoded data
+         * @param size The number of bytes of encoded data
+         * @param out Where to append the decoded string
+         * @return True on success, false if the encoding is invalid (bad padding, or an EOS symbol).
+         */
+        static bool huffman_decode(const char *data, size_t size, std::string &out);
+
+    protected:
+        /*!
+         * The dynamic table. Entries are added at the front, and evicted from the back.
+         */
+        class Table
+        {
+        public:
+            explicit Table(uint32_t max_size);
+
+            /*!
+             * Adds an entry, evicting older ones to make room. If the entry
+             * is larger than the table, the table is emptied instead.
+             */
+            void add(std::string name, std::string value);
+
+            /*!
+             * Changes the maximum size, evicting entries until the table fits.
+             */
+            void set_max_size(uint32_t size);
+
+            /*!
+             * Gets an entry by its HPACK index, which covers both the static and dynamic tables.
+             *
+             * @return The entry, or nullptr if the index is out of range.
+             */
+            const Header *get(uint64_t index) const;
+
+            /*!
+             * Searches both tables for a header.
+             *
+             * @param name_index Set to the index of the first entry with the same name, or 0 if there is none.
+             * @return The index of an exact match, or 0 if there is none.
+             */
+            uint64_t find(const std::string &name, const std::string &value, uint64_t &name_index) const;
+
+            inline uint32_t get_size() const
+            {
+                return size;
+            }
+
+            inline uint32_t get_max_size() const
+            {
+                return max_size;
+            }
+
+        private:
+            void evict(uint32_t required);
+
+            std::deque<Header> entries;
+            uint32_t size;
+            uint32_t max_size;
+        };
+    };
+
+    class HpackEncoder : public Hpack
+    {
+    public:
+        explicit HpackEncoder(uint32_t max_table_size = DEFAULT_TABLE_SIZE);
+
+        /*!
+         * Sets the maximum dynamic table size. Should be called when the peer's
+         * SETTINGS_HEADER_TABLE_SIZE changes. The change is signalled to the peer
+         * at the start of the next encoded block.
+         *
+         * @param size The table size the peer allows. The encoder never uses more than its initial size.
+         */
+        void set_max_table_size(uint32_t size);
+
+        /*!
+         * Encodes a list of headers into a header block. Names must be lowercase.
+         *
+         * Headers which are likely to contain credentials (authorization, and short cookies)
+         * are sent as never indexed, so they don't end up in any compression context.
+         *
+         * @param headers The headers to encode
+         * @param out Where to append the header block
+         */
+        void encode(const HeaderList &headers, std::string &out);
+
+    private:
+        static void encode_string(const std::string &str, std::string &out);
+
+        Table table;
+        uint32_t size_limit;
+        uint32_t min_pending_size;
+        bool size_update_pending;
+    };
+
+    class HpackDecoder : public Hpack
+    {
+    public:
+        /*!
+         * Constructs the decoder.
+         *
+         * @param max_table_size The dynamic table size advertised to the peer through SETTINGS_HEADER_TABLE_SIZE.
+         * @param max_header_list_size The maximum total size of a decoded header block, counted as in SETTINGS_MAX_HEADER_LIST_SIZE.
+         */
+        explicit HpackDecoder(uint32_t max_table_size = DEFAULT_TABLE_SIZE, size_t max_header_list_size = MAX_HTTP_HEADER_SIZE);
+
+        /*!
+         * Decodes a complete header block.
+         *
+         * @param data The header block
+         * @param size The size of the header block
+         * @param headers Where to append the decoded headers
+         * @return True on success. False if the block is malformed or too large, which
+         * is a connection error, as the dynamic table can no longer be trusted.
+         */
+        bool decode(const char *data, size_t size, HeaderList &headers);
+
+        /*!
+         * Gets the current size of the dynamic table, in HPACK units.
+         *
+         * @return The dynamic table size
+         */
+        inline uint32_t get_table_size() const
+        {
+            return table.get_size();
+        }
+
+    private:
+        bool decode_string(const uint8_t *&pos, const uint8_t *end, std::string &out);
+
+        Table table;
+        uint32_t size_limit;
+        size_t max_header_list_size;
+    };
+}
+
+#endif //FRNETLIB_HPACK_H
@@ -8,6 +8,7 @@
 #include <vector>
 #include <unordered_map>
 #include <set>
+#include <atomic>
 #include <iostream>
 #include <algorithm>
 #include "Socket.h"
@@ -182,6 +183,14 @@ namespace fr
         */
         std::string &header(std::string key);
 
+        /*!
+        * Returns a header's value, without creating it if it doesn't exist.
+        *
+        * @param key The name of the header
+        * @return The header's value, or an empty string if it doesn't exist.
+        */
+        const std::string &header(std::string key) const;
+
 
         /*!
          * Checks to see if a given GET variable exists
@@ -265,13 +274,43 @@ namespace fr
         static std::string url_encode(const std::string &str);
 
         /*!
-         * Decodes a URL encoded string.
+         * URL Encodes data, appending it to a buffer.
+         *
+         * @param data The data to URL encode
+         * @param size The number of bytes of data
+         * @param out The string to append the URL encoded data to
+         */
+        static void url_encode(const char *data, size_t size, std::string &out);
+
+        /*!
+         * Decodes a URL encoded string. Invalid escapes are left as they are.
          *
          * @param str The string to decode
          * @return The decoded string
          */
         static std::string url_decode(const std::string &str);
 
+        /*!
+         * Decodes URL encoded data, appending it to a buffer.
+         * Invalid escapes are left as they are.
+         *
+         * @param data The data to decode
+         * @param size The number of bytes of data
+         * @param out The string to append the decoded data to
+         * @return True if the data was valid. False if it contained a '%' which wasn't followed by two hex digits.
+         */
+        static bool url_decode(const char *data, size_t size, std::string &out);
+
+        /*!
+         * Decodes a URL encoded string in place. Doesn't allocate.
+         * Invalid escapes are left as they are.
+         *
+         * @param str The string to decode
+         * @param plus_as_space True to decode '+' as a space, as in form data. False to only decode percent escapes, as in paths.
+         * @return True if the string was valid. False if it contained a '%' which wasn't followed by two hex digits.
+         */
+        static bool url_decode_in_place(std::string &str, bool plus_as_space = true);
+
         /*!
          * Gets the mimetype of a given filename, or file extention.
          *
@@ -287,20 +326,7 @@ namespace fr
          * @param encoding String to convert.
          * @return The encoding type, or TransferEncoding::None if no match was found
          */
-        static TransferEncoding string_to_transfer_encoding(std::string encoding)
-        {
-            static_assert((uint32_t)TransferEncoding::EncodingCount == 6, "Update transfer_encoding_to_string");
-            const static std::unordered_map<std::string, TransferEncoding> string_list = {{"none", TransferEncoding::None},
-                                                                                          {"chunked", TransferEncoding::Chunked},
-                                                                                          {"compress", TransferEncoding::Compress},
-                                                                                          {"deflate", TransferEncoding::Deflate},
-                                                                                          {"gzip", TransferEncoding::Gzip},
-                                                                                          {"identity", TransferEncoding::Identity}};
-
-            std::transform(encoding.begin(), encoding.end(), encoding.begin(), tolower);
-            auto iter = string_list.find(encoding);
-            return iter == string_list.end() ? TransferEncoding::None : iter->second;
-        }
+        static TransferEncoding string_to_transfer_encoding(const std::string &encoding);
 
         /*!
          * Converts a 'RequestType' enum value to
@@ -309,46 +335,15 @@ namespace fr
          * @param type The RequestType to convert
          * @return The printable version of the enum value
          */
-        static std::string request_type_to_string(RequestType type)
-        {
-            static_assert((uint32_t)RequestType::RequestTypeCount == 5, "Update request_type_to_string");
-            const static std::string request_type_strings[(uint32_t)RequestType::RequestTypeCount] = {"GET",
-                                                                                                      "POST",
-                                                                                                      "PUT",
-                                                                                                      "DELETE",
-                                                                                                      "PATCH"};
-
-            if(type >= RequestType::RequestTypeCount)
-                return "UNKNOWN";
-            return request_type_strings[(uint32_t)type];
-        }
+        static const std::string &request_type_to_string(RequestType type);
 
         /*!
          * Converts a string value into a 'RequestType' enum value.
          *
-         * @param str The string to convert
+         * @param str The string to convert. Only the start of it needs to be the request type.
          * @return The converted RequestType. Unknown on failure. Or Partial if str is part of a request type.
          */
-        static RequestType string_to_request_type(const std::string &str)
-        {
-            //Find the request type
-            static_assert((uint32_t)Http::RequestType::RequestTypeCount == 5, "Update parse_header_type()");
-
-            RequestType type = Http::RequestType::Unknown;
-            for(size_t a = 0; a < (uint32_t)Http::RequestType::RequestTypeCount; ++a)
-            {
-                std::string type_string = request_type_to_string(static_cast<RequestType>(a));
-                int cmp_ret = str.compare(0, type_string.size(), type_string);
-                if(cmp_ret == 0)
-                    return static_cast<RequestType>(a);
-                if(str.size() < type_string.size() && cmp_ret < 0)
-                    type = Http::RequestType::Partial;
-                if(type != Http::RequestType::Partial && str.size() < type_string.size() && cmp_ret > 0)
-                    type = Http::RequestType::Unknown;
-            }
-
-            return type;
-        }
+        static RequestType string_to_request_type(const std::string &str);
 
         /*!
          * Overridable send, to allow
@@ -384,14 +379,34 @@ namespace fr
         static std::vector<std::string> split_string(const std::string &str, char token = '\n', bool strip_spacing = false);
 
         /*!
-         * Converts a parameter list to a vector pair.
-         * i.e: ?bob=10&fish=hey
+         * Parses a parameter list into a map, lowercasing the names.
+         * i.e: bob=10&fish=hey
          * to: <bob, 10>, <fish, hey>
          *
-         * @param str The string to parse
-         * @return The vector containing the results pairs
+         * @param begin The start of the list
+         * @param end The end of the list
+         * @param out Where to store the arguments
+         * @param overwrite True if later arguments should replace earlier ones with the same name, false to keep the first.
          */
-        static std::vector<std::pair<std::string, std::string>> parse_argument_list(const std::string &str);
+        static void parse_argument_list(const char *begin, const char *end, std::unordered_map<std::string, std::string> &out, bool overwrite);
+
+        /*!
+         * Parses the query string and form body, if they've been received but not yet needed.
+         * Const accessors can call this from several threads at once, so only one of them does the parsing.
+         */
+        inline void parse_pending_arguments() const
+        {
+            if(arguments_pending.value.load(std::memory_order_acquire) != ArgumentState::Parsed)
+                parse_pending_arguments_slow();
+        }
+
+        /*!
+         * Notes that a received query string or form needs parsing, once pending_query or pending_form has been set.
+         */
+        inline void set_arguments_pending()
+        {
+            arguments_pending.value.store(ArgumentState::Pending, std::memory_order_relaxed);
+        }
 
         /*!
          * Parses a header line in a HTTP request/response
@@ -404,8 +419,10 @@ namespace fr
 
         //Other request info
         std::unordered_map<std::string, std::string> header_data;
-        std::unordered_map<std::string, std::string> post_data;
-        std::unordered_map<std::string, std::string> get_data;
+        mutable std::unordered_map<std::string, std::string> post_data;
+        mutable std::unordered_map<std::string, std::string> get_data;
+        mutable std::string pending_query; //A received query string, which is parsed into get_data on first access
+        mutable bool pending_form; //True if 'body' is a received form, which is parsed into post_data on first access
         std::set<TransferEncoding> transfer_encodings;
         std::string body;
         RequestType request_type;
@@ -413,6 +430,38 @@ namespace fr
         RequestStatus status;
         RequestVersion version;
 
+    private:
+        enum ArgumentState : uint8_t
+        {
+            Parsed = 0, //Nothing's waiting to be parsed
+            Pending = 1, //pending_query or pending_form need parsing
+            Parsing = 2, //A reader is parsing them, and the others wait for it
+        };
+
+        //An atomic ArgumentState, which is copied as a plain value along with the rest of the object. A copy
+        //has nobody parsing it, so it never starts out as Parsing.
+        struct PendingFlag
+        {
+            PendingFlag() : value(ArgumentState::Parsed) {}
+            PendingFlag(const PendingFlag &other) : value(copy_state(other)) {}
+            PendingFlag &operator=(const PendingFlag &other)
+            {
+                value = copy_state(other);
+                return *this;
+            }
+
+            static ArgumentState copy_state(const PendingFlag &other)
+            {
+                auto state = other.value.load();
+                return state == ArgumentState::Parsing ? ArgumentState::Pending : state;
+            }
+
+            std::atomic<ArgumentState> value;
+        };
+
+        void parse_pending_arguments_slow() const;
+
+        mutable PendingFlag arguments_pending; //Whether pending_query and pending_form have been parsed yet
     };
 }
 
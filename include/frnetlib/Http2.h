@@ -0,0 +1,332 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#ifndef FRNETLIB_HTTP2_H
+#define FRNETLIB_HTTP2_H
+
+#include <string>
+#include <deque>
+#include <unordered_map>
+#include "Socket.h"
+#include "Hpack.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+
+namespace fr
+{
+    /*!
+     * An HTTP/2 (RFC 7540) connection, running over an already connected socket.
+     *
+     * Requests and responses are exchanged as the usual HttpRequest/HttpResponse objects, so
+     * existing handlers work unchanged. Many requests can be in flight at once, each on its
+     * own stream, and responses can be sent in any order.
+     *
+     * The connection can be established with prior knowledge (Http2Connection::handshake()),
+     * through ALPN "h2" on an SSLSocket (see SSLListener::set_alpn_protocols), or on the
+     * server by upgrading an HTTP/1.1 request which asks for h2c (Http2Connection::upgrade()).
+     *
+     * Server push isn't supported, and is disabled when acting as a client.
+     *
+     * @note This isn't thread safe. The socket may be non-blocking, in which case the receive
+     * functions return WouldBlock until a whole request/response has arrived, and the send functions
+     * return WouldBlock if the socket couldn't take everything. What's left is kept, and sent by
+     * flush() once the socket's writable, or along with whatever's sent next.
+     */
+    class Http2Connection
+    {
+    public:
+        enum class Role
+        {
+            Client = 0,
+            Server = 1,
+        };
+
+        enum class ErrorCode : uint32_t
+        {
+            NoError = 0x0,
+            ProtocolError = 0x1,
+            InternalError = 0x2,
+            FlowControlError = 0x3,
+            SettingsTimeout = 0x4,
+            StreamClosed = 0x5,
+            FrameSizeError = 0x6,
+            RefusedStream = 0x7,
+            Cancel = 0x8,
+            CompressionError = 0x9,
+            ConnectError = 0xa,
+            EnhanceYourCalm = 0xb,
+            InadequateSecurity = 0xc,
+            Http11Required = 0xd,
+        };
+
+        /*!
+         * Constructs the connection.
+         *
+         * @param socket The connected socket to use. Must outlive the connection.
+         * @param role Whether this end is the client or the server.
+         */
+        Http2Connection(Socket &socket, Role role);
+        Http2Connection(Http2Connection &&)=delete;
+        Http2Connection(const Http2Connection &)=delete;
+        void operator=(Http2Connection &&)=delete;
+        void operator=(const Http2Connection &)=delete;
+
+        /*!
+         * Starts the connection with prior knowledge that the peer speaks HTTP/2,
+         * or after "h2" has been negotiated through ALPN.
+         *
+         * Clients send the connection preface along with their settings. Servers send
+         * their settings, and then expect the client preface as the first thing received.
+         *
+         * @return The status of the send. Success on success.
+         */
+        Socket::Status handshake();
+
+        /*!
+         * Checks if an HTTP/1.1 request is asking to upgrade to HTTP/2 over cleartext (h2c).
+         *
+         * @param request The request to check
+         * @return True if it is, false otherwise.
+         */
+        static bool is_upgrade_request(const HttpRequest &request);
+
+        /*!
+         * Server only. Accepts an h2c upgrade request, switching the connection to HTTP/2.
+         *
+         * The upgrade request itself becomes stream 1, and will be the first
+         * request returned by receive_request(). The client's HTTP2-Settings
+         * header is applied as if it had been sent in a SETTINGS frame.
+         *
+         * @param request The HTTP/1.1 request which asked to upgrade. See is_upgrade_request().
+         * @return The status of the send. Success on success.
+         */
+        Socket::Status upgrade(const HttpRequest &request);
+
+        /*!
+         * Server only. Receives the next complete request from the client.
+         *
+         * @param request Where to store the request
+         * @param stream_id Where to store the ID of the request's stream. Pass this to send_response().
+         * @return The status of the operation:
+         * 'Success' if a request was received.
+         * 'WouldBlock' if the socket is non-blocking and no complete request has arrived yet.
+         * 'Disconnected' if the connection has been closed, or the client sent GOAWAY.
+         * 'ParseError' if the client broke the protocol. The connection has been closed with GOAWAY.
+         * Other socket errors on failure.
+         */
+        Socket::Status receive_request(HttpRequest &request, uint32_t &stream_id);
+
+        /*!
+         * Server only. Sends the response to a request, closing its stream.
+         * Blocks while the client's flow control window is full.
+         *
+         * @param stream_id The stream of the request being responded to
+         * @param response The response to send
+         * @return The status of the operation:
+         * 'Success' on success.
+         * 'WouldBlock' if the socket is non-blocking, and the end of the response is still waiting to be sent by flush().
+         * 'Error' if the stream doesn't exist, or was reset by the client. The connection is still usable.
+         * Other socket errors on failure.
+         */
+        Socket::Status send_response(uint32_t stream_id, const HttpResponse &response);
+
+        /*!
+         * Client only. Sends a request on a new stream. More requests can be sent
+         * before the response to this one has been received.
+         *
+         * @param request The request to send. Its host header (or the socket's remote address) becomes the :authority.
+         * @param stream_id Where to store the ID of the new stream. Pass this to receive_response().
+         * @return The status of the operation:
+         * 'Success' on success.
+         * 'WouldBlock' if the socket is non-blocking, and the end of the request is still waiting to be sent by flush().
+         * 'Disconnected' if the server has sent GOAWAY, or the stream IDs have been exhausted.
+         * Other socket errors on failure.
+         */
+        Socket::Status send_request(const HttpRequest &request, uint32_t &stream_id);
+
+        /*!
+         * Client only. Receives the response to a request sent by send_request().
+         * Responses to other streams which arrive in the meantime are kept for later.
+         *
+         * @param stream_id The stream to receive the response of
+         * @param response Where to store the response
+         * @return The status of the operation:
+         * 'Success' if the response was received.
+         * 'WouldBlock' if the socket is non-blocking and the response hasn't fully arrived yet.
+         * 'Error' if the stream doesn't exist, or was reset or refused by the server.
+         * 'HttpBodyTooBig' if the response body exceeded MAX_HTTP_BODY_SIZE, in which case the stream was reset.
+         * 'ParseError' if the server broke the protocol. The connection has been closed with GOAWAY.
+         * Other socket errors on failure.
+         */
+        Socket::Status receive_response(uint32_t stream_id, HttpResponse &response);
+
+        /*!
+         * Gracefully closes the connection by sending GOAWAY. The socket is left connected.
+         *
+         * @param error The reason for closing.
+         * @return The status of the send.
+         */
+        Socket::Status close(ErrorCode error = ErrorCode::NoError);
+
+        /*!
+         * Receives whatever is available from the socket, and processes any complete frames.
+         * The receive functions call this as needed, but it can also be called to respond to
+         * pings and flow control updates while the connection is otherwise idle.
+         *
+         * @return The status of the receive. Success if anything was received.
+         */
+        Socket::Status process();
+
+        /*!
+         * Sends whatever's left over from an earlier call which returned WouldBlock.
+         *
+         * @return 'Success' once everything's been sent. 'WouldBlock' if the socket still can't take all of it,
+         * in which case call this again once it's writable. Other socket errors on failure.
+         */
+        Socket::Status flush();
+
+        /*!
+         * Checks if anything's waiting to be sent, because the socket couldn't take it when it was queued.
+         *
+         * @return True if flush() needs to be called, false otherwise.
+         */
+        inline bool has_pending_output() const
+        {
+            return !output.empty();
+        }
+
+    private:
+        enum class FrameType : uint8_t
+        {
+            Data = 0x0,
+            Headers = 0x1,
+            Priority = 0x2,
+            RstStream = 0x3,
+            Settings = 0x4,
+            PushPromise = 0x5,
+            Ping = 0x6,
+            GoAway = 0x7,
+            WindowUpdate = 0x8,
+            Continuation = 0x9,
+        };
+
+        struct Stream
+        {
+            explicit Stream(int64_t send_window_, int64_t receive_window_)
+            : send_window(send_window_),
+              receive_window(receive_window_),
+              receive_consumed(0),
+              headers_received(false),
+              end_stream_pending(false),
+              remote_closed(false),
+              error(Socket::Status::Success)
+            {}
+
+            int64_t send_window;
+            int64_t receive_window;
+            uint32_t receive_consumed; //Bytes received since the last WINDOW_UPDATE
+            std::string header_block; //Header block fragments, until END_HEADERS
+            Hpack::HeaderList headers;
+            std::string body;
+            bool headers_received;
+            bool end_stream_pending; //END_STREAM was set on a HEADERS frame still awaiting CONTINUATION
+            bool remote_closed; //The peer has sent END_STREAM
+            Socket::Status error; //Set if the stream was reset
+        };
+
+        /*!
+         * Handles a single complete frame.
+         *
+         * @return Success, or an error if the connection must be closed.
+         */
+        Socket::Status handle_frame(FrameType type, uint8_t flags, uint32_t stream_id, const uint8_t *payload, uint32_t length);
+        Socket::Status handle_data(uint8_t flags, uint32_t stream_id, const uint8_t *payload, uint32_t length);
+        Socket::Status handle_headers(uint8_t flags, uint32_t stream_id, const uint8_t *payload, uint32_t length);
+        Socket::Status handle_header_block_end(uint32_t stream_id);
+        Socket::Status handle_settings(uint8_t flags, uint32_t stream_id, const uint8_t *payload, uint32_t length);
+        Socket::Status handle_window_update(uint32_t stream_id, const uint8_t *payload, uint32_t length);
+
+        /*!
+         * Applies the contents of a SETTINGS frame.
+         *
+         * @return NoError, or the connection error to report.
+         */
+        ErrorCode apply_settings(const uint8_t *payload, size_t length);
+
+        /*!
+         * Called once a stream's request/response has fully arrived.
+         */
+        void on_stream_complete(uint32_t stream_id);
+
+        /*!
+         * Converts the headers and body received on a stream into an HttpRequest.
+         *
+         * @return Ok on success. BadRequest if the request is malformed, or NotImplemented if its method isn't supported.
+         */
+        Http::RequestStatus build_request(Stream &stream, HttpRequest &request);
+
+        /*!
+         * Converts the headers and body received on a stream into an HttpResponse.
+         *
+         * @return True on success, false if the response is malformed.
+         */
+        bool build_response(Stream &stream, HttpResponse &response);
+
+        /*!
+         * Queues a message's header block on a stream, splitting it into CONTINUATION frames where needed.
+         */
+        void queue_headers(uint32_t stream_id, const Hpack::HeaderList &headers, bool end_stream);
+
+        /*!
+         * Sends a message body on a stream, respecting flow control. Ends the stream.
+         */
+        Socket::Status send_body(uint32_t stream_id, const char *data, size_t size);
+
+        void queue_frame(FrameType type, uint8_t flags, uint32_t stream_id, const char *payload, size_t length);
+        void queue_rst_stream(uint32_t stream_id, ErrorCode error);
+        void queue_window_update(uint32_t stream_id, uint32_t increment);
+
+        /*!
+         * Waits for the socket to become readable, or writable if there's output left to send, for
+         * up to the socket's receive timeout. Used where a non-blocking socket has to be waited on.
+         *
+         * @return 'Success' when the socket's ready, 'Timeout' if it didn't become ready in time.
+         */
+        Socket::Status wait_for_socket();
+
+        /*!
+         * Sends GOAWAY, and marks the connection as closed.
+         *
+         * @return ParseError, for the caller to return.
+         */
+        Socket::Status connection_error(ErrorCode error);
+
+        Socket &socket;
+        Role role;
+        std::string scheme;
+        HpackEncoder encoder;
+        HpackDecoder decoder;
+        std::string input;
+        size_t input_offset;
+        std::string output;
+        std::unordered_map<uint32_t, Stream> streams;
+        std::deque<std::pair<uint32_t, HttpRequest>> requests; //Complete requests awaiting receive_request()
+        uint32_t next_stream_id; //The next stream ID to use for a request
+        uint32_t last_peer_stream_id; //The highest stream ID opened by the peer
+        uint32_t continuation_stream; //The stream awaiting CONTINUATION frames, or 0
+        std::string orphan_header_block; //A header block for a stream which has already been closed
+        int64_t connection_send_window;
+        int64_t connection_receive_window;
+        uint32_t connection_receive_consumed;
+        uint32_t peer_initial_window_size;
+        uint32_t peer_max_frame_size;
+        uint32_t peer_max_concurrent_streams;
+        bool preface_received;
+        bool settings_received;
+        bool goaway_received;
+        bool closed;
+    };
+}
+
+#endif //FRNETLIB_HTTP2_H
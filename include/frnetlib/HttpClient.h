@@ -0,0 +1,201 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#ifndef FRNETLIB_HTTPCLIENT_H
+#define FRNETLIB_HTTPCLIENT_H
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include "Socket.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "URL.h"
+
+namespace fr
+{
+    class SSLContext;
+    class Resolver;
+
+    /*!
+     * An HTTP/1.1 client which keeps connections alive between requests.
+     *
+     * Connections are pooled per scheme, host and port. When a request completes
+     * and the server allows it, the connection is kept for the next request to
+     * the same host, which saves the TCP (and TLS) handshake. Idle connections are
+     * dropped after set_idle_timeout(), and are checked to still be open before
+     * being reused.
+     *
+     * One client can be shared between any number of threads.
+     */
+    class HttpClient
+    {
+    public:
+        /*!
+         * Constructs the client.
+         *
+         * @param ssl_context The SSL context to use for https URLs. Only needed if frnetlib is built with USE_SSL,
+         * and https URLs will be requested.
+         */
+        explicit HttpClient(std::shared_ptr<SSLContext> ssl_context = nullptr);
+        HttpClient(HttpClient &&)=delete;
+        HttpClient(const HttpClient &)=delete;
+        void operator=(HttpClient &&)=delete;
+        void operator=(const HttpClient &)=delete;
+
+        /*!
+         * Sends a request, and receives the response.
+         *
+         * If there's an idle connection to the URL's host, then it's used. Otherwise a
+         * new one is opened, unless the host already has set_max_connections_per_host()
+         * connections in use, in which case this waits for one of them to become free.
+         *
+         * If a pooled connection turns out to have been closed by the server before any of the
+         * response arrived, then GET, PUT and DELETE requests are sent again on another connection.
+         * Other requests aren't, as the server might have acted on them, so the error is returned.
+         *
+         * @param url The URL to request. Its path and query (if it has any) replace the request's URI.
+         * @param request The request to send. A host header is added if it doesn't have one.
+         * @param response Where to store the response. If it has a body sink set, then the body is streamed to it,
+         * and the sink can check the response's status and headers, which are parsed by the time it's called.
+         * @return The status of the operation:
+         * 'Success' if the response was received.
+         * 'SSLError' if the URL is https, but there's no SSL support, or no SSL context.
+         * 'Error' if the URL's scheme isn't http or https.
+         * Other socket or parse errors on failure.
+         */
+        Socket::Status request(const URL &url, HttpRequest request, HttpResponse &response);
+
+        /*!
+         * Sets the maximum number of connections which can be open to a single host at once,
+         * including those in use. Defaults to 6.
+         *
+         * @param max The maximum number of connections. Must be at least 1.
+         */
+        void set_max_connections_per_host(size_t max);
+
+        /*!
+         * Sets how long a connection can sit unused in the pool before it's closed. Defaults to 60 seconds.
+         *
+         * @param timeout The idle timeout
+         */
+        void set_idle_timeout(std::chrono::milliseconds timeout);
+
+        /*!
+         * Sets the timeout which applies when opening new connections.
+         *
+         * @param timeout The connect timeout. Pass {} for the default.
+         */
+        void set_connect_timeout(std::chrono::seconds timeout);
+
+        /*!
+         * Sets the resolver to look up hosts with, when opening new connections, so that
+         * their addresses can be cached. By default, hosts are looked up on every connect.
+         *
+         * @param resolver The resolver to use. Can be shared with other clients. nullptr for none.
+         */
+        void set_resolver(std::shared_ptr<Resolver> resolver);
+
+        /*!
+         * Sets the receive timeout which is applied to new connections.
+         *
+         * @param timeout The receive timeout in milliseconds. 0 (default) for none.
+         */
+        void set_receive_timeout(uint32_t timeout);
+
+        /*!
+         * Closes all idle connections. Connections in use are unaffected.
+         */
+        void close_idle_connections();
+
+        /*!
+         * Gets the number of idle connections in the pool.
+         *
+         * @return The number of idle connections, across all hosts.
+         */
+        size_t get_idle_connection_count() const;
+
+        /*!
+         * Fills in a request from the URL it's going to, before it's sent.
+         *
+         * @param url The URL being requested. Its path and query (if it has any) replace the request's URI.
+         * @param request The request to fill in. A host header is added if it doesn't have one.
+         */
+        static void prepare_request(const URL &url, HttpRequest &request);
+
+        /*!
+         * Checks if a connection can be reused after a response, going by its headers.
+         */
+        static bool is_reusable(const HttpRequest &request, const HttpResponse &response);
+
+        /*!
+         * Checks if sending a request twice has the same effect as sending it once, so that
+         * it can be sent again if the connection closes before it's answered.
+         */
+        static bool is_idempotent(Http::RequestType type);
+
+    private:
+        struct Connection
+        {
+            std::unique_ptr<Socket> socket;
+            std::chrono::steady_clock::time_point last_used;
+        };
+
+        struct Host
+        {
+            std::vector<Connection> idle; //Most recently used at the back
+            size_t open = 0; //Connections which are idle or in use
+        };
+
+        /*!
+         * Takes an idle connection to a host from the pool, or opens a new one.
+         *
+         * @param key The pool key of the host
+         * @param url The URL being requested
+         * @param connection Where to store the connection
+         * @param reused Set to true if the connection was already open, false if it's new.
+         * @return The status of the connect, if a new connection was opened.
+         */
+        Socket::Status checkout(const std::string &key, const URL &url, Connection &connection, bool &reused);
+
+        /*!
+         * Returns a connection to the pool, or closes it if it can't be reused.
+         */
+        void checkin(const std::string &key, Connection connection, bool reusable);
+
+        /*!
+         * Opens a new connection to a URL's host.
+         */
+        Socket::Status open_connection(const URL &url, std::chrono::seconds timeout, uint32_t socket_receive_timeout, Resolver *host_resolver, Connection &connection);
+
+        /*!
+         * Sends a request on a connection, and receives the response.
+         *
+         * @param received Set to true if any of the response was received.
+         */
+        Socket::Status exchange(Socket &socket, const HttpRequest &request, HttpResponse &response, bool &received);
+
+        /*!
+         * Checks if an idle connection is still usable. An idle connection which is readable
+         * has either been closed by the server, or has unexpected data waiting on it.
+         */
+        static bool is_healthy(const Socket &socket);
+
+        std::shared_ptr<SSLContext> ssl_context;
+        std::shared_ptr<Resolver> resolver;
+        mutable std::mutex mutex;
+        std::condition_variable connection_released;
+        std::unordered_map<std::string, Host> hosts;
+        size_t max_connections_per_host;
+        std::chrono::milliseconds idle_timeout;
+        std::chrono::seconds connect_timeout;
+        uint32_t receive_timeout;
+    };
+}
+
+#endif //FRNETLIB_HTTPCLIENT_H
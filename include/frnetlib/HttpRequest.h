@@ -7,8 +7,10 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <memory>
 #include "TcpSocket.h"
 #include "Http.h"
+#include "MultipartParser.h"
 
 namespace fr
 {
@@ -41,6 +43,19 @@ namespace fr
          */
         std::string construct(const std::string &host) const override;
 
+        /*!
+         * Sets a parser to stream multipart bodies (such as multipart/form-data uploads) into.
+         *
+         * If the request has a multipart content type, then the body is passed to the parser
+         * as it's received, instead of being stored. get_body() will be empty, POST data won't
+         * be parsed, and MAX_HTTP_BODY_SIZE doesn't apply. parse() returns Success once
+         * the closing boundary (and the rest of the content length) has been received.
+         * Requests with other content types are parsed as usual.
+         *
+         * @param parser The parser to use. Its boundary is set from the request's content type.
+         */
+        void set_multipart_parser(std::shared_ptr<MultipartParser> parser);
+
     private:
         /*!
          * Parses the request header.
@@ -50,11 +65,6 @@ namespace fr
          */
         bool parse_header(int64_t header_end_pos);
 
-        /*!
-         * Parses the POST data from the body
-         */
-        void parse_post_body();
-
         /*!
          * Parses the header type (GET/POST) from the given string.
          *
@@ -70,9 +80,21 @@ namespace fr
          */
         void parse_header_uri(const std::string &str);
 
+        /*!
+         * Passes the next part of a multipart body to the multipart parser.
+         *
+         * @param data The body data received
+         * @param datasz The number of bytes of data
+         * @return The status of the parse, as with parse().
+         */
+        fr::Socket::Status parse_multipart_body(const char *data, size_t datasz);
+
         //State
         bool header_ended;
         size_t content_length;
+        std::shared_ptr<MultipartParser> multipart_parser;
+        bool multipart_streaming;
+        size_t multipart_received;
 
     };
 }
@@ -8,13 +8,25 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <memory>
+#include <functional>
 #include "Http.h"
 
 namespace fr
 {
+    class Inflater;
     class HttpResponse : public Http
     {
     public:
+        /*!
+         * Receives a response body as it arrives.
+         *
+         * @param data The next piece of the body, after de-chunking and decoding
+         * @param size The size of data in bytes
+         * @return True to carry on, false to abort the parse, which then returns 'Error'.
+         */
+        using BodySink = std::function<bool(const char *data, size_t size)>;
+
         //Constructors
         HttpResponse()=default;
         HttpResponse(HttpResponse&&)=default;
@@ -39,6 +51,82 @@ namespace fr
          */
         std::string construct(const std::string &host) const override;
 
+        /*!
+         * Enables or disables transparent decoding of 'gzip' and 'deflate'
+         * Content-Encodings while parsing. The body is inflated incrementally as data
+         * arrives, and the decoded size is held to MAX_HTTP_BODY_SIZE.
+         *
+         * Once decoded, the 'content-encoding' and 'content-length' headers are removed,
+         * as they no longer describe the body. Remember to advertise support to the server,
+         * with 'accept-encoding: gzip, deflate' in the request.
+         *
+         * @note Requires frnetlib to be built with USE_ZLIB, otherwise bodies are left encoded.
+         * @param should_decode True to decode the body, false to store it verbatim (default).
+         */
+        inline void set_content_decoding(bool should_decode)
+        {
+            decode_content = should_decode;
+        }
+
+        /*!
+         * Checks if transparent Content-Encoding decoding is enabled.
+         *
+         * @return True if it is, false otherwise.
+         */
+        inline bool get_content_decoding() const
+        {
+            return decode_content;
+        }
+
+        /*!
+         * Checks if the end of the body was marked by a 'content-length' or chunked encoding,
+         * rather than by the server closing the connection. This is still known once decoding
+         * has removed the 'content-length' header.
+         *
+         * @return True if the body's length was given, false otherwise.
+         */
+        inline bool is_length_delimited() const
+        {
+            return length_delimited;
+        }
+
+        /*!
+         * Gets any data which was received after the end of the response. Once parse()
+         * has returned Success, this is the start of whatever came next on the connection,
+         * such as the next response if requests were pipelined.
+         *
+         * @return The data received after the end of the response
+         */
+        inline const std::string &get_excess_data() const
+        {
+            return excess_data;
+        }
+
+        /*!
+         * Streams the body to a sink while parsing, instead of storing it. The body is passed
+         * on piece by piece as it arrives, after being de-chunked and decoded (if enabled), so it's
+         * no longer held to MAX_HTTP_BODY_SIZE, and get_body() stays empty. Memory use is the same
+         * no matter how big the body is.
+         *
+         * Must be set before parsing starts.
+         *
+         * @param sink The sink to pass the body to. Or nullptr to store it as usual (default).
+         */
+        inline void set_body_sink(BodySink sink)
+        {
+            body_sink = std::move(sink);
+        }
+
+        /*!
+         * Gets the sink that the body is being streamed to, if any.
+         *
+         * @return The body sink. Empty if the body is being stored.
+         */
+        inline const BodySink &get_body_sink() const
+        {
+            return body_sink;
+        }
+
     private:
         /*!
          * Parses the request header.
@@ -47,10 +135,48 @@ namespace fr
          */
         bool parse_header(size_t header_end_pos);
 
+        /*!
+         * Inflates the body between decoded_offset and payload_end in place.
+         *
+         * @param payload_end The position in 'body' where the received payload ends.
+         * @return Success on success, HttpBodyTooBig/ParseError on failure.
+         */
+        fr::Socket::Status inflate_body(size_t payload_end);
+
+        /*!
+         * Passes the start of the body on to the body sink, and removes it, if there is a sink.
+         *
+         * @param end The position in 'body' up to which the body is ready
+         * @return False if the sink aborted the parse, true otherwise.
+         */
+        bool drain_body(size_t end);
+
+        //The decoder for the body. Copies get their own clone of it, rather than sharing one zlib stream.
+        //It's a shared_ptr so that nothing here needs Inflater's definition, which only exists with zlib.
+        struct InflaterPtr
+        {
+            InflaterPtr()=default;
+            InflaterPtr(InflaterPtr &&)=default;
+            InflaterPtr(const InflaterPtr &other);
+            InflaterPtr &operator=(InflaterPtr &&)=default;
+            InflaterPtr &operator=(const InflaterPtr &other);
+
+            std::shared_ptr<Inflater> value;
+        };
+
         //State
         bool header_ended{false};
         size_t content_length{0};
+        bool length_delimited{false};
         size_t chunk_offset{0};
+        size_t chunk_remaining{0};
+        bool in_chunk{false};
+        bool decode_content{false};
+        size_t decoded_offset{0};
+        size_t content_received{0};
+        InflaterPtr inflater;
+        std::string excess_data;
+        BodySink body_sink;
     };
 }
 
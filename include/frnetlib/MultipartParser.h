@@ -0,0 +1,149 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#ifndef FRNETLIB_MULTIPARTPARSER_H
+#define FRNETLIB_MULTIPARTPARSER_H
+
+#include <string>
+#include <functional>
+#include <unordered_map>
+#include "Socket.h"
+
+namespace fr
+{
+    /*!
+     * A streaming multipart (RFC 2046, RFC 7578) body parser, for multipart/form-data uploads.
+     *
+     * Data is passed to callbacks as it arrives, rather than being stored, so memory use
+     * stays constant no matter how large the parts are. Boundaries are found with a
+     * Boyer-Moore-Horspool search, which skips over most of the data without looking at it.
+     *
+     * Attach it to an HttpRequest with HttpRequest::set_multipart_parser() to parse uploads
+     * as they're received, or feed it a body directly with parse().
+     */
+    class MultipartParser
+    {
+    public:
+        typedef std::unordered_map<std::string, std::string> Headers;
+        typedef std::function<void(const Headers &headers)> PartBeginCallback;
+        typedef std::function<void(const char *data, size_t size)> PartDataCallback;
+        typedef std::function<void()> PartEndCallback;
+
+        /*!
+         * Constructs the parser.
+         *
+         * @param boundary The boundary from the multipart content type. May be left empty, and set later with set_boundary().
+         */
+        explicit MultipartParser(const std::string &boundary = "");
+
+        /*!
+         * Sets the boundary which separates the parts, and resets the parser.
+         *
+         * @param boundary The boundary, without the leading "--". See get_parameter().
+         */
+        void set_boundary(const std::string &boundary);
+
+        /*!
+         * Sets the callback which is called at the start of each part.
+         *
+         * @param callback Called with the part's headers. Names are lowercase.
+         */
+        inline void on_part_begin(PartBeginCallback callback)
+        {
+            part_begin_callback = std::move(callback);
+        }
+
+        /*!
+         * Sets the callback which receives the data of the current part.
+         * This may be called any number of times per part.
+         *
+         * @param callback Called with the next piece of the part's data.
+         */
+        inline void on_part_data(PartDataCallback callback)
+        {
+            part_data_callback = std::move(callback);
+        }
+
+        /*!
+         * Sets the callback which is called at the end of each part.
+         *
+         * @param callback Called once all of a part's data has been passed to on_part_data.
+         */
+        inline void on_part_end(PartEndCallback callback)
+        {
+            part_end_callback = std::move(callback);
+        }
+
+        /*!
+         * Parses the next part of the body. Can be called repeatedly as more of it arrives.
+         *
+         * @param data The data to parse
+         * @param datasz The number of bytes of data
+         * @return Status of the parse:
+         * 'NotEnoughData' if the closing boundary hasn't been reached yet.
+         * 'Success' if the closing boundary has been reached. Anything after it is ignored.
+         * 'HttpHeaderTooBig' if a part's headers exceed MAX_HTTP_HEADER_SIZE.
+         * 'ParseError' if the body is malformed, or no boundary has been set.
+         */
+        Socket::Status parse(const char *data, size_t datasz);
+
+        /*!
+         * Checks if the closing boundary has been reached.
+         *
+         * @return True if it has, false otherwise.
+         */
+        inline bool finished() const
+        {
+            return state == State::Finished;
+        }
+
+        /*!
+         * Gets a parameter from a header value. Such as the boundary from a content-type,
+         * or the name and filename from a content-disposition:
+         *
+         *     multipart/form-data; boundary=abc
+         *     form-data; name="upload"; filename="photo.jpg"
+         *
+         * @param header_value The header value to search
+         * @param name The name of the parameter, which is matched case insensitively.
+         * @return The value of the parameter, with any quotes removed. Empty if it isn't present.
+         */
+        static std::string get_parameter(const std::string &header_value, const std::string &name);
+
+    private:
+        enum class State
+        {
+            Preamble = 0, //Before the first boundary
+            BoundaryEnd = 1, //After a boundary. Expecting "--" to finish, or CRLF for another part.
+            Headers = 2, //Receiving part headers
+            Data = 3, //Receiving part data
+            Finished = 4, //After the closing boundary
+        };
+
+        /*!
+         * Searches for the delimiter using Boyer-Moore-Horspool.
+         *
+         * @return The position of the delimiter in 'buffer', or std::string::npos if it's not there.
+         */
+        size_t find_delimiter(size_t offset) const;
+
+        /*!
+         * Parses a part's header block into headers, and begins the part.
+         *
+         * @param header_begin The position in 'buffer' of the part's first header
+         * @param header_end The position in 'buffer' of the blank line which ends the headers
+         */
+        void begin_part(size_t header_begin, size_t header_end);
+
+        std::string delimiter; //CRLF, "--", then the boundary
+        size_t skip_table[256];
+        State state;
+        std::string buffer;
+        PartBeginCallback part_begin_callback;
+        PartDataCallback part_data_callback;
+        PartEndCallback part_end_callback;
+    };
+}
+
+#endif //FRNETLIB_MULTIPARTPARSER_H
@@ -41,6 +41,7 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netdb.h>
+#include <poll.h>
 #endif
 
 
@@ -123,6 +124,16 @@ inline bool set_unix_socket_blocking(int32_t socket_descriptor, bool is_blocking
     return true;
 }
 
+inline int poll_sockets(pollfd *fds, size_t count, int timeout_ms)
+{
+    //Unlike select(), there's no limit on the descriptors' values
+#ifdef _WIN32
+    return WSAPoll(fds, (ULONG)count, timeout_ms);
+#else
+    return poll(fds, (nfds_t)count, timeout_ms);
+#endif
+}
+
 inline static void init_wsa()
 {
 #ifdef _WIN32
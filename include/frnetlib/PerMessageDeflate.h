@@ -0,0 +1,240 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#ifndef FRNETLIB_PERMESSAGEDEFLATE_H
+#define FRNETLIB_PERMESSAGEDEFLATE_H
+
+#include <string>
+#include <memory>
+#include "Socket.h"
+
+namespace fr
+{
+    /*!
+     * The permessage-deflate WebSocket extension (RFC 7692), which compresses the payloads of
+     * whole messages. Each connection has its own, which negotiates the extension's parameters in
+     * the handshake, and then holds the compression state for each direction.
+     *
+     * The compression state is only allocated whilst it's needed. If a direction has no context
+     * takeover, then its state is freed after each message, so idle connections cost nothing,
+     * at the expense of compressing each message on its own.
+     *
+     * @note Requires frnetlib to be built with USE_ZLIB, otherwise the extension is never negotiated.
+     */
+    class PerMessageDeflate
+    {
+    public:
+        PerMessageDeflate();
+        ~PerMessageDeflate();
+        PerMessageDeflate(PerMessageDeflate &&)=delete;
+        PerMessageDeflate(const PerMessageDeflate &)=delete;
+        void operator=(PerMessageDeflate &&)=delete;
+        void operator=(const PerMessageDeflate &)=delete;
+
+        /*!
+         * Sets whether the extension should be offered by clients, or accepted by servers. Disabled by default.
+         *
+         * @param enable True to negotiate compression, false not to.
+         */
+        inline void set_enabled(bool enable)
+        {
+            enabled = enable;
+        }
+
+        /*!
+         * Checks if the extension will be offered or accepted.
+         *
+         * @return True if it will, false otherwise.
+         */
+        inline bool is_enabled() const
+        {
+            return enabled;
+        }
+
+        /*!
+         * Checks if the extension was negotiated in the last handshake.
+         *
+         * @return True if messages may be compressed, false otherwise.
+         */
+        inline bool is_active() const
+        {
+            return active;
+        }
+
+        /*!
+         * Sets the compression level.
+         *
+         * @param level From 0 (none) to 9 (best). -1 for zlib's default.
+         */
+        inline void set_compression_level(int level)
+        {
+            compression_level = level;
+        }
+
+        /*!
+         * Sets the largest window to compress with. Smaller windows use less memory, but compress less well.
+         *
+         * @throws std::logic_error if bits isn't between 9 and 15
+         * @param bits The base two logarithm of the window size. 15 by default.
+         */
+        void set_max_window_bits(uint8_t bits);
+
+        /*!
+         * Sets the largest window to ask the other end to compress with, which is the one that
+         * incoming messages are decompressed with. The other end doesn't have to support this.
+         *
+         * @throws std::logic_error if bits isn't between 8 and 15
+         * @param bits The base two logarithm of the window size. 15 by default.
+         */
+        void set_peer_max_window_bits(uint8_t bits);
+
+        /*!
+         * Sets whether each outgoing message is compressed on its own, rather than referring back to
+         * earlier ones. Lets the compression state be freed between messages. Disabled by default.
+         *
+         * @param no_takeover True to compress each message on its own
+         */
+        inline void set_no_context_takeover(bool no_takeover)
+        {
+            no_context_takeover = no_takeover;
+        }
+
+        /*!
+         * Sets whether to ask the other end to compress each message on its own. Lets the
+         * decompression state be freed between messages. Disabled by default.
+         *
+         * @param no_takeover True to ask for each message to be compressed on its own
+         */
+        inline void set_peer_no_context_takeover(bool no_takeover)
+        {
+            peer_no_context_takeover = no_takeover;
+        }
+
+        /*!
+         * Sets the most memory that the compression state of the connection may use. When negotiating,
+         * window sizes and the compressor's memory level are reduced until they fit, and the extension
+         * is declined if they can't.
+         *
+         * @param bytes The limit in bytes. 0 (default) for no limit.
+         */
+        inline void set_memory_limit(size_t bytes)
+        {
+            memory_limit = bytes;
+        }
+
+        /*!
+         * Sets the size below which messages are sent uncompressed, as they'd gain little from it.
+         *
+         * @param bytes The smallest payload to compress. 0 (default) to compress everything.
+         */
+        inline void set_min_size(size_t bytes)
+        {
+            min_size = bytes;
+        }
+
+        /*!
+         * Checks if a message should be compressed.
+         *
+         * @param size The size of the message's payload
+         * @return True if the extension's active and the message is large enough, false otherwise.
+         */
+        inline bool should_compress(size_t size) const
+        {
+            return active && size >= min_size;
+        }
+
+        /*!
+         * Gets the most memory that the compression state may use, with the negotiated parameters.
+         *
+         * @return The estimated memory usage in bytes. 0 if the extension isn't active.
+         */
+        size_t get_memory_usage() const;
+
+        /*!
+         * Gets the extension offer for a client to send in its Sec-WebSocket-Extensions header.
+         *
+         * @return The offer. Empty if the extension is disabled, or can't fit in the memory limit.
+         */
+        std::string offer() const;
+
+        /*!
+         * Accepts the first suitable offer from a client's Sec-WebSocket-Extensions header,
+         * making the extension active.
+         *
+         * @param extensions The client's Sec-WebSocket-Extensions header
+         * @param response Set to the value of the Sec-WebSocket-Extensions header to respond with
+         * @return True if an offer was accepted. False otherwise, in which case no header should be sent.
+         */
+        bool accept_offer(const std::string &extensions, std::string &response);
+
+        /*!
+         * Applies the server's response to the offer, making the extension active.
+         *
+         * @param extensions The server's Sec-WebSocket-Extensions header
+         * @return True on success. False if the response is invalid, and the connection should be failed.
+         */
+        bool accept_response(const std::string &extensions);
+
+        /*!
+         * Deactivates the extension and frees its state, ready for a new connection.
+         */
+        void reset();
+
+        /*!
+         * Compresses the next part of an outgoing message, appending the output to 'out'.
+         *
+         * @param data The part of the message to compress
+         * @param size The number of bytes of data
+         * @param final True if this is the last part of the message
+         * @param out Where to append the compressed data
+         * @return 'Success' on success. 'Error' if the extension isn't active.
+         */
+        Socket::Status compress(const char *data, size_t size, bool final, std::string &out);
+
+        /*!
+         * Decompresses the next part of an incoming message, appending the output to 'out'.
+         *
+         * @param data The compressed payload of the message's next frame
+         * @param size The number of bytes of data
+         * @param final True if this is the message's last frame
+         * @param out Where to append the decompressed data
+         * @param max_out The most bytes which may be appended to 'out'. Guards against decompression bombs.
+         * @return 'Success' on success. 'MaxPacketSizeExceeded' if more than max_out bytes would be produced.
+         * 'ParseError' if the data is corrupt. 'Error' if the extension isn't active.
+         */
+        Socket::Status decompress(const char *data, size_t size, bool final, std::string &out, size_t max_out);
+
+    private:
+        struct Streams;
+
+        /*!
+         * Shrinks the windows and memory level, largest first, until they fit in the memory limit.
+         *
+         * @param peer_adjustable True if the other end's window can be asked to shrink
+         * @return True if they fit, false otherwise.
+         */
+        bool fit_memory_limit(uint8_t &own_bits, uint8_t &peer_bits, uint8_t &level, bool peer_adjustable) const;
+
+        //Settings
+        bool enabled;
+        int compression_level;
+        uint8_t max_window_bits;
+        uint8_t peer_max_window_bits;
+        bool no_context_takeover;
+        bool peer_no_context_takeover;
+        size_t memory_limit;
+        size_t min_size;
+
+        //What was negotiated
+        bool active;
+        uint8_t deflate_window_bits;
+        uint8_t deflate_memory_level;
+        uint8_t inflate_window_bits;
+        bool deflate_no_context_takeover;
+        bool inflate_no_context_takeover;
+        std::unique_ptr<Streams> streams;
+    };
+}
+
+#endif //FRNETLIB_PERMESSAGEDEFLATE_H
@@ -0,0 +1,94 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#ifndef FRNETLIB_RANGEDOWNLOADER_H
+#define FRNETLIB_RANGEDOWNLOADER_H
+
+#include <atomic>
+#include "Socket.h"
+#include "HttpClient.h"
+#include "HttpRequest.h"
+#include "URL.h"
+
+namespace fr
+{
+    /*!
+     * Downloads an object to a file in several segments at once, using HTTP range requests.
+     *
+     * The object's size is found first, by asking for its first byte. The rest is then split into
+     * byte ranges, which are fetched in parallel over the client's pooled connections, and each
+     * segment is written straight to its offset in the file as it arrives. If a segment fails, it's
+     * retried from where it got to, without affecting the others.
+     *
+     * Servers which don't support range requests send the whole object in response to the first
+     * request, in which case it's downloaded in one go instead.
+     */
+    class RangeDownloader
+    {
+    public:
+        /*!
+         * Constructs the downloader.
+         *
+         * @param client The client to make the requests with. Its set_max_connections_per_host()
+         * limits how many segments are actually downloaded at once.
+         */
+        explicit RangeDownloader(HttpClient &client);
+
+        /*!
+         * Downloads an object into a file.
+         *
+         * @param url The URL of the object
+         * @param fd The file to write to. It's truncated to the object's size.
+         * @param request The request to make for each segment, for any extra headers. A range header
+         * is added to it.
+         * @return The status of the operation:
+         * 'Success' if the whole object was written to the file.
+         * 'Error' if the server didn't send the object, or it changed during the download, or the file couldn't be written.
+         * 'ParseError' if the server's content-range header isn't valid.
+         * Other socket errors if a segment still failed after set_max_attempts() attempts.
+         */
+        Socket::Status download(const URL &url, int32_t fd, const HttpRequest &request = {});
+
+        /*!
+         * Sets how many segments an object is split into. Defaults to 4. Small objects
+         * are split into fewer segments, so that none are smaller than 64KiB.
+         *
+         * @param count The maximum number of segments. Must be at least 1.
+         */
+        void set_segment_count(size_t count);
+
+        /*!
+         * Sets how many times each segment is tried before the download fails. Defaults to 3.
+         *
+         * @param attempts The maximum attempts per segment. Must be at least 1.
+         */
+        void set_max_attempts(size_t attempts);
+
+    private:
+        /*!
+         * Downloads part of an object into the file, retrying as needed.
+         *
+         * @param begin The offset of the first byte of the segment
+         * @param end The offset just past the last byte of the segment
+         * @param total The size of the object, which the server should agree with
+         * @param failed Set by other segments if they fail, in which case this one gives up too
+         */
+        Socket::Status download_segment(const URL &url, int32_t fd, const HttpRequest &request, uint64_t begin,
+                                        uint64_t end, uint64_t total, const std::atomic<bool> &failed);
+
+        /*!
+         * Parses a 'content-range' header, of the form 'bytes <first>-<last>/<total>'. If the range
+         * couldn't be satisfied, then the first byte is given as '*', and first is set to total.
+         *
+         * @return True if it was valid, false otherwise.
+         */
+        static bool parse_content_range(const std::string &value, uint64_t &first, uint64_t &total);
+
+        HttpClient &client;
+        size_t segment_count;
+        size_t max_attempts;
+    };
+}
+
+#endif //FRNETLIB_RANGEDOWNLOADER_H
@@ -0,0 +1,177 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#ifndef FRNETLIB_RESOLVER_H
+#define FRNETLIB_RESOLVER_H
+
+#include <string>
+#include <vector>
+#include <list>
+#include <deque>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+#include <unordered_map>
+#include "Socket.h"
+#include "Address.h"
+
+namespace fr
+{
+    /*!
+     * Looks up host names, and caches the results for as long as their DNS records allow.
+     *
+     * Lookups are made by a built-in DNS client over UDP, to the nameservers listed in
+     * /etc/resolv.conf (or set with set_nameservers()), so that the records' TTLs are known.
+     * Names in /etc/hosts are answered from there. If no nameservers are configured, or an answer
+     * is too big to fit in a UDP response, then getaddrinfo() is used instead, and its results are
+     * cached for a minute. Relative names are tried with resolv.conf's search domains too, following
+     * its 'ndots' option.
+     *
+     * The cache is bounded, dropping the least recently used names first, and one resolver can be
+     * shared between any number of threads and sockets. Lookups can also be made asynchronously,
+     * on a small pool of threads which is started on first use.
+     */
+    class Resolver
+    {
+    public:
+        /*!
+         * Called when an asynchronous lookup completes, from one of the resolver's threads.
+         *
+         * @param status The status of the lookup, as returned by resolve()
+         * @param addresses The addresses which were found
+         */
+        using Callback = std::function<void(Socket::Status status, const std::vector<Address> &addresses)>;
+
+        /*!
+         * Constructs the resolver, loading the system's nameservers and hosts file.
+         *
+         * @param threads The number of threads to run asynchronous lookups on. Must be at least 1.
+         */
+        explicit Resolver(size_t threads = 2);
+        ~Resolver();
+        Resolver(Resolver &&)=delete;
+        Resolver(const Resolver &)=delete;
+        void operator=(Resolver &&)=delete;
+        void operator=(const Resolver &)=delete;
+
+        /*!
+         * Looks up a host's addresses, blocking until they're found. Numeric addresses are
+         * returned as they are.
+         *
+         * @param host The host name to look up
+         * @param addresses Where to store the addresses. IPv6 addresses come before IPv4 ones. Their ports are 0.
+         * @param family AF_INET or AF_INET6 for only those addresses, AF_UNSPEC (default) for both.
+         * @return The status of the lookup:
+         * 'Success' if at least one address was found.
+         * 'AddressLookupFailure' if the host doesn't exist, has no addresses, or isn't a valid name.
+         * 'Timeout' if none of the nameservers answered.
+         */
+        Socket::Status resolve(const std::string &host, std::vector<Address> &addresses, int family = AF_UNSPEC);
+
+        /*!
+         * Looks up a host's addresses in the background. Hosts which are cached are still
+         * looked up in the background, so the callback is never called from within resolve_async().
+         *
+         * @param host The host name to look up
+         * @param callback Called with the result, from one of the resolver's threads
+         * @param family AF_INET or AF_INET6 for only those addresses, AF_UNSPEC (default) for both.
+         */
+        void resolve_async(const std::string &host, Callback callback, int family = AF_UNSPEC);
+
+        /*!
+         * Sets the nameservers to send queries to, replacing those from /etc/resolv.conf.
+         * They're tried in order. An empty list means that getaddrinfo() is used instead.
+         *
+         * @param nameservers The nameservers' addresses. Those with a port of 0 use port 53.
+         */
+        void set_nameservers(std::vector<Address> nameservers);
+
+        /*!
+         * Sets the domains to try appending to relative names, replacing those from /etc/resolv.conf.
+         * Names ending in a '.' are absolute, and are never searched.
+         *
+         * @param domains The search domains, tried in order
+         * @param ndots Names with at least this many dots are tried as they are before the search domains,
+         * and those with fewer are tried after them. Defaults to 1.
+         */
+        void set_search_domains(std::vector<std::string> domains, size_t ndots = 1);
+
+        /*!
+         * Sets how long to wait for each nameserver to answer, before moving on to the next.
+         * Each nameserver is tried twice. Defaults to 2 seconds.
+         *
+         * @param timeout The timeout per query
+         */
+        void set_timeout(std::chrono::milliseconds timeout);
+
+        /*!
+         * Sets the maximum number of hosts to cache. Defaults to 512.
+         *
+         * @param entries The maximum number of cached hosts. 0 disables caching.
+         */
+        void set_cache_size(size_t entries);
+
+        /*!
+         * Forgets everything in the cache.
+         */
+        void clear_cache();
+
+    private:
+        struct CacheEntry
+        {
+            std::string key;
+            std::vector<Address> addresses;
+            std::chrono::steady_clock::time_point expiry;
+        };
+
+        /*!
+         * Queries the nameservers for a host's addresses.
+         *
+         * @param ttl Set to how long the addresses can be cached for
+         */
+        Socket::Status query(const std::string &host, int family, const std::vector<Address> &nameservers,
+                             std::chrono::milliseconds timeout, std::vector<Address> &addresses, uint32_t &ttl);
+
+        /*!
+         * Looks up a host with getaddrinfo(), for when there aren't any nameservers.
+         */
+        static Socket::Status query_system(const std::string &host, int family, std::vector<Address> &addresses);
+
+        /*!
+         * Reads the nameservers and search domains from /etc/resolv.conf, and the addresses from /etc/hosts.
+         */
+        void load_system_config();
+
+        /*!
+         * Adds a lookup to the cache, dropping the least recently used one if it's full.
+         */
+        void cache_insert(const std::string &key, const std::vector<Address> &addresses, uint32_t ttl);
+
+        /*!
+         * Runs asynchronous lookups until the resolver is destroyed.
+         */
+        void run_worker();
+
+        mutable std::mutex mutex;
+        std::vector<Address> nameservers;
+        std::vector<std::string> search_domains;
+        size_t ndots;
+        std::unordered_map<std::string, std::vector<Address>> hosts;
+        std::chrono::milliseconds timeout;
+
+        std::list<CacheEntry> cache; //Most recently used first
+        std::unordered_map<std::string, std::list<CacheEntry>::iterator> cache_index;
+        size_t max_cache_size;
+
+        size_t thread_count;
+        std::vector<std::thread> workers;
+        std::deque<std::function<void()>> jobs;
+        std::condition_variable job_ready;
+        bool stopping;
+    };
+}
+
+#endif //FRNETLIB_RESOLVER_H
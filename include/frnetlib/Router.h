@@ -0,0 +1,428 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#ifndef FRNETLIB_ROUTER_H
+#define FRNETLIB_ROUTER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstring>
+#include <stdexcept>
+#include <initializer_list>
+#include "HttpRequest.h"
+
+#define FRNETLIB_MAX_ROUTE_PARAMS 16 //The maximum number of parameters which may be captured by a single route
+
+namespace fr
+{
+    /*!
+     * Dispatches requests to handlers based on their type and URI.
+     *
+     * Routes are stored in a compressed radix tree, so lookups are proportional to the length
+     * of the URI, not the number of routes. Route paths may contain named parameters, which
+     * match a single path segment, such as ':id' and ':post' in "/users/:id/posts/:post". They may
+     * also end in a wildcard which matches the rest of the path, such as '*path' following "/static/".
+     *
+     * Static segments take priority over parameters, which take priority over wildcards.
+     *
+     * @tparam Handler The type of value stored for each route. Such as an std::function.
+     */
+    template<typename Handler>
+    class Router
+    {
+    public:
+        /*!
+         * A parameter captured from the URI. Points into the matched URI
+         * rather than copying it, so it's only valid for as long as the URI is.
+         */
+        struct Param
+        {
+            const std::string *name;
+            const char *data;
+            size_t size;
+
+            /*!
+             * Copies the captured value into a string
+             *
+             * @return The parameter value
+             */
+            inline std::string to_string() const
+            {
+                return std::string(data, size);
+            }
+
+            /*!
+             * Compares the captured value against a string
+             *
+             * @param str The string to compare against
+             * @return True if they're equal, false otherwise
+             */
+            inline bool operator==(const std::string &str) const
+            {
+                return str.size() == size && str.compare(0, size, data, size) == 0;
+            }
+        };
+
+        /*!
+         * The result of matching a URI against the router. Parameters are
+         * stored inline, so matching doesn't allocate.
+         */
+        class Match
+        {
+        public:
+            Match()
+            : handler(nullptr),
+              param_count(0),
+              method_not_allowed(false)
+            {}
+
+            /*!
+             * Gets the matched handler
+             *
+             * @return The handler, or nullptr if nothing matched.
+             */
+            inline const Handler *get_handler() const
+            {
+                return handler;
+            }
+
+            /*!
+             * Checks if the URI matched a route, but not for the requested type.
+             * Can be used to send back MethodNotAllowed instead of NotFound.
+             *
+             * @return True if the type didn't match, false otherwise.
+             */
+            inline bool is_method_not_allowed() const
+            {
+                return method_not_allowed;
+            }
+
+            /*!
+             * Gets the number of captured parameters
+             *
+             * @return The number of captured parameters
+             */
+            inline size_t size() const
+            {
+                return param_count;
+            }
+
+            /*!
+             * Gets a captured parameter by index, in the order they appear in the route.
+             *
+             * @param index The index of the parameter. Must be less than size().
+             * @return The parameter
+             */
+            inline const Param &operator[](size_t index) const
+            {
+                return params[index];
+            }
+
+            /*!
+             * Checks if a parameter with a given name was captured
+             *
+             * @param name The name of the parameter, without the leading ':' or '*'
+             * @return True if it was, false otherwise
+             */
+            inline bool exists(const std::string &name) const
+            {
+                return find(name) != nullptr;
+            }
+
+            /*!
+             * Gets a captured parameter by name.
+             *
+             * @throws An std::out_of_range if no parameter with the given name was captured
+             * @param name The name of the parameter, without the leading ':' or '*'
+             * @return The parameter
+             */
+            inline const Param &get(const std::string &name) const
+            {
+                auto param = find(name);
+                if(!param)
+                    throw std::out_of_range("No route parameter named: " + name);
+                return *param;
+            }
+
+        private:
+            friend class Router;
+
+            inline const Param *find(const std::string &name) const
+            {
+                for(size_t a = 0; a < param_count; ++a)
+                {
+                    if(*params[a].name == name)
+                        return &params[a];
+                }
+                return nullptr;
+            }
+
+            const Handler *handler;
+            Param params[FRNETLIB_MAX_ROUTE_PARAMS];
+            size_t param_count;
+            bool method_not_allowed;
+        };
+
+        /*!
+         * A route, used for building a router from a static table.
+         */
+        struct Route
+        {
+            Http::RequestType type;
+            std::string path;
+            Handler handler;
+        };
+
+        Router()
+        : root(new Node)
+        {}
+
+        /*!
+         * Constructs a router from a table of routes
+         *
+         * @throws An std::logic_error if any of the routes are invalid, or conflict.
+         * @param routes The routes to add
+         */
+        Router(std::initializer_list<Route> routes)
+        : Router()
+        {
+            for(auto &route : routes)
+                add(route.type, route.path, route.handler);
+        }
+
+        /*!
+         * Adds a route to the router.
+         *
+         * @throws An std::logic_error if the path is invalid, or conflicts with an existing route.
+         * @param type The request type to route (Get, Post, etc)
+         * @param path The path to route, which must begin with a '/'. May contain :params and a trailing *wildcard.
+         * @param handler The handler to associate with the route
+         */
+        void add(Http::RequestType type, const std::string &path, Handler handler)
+        {
+            if(type >= Http::RequestType::RequestTypeCount)
+                throw std::logic_error("Can't route an invalid request type");
+            if(path.empty() || path.front() != '/')
+                throw std::logic_error("Route paths must begin with a '/': " + path);
+
+            Node *node = root.get();
+            size_t param_count = 0;
+            size_t pos = 0;
+            while(pos < path.size())
+            {
+                //Insert the static text up to the next parameter
+                size_t param_pos = path.find_first_of(":*", pos);
+                if(param_pos == std::string::npos)
+                    param_pos = path.size();
+                node = insert_static(node, path.data() + pos, param_pos - pos);
+                pos = param_pos;
+                if(pos == path.size())
+                    break;
+
+                //Then the parameter itself
+                if(path[pos - 1] != '/')
+                    throw std::logic_error("Route parameters must span a whole path segment: " + path);
+                if(++param_count > FRNETLIB_MAX_ROUTE_PARAMS)
+                    throw std::logic_error("Too many parameters in route: " + path);
+
+                bool wildcard = path[pos] == '*';
+                size_t name_end = wildcard ? path.size() : path.find('/', pos);
+                if(name_end == std::string::npos)
+                    name_end = path.size();
+                std::string name = path.substr(pos + 1, name_end - pos - 1);
+                if(name.empty() || name.find_first_of(":*") != std::string::npos)
+                    throw std::logic_error("Invalid route parameter in: " + path);
+                if(wildcard && name.find('/') != std::string::npos)
+                    throw std::logic_error("Wildcard route parameters must come last: " + path);
+
+                std::unique_ptr<Node> &child = wildcard ? node->wildcard_child : node->param_child;
+                if(!child)
+                {
+                    child.reset(new Node);
+                    child->prefix = std::move(name);
+                }
+                else if(child->prefix != name)
+                {
+                    throw std::logic_error("Route parameter '" + name + "' conflicts with existing parameter '" + child->prefix + "' in: " + path);
+                }
+                node = child.get();
+                pos = name_end;
+            }
+
+            auto &slot = node->handlers[(uint32_t)type];
+            if(slot)
+                throw std::logic_error("Duplicate route: " + Http::request_type_to_string(type) + " " + path);
+            slot.reset(new Handler(std::move(handler)));
+        }
+
+        /*!
+         * Matches a request's type and URI against the router.
+         *
+         * @note The parameters in 'match' point into the request's URI, so the request must outlive them.
+         * @param request The request to match
+         * @param match Where to store the result
+         * @return The matched handler, or nullptr if no route matched. Also available through match.
+         */
+        const Handler *match(const HttpRequest &request, Match &match) const
+        {
+            return this->match(request.get_type(), request.get_uri(), match);
+        }
+
+        /*!
+         * Matches a request type and URI against the router.
+         *
+         * @note The parameters in 'match' point into 'uri', so it must outlive them.
+         * @param type The request type
+         * @param uri The URI to match, without a query string
+         * @param match Where to store the result
+         * @return The matched handler, or nullptr if no route matched. Also available through match.
+         */
+        const Handler *match(Http::RequestType type, const std::string &uri, Match &match) const
+        {
+            match = Match();
+            if(type < Http::RequestType::RequestTypeCount)
+            {
+                match.handler = lookup(root.get(), uri.data(), uri.size(), (uint32_t)type, match);
+                if(match.handler)
+                    return match.handler;
+            }
+
+            //Check if any other request type would've matched, to distinguish 404s from 405s
+            Match any;
+            match.method_not_allowed = lookup(root.get(), uri.data(), uri.size(), (uint32_t)Http::RequestType::RequestTypeCount, any) != nullptr;
+            match.param_count = 0;
+            return nullptr;
+        }
+
+    private:
+        struct Node
+        {
+            std::string prefix; //The static text matched by this node, or the parameter name
+            std::string indices; //The first character of each static child, for quick lookups
+            std::vector<std::unique_ptr<Node>> children;
+            std::unique_ptr<Node> param_child;
+            std::unique_ptr<Node> wildcard_child;
+            std::unique_ptr<Handler> handlers[(uint32_t)Http::RequestType::RequestTypeCount];
+        };
+
+        /*!
+         * Inserts static text below a node, splitting existing nodes where they diverge.
+         *
+         * @return The node representing the end of the text
+         */
+        static Node *insert_static(Node *node, const char *text, size_t len)
+        {
+            while(len > 0)
+            {
+                auto index = node->indices.find(text[0]);
+                if(index == std::string::npos)
+                {
+                    std::unique_ptr<Node> child(new Node);
+                    child->prefix.assign(text, len);
+                    node->indices.push_back(text[0]);
+                    node->children.emplace_back(std::move(child));
+                    return node->children.back().get();
+                }
+
+                //Find how much of the child's prefix is shared
+                Node *child = node->children[index].get();
+                size_t common = 0;
+                while(common < len && common < child->prefix.size() && child->prefix[common] == text[common])
+                    ++common;
+
+                //Split the child if only part of it is shared
+                if(common < child->prefix.size())
+                {
+                    std::unique_ptr<Node> split(new Node);
+                    split->prefix = child->prefix.substr(0, common);
+                    child->prefix.erase(0, common);
+                    split->indices.push_back(child->prefix[0]);
+                    split->children.emplace_back(std::move(node->children[index]));
+                    node->children[index] = std::move(split);
+                    child = node->children[index].get();
+                }
+
+                node = child;
+                text += common;
+                len -= common;
+            }
+            return node;
+        }
+
+        /*!
+         * Finds the handler for a path below a given node, backtracking where needed.
+         *
+         * @param type The request type index, or RequestTypeCount to match any type.
+         * @return The matched handler, or nullptr if nothing matched.
+         */
+        static const Handler *lookup(const Node *node, const char *path, size_t len, uint32_t type, Match &match)
+        {
+            if(len == 0)
+            {
+                auto handler = find_handler(node, type);
+                if(handler || !node->wildcard_child)
+                    return handler;
+            }
+
+            //Try static children first
+            auto index = len > 0 ? node->indices.find(path[0]) : std::string::npos;
+            if(index != std::string::npos)
+            {
+                const Node *child = node->children[index].get();
+                size_t prefix_len = child->prefix.size();
+                if(len >= prefix_len && memcmp(path, child->prefix.data(), prefix_len) == 0)
+                {
+                    auto handler = lookup(child, path + prefix_len, len - prefix_len, type, match);
+                    if(handler)
+                        return handler;
+                }
+            }
+
+            //Then a parameter, which captures up to the end of the segment
+            if(node->param_child && len > 0)
+            {
+                auto segment_end = static_cast<const char *>(memchr(path, '/', len));
+                size_t segment_len = segment_end ? segment_end - path : len;
+                if(segment_len > 0)
+                {
+                    match.params[match.param_count++] = {&node->param_child->prefix, path, segment_len};
+                    auto handler = lookup(node->param_child.get(), path + segment_len, len - segment_len, type, match);
+                    if(handler)
+                        return handler;
+                    --match.param_count;
+                }
+            }
+
+            //Finally a wildcard, which captures everything that's left
+            if(node->wildcard_child)
+            {
+                auto handler = find_handler(node->wildcard_child.get(), type);
+                if(handler)
+                {
+                    match.params[match.param_count++] = {&node->wildcard_child->prefix, path, len};
+                    return handler;
+                }
+            }
+            return nullptr;
+        }
+
+        static const Handler *find_handler(const Node *node, uint32_t type)
+        {
+            if(type < (uint32_t)Http::RequestType::RequestTypeCount)
+                return node->handlers[type].get();
+
+            for(auto &handler : node->handlers)
+            {
+                if(handler)
+                    return handler.get();
+            }
+            return nullptr;
+        }
+
+        std::unique_ptr<Node> root;
+    };
+}
+
+#endif //FRNETLIB_ROUTER_H
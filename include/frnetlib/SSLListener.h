@@ -45,6 +45,17 @@ namespace fr
          */
         Socket::Status accept(Socket &client) override;
 
+        /*!
+         * Sets the application protocols which may be selected through ALPN,
+         * in order of preference. E.g: {"h2", "http/1.1"}. Use SSLSocket::get_alpn_protocol()
+         * on accepted sockets to see which was chosen.
+         *
+         * @note This must be called once, before accepting connections. Requires mbedtls to be built with MBEDTLS_SSL_ALPN.
+         * @throws An std::runtime_error if mbedtls rejects the list.
+         * @param protocols The supported protocols. ALPN is disabled by default.
+         */
+        void set_alpn_protocols(std::vector<std::string> protocols);
+
         /*!
          * Closes the socket
          */
@@ -88,6 +99,8 @@ namespace fr
         mbedtls_pk_context pkey;
 
         std::shared_ptr<SSLContext> ssl_context;
+        std::vector<std::string> alpn_protocols;
+        std::vector<const char*> alpn_list;
     };
 
 }
@@ -4,6 +4,8 @@
 
 #ifndef FRNETLIB_SSL_SOCKET_H
 #define FRNETLIB_SSL_SOCKET_H
+#include <vector>
+#include <functional>
 #include "TcpSocket.h"
 #include "SSLContext.h"
 #include <mbedtls/net_sockets.h>
@@ -67,6 +69,17 @@ namespace fr
          */
         Socket::Status connect(const std::string &address, const std::string &port, std::chrono::seconds timeout) override;
 
+        /*!
+         * Connects the socket to a host whose addresses have already been resolved.
+         *
+         * @param host The name of the host, which is used for the remote address, and to verify its certificate
+         * @param addresses The host's addresses, which are tried in order. Their ports are ignored.
+         * @param port The port to connect to. Must be numeric.
+         * @param timeout The number of seconds to wait before timing each connection attempt out. Pass {} for default.
+         * @return A Socket::Status indicating the status of the operation.
+         */
+        Socket::Status connect(const std::string &host, const std::vector<Address> &addresses, const std::string &port, std::chrono::seconds timeout) override;
+
         /*!
          * Sets the socket file descriptor. Internally used.
          *
@@ -92,6 +105,22 @@ namespace fr
          */
         void verify_certificates(bool should_verify);
 
+        /*!
+         * Sets the application protocols to offer through ALPN
+         * when connecting, in order of preference. E.g: {"h2", "http/1.1"}.
+         *
+         * @note This must be called once, before connect(). Requires mbedtls to be built with MBEDTLS_SSL_ALPN.
+         * @param protocols The protocols to offer. ALPN is disabled by default.
+         */
+        void set_alpn_protocols(std::vector<std::string> protocols);
+
+        /*!
+         * Gets the application protocol negotiated through ALPN.
+         *
+         * @return The protocol agreed with the peer, or an empty string if none was.
+         */
+        std::string get_alpn_protocol() const;
+
         /*!
          * Applies requested socket options to the socket.
          * Should be called when a new socket is created.
@@ -141,11 +170,21 @@ namespace fr
          */
         void close_socket() override;
 
+        /*!
+         * Opens the underlying TCP connection with the given function, and then does the SSL handshake over it.
+         *
+         * @param host The name of the host, to verify its certificate against
+         * @param open Connects the TCP socket
+         */
+        Socket::Status connect_with(const std::string &host, const std::function<Socket::Status(TcpSocket&)> &open);
+
         std::shared_ptr<SSLContext> ssl_context;
         std::unique_ptr<mbedtls_net_context, decltype(&mbedtls_net_free)> ssl_socket_descriptor;
         std::unique_ptr<mbedtls_ssl_context, decltype(&mbedtls_ssl_free)> ssl;
         mbedtls_ssl_config conf;
         bool should_verify;
+        std::vector<std::string> alpn_protocols;
+        std::vector<const char*> alpn_list;
         uint32_t receive_timeout;
         bool is_blocking;
     };
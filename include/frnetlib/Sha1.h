@@ -6,40 +6,61 @@
 #define FRNETLIB_SHA1_H
 
 #include <string>
-#include "frnetlib/NetworkEncoding.h"
+#include <cstdint>
 
 namespace fr
 {
+    /*!
+     * Sha1 hashing. Blocks are hashed with the CPU's SHA instructions where it has them (SHA-NI on x86,
+     * checked for at runtime, or the ARMv8 crypto extension if it's enabled when compiling), and
+     * in software otherwise. Nothing is allocated whilst hashing.
+     */
     class Sha1
     {
     public:
+        static constexpr size_t DIGEST_SIZE = 20; //The size of a Sha1 digest in bytes
+
         Sha1();
 
+        /*!
+         * Hashes the next part of the input.
+         *
+         * @param data The input
+         * @param size The number of bytes of data
+         */
+        void update(const char *data, size_t size);
+
+        /*!
+         * Finishes hashing, and resets for the next input.
+         *
+         * @param out Where to put the digest, DIGEST_SIZE bytes long
+         */
+        void final(char *out);
+
+        /*!
+         * Sha1 hashes a buffer.
+         *
+         * @param data The input to hash
+         * @param size The number of bytes of data
+         * @param out Where to put the digest, DIGEST_SIZE bytes long
+         */
+        static void sha1_digest(const char *data, size_t size, char *out);
+
         /*!
          * Sha1 hashes a string input and returns the raw digest
          *
          * @param input The string to hash
-         * @return The Sha1 digest converted to host endianness
+         * @return The Sha1 digest, in network byte order
          */
-        static std::string sha1_digest(const std::string &input)
-        {
-            Sha1 ctx;
-            ctx.update(input);
-            ctx.final();
-            for(unsigned int &a : ctx.digest)
-                a = ntohl(a);
-
-            return std::string((char*)&ctx.digest[0], sizeof(ctx.digest));
-        }
+        static std::string sha1_digest(const std::string &input);
 
     private:
-        void update(const std::string &s);
-        void update(std::istream &is);
-        void final();
+        void reset();
 
         uint32_t digest[5];
-        std::string buffer;
-        uint64_t transforms;
+        char buffer[64]; //Input which doesn't yet fill a block
+        size_t buffer_size;
+        uint64_t total_size;
     };
 }
 
@@ -6,8 +6,10 @@
 #define FRNETLIB_SOCKET_H
 
 #include <mutex>
+#include <vector>
 #include "NetworkEncoding.h"
 #include "SocketDescriptor.h"
+#include "Address.h"
 
 #define RECV_CHUNK_SIZE 4096 //How much data to try and recv at once
 namespace fr
@@ -41,9 +43,20 @@ namespace fr
             SSLError = 19,
             NoRouteToHost = 20,
             Timeout = 21,
+            Connecting = 22,
+            InvalidPayload = 23,
             //Remember to update status_to_string if more are added
         };
 
+        /*!
+         * A piece of data to send, which doesn't belong to the socket. See send_gather().
+         */
+        struct Buffer
+        {
+            const char *data;
+            size_t size;
+        };
+
         enum class IP
         {
             v4 = 1,
@@ -78,6 +91,18 @@ namespace fr
          */
         virtual Socket::Status connect(const std::string &address, const std::string &port, std::chrono::seconds timeout)=0;
 
+        /*!
+         * Connects the socket to a host whose addresses have already been resolved, such as by
+         * an fr::Resolver, rather than looking them up again. They're tried in order until one connects.
+         *
+         * @param host The name of the host, which is used for the remote address
+         * @param addresses The host's addresses. Their ports are ignored.
+         * @param port The port to connect to
+         * @param timeout The number of seconds to wait before timing each connection attempt out. Pass {} for default.
+         * @return A Socket::Status indicating the status of the operation. (Success on success, an error type on failure).
+         */
+        virtual Socket::Status connect(const std::string &host, const std::vector<Address> &addresses, const std::string &port, std::chrono::seconds timeout)=0;
+
 
         /*!
          * Sets the socket to blocking or non-blocking.
@@ -123,6 +148,32 @@ namespace fr
          */
         virtual Status receive_raw(void *data, size_t data_size, size_t &received) = 0;
 
+        /*!
+         * Sends part of a file down the socket, without any of frnetlib's framing.
+         * The default implementation reads the file into a buffer and passes it to send_raw.
+         * Socket types which can send straight from the page cache override this.
+         *
+         * @param fd The descriptor of the file to send
+         * @param offset The offset within the file to start sending from
+         * @param count The number of bytes to send, starting from 'offset'
+         * @param sent The number of bytes that could be sent. You must zero this, prior to calling send_file the first time.
+         * @return The status of the operation. Dependent on the underlying socket type. 'Error' if the file couldn't be read.
+         */
+        virtual Status send_file(int32_t fd, uint64_t offset, size_t count, size_t &sent);
+
+        /*!
+         * Sends several buffers down the socket, back to back, as if they were one, without any of
+         * frnetlib's framing. This saves copying separate pieces, such as a header and a body, together first.
+         * The default implementation passes each buffer to send_raw in turn. Socket types which can
+         * send them in one go override this.
+         *
+         * @param buffers The buffers to send, in order
+         * @param count The number of buffers
+         * @param sent The number of bytes that could be sent, across all of the buffers. You must zero this, prior to calling send_gather the first time.
+         * @return The status of the operation. Dependent on the underlying socket type.
+         */
+        virtual Status send_gather(const Buffer *buffers, size_t count, size_t &sent);
+
         /*!
          * Sets the socket file descriptor. Internally used.
          *
@@ -28,8 +28,21 @@ namespace fr
          * @param socket The socket to add, can be a Listener/Socket.
          * @param opaque Opaque data which is passed back by wait() when the socket
          * has activity. Can be used for state management.
+         * @param want_write True to also wait for the socket to become writable, such as when
+         * it's connecting, or its send buffer is full. False (default) to only wait for it to be readable.
          */
-        void add(const std::shared_ptr<fr::SocketDescriptor> &socket, void *opaque);
+        void add(const std::shared_ptr<fr::SocketDescriptor> &socket, void *opaque, bool want_write = false);
+
+        /*!
+         * Changes whether wait() reports an added socket when it's writable. This also
+         * picks up a change to the socket's descriptor, such as when TcpSocket::finish_connect()
+         * moves on to another address.
+         *
+         * @throws An std::exception if the socket hasn't been added, or an internal EPOLL error occurs
+         * @param socket The socket to change
+         * @param want_write True to wait for it to become writable, as well as readable. False to only wait for it to be readable.
+         */
+        void set_write_interest(const std::shared_ptr<fr::SocketDescriptor> &socket, bool want_write);
 
         /*!
          * Waits for activity on one of the added sockets. If a socket disconnects,
@@ -38,7 +51,7 @@ namespace fr
          *
          * @throws An std::exception on failure
          * @param timeout The maximum time in milliseconds to wait for. Default/-1 for no timeout.
-         * @return A list of sockets which either are ready, or have disconnected. This can be empty
+         * @return A list of sockets which either are ready (readable, or writable if asked for), or have disconnected. This can be empty
          * if there is a timeout, or the wait is interrupted.
          */
         std::vector<std::pair<std::shared_ptr<fr::SocketDescriptor>, void*>> wait(std::chrono::milliseconds timeout = std::chrono::milliseconds(-1));
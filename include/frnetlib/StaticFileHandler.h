@@ -0,0 +1,137 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#ifndef FRNETLIB_STATICFILEHANDLER_H
+#define FRNETLIB_STATICFILEHANDLER_H
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <list>
+#include <unordered_map>
+#include "Socket.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+
+namespace fr
+{
+    /*!
+     * Serves files from a directory in response to HttpRequests.
+     *
+     * File bodies are sent with Socket::send_file, so on a TcpSocket they go straight from
+     * the page cache to the socket. Small files can optionally be kept memory mapped, which
+     * avoids re-reading them for sockets that can't send from the page cache, such as SSLSocket.
+     *
+     * Conditional requests (If-None-Match/If-Modified-Since) are answered with NotModified,
+     * and single byte ranges with PartialContent.
+     *
+     * @note This is safe to share between threads.
+     */
+    class StaticFileHandler
+    {
+    public:
+        /*!
+         * Constructs the handler.
+         *
+         * @param root The directory to serve files from
+         * @param index_file The file to serve when a directory is requested. Empty to return NotFound instead.
+         */
+        explicit StaticFileHandler(std::string root, std::string index_file = "index.html");
+        ~StaticFileHandler();
+        StaticFileHandler(StaticFileHandler &&)=delete;
+        StaticFileHandler(const StaticFileHandler &)=delete;
+        void operator=(StaticFileHandler &&)=delete;
+        void operator=(const StaticFileHandler &)=delete;
+
+        /*!
+         * Enables the memory mapped file cache.
+         *
+         * @param max_file_size Files no larger than this many bytes are cached. Pass 0 to disable the cache (default).
+         * @param max_cache_size The maximum total size of all cached files in bytes. The least recently used are evicted first.
+         */
+        void set_cache_limits(size_t max_file_size, size_t max_cache_size);
+
+        /*!
+         * Serves the file requested by 'request' through 'socket', including any
+         * error responses (NotFound, MethodNotAllowed, RequestedRangeNotSatisfiable).
+         *
+         * @param socket The socket to send the response through
+         * @param request The request to respond to
+         * @return The status of the send. If this isn't Success, then the socket should be disconnected.
+         */
+        Socket::Status serve(Socket &socket, const HttpRequest &request);
+
+        /*!
+         * Same as the other serve(), but serves a given path instead of the request's URI.
+         *
+         * @param socket The socket to send the response through
+         * @param request The request to respond to
+         * @param path The path of the file to serve, relative to the root directory.
+         * @return The status of the send. If this isn't Success, then the socket should be disconnected.
+         */
+        Socket::Status serve(Socket &socket, const HttpRequest &request, const std::string &path);
+
+        /*!
+         * Formats a unix timestamp as an HTTP date. E.g: Sun, 06 Nov 1994 08:49:37 GMT
+         *
+         * @param time The time to format
+         * @return The HTTP date
+         */
+        static std::string format_http_date(time_t time);
+
+        /*!
+         * Parses an HTTP date into a unix timestamp.
+         *
+         * @param date The date to parse. E.g: Sun, 06 Nov 1994 08:49:37 GMT
+         * @return The timestamp, or -1 on failure.
+         */
+        static time_t parse_http_date(const std::string &date);
+
+    private:
+        struct MappedFile
+        {
+            MappedFile(void *data_, size_t size_, time_t modified_, uint64_t inode_)
+            : data(data_),
+              size(size_),
+              modified(modified_),
+              inode(inode_)
+            {}
+            ~MappedFile();
+
+            void *data;
+            size_t size;
+            time_t modified;
+            uint64_t inode;
+            std::list<std::string>::iterator lru_position;
+        };
+
+        /*!
+         * Gets a memory mapped copy of a file, from the cache if it's still valid.
+         *
+         * @return The mapped file, or nullptr if it couldn't be mapped.
+         */
+        std::shared_ptr<MappedFile> get_mapped_file(const std::string &path, int32_t fd, size_t size, time_t modified, uint64_t inode);
+
+        /*!
+         * Sends a response with no body, other than a short description of the status.
+         */
+        static Socket::Status send_status(Socket &socket, Http::RequestStatus status);
+
+        /*!
+         * Checks if any entity tag in an If-None-Match/If-Range header matches 'etag'.
+         */
+        static bool etag_matches(const std::string &header, const std::string &etag);
+
+        std::string root;
+        std::string index_file;
+        size_t max_cached_file_size;
+        size_t max_cache_size;
+        size_t cache_size;
+        std::list<std::string> cache_lru;
+        std::unordered_map<std::string, std::shared_ptr<MappedFile>> cache;
+        std::mutex cache_lock;
+    };
+}
+
+#endif //FRNETLIB_STATICFILEHANDLER_H
@@ -7,6 +7,7 @@
 
 #include <memory>
 #include <mutex>
+#include <deque>
 #include "Socket.h"
 
 namespace fr
@@ -31,6 +32,71 @@ namespace fr
          */
         Socket::Status connect(const std::string &address, const std::string &port, std::chrono::seconds timeout) override;
 
+        /*!
+         * Connects the socket to a host whose addresses have already been resolved.
+         *
+         * @param host The name of the host, which is used for the remote address
+         * @param addresses The host's addresses, which are tried in order. Their ports are ignored.
+         * @param port The port to connect to. Must be numeric.
+         * @param timeout The number of seconds to wait before timing each connection attempt out. Pass {} for default.
+         * @return A Socket::Status indicating the status of the operation. (Success on success, an error type on failure).
+         */
+        Socket::Status connect(const std::string &host, const std::vector<Address> &addresses, const std::string &port, std::chrono::seconds timeout) override;
+
+        /*!
+         * Starts connecting the socket, without waiting for the connection to be made.
+         *
+         * Once the connect is started, add the socket to a SocketSelector with write interest,
+         * and call finish_connect() when it's reported, until it no longer returns 'Connecting'.
+         *
+         * @note The host name is looked up with getaddrinfo(), which blocks. Use the other overload
+         * with a Resolver to avoid this.
+         * @param address The address of the socket to connect to
+         * @param port The port of the socket to connect to
+         * @return The status of the operation:
+         * 'Connecting' if the connect is in progress.
+         * 'Success' if it connected immediately.
+         * 'AddressLookupFailure' if the address couldn't be looked up.
+         * 'NoRouteToHost' if none of the host's addresses could be connected to.
+         */
+        Socket::Status connect_async(const std::string &address, const std::string &port);
+
+        /*!
+         * Starts connecting the socket to a host whose addresses have already been resolved,
+         * without waiting for the connection to be made. The addresses are tried one at a time.
+         *
+         * @param host The name of the host, which is used for the remote address
+         * @param addresses The host's addresses, which are tried in order. Their ports are ignored.
+         * @param port The port to connect to. Must be numeric.
+         * @return The status of the operation, as with the other overload.
+         */
+        Socket::Status connect_async(const std::string &host, const std::vector<Address> &addresses, const std::string &port);
+
+        /*!
+         * Continues a connect started by connect_async(), once the socket is reported as writable.
+         * If the current address failed, the next one is tried, which changes the socket's
+         * descriptor. So if 'Connecting' is returned, pass the socket to SocketSelector::set_write_interest()
+         * again to keep waiting on it.
+         *
+         * @return The status of the operation:
+         * 'Connecting' if the connect is still in progress.
+         * 'Success' once connected. The socket is in whichever blocking mode it was last set to.
+         * 'NoRouteToHost' if none of the addresses could be connected to.
+         * 'Disconnected' if no connect was started.
+         */
+        Socket::Status finish_connect();
+
+        /*!
+         * Checks if a connect started by connect_async() is still in progress. connected()
+         * also returns true whilst this is the case, as the socket has a descriptor.
+         *
+         * @return True if the socket is still connecting, false otherwise.
+         */
+        inline bool connecting() const
+        {
+            return is_connecting;
+        }
+
         /*!
          * Attempts to send raw data down the socket, without
          * any of frnetlib's framing. Useful for communicating through
@@ -66,6 +132,35 @@ namespace fr
          */
         Status receive_raw(void *data, size_t buffer_size, size_t &received) override;
 
+        /*!
+         * Sends part of a file down the socket. Where supported, this uses sendfile(),
+         * so that the data goes straight from the page cache to the socket without
+         * being copied through userspace.
+         *
+         * @param fd The descriptor of the file to send
+         * @param offset The offset within the file to start sending from
+         * @param count The number of bytes to send, starting from 'offset'
+         * @param sent The number of bytes that could be sent. You must zero this, prior to calling send_file the first time.
+         * @return The status of the operation:
+         * 'WouldBlock' if the socket is in non-blocking mode and the send buffer is full. Call again with the same 'sent'.
+         * 'Timeout' if the socket is in blocking mode and it timed out.
+         * 'SendError' if a send error has occurred.
+         * 'Error' if the file couldn't be read.
+         * 'Success' if all of the bytes have been sent.
+         */
+        Status send_file(int32_t fd, uint64_t offset, size_t count, size_t &sent) override;
+
+        /*!
+         * Sends several buffers down the socket, back to back, as if they were one.
+         * They're handed to the kernel together with sendmsg(), where it's available.
+         *
+         * @param buffers The buffers to send, in order
+         * @param count The number of buffers
+         * @param sent The number of bytes that could be sent, across all of the buffers. You must zero this, prior to calling send_gather the first time.
+         * @return The status of the operation, as with send_raw.
+         */
+        Status send_gather(const Buffer *buffers, size_t count, size_t &sent) override;
+
         /*!
          * Sets if the socket should be blocking or non-blocking.
          *
@@ -119,8 +214,44 @@ namespace fr
          */
         void close_socket() override;
 
+        /*!
+         * Connects to the first of the addresses to accept a connection. Attempts are staggered
+         * (RFC 8305 'Happy Eyeballs'): a new one is started every 250ms, or as soon as the last one
+         * fails, alternating between IPv6 and IPv4. The rest are cancelled once one succeeds.
+         *
+         * @param addresses The addresses to try, in order of preference, with their ports set
+         * @param timeout How long each attempt is given to connect. {} for the default.
+         */
+        Socket::Status connect_addresses(const std::string &host, const std::vector<Address> &addresses, const std::string &port, std::chrono::seconds timeout);
+
         int32_t socket_descriptor;
         bool is_blocking;
+
+    private:
+        /*!
+         * Looks up an address with getaddrinfo(), for any of the socket's allowed address families.
+         */
+        Socket::Status lookup(const std::string &address, const std::string &port, std::vector<Address> &addresses) const;
+
+        /*!
+         * Copies the addresses of the socket's allowed address families, setting their ports.
+         */
+        Socket::Status set_ports(const std::vector<Address> &addresses, const std::string &port, std::vector<Address> &targets) const;
+
+        /*!
+         * Starts a non-blocking connect to the next address in connect_queue, moving
+         * past those which fail immediately.
+         */
+        Socket::Status start_connect();
+
+        /*!
+         * Sets up the socket once it has connected.
+         */
+        Socket::Status on_connected(const std::string &remote_address);
+
+        bool is_connecting;
+        std::deque<Address> connect_queue; //Addresses left to try, if the current async connect fails
+        std::string connect_remote; //The remote address to set once the async connect completes
     };
 
 }
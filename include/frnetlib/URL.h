@@ -5,8 +5,6 @@
 #ifndef FRNETLIB_URLPARSER_H
 #define FRNETLIB_URLPARSER_H
 #include <string>
-#include <unordered_map>
-#include <algorithm>
 
 //Note, a URL looks like this:  scheme:[//host[:port]][/path][?query][#fragment]
 namespace fr
@@ -205,17 +203,13 @@ namespace fr
         }
     private:
         /*!
-         * Converts a string to lower case
+         * Converts a string to a scheme enum, without needing to copy it out of a larger string.
          *
-         * @param str The string to convert
-         * @return The converted string
+         * @param scheme The scheme to convert
+         * @param length The length of the scheme in bytes
+         * @return The associated scheme enum value. Scheme::Unknown on failure.
          */
-        static std::string to_lower(const std::string &str)
-        {
-            std::string out = str;
-            std::transform(out.begin(), out.end(), out.begin(), ::tolower);
-            return out;
-        }
+        static Scheme string_to_scheme(const char *scheme, size_t length);
 
         //State
         Scheme scheme;
@@ -224,7 +218,6 @@ namespace fr
         std::string path;
         std::string query;
         std::string fragment;
-        static std::unordered_map<std::string, URL::Scheme> scheme_string_map;
     };
 }
 
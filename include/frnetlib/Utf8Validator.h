@@ -0,0 +1,68 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#ifndef FRNETLIB_UTF8VALIDATOR_H
+#define FRNETLIB_UTF8VALIDATOR_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace fr
+{
+    /*!
+     * Checks that text is valid UTF-8, as WebSocket Text messages have to be. The text can be given
+     * a piece at a time, such as a frame at a time, with characters split between pieces.
+     *
+     * Runs of ASCII are skipped over 16 bytes at a time, so plain text costs very little to check.
+     * Overlong encodings, surrogates and code points above U+10FFFF are all rejected.
+     */
+    class Utf8Validator
+    {
+    public:
+        Utf8Validator();
+
+        /*!
+         * Checks the next piece of text.
+         *
+         * @param data The text
+         * @param size The number of bytes of data
+         * @return False if the text so far is invalid, true otherwise. Once false, it stays false until reset.
+         */
+        bool update(const char *data, size_t size);
+
+        /*!
+         * Ends the text, and resets the validator for the next.
+         *
+         * @return True if all of the text was valid, false if it was invalid or ended part way through a character.
+         */
+        bool finish();
+
+        /*!
+         * Forgets any text given so far.
+         */
+        void reset();
+
+        /*!
+         * Checks a whole piece of text at once.
+         *
+         * @param data The text
+         * @param size The number of bytes of data
+         * @return True if it's valid UTF-8, false otherwise.
+         */
+        static bool validate(const char *data, size_t size);
+
+    private:
+        /*!
+         * Checks the continuation bytes of a character split between pieces, a byte at a time.
+         */
+        void continue_character(const char *data, size_t size, size_t &offset);
+
+        uint8_t needed; //How many continuation bytes are still to come for the current character
+        uint8_t lower; //The range that the next continuation byte has to be in
+        uint8_t upper;
+        bool valid;
+    };
+}
+
+#endif //FRNETLIB_UTF8VALIDATOR_H
@@ -94,6 +94,28 @@ namespace fr
             final = is_final;
         }
 
+        /*!
+         * Checks if the frame's RSV1 bit is set. With the permessage-deflate extension, this marks
+         * the first frame of a compressed message.
+         *
+         * @return True if the RSV1 bit is set, false otherwise.
+         */
+        inline bool is_compressed()
+        {
+            return rsv1;
+        }
+
+        /*!
+         * Sets the frame's RSV1 bit. This should only be set if an extension which uses it,
+         * such as permessage-deflate, has been negotiated.
+         *
+         * @param compressed True to set the RSV1 bit. False to clear it.
+         */
+        inline void set_compressed(bool compressed = true)
+        {
+            rsv1 = compressed;
+        }
+
         /*!
          * Overridable send, to allow
          * custom types to be directly sent through
@@ -104,6 +126,14 @@ namespace fr
          */
         Socket::Status send(Socket *socket) const override;
 
+        /*!
+         * Constructs the frame as it's sent, header and all. Client frames are masked with a new key.
+         * For when the same frame is sent to many sockets, so that it's only encoded once.
+         *
+         * @return The frame's wire format
+         */
+        std::string construct() const;
+
         /*!
          * Overrideable receive, to allow
          * custom types to be directly received through
@@ -118,6 +148,33 @@ namespace fr
          */
         Socket::Status receive(Socket *socket) override;
 
+        /*!
+         * Receives a frame, as with receive(), but with a limit on its payload size other than the socket's.
+         * The limit's checked before anything is allocated for the payload.
+         *
+         * @param socket The socket to receive from
+         * @param max_payload_size The largest payload to accept in bytes. 0 for no limit.
+         * @return The status of the receive, as with receive(). 'MaxPacketSizeExceeded' if the payload is too big.
+         */
+        Socket::Status receive(Socket *socket, uint64_t max_payload_size);
+
+        /*!
+         * Parses a frame from received data, a piece at a time, for use with non-blocking sockets
+         * instead of receive(). Each call carries on from where the last one left off, and stops at
+         * the end of the frame, so anything left over is the start of the next frame.
+         *
+         * @param data The received data
+         * @param size The number of bytes of data
+         * @param consumed Set to the number of bytes of data which belonged to this frame
+         * @param max_payload_size The largest payload to accept in bytes. 0 (default) for no limit.
+         * @return The status of the parse:
+         * 'NotEnoughData' if all of data was consumed, and more is needed to finish the frame.
+         * 'Success' once the frame is complete. The next call starts a new frame.
+         * 'MaxPacketSizeExceeded' if the payload is larger than max_payload_size.
+         * 'Error' if the frame is invalid, such as a client receiving a masked frame. The connection should be closed.
+         */
+        Socket::Status parse(const char *data, size_t size, size_t &consumed, uint64_t max_payload_size = 0);
+
         /*!
          * Checks if the webFrame is used in a client component or in a server component
          *
@@ -125,11 +182,67 @@ namespace fr
          */
         virtual bool is_client() const = 0;
 
+        /*!
+         * XORs data with a WebSocket masking key, as is done to the payloads of masked frames.
+         * Applying the same mask twice gives back the original data.
+         *
+         * @param data The data to mask/unmask in place
+         * @param size The number of bytes of data
+         * @param mask_key The masking key, in the byte order it's sent in
+         * @param offset The position of data within the payload, for when a payload is masked in parts. 0 by default.
+         */
+        static void apply_mask(char *data, size_t size, uint32_t mask_key, size_t offset = 0);
+
     private:
-        mutable std::string payload;
+        friend class WebSocketMessage;
+        template<typename SocketType> friend class WebSocket;
+
+        /*!
+         * Constructs the header for a frame with a payload of the given size.
+         *
+         * @param header Where to put the header. Must have room for the largest header, of 14 bytes.
+         * @param size The size of the payload
+         * @param mask_key The masking key to include, if this is a client frame
+         * @return The size of the header
+         */
+        size_t construct_header(char *header, size_t size, uint32_t mask_key) const;
+
+        /*!
+         * Sends the frame with a payload other than its own, such as part of a larger message.
+         */
+        Socket::Status send_payload(Socket *socket, const char *data, size_t size) const;
+
+        /*!
+         * Receives and checks a frame's header, leaving its payload_length bytes of payload to be received.
+         */
+        Socket::Status receive_header(Socket *socket, uint64_t max_payload_size);
+
+        /*!
+         * Receives the next part of the payload, once the header has been received, and unmasks it.
+         *
+         * @param dest Where to put it
+         * @param size How much to receive
+         * @param offset How much of the payload has been received before this part
+         */
+        Socket::Status receive_payload(Socket *socket, char *dest, size_t size, uint64_t offset);
+
+        /*!
+         * Checks the header once parse() has received all of it.
+         */
+        Socket::Status parse_header(uint64_t max_payload_size);
+
+        std::string payload;
         Opcode opcode;
         uint8_t final;
+        uint8_t rsv1;
         static uint32_t current_mask_key;
+
+        //The state of parse(), between calls
+        char header[14]; //The largest header has a 64bit length and a masking key
+        uint8_t header_received;
+        uint8_t header_size; //0 until the first two bytes have been received
+        uint64_t payload_length;
+        uint32_t mask_key;
     };
 
     class ClientWebFrame : public fr::WebFrame {
@@ -12,6 +12,9 @@
 #include "Base64.h"
 #include "Sha1.h"
 #include "WebFrame.h"
+#include "WebSocketMessage.h"
+#include "PerMessageDeflate.h"
+#include "Utf8Validator.h"
 
 namespace fr
 {
@@ -20,6 +23,16 @@ namespace fr
     {
     public:
         WebSocket()
+        : async_handshake(false),
+          handshake_pending(false),
+          handshake_timeout(std::chrono::seconds(10)),
+          client(false),
+          auto_pong(true),
+          keepalive_interval(0),
+          max_missed_pongs(2),
+          missed_pongs(0),
+          validate_utf8(false),
+          in_text(false)
         {}
 
         /*!
@@ -36,6 +49,9 @@ namespace fr
         Socket::Status connect(const std::string &address, const std::string &port, const std::string &path,  const std::vector<std::string> &ws_protocols, std::chrono::seconds timeout)
         {
             //Establish a connection using the parent class
+            compression.reset();
+            client = true;
+            reset_keepalive();
             Socket::Status status = SocketType::connect(address, port, timeout);
             if(status != Socket::Status::Success)
                 return status;
@@ -52,6 +68,10 @@ namespace fr
                     request.header("sec-websocket-protocol") += ", " + ws_protocols[i];
             }
 
+            std::string extensions = compression.offer();
+            if(!extensions.empty())
+                request.header("sec-websocket-extensions") = extensions;
+
             request.header("connection") = "upgrade";
             request.header("upgrade") = "websocket";
 
@@ -75,7 +95,15 @@ namespace fr
 
             //Verify the sec-websocket-accept header
             std::string derived_key = response.header("sec-websocket-accept");
-            if(derived_key != Base64::encode(Sha1::sha1_digest(websocket_key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11")))
+            if(derived_key != derive_accept_key(websocket_key))
+            {
+                disconnect();
+                errno = EPROTO;
+                return Socket::Status::HandshakeFailed;
+            }
+
+            //The server may only accept an extension if we offered it
+            if(response.header_exists("sec-websocket-extensions") && !compression.accept_response(response.header("sec-websocket-extensions")))
             {
                 disconnect();
                 errno = EPROTO;
@@ -99,6 +127,177 @@ namespace fr
             return connect(address, port, "/", {}, timeout);
         }
 
+        /*!
+         * Sends an object through the socket. WebSocketMessages are compressed if
+         * the connection has negotiated permessage-deflate.
+         *
+         * @param obj The object to send
+         * @return The status of the send
+         */
+        Socket::Status send(const Sendable &obj) override
+        {
+            auto message = compression.is_active() ? dynamic_cast<const WebSocketMessage*>(&obj) : nullptr;
+            if(!message)
+                return SocketType::send(obj);
+            if(!SocketType::connected())
+                return Socket::Status::Disconnected;
+            return message->send(this, &compression);
+        }
+
+        /*!
+         * Receives an object through the socket. WebSocketMessages are decompressed if
+         * the connection has negotiated permessage-deflate.
+         *
+         * @param obj The object to receive into
+         * @return The status of the receive. 'InvalidPayload' if UTF-8 validation is enabled, and
+         * invalid text was received, in which case the connection's closed with code 1007.
+         */
+        Socket::Status receive(Sendable &obj) override
+        {
+            auto message = dynamic_cast<WebSocketMessage*>(&obj);
+            auto frame = message ? nullptr : dynamic_cast<WebFrame*>(&obj);
+            if(message && validate_utf8)
+                message->set_validate_utf8(true);
+            Socket::Status status;
+            if(message && compression.is_active())
+                status = message->receive(this, &compression);
+            else
+                status = SocketType::receive(obj);
+            return on_received(message, frame, status);
+        }
+
+        /*!
+         * Parses a frame or message from data which the caller has received, such as in a non-blocking
+         * event loop, as with WebFrame::parse() and WebSocketMessage::parse(). Completed frames and messages
+         * get the same handling as with receive(): they count towards the keepalive, pings are answered
+         * if auto pong is enabled, and text is checked if UTF-8 validation is enabled. Messages are
+         * decompressed if the connection has negotiated permessage-deflate.
+         *
+         * @param obj The WebFrame or WebSocketMessage to parse into
+         * @param data The received data
+         * @param size The number of bytes of data
+         * @param consumed Set to the number of bytes of data which belonged to obj
+         * @return The status of the parse, as with WebFrame::parse(). 'InvalidPayload' if invalid text was
+         * received, in which case the connection's closed with code 1007. 'Error' if obj isn't a frame or message.
+         */
+        Socket::Status parse(Sendable &obj, const char *data, size_t size, size_t &consumed)
+        {
+            consumed = 0;
+            auto message = dynamic_cast<WebSocketMessage*>(&obj);
+            auto frame = message ? nullptr : dynamic_cast<WebFrame*>(&obj);
+            if(!message && !frame)
+                return Socket::Status::Error;
+            if(message && validate_utf8)
+                message->set_validate_utf8(true);
+
+            Socket::Status status;
+            if(message)
+                status = message->parse(data, size, consumed, compression.is_active() ? &compression : nullptr, SocketType::get_max_receive_size());
+            else
+                status = frame->parse(data, size, consumed, SocketType::get_max_receive_size());
+            return on_received(message, frame, status);
+        }
+
+        /*!
+         * Sets whether pings are answered automatically, with a pong carrying the same payload, when
+         * they're received or parsed. Pings are still returned by receive() and parse() either way. Enabled by default.
+         *
+         * @note Pongs are written straight to the socket, so disable this if the socket's in a WebSocketHub,
+         * and answer pings through the hub instead.
+         * @param enable True to answer pings, false not to.
+         */
+        void set_auto_pong(bool enable)
+        {
+            auto_pong = enable;
+        }
+
+        /*!
+         * Sets whether received text is checked to be valid UTF-8, as RFC 6455 requires. If it isn't, the
+         * connection's closed with code 1007, and receive() returns 'InvalidPayload'. Text received as
+         * WebSocketMessages is checked as each fragment arrives, as is text received a frame at a time,
+         * unless it's compressed. Disabled by default.
+         *
+         * @param validate True to check text, false not to.
+         */
+        void set_validate_utf8(bool validate)
+        {
+            validate_utf8 = validate;
+        }
+
+        /*!
+         * Sets the connection's keepalive policy. Once nothing's been received for 'interval', a ping is sent,
+         * and another each interval after that until something arrives. If 'max_missed' pings go unanswered,
+         * the other end's assumed to be gone, and the connection's closed.
+         *
+         * This happens in check_keepalive(), which is best driven by a WebSocketKeepalive shared between
+         * connections. Disabled by default.
+         *
+         * @param interval How long the connection can be idle before pinging. 0 to disable keepalives.
+         * @param max_missed How many pings can go unanswered before giving up. 2 by default.
+         */
+        void set_keepalive(std::chrono::milliseconds interval, uint32_t max_missed = 2)
+        {
+            keepalive_interval = interval;
+            max_missed_pongs = max_missed;
+        }
+
+        /*!
+         * Pings the other end if the connection's been idle for the keepalive interval, or closes
+         * the connection if too many pings have gone unanswered.
+         *
+         * @param now The current time
+         * @return 'Success' if the connection's alive, or keepalives are disabled. 'Timeout' if it was
+         * closed because the other end stopped responding. 'Disconnected' if it isn't connected.
+         * Anything else if it was closed because a ping couldn't be sent.
+         */
+        Socket::Status check_keepalive(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now())
+        {
+            if(!SocketType::connected())
+                return Socket::Status::Disconnected;
+            if(keepalive_interval.count() == 0 || now < get_keepalive_deadline())
+                return Socket::Status::Success;
+
+            if(missed_pongs >= max_missed_pongs)
+            {
+                SocketType::close_socket();
+                return Socket::Status::Timeout;
+            }
+
+            //A ping which doesn't fit in the send buffer counts as missed too, as the other end isn't reading
+            ++missed_pongs;
+            last_ping = now;
+            auto status = send_control(WebFrame::Opcode::Ping, "");
+            if(status != Socket::Status::Success && status != Socket::Status::WouldBlock)
+            {
+                SocketType::close_socket();
+                return status == Socket::Status::Disconnected ? Socket::Status::SendError : status;
+            }
+            return Socket::Status::Success;
+        }
+
+        /*!
+         * Gets the time by which check_keepalive() next needs calling.
+         *
+         * @return The keepalive deadline. time_point::max() if keepalives are disabled.
+         */
+        std::chrono::steady_clock::time_point get_keepalive_deadline() const
+        {
+            if(keepalive_interval.count() == 0)
+                return std::chrono::steady_clock::time_point::max();
+            return (missed_pongs == 0 ? last_received : last_ping) + keepalive_interval;
+        }
+
+        /*!
+         * Gets the connection's permessage-deflate settings, to enable compression before connecting
+         * or accepting, and to check whether it was negotiated afterwards.
+         *
+         * @return The connection's compression state
+         */
+        PerMessageDeflate &get_compression()
+        {
+            return compression;
+        }
+
         /*!
          * Sends a Disconnect Frame and then
          * closes the connection.
@@ -117,31 +316,282 @@ namespace fr
          * when accepting a connection, and so we can use the opportunity to
          * handshake with the server.
          *
+         * If the handshake is asynchronous (see set_async_handshake()), then the socket is put into
+         * non-blocking mode, and nothing is received until continue_handshake() is called.
+         *
+         * @throws An std::exception if the handshake is synchronous and fails.
          * @param descriptor The socket descriptor.
          */
         void set_descriptor(void *descriptor) override
         {
             SocketType::set_descriptor(descriptor);
+            handshake_pending = false;
+            compression.reset();
+            client = false;
+            reset_keepalive();
             if(!descriptor || SocketType::get_socket_descriptor() == -1)
                 return;
 
+            //Leave the handshake to the caller's event loop
+            if(async_handshake)
+            {
+                handshake_request = HttpRequest();
+                handshake_deadline = std::chrono::steady_clock::now() + handshake_timeout;
+                handshake_pending = true;
+                SocketType::set_blocking(false);
+                return;
+            }
+
             //Initialise connection, receive the handshake
             HttpRequest request;
             if(SocketType::receive(request) != Socket::Status::Success)
                 throw std::runtime_error("Failed to receive WebSock handshake");
+            if(send_handshake_response(request) == Socket::Status::HandshakeFailed)
+                throw std::runtime_error("Client isn't using the WebSock protocol");
+        }
 
+        /*!
+         * Sets whether connections accepted into this socket handshake asynchronously. By default
+         * they don't, and the listener's accept() blocks until the client has sent its upgrade request.
+         *
+         * When asynchronous, accept() returns as soon as the TCP connection is made, leaving the
+         * socket non-blocking. Add it to a SocketSelector, and call continue_handshake() each time that
+         * it's readable, until it no longer returns 'NotEnoughData'. Frames shouldn't be sent or
+         * received until then.
+         *
+         * @param async True to handshake asynchronously, false to handshake within accept().
+         */
+        void set_async_handshake(bool async)
+        {
+            async_handshake = async;
+        }
+
+        /*!
+         * Sets how long a client has to finish an asynchronous handshake, from when it's accepted.
+         * Defaults to 10 seconds.
+         *
+         * @param timeout The handshake timeout
+         */
+        void set_handshake_timeout(std::chrono::milliseconds timeout)
+        {
+            handshake_timeout = timeout;
+        }
+
+        /*!
+         * Receives whatever's available of the client's upgrade request, and answers it once it's complete.
+         * The socket is closed if the handshake fails.
+         *
+         * @return The status of the handshake:
+         * 'Success' once the handshake has completed. Also returned if there isn't one in progress.
+         * 'NotEnoughData' if more of the request is needed. Call this again when the socket's readable,
+         * or when get_handshake_deadline() passes.
+         * 'Timeout' if the client took too long.
+         * 'HandshakeFailed' if the request isn't a valid WebSocket upgrade.
+         * Anything else if the socket failed.
+         */
+        Socket::Status continue_handshake()
+        {
+            if(!handshake_pending)
+                return Socket::Status::Success;
+
+            char recv_buffer[RECV_CHUNK_SIZE];
+            while(true)
+            {
+                size_t received = 0;
+                auto status = SocketType::receive_raw(recv_buffer, RECV_CHUNK_SIZE, received);
+                if(status == Socket::Status::WouldBlock)
+                {
+                    if(std::chrono::steady_clock::now() < handshake_deadline)
+                        return Socket::Status::NotEnoughData;
+                    status = Socket::Status::Timeout;
+                }
+                if(status == Socket::Status::Success)
+                    status = handshake_request.parse(recv_buffer, received);
+                if(status == Socket::Status::NotEnoughData)
+                    continue;
+
+                handshake_pending = false;
+                if(status == Socket::Status::Success)
+                    status = send_handshake_response(handshake_request);
+                else if(status != Socket::Status::Timeout && status != Socket::Status::Disconnected)
+                    status = Socket::Status::HandshakeFailed;
+                handshake_request = HttpRequest();
+                if(status != Socket::Status::Success)
+                    SocketType::close_socket();
+                return status;
+            }
+        }
+
+        /*!
+         * Checks if an asynchronous handshake is still in progress.
+         *
+         * @return True if continue_handshake() needs to be called, false otherwise.
+         */
+        bool is_handshake_pending() const
+        {
+            return handshake_pending;
+        }
+
+        /*!
+         * Gets the time by which the client has to finish an asynchronous handshake. An event loop should
+         * call continue_handshake() once this passes, if the socket hasn't become readable by then.
+         *
+         * @return The handshake deadline
+         */
+        std::chrono::steady_clock::time_point get_handshake_deadline() const
+        {
+            return handshake_deadline;
+        }
+
+    private:
+        /*!
+         * Sends a control frame without waiting for room in the send buffer, so that an other end which
+         * has stopped reading can't hold up the caller. If none of it fits, then the frame's dropped.
+         *
+         * @return 'Success' if it was sent, 'WouldBlock' if it was dropped, or the send's status on failure.
+         */
+        Socket::Status send_control(WebFrame::Opcode opcode, const std::string &payload)
+        {
+            ClientWebFrame client_frame;
+            ServerWebFrame server_frame;
+            WebFrame &frame = client ? static_cast<WebFrame&>(client_frame) : server_frame;
+            frame.set_opcode(opcode);
+            frame.set_payload(payload);
+            std::string data = frame.construct();
+
+            //Once part of it's gone, the rest has to follow
+            size_t sent = 0;
+            Socket::Status status;
+            do
+            {
+                status = SocketType::send_raw(data.data(), data.size(), sent);
+            } while(status == Socket::Status::WouldBlock && sent > 0);
+            return status;
+        }
+
+        /*!
+         * Does the bookkeeping for a frame or message which has been received or parsed. Either of them can
+         * be nullptr, if something else was received.
+         *
+         * @return The status to pass on to the caller
+         */
+        Socket::Status on_received(WebSocketMessage *message, WebFrame *frame, Socket::Status status)
+        {
+            if(status == Socket::Status::Success && frame && validate_utf8 && !valid_text(*frame))
+                status = Socket::Status::InvalidPayload;
+            if(status == Socket::Status::InvalidPayload)
+            {
+                fail_connection(1007); //Invalid frame payload data
+                return status;
+            }
+            if(status != Socket::Status::Success || (!message && !frame))
+                return status;
+
+            //Anything arriving shows that the other end's still there
+            last_received = std::chrono::steady_clock::now();
+            missed_pongs = 0;
+            auto opcode = message ? message->get_opcode() : frame->get_opcode();
+            if(opcode == WebFrame::Opcode::Ping && auto_pong)
+                send_control(WebFrame::Opcode::Pong, message ? message->get_payload() : frame->get_payload());
+            return status;
+        }
+
+        void reset_keepalive()
+        {
+            last_received = std::chrono::steady_clock::now();
+            missed_pongs = 0;
+            in_text = false;
+        }
+
+        /*!
+         * Checks a received frame, if it's part of a text message, carrying on from the
+         * message's earlier frames. Compressed messages can't be checked until they're inflated.
+         *
+         * @return False if the text is invalid, true otherwise.
+         */
+        bool valid_text(WebFrame &frame)
+        {
+            if(frame.get_opcode() == WebFrame::Opcode::Text)
+            {
+                text_validator.reset();
+                in_text = !frame.is_compressed();
+            }
+            else if(frame.get_opcode() != WebFrame::Opcode::Continuation)
+            {
+                return true;
+            }
+            if(!in_text)
+                return true;
+
+            in_text = !frame.is_final();
+            return text_validator.update(frame.payload.data(), frame.payload.size()) && (in_text || text_validator.finish());
+        }
+
+        /*!
+         * Sends a Disconnect frame with a close code, such as after a protocol error, and closes the connection.
+         */
+        void fail_connection(uint16_t close_code)
+        {
+            char payload[] = {static_cast<char>(close_code >> 8), static_cast<char>(close_code & 0xFF)};
+            send_control(WebFrame::Opcode::Disconnect, std::string(payload, sizeof(payload)));
+            SocketType::close_socket();
+        }
+
+        /*!
+         * Works out the Sec-WebSocket-Accept value for a client's key, hashing the key
+         * and the WebSocket GUID in place, rather than joining them together first.
+         */
+        static std::string derive_accept_key(const std::string &key)
+        {
+            static const char guid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+            char digest[Sha1::DIGEST_SIZE];
+            Sha1 sha1;
+            sha1.update(key.data(), key.size());
+            sha1.update(guid, sizeof(guid) - 1);
+            sha1.final(digest);
+            return Base64::encode(digest, sizeof(digest));
+        }
+
+        /*!
+         * Checks a client's upgrade request, and sends back the response which accepts it.
+         *
+         * @return 'Success' on success. 'HandshakeFailed' if the request isn't a WebSocket upgrade. Otherwise the send's status.
+         */
+        Socket::Status send_handshake_response(const HttpRequest &request)
+        {
             if(request.header("Upgrade") != "websocket" || request.get_type() != Http::RequestType::Get)
-                throw std::runtime_error("Client isn't using the WebSock protocol");
+                return Socket::Status::HandshakeFailed;
 
             //Calculate the derived key, then send back our response
-            std::string derived_key = Base64::encode(Sha1::sha1_digest(request.header("sec-websocket-key") + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"));
+            std::string derived_key = derive_accept_key(request.header("sec-websocket-key"));
             HttpResponse response;
             response.set_status(Http::RequestStatus::SwitchingProtocols);
             response.header("Upgrade") = "websocket";
             response.header("Connection") = "Upgrade";
             response.header("Sec-WebSocket-Accept") = derived_key;
-            SocketType::send(response);
+
+            std::string extensions;
+            if(compression.accept_offer(request.header("sec-websocket-extensions"), extensions))
+                response.header("Sec-WebSocket-Extensions") = extensions;
+            return SocketType::send(response);
         }
+
+        bool async_handshake;
+        bool handshake_pending;
+        std::chrono::milliseconds handshake_timeout;
+        std::chrono::steady_clock::time_point handshake_deadline;
+        HttpRequest handshake_request; //The upgrade request, as it's received
+        PerMessageDeflate compression;
+        bool client; //True if we connected, false if we were accepted
+        bool auto_pong;
+        std::chrono::milliseconds keepalive_interval;
+        uint32_t max_missed_pongs;
+        uint32_t missed_pongs; //Pings sent since anything was last received
+        std::chrono::steady_clock::time_point last_received;
+        std::chrono::steady_clock::time_point last_ping;
+        bool validate_utf8;
+        bool in_text; //True whilst the frames of a text message are being received and checked
+        Utf8Validator text_validator;
     };
 }
 
@@ -0,0 +1,225 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#ifndef FRNETLIB_WEBSOCKETHUB_H
+#define FRNETLIB_WEBSOCKETHUB_H
+
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include "Socket.h"
+#include "WebFrame.h"
+
+namespace fr
+{
+    /*!
+     * Fans frames out to many server side WebSocket connections, by topic or to all of them. Each frame
+     * is constructed once into a shared buffer, which is then queued to every connection that it's for,
+     * rather than being encoded and copied for each one.
+     *
+     * Connections should be non-blocking. Frames are written as far as they'll go as soon as they're queued,
+     * and the rest when flush() is called, such as when a SocketSelector says that the connection's writable.
+     * A connection whose queue goes over its budget can't keep up, and is evicted: removed from the hub
+     * and shut down, so that it shows up as disconnected wherever else it's being waited on.
+     *
+     * Once a connection's been added, everything sent to it should go through the hub, so that frames
+     * aren't interleaved. Frames are sent as they are, so aren't compressed even if the connection has
+     * negotiated permessage-deflate. The hub is thread safe, but its handlers should be set before use.
+     */
+    class WebSocketHub
+    {
+    public:
+        /*!
+         * Called when a connection's evicted.
+         *
+         * @param socket The connection
+         * @param reason 'MaxPacketSizeExceeded' if it went over its budget. Otherwise the status of the send which failed.
+         */
+        using EvictHandler = std::function<void(const std::shared_ptr<Socket> &socket, Socket::Status reason)>;
+
+        /*!
+         * Called when a connection has queued frames waiting for it to become writable, and again
+         * once they've all been sent. Can be used to set its write interest with a SocketSelector.
+         *
+         * @param socket The connection
+         * @param want_write True if it has frames waiting, false once it doesn't.
+         */
+        using WriteInterestHandler = std::function<void(const std::shared_ptr<Socket> &socket, bool want_write)>;
+
+        WebSocketHub();
+
+        /*!
+         * Adds a connection, which receives broadcasts. Does nothing if it's already been added.
+         *
+         * @param socket The connection to add
+         */
+        void add(const std::shared_ptr<Socket> &socket);
+
+        /*!
+         * Removes a connection, along with its subscriptions and anything still queued for it.
+         * Does nothing if it isn't in the hub.
+         *
+         * @param socket The connection to remove
+         */
+        void remove(const std::shared_ptr<Socket> &socket);
+
+        /*!
+         * Subscribes a connection to a topic, adding it to the hub if need be.
+         *
+         * @param socket The connection to subscribe
+         * @param topic The topic to receive frames published to
+         */
+        void subscribe(const std::shared_ptr<Socket> &socket, const std::string &topic);
+
+        /*!
+         * Unsubscribes a connection from a topic.
+         *
+         * @param socket The connection to unsubscribe
+         * @param topic The topic to stop receiving
+         */
+        void unsubscribe(const std::shared_ptr<Socket> &socket, const std::string &topic);
+
+        /*!
+         * Sends a frame to every connection in the hub.
+         *
+         * @param frame The frame to send. Should be a ServerWebFrame.
+         * @return The number of connections it was queued to.
+         */
+        size_t broadcast(const WebFrame &frame);
+
+        /*!
+         * Sends a frame to every connection subscribed to a topic.
+         *
+         * @param topic The topic to publish to
+         * @param frame The frame to send. Should be a ServerWebFrame.
+         * @return The number of connections it was queued to.
+         */
+        size_t publish(const std::string &topic, const WebFrame &frame);
+
+        /*!
+         * Sends a frame to one connection, in order with everything else queued for it.
+         *
+         * @param socket The connection to send to
+         * @param frame The frame to send
+         * @return True if it was queued. False if the connection isn't in the hub, or was evicted.
+         */
+        bool send(const std::shared_ptr<Socket> &socket, const WebFrame &frame);
+
+        /*!
+         * Sends as much as possible of what's queued for a connection, such as when it becomes writable.
+         *
+         * @param socket The connection to flush
+         */
+        void flush(const std::shared_ptr<Socket> &socket);
+
+        /*!
+         * Sends as much as possible of what's queued for every connection.
+         */
+        void flush();
+
+        /*!
+         * Checks if a connection has frames waiting to be sent.
+         *
+         * @param socket The connection to check
+         * @return True if it does, false otherwise.
+         */
+        bool has_pending(const std::shared_ptr<Socket> &socket) const;
+
+        /*!
+         * Gets the number of connections in the hub.
+         *
+         * @return The number of connections
+         */
+        size_t size() const;
+
+        /*!
+         * Sets how many bytes may be waiting to be sent to a connection before it's evicted.
+         * Should be larger than the largest frame. Defaults to 4MiB.
+         *
+         * @param bytes The budget in bytes. 0 for no limit.
+         */
+        void set_budget(size_t bytes);
+
+        /*!
+         * Sets the function to call when a connection's evicted.
+         *
+         * @param handler The handler to use
+         */
+        void set_evict_handler(EvictHandler handler);
+
+        /*!
+         * Sets the function to call when a connection starts or stops waiting to become writable.
+         *
+         * @param handler The handler to use
+         */
+        void set_write_interest_handler(WriteInterestHandler handler);
+
+    private:
+        struct Connection
+        {
+            std::shared_ptr<Socket> socket;
+            std::deque<std::shared_ptr<const std::string>> queue;
+            size_t offset = 0; //How much of the frame at the front of the queue has been sent
+            size_t queued = 0; //How many bytes are waiting to be sent
+            bool want_write = false;
+            bool evicted = false;
+            std::vector<std::string> topics;
+        };
+
+        //Something to tell the handlers about, once the hub's unlocked
+        struct Event
+        {
+            std::shared_ptr<Socket> socket;
+            bool evicted;
+            Socket::Status reason;
+            bool want_write;
+        };
+
+        /*!
+         * Queues a frame to a connection, and sends it straight away if nothing's ahead of it.
+         *
+         * @return True if it was queued, false if the connection's been evicted.
+         */
+        bool enqueue(Connection &connection, const std::shared_ptr<const std::string> &frame, std::vector<Event> &events);
+
+        /*!
+         * Sends as much of a connection's queue as possible.
+         */
+        void write(Connection &connection, std::vector<Event> &events);
+
+        /*!
+         * Marks a connection for eviction, which is done by remove_evicted().
+         */
+        void evict(Connection &connection, Socket::Status reason, std::vector<Event> &events);
+
+        /*!
+         * Removes and shuts down connections which were evicted, once nothing is looping over them.
+         */
+        void remove_evicted(const std::vector<Event> &events);
+
+        /*!
+         * Removes a connection from the hub and its topics.
+         */
+        void erase(Socket *socket);
+
+        /*!
+         * Passes events to the handlers. Called without the hub being locked, so that handlers can use it.
+         */
+        void dispatch(const std::vector<Event> &events);
+
+        mutable std::mutex mutex;
+        std::unordered_map<Socket*, Connection> connections;
+        std::unordered_map<std::string, std::unordered_set<Socket*>> topics;
+        size_t budget;
+        EvictHandler evict_handler;
+        WriteInterestHandler write_interest_handler;
+    };
+}
+
+#endif //FRNETLIB_WEBSOCKETHUB_H
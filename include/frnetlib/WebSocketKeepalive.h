@@ -0,0 +1,106 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#ifndef FRNETLIB_WEBSOCKETKEEPALIVE_H
+#define FRNETLIB_WEBSOCKETKEEPALIVE_H
+
+#include <map>
+#include <mutex>
+#include <memory>
+#include <chrono>
+#include <functional>
+#include "WebSocket.h"
+
+namespace fr
+{
+    /*!
+     * A timer shared between many WebSocket connections, which calls their check_keepalive() when
+     * their keepalive deadlines come up. Rather than having a thread each, run() is called from an event
+     * loop, waiting no longer than time_until_next() in between.
+     *
+     * Connections are held weakly, and dropped once they're destroyed, closed, or have keepalives disabled.
+     */
+    class WebSocketKeepalive
+    {
+    public:
+        /*!
+         * Called when a connection is closed by its keepalive.
+         *
+         * @param socket The connection
+         * @param reason 'Timeout' if too many pings went unanswered. Otherwise the status of the ping which couldn't be sent.
+         */
+        using CloseHandler = std::function<void(const std::shared_ptr<Socket> &socket, Socket::Status reason)>;
+
+        /*!
+         * Adds a connection, once its keepalive policy has been set with WebSocket::set_keepalive().
+         * Each connection should only be added once.
+         *
+         * @param socket The connection to keep alive
+         */
+        template<typename SocketType>
+        void add(const std::shared_ptr<WebSocket<SocketType>> &socket)
+        {
+            std::weak_ptr<WebSocket<SocketType>> weak_socket = socket;
+            schedule(socket->get_keepalive_deadline(), [this, weak_socket](std::chrono::steady_clock::time_point now) {
+                auto socket = weak_socket.lock();
+                if(!socket)
+                    return std::chrono::steady_clock::time_point::max();
+                auto status = socket->check_keepalive(now);
+                if(status != Socket::Status::Success)
+                {
+                    if(status != Socket::Status::Disconnected)
+                        closed(socket, status);
+                    return std::chrono::steady_clock::time_point::max();
+                }
+                return socket->get_keepalive_deadline();
+            });
+        }
+
+        /*!
+         * Checks every connection whose keepalive deadline has passed.
+         *
+         * @param now The current time
+         */
+        void run(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+        /*!
+         * Gets how long until run() next needs calling, for use as a SocketSelector::wait() timeout.
+         *
+         * @param now The current time
+         * @return The time until the next deadline, rounded up. 0 if one has already passed, or -1 if there aren't any connections.
+         */
+        std::chrono::milliseconds time_until_next(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now()) const;
+
+        /*!
+         * Gets the number of connections being kept alive.
+         *
+         * @return The number of connections
+         */
+        size_t size() const;
+
+        /*!
+         * Sets the function to call when a connection is closed by its keepalive, such as to
+         * remove it from a SocketSelector. Should be set before use.
+         *
+         * @param handler The handler to use
+         */
+        void set_close_handler(CloseHandler handler);
+
+    private:
+        /*!
+         * Checks a connection at the time given, returning when it next needs checking,
+         * or time_point::max() if it no longer does.
+         */
+        using Check = std::function<std::chrono::steady_clock::time_point(std::chrono::steady_clock::time_point now)>;
+
+        void schedule(std::chrono::steady_clock::time_point deadline, Check check);
+        void closed(const std::shared_ptr<Socket> &socket, Socket::Status reason);
+
+        mutable std::mutex mutex;
+        std::multimap<std::chrono::steady_clock::time_point, Check> checks;
+        CloseHandler close_handler;
+    };
+}
+
+#endif //FRNETLIB_WEBSOCKETKEEPALIVE_H
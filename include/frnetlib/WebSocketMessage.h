@@ -0,0 +1,300 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#ifndef FRNETLIB_WEBSOCKETMESSAGE_H
+#define FRNETLIB_WEBSOCKETMESSAGE_H
+
+#include <string>
+#include <functional>
+#include "Sendable.h"
+#include "WebFrame.h"
+#include "PerMessageDeflate.h"
+#include "Utf8Validator.h"
+
+namespace fr
+{
+    /*!
+     * A whole WebSocket message, which may be split across any number of frames.
+     *
+     * When sent, the payload is split into frames of at most set_fragment_size() bytes, so that
+     * one large message doesn't hold up the connection, and other frames (such as pings) can be
+     * sent between them with send_fragment().
+     *
+     * When received, fragments are put back together into one payload. Control frames (Ping,
+     * Pong and Disconnect) can arrive between the fragments of a message, and are returned as
+     * messages of their own, with the rest of the message following on the next call. So one
+     * WebSocketMessage should be used for everything received on a connection. If a payload sink
+     * is set, then fragments are passed to it as they arrive, instead of being kept in memory.
+     *
+     * If a connection has negotiated permessage-deflate, then sending or receiving through its WebSocket
+     * compresses and decompresses messages as they go. Through any other socket, they're sent as they are.
+     */
+    class WebSocketMessage : public fr::Sendable
+    {
+    public:
+        /*!
+         * Receives each part of a message's payload as it arrives, in order.
+         *
+         * @param data The next part of the payload
+         * @param size The number of bytes of data
+         * @return True to carry on, false to abort the receive, which then returns 'Error'.
+         */
+        using PayloadSink = std::function<bool(const char *data, size_t size)>;
+
+        /*!
+         * Constructs the message.
+         *
+         * @param type The opcode of the message. Text by default.
+         */
+        explicit WebSocketMessage(WebFrame::Opcode type = WebFrame::Opcode::Text);
+
+        /*!
+         * Gets the message's payload. Empty if it was received into a payload sink.
+         *
+         * @return The payload
+         */
+        inline const std::string &get_payload() const
+        {
+            return payload;
+        }
+
+        /*!
+         * Sets the message's payload.
+         *
+         * @param payload_ The payload to send
+         */
+        inline void set_payload(std::string payload_)
+        {
+            payload = std::move(payload_);
+        }
+
+        /*!
+         * Gets the message's opcode. This is never Continuation.
+         *
+         * @return The opcode
+         */
+        inline WebFrame::Opcode get_opcode() const
+        {
+            return opcode;
+        }
+
+        /*!
+         * Sets the message's opcode. Text or Binary for data, or Ping, Pong or Disconnect
+         * for control messages, which are always sent in one frame.
+         *
+         * @param opcode_ The opcode to use
+         */
+        inline void set_opcode(WebFrame::Opcode opcode_)
+        {
+            opcode = opcode_;
+        }
+
+        /*!
+         * Sets the largest frame which a message's payload is split into when sent. Defaults to 64KiB.
+         *
+         * @throws std::logic_error if size is 0
+         * @param size The maximum payload size of each frame in bytes
+         */
+        void set_fragment_size(size_t size);
+
+        /*!
+         * Sets the largest message to accept, and the largest frame when using parse().
+         * Without a payload sink, it also limits the total size of fragmented messages.
+         * Defaults to 0: the socket's maximum receive size for receive(), and no limit for parse().
+         *
+         * @param size The maximum size in bytes. 0 for the default.
+         */
+        inline void set_max_size(uint64_t size)
+        {
+            max_size = size;
+        }
+
+        /*!
+         * Reserves room for the next message to be reassembled into, for when its size is
+         * roughly known, to save it being reallocated as fragments arrive.
+         *
+         * @param size The number of bytes to reserve
+         */
+        inline void reserve(size_t size)
+        {
+            partial.reserve(size);
+        }
+
+        /*!
+         * Sets a sink which is given data messages' payloads as they arrive, a frame at a time,
+         * rather than having them put together in memory. Control messages are still received as usual.
+         *
+         * @param sink The sink to use. Pass {} to go back to collecting the payload.
+         */
+        inline void set_payload_sink(PayloadSink sink)
+        {
+            payload_sink = std::move(sink);
+        }
+
+        /*!
+         * Sets whether received Text messages are checked to be valid UTF-8. Each fragment's checked as
+         * it arrives, so an invalid message is rejected as soon as it goes wrong. Disabled by default.
+         *
+         * @param validate True to check Text messages, false not to.
+         */
+        inline void set_validate_utf8(bool validate)
+        {
+            validate_utf8 = validate;
+        }
+
+        /*!
+         * Sends the message, split into as many frames as it needs.
+         *
+         * @param socket The socket to send through
+         * @return Status indicating if the send succeeded or not.
+         */
+        Socket::Status send(Socket *socket) const override;
+
+        /*!
+         * Sends the message, compressing it if the connection's negotiated permessage-deflate.
+         *
+         * @param socket The socket to send through
+         * @param compression The connection's compression state. nullptr to send the message as it is.
+         * @return Status indicating if the send succeeded or not.
+         */
+        Socket::Status send(Socket *socket, PerMessageDeflate *compression) const;
+
+        /*!
+         * Sends the next frame of the message, so that other frames can be sent between them.
+         * Call it until offset reaches the size of the payload (at least once, for an empty payload).
+         * If the message is compressed, then no other data messages can be sent until it's finished.
+         *
+         * @param socket The socket to send through
+         * @param offset How much of the payload has been sent. Should start at 0, and is moved on by each frame sent.
+         * @param compression The connection's compression state. nullptr (default) to send the message as it is.
+         * @return Status indicating if the send succeeded or not.
+         */
+        Socket::Status send_fragment(Socket *socket, size_t &offset, PerMessageDeflate *compression = nullptr) const;
+
+        /*!
+         * Receives frames until a whole message, or a control frame, has arrived.
+         *
+         * @param socket The socket to receive from
+         * @return Status indicating if the receive succeeded or not:
+         * 'Success': A message was received.
+         * 'WouldBlock' or 'Timeout': Nothing more was received. Any partial message is kept for the next call.
+         * 'MaxPacketSizeExceeded': The message or a frame was too big.
+         * 'InvalidPayload': A Text message wasn't valid UTF-8, and UTF-8 validation is enabled.
+         * 'Error': The frames were out of order, or the payload sink asked to stop.
+         * Anything else: Object invalid. Call disconnect().
+         */
+        Socket::Status receive(Socket *socket) override;
+
+        /*!
+         * Receives frames until a whole message, or a control frame, has arrived, decompressing
+         * them if the connection's negotiated permessage-deflate.
+         *
+         * @param socket The socket to receive from
+         * @param compression The connection's compression state. nullptr if there isn't any, in
+         * which case compressed messages are rejected with 'Error'.
+         * @return Status indicating if the receive succeeded or not, as with receive().
+         * 'ParseError' if a compressed message is corrupt.
+         */
+        Socket::Status receive(Socket *socket, PerMessageDeflate *compression);
+
+        /*!
+         * Parses a message from received data, a piece at a time, as with WebFrame::parse().
+         *
+         * @param data The received data
+         * @param size The number of bytes of data
+         * @param consumed Set to the number of bytes of data which belonged to this message
+         * @param compression The connection's compression state. nullptr (default) if there isn't any.
+         * @param max_message_size The largest message to accept, on top of set_max_size(). 0 (default) for no extra limit.
+         * @return 'NotEnoughData' if all of data was consumed and more is needed. 'Success' once
+         * a message is complete. Anything else on error, as with receive().
+         */
+        Socket::Status parse(const char *data, size_t size, size_t &consumed, PerMessageDeflate *compression = nullptr, uint64_t max_message_size = 0);
+
+        /*!
+         * Checks if the message is used in a client component or in a server component
+         *
+         * @return True if it's the client component. False otherwise.
+         */
+        virtual bool is_client() const = 0;
+
+    private:
+        //A frame which is sent or received on behalf of the message
+        class MessageFrame : public WebFrame
+        {
+        public:
+            bool is_client() const override
+            {
+                return client;
+            }
+
+            bool client = false;
+        };
+
+        /*!
+         * Adds a frame to the message being received.
+         *
+         * @return 'NotEnoughData' if more fragments are needed. 'Success' if a message is complete. Anything else on error.
+         */
+        Socket::Status add_frame(uint64_t max_message_size, PerMessageDeflate *compression);
+
+        /*!
+         * Checks that a data frame carries on the message being received, or starts a new one.
+         *
+         * @return 'Success' if it does, 'Error' if it's out of order.
+         */
+        Socket::Status start_frame(PerMessageDeflate *compression);
+
+        /*!
+         * Inflates and checks part of a data frame's payload, and passes it to the payload sink.
+         *
+         * @param last True if it's the end of the message
+         */
+        Socket::Status add_to_sink(const char *data, size_t size, bool last, uint64_t max_message_size, PerMessageDeflate *compression);
+
+        /*!
+         * Checks the next part of a text message, if UTF-8 validation's enabled.
+         *
+         * @param last True if it's the end of the message
+         * @return False if the text's invalid, true otherwise.
+         */
+        bool check_text(const char *data, size_t size, bool last);
+
+        /*!
+         * Hands over the message that's been put together.
+         */
+        Socket::Status finish_message();
+
+        std::string payload;
+        WebFrame::Opcode opcode;
+        size_t fragment_size;
+        uint64_t max_size;
+        PayloadSink payload_sink;
+        bool validate_utf8;
+
+        //The state of the message being received, between calls
+        MessageFrame frame;
+        std::string partial;
+        WebFrame::Opcode partial_opcode;
+        uint64_t partial_size;
+        bool partial_compressed;
+        bool in_message;
+        Utf8Validator validator;
+    };
+
+    class ClientWebSocketMessage : public fr::WebSocketMessage
+    {
+    public:
+        using WebSocketMessage::WebSocketMessage;
+        bool is_client() const override { return true; }
+    };
+
+    class ServerWebSocketMessage : public fr::WebSocketMessage
+    {
+    public:
+        using WebSocketMessage::WebSocketMessage;
+        bool is_client() const override { return false; }
+    };
+}
+
+#endif //FRNETLIB_WEBSOCKETMESSAGE_H
@@ -0,0 +1,88 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#include <cstring>
+#include <stdexcept>
+#ifndef _WIN32
+#include <arpa/inet.h>
+#endif
+#include "frnetlib/Address.h"
+
+namespace fr
+{
+    Address::Address()
+    : storage(),
+      length(0)
+    {
+        storage.ss_family = AF_UNSPEC;
+    }
+
+    Address::Address(const sockaddr *address, socklen_t length_)
+    : Address()
+    {
+        if((address->sa_family != AF_INET || length_ < sizeof(sockaddr_in)) && (address->sa_family != AF_INET6 || length_ < sizeof(sockaddr_in6)))
+            throw std::logic_error("Address only supports IPv4 and IPv6 socket addresses");
+        length = address->sa_family == AF_INET ? sizeof(sockaddr_in) : sizeof(sockaddr_in6);
+        memcpy(&storage, address, length);
+    }
+
+    bool Address::parse(const std::string &ip, Address &address)
+    {
+        address = Address();
+        auto *ipv4 = reinterpret_cast<sockaddr_in*>(&address.storage);
+        if(inet_pton(AF_INET, ip.c_str(), &ipv4->sin_addr) == 1)
+        {
+            ipv4->sin_family = AF_INET;
+            address.length = sizeof(sockaddr_in);
+            return true;
+        }
+
+        auto *ipv6 = reinterpret_cast<sockaddr_in6*>(&address.storage);
+        if(inet_pton(AF_INET6, ip.c_str(), &ipv6->sin6_addr) == 1)
+        {
+            ipv6->sin6_family = AF_INET6;
+            address.length = sizeof(sockaddr_in6);
+            return true;
+        }
+        return false;
+    }
+
+    uint16_t Address::get_port() const
+    {
+        if(storage.ss_family == AF_INET)
+            return ntohs(reinterpret_cast<const sockaddr_in*>(&storage)->sin_port);
+        if(storage.ss_family == AF_INET6)
+            return ntohs(reinterpret_cast<const sockaddr_in6*>(&storage)->sin6_port);
+        return 0;
+    }
+
+    void Address::set_port(uint16_t port)
+    {
+        if(storage.ss_family == AF_INET)
+            reinterpret_cast<sockaddr_in*>(&storage)->sin_port = htons(port);
+        else if(storage.ss_family == AF_INET6)
+            reinterpret_cast<sockaddr_in6*>(&storage)->sin6_port = htons(port);
+    }
+
+    std::string Address::to_string() const
+    {
+        char buffer[INET6_ADDRSTRLEN] = {0};
+        if(storage.ss_family == AF_INET)
+            inet_ntop(AF_INET, &reinterpret_cast<const sockaddr_in*>(&storage)->sin_addr, buffer, sizeof(buffer));
+        else if(storage.ss_family == AF_INET6)
+            inet_ntop(AF_INET6, &reinterpret_cast<const sockaddr_in6*>(&storage)->sin6_addr, buffer, sizeof(buffer));
+        return buffer;
+    }
+
+    bool Address::operator==(const Address &other) const
+    {
+        if(storage.ss_family != other.storage.ss_family || get_port() != other.get_port())
+            return false;
+        if(storage.ss_family == AF_INET)
+            return memcmp(&reinterpret_cast<const sockaddr_in*>(&storage)->sin_addr, &reinterpret_cast<const sockaddr_in*>(&other.storage)->sin_addr, sizeof(in_addr)) == 0;
+        if(storage.ss_family == AF_INET6)
+            return memcmp(&reinterpret_cast<const sockaddr_in6*>(&storage)->sin6_addr, &reinterpret_cast<const sockaddr_in6*>(&other.storage)->sin6_addr, sizeof(in6_addr)) == 0;
+        return true;
+    }
+}
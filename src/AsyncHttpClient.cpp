@@ -0,0 +1,311 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#include <iterator>
+#include <algorithm>
+#include "frnetlib/AsyncHttpClient.h"
+#include "frnetlib/HttpClient.h"
+#include "frnetlib/TcpSocket.h"
+
+#define DEFAULT_MAX_PIPELINE_DEPTH 8
+#define DEFAULT_CONNECT_TIMEOUT 20 //Seconds
+
+namespace fr
+{
+    AsyncHttpClient::AsyncHttpClient()
+    : outstanding(0),
+      max_pipeline_depth(DEFAULT_MAX_PIPELINE_DEPTH),
+      connect_timeout(0)
+    {
+
+    }
+
+    void AsyncHttpClient::request(const URL &url, HttpRequest request, Callback callback)
+    {
+        ++outstanding;
+        if(url.get_scheme() != URL::HTTP)
+        {
+            completions.push_back({std::move(callback), url.get_scheme() == URL::HTTPS ? Socket::Status::SSLError : Socket::Status::Error, {}});
+            return;
+        }
+
+        HttpClient::prepare_request(url, request);
+        auto &connection = connections[url.get_host() + ":" + url.get_port()];
+        if(!connection)
+        {
+            connection.reset(new Connection());
+            connection->url = url;
+        }
+
+        Pending pending;
+        pending.request = std::move(request);
+        pending.callback = std::move(callback);
+        connection->queued.emplace_back(std::move(pending));
+    }
+
+    size_t AsyncHttpClient::poll(std::chrono::milliseconds timeout)
+    {
+        for(auto &connection : connections)
+            flush(*connection.second);
+
+        //Only wait if there's nothing to report yet
+        if(completions.empty() && outstanding > 0)
+        {
+            //Don't wait past the point where a connect should give up
+            auto now = std::chrono::steady_clock::now();
+            for(auto &connection : connections)
+            {
+                if(!connection.second->socket || !connection.second->socket->connecting())
+                    continue;
+                auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(connection.second->connect_expiry - now) + std::chrono::milliseconds(1);
+                remaining = std::max(remaining, std::chrono::milliseconds(0));
+                if(timeout.count() < 0 || remaining < timeout)
+                    timeout = remaining;
+            }
+
+            for(auto &event : selector.wait(timeout))
+            {
+                auto &connection = *static_cast<Connection*>(event.second);
+                if(connection.socket && connection.socket->connecting())
+                    finish_connect(connection);
+                else
+                    receive(connection);
+            }
+
+            now = std::chrono::steady_clock::now();
+            for(auto &connection : connections)
+            {
+                if(connection.second->socket && connection.second->socket->connecting() && now >= connection.second->connect_expiry)
+                    fail_connect(*connection.second, Socket::Status::Timeout);
+            }
+            for(auto &connection : connections)
+                flush(*connection.second);
+        }
+
+        //Forget about hosts which have nothing left going on
+        for(auto iter = connections.begin(); iter != connections.end();)
+        {
+            if(!iter->second->socket && iter->second->queued.empty())
+                iter = connections.erase(iter);
+            else
+                ++iter;
+        }
+
+        //Callbacks might queue more requests, so only call them once everything else is done
+        auto completed = std::move(completions);
+        completions.clear();
+        outstanding -= completed.size();
+        for(auto &completion : completed)
+            completion.callback(completion.status, completion.response);
+        return outstanding;
+    }
+
+    void AsyncHttpClient::run()
+    {
+        while(poll() > 0);
+    }
+
+    void AsyncHttpClient::flush(Connection &connection)
+    {
+        if(connection.queued.empty() && connection.output.empty())
+            return;
+
+        //Nothing can be sent until the connection's open
+        if(connection.socket && connection.socket->connecting())
+            return;
+
+        //The server might have closed an idle connection while nothing was happening on it
+        if(connection.socket && connection.in_flight.empty())
+            receive(connection);
+
+        if(!connection.socket)
+        {
+            auto socket = std::make_shared<TcpSocket>();
+            auto status = socket->connect_async(connection.url.get_host(), connection.url.get_port().empty() ? "80" : connection.url.get_port());
+            if(status == Socket::Status::Success)
+                status = socket->set_blocking(false);
+            if(status != Socket::Status::Success && status != Socket::Status::Connecting)
+            {
+                fail_connect(connection, status);
+                return;
+            }
+
+            connection.want_write = status == Socket::Status::Connecting;
+            connection.connect_expiry = std::chrono::steady_clock::now() + (connect_timeout.count() == 0 ? std::chrono::seconds(DEFAULT_CONNECT_TIMEOUT) : connect_timeout);
+            selector.add(socket, &connection, connection.want_write);
+            connection.socket = std::move(socket);
+            if(connection.want_write)
+                return;
+        }
+
+        //Move as many requests into the pipeline as it can take. Nothing is pipelined together
+        //with a request which can't be repeated, so that it's never caught up in another's failure.
+        while(!connection.queued.empty() && connection.in_flight.size() < max_pipeline_depth)
+        {
+            if(!connection.in_flight.empty() && (!HttpClient::is_idempotent(connection.queued.front().request.get_type()) || !HttpClient::is_idempotent(connection.in_flight.back().request.get_type())))
+                break;
+            connection.output += connection.queued.front().request.construct(connection.url.get_host());
+            connection.in_flight.emplace_back(std::move(connection.queued.front()));
+            connection.queued.pop_front();
+        }
+
+        if(connection.output.empty())
+            return;
+        auto status = connection.socket->send_raw(connection.output.data(), connection.output.size(), connection.output_sent);
+        if(status != Socket::Status::Success && status != Socket::Status::WouldBlock)
+        {
+            close(connection, status, false);
+            return;
+        }
+        if(connection.output_sent == connection.output.size())
+        {
+            connection.output.clear();
+            connection.output_sent = 0;
+        }
+
+        //Wait for room in the send buffer if it's full, rather than trying again and again
+        bool want_write = !connection.output.empty();
+        if(want_write != connection.want_write)
+        {
+            selector.set_write_interest(connection.socket, want_write);
+            connection.want_write = want_write;
+        }
+    }
+
+    void AsyncHttpClient::finish_connect(Connection &connection)
+    {
+        auto status = connection.socket->finish_connect();
+        if(status == Socket::Status::Connecting)
+        {
+            //It's moved on to another of the host's addresses, which has a new descriptor
+            selector.set_write_interest(connection.socket, true);
+            return;
+        }
+        if(status == Socket::Status::Success)
+            status = connection.socket->set_blocking(false);
+        if(status != Socket::Status::Success)
+        {
+            fail_connect(connection, status);
+            return;
+        }
+
+        //flush() takes it from here, and waits for writability again if it needs to
+        selector.set_write_interest(connection.socket, false);
+        connection.want_write = false;
+    }
+
+    void AsyncHttpClient::fail_connect(Connection &connection, Socket::Status status)
+    {
+        selector.remove(connection.socket);
+        connection.socket.reset();
+        connection.want_write = false;
+        for(auto &pending : connection.queued)
+            completions.push_back({std::move(pending.callback), status, {}});
+        connection.queued.clear();
+    }
+
+    void AsyncHttpClient::receive(Connection &connection)
+    {
+        char recv_buffer[RECV_CHUNK_SIZE];
+        while(connection.socket)
+        {
+            size_t received = 0;
+            auto status = connection.socket->receive_raw(recv_buffer, RECV_CHUNK_SIZE, received);
+            if(status == Socket::Status::WouldBlock)
+                return;
+            if(status != Socket::Status::Success)
+            {
+                close(connection, status, false);
+                return;
+            }
+            if(!feed(connection, recv_buffer, received))
+                return;
+        }
+    }
+
+    bool AsyncHttpClient::feed(Connection &connection, const char *data, size_t size)
+    {
+        std::string excess;
+        while(true)
+        {
+            //Nothing should arrive unless a response is expected
+            if(connection.in_flight.empty())
+            {
+                close(connection, Socket::Status::ParseError, false);
+                return false;
+            }
+
+            auto status = connection.response.parse(data, size);
+            if(status == Socket::Status::NotEnoughData)
+                return true;
+
+            //Whatever came after this response is the start of the next one
+            Pending pending = std::move(connection.in_flight.front());
+            connection.in_flight.pop_front();
+            bool reusable = status == Socket::Status::Success && HttpClient::is_reusable(pending.request, connection.response);
+            excess = connection.response.get_excess_data();
+            completions.push_back({std::move(pending.callback), status, std::move(connection.response)});
+            connection.response = HttpResponse();
+
+            //The server might have said that it's closing the connection, in which case it won't
+            //have answered anything after this, and so the rest can be safely sent again.
+            if(!reusable)
+            {
+                close(connection, Socket::Status::Disconnected, status == Socket::Status::Success);
+                return false;
+            }
+            if(excess.empty())
+                return true;
+            data = excess.data();
+            size = excess.size();
+        }
+    }
+
+    void AsyncHttpClient::close(Connection &connection, Socket::Status status, bool graceful)
+    {
+        selector.remove(connection.socket);
+        connection.socket.reset();
+        connection.want_write = false;
+        connection.response = HttpResponse();
+        connection.output.clear();
+        connection.output_sent = 0;
+
+        //Requests which weren't answered go back to the front of the queue, in order, if they can be repeated
+        std::deque<Pending> retry;
+        for(auto &pending : connection.in_flight)
+        {
+            if(graceful || (!pending.retried && HttpClient::is_idempotent(pending.request.get_type())))
+            {
+                pending.retried = pending.retried || !graceful;
+                retry.emplace_back(std::move(pending));
+            }
+            else
+            {
+                completions.push_back({std::move(pending.callback), status, {}});
+            }
+        }
+        connection.in_flight.clear();
+        connection.queued.insert(connection.queued.begin(), std::make_move_iterator(retry.begin()), std::make_move_iterator(retry.end()));
+    }
+
+    void AsyncHttpClient::set_max_pipeline_depth(size_t depth)
+    {
+        if(depth == 0)
+            throw std::logic_error("AsyncHttpClient needs to allow at least one request in flight per connection");
+        max_pipeline_depth = depth;
+    }
+
+    void AsyncHttpClient::set_connect_timeout(std::chrono::seconds timeout)
+    {
+        connect_timeout = timeout;
+    }
+
+    size_t AsyncHttpClient::get_connection_count() const
+    {
+        size_t count = 0;
+        for(auto &connection : connections)
+            count += connection.second->socket != nullptr;
+        return count;
+    }
+}
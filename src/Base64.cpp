@@ -2,45 +2,123 @@
 // Created by fred on 01/03/18.
 //
 
+#include <cstdint>
 #include "frnetlib/Base64.h"
 
+#define BASE64_INVALID 0xFF //Marks characters which aren't part of the Base64 alphabet in the decode table
+
 namespace fr
 {
+    namespace
+    {
+        const char base64_table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+        //Maps each character back to its 6 bits
+        struct DecodeTable
+        {
+            DecodeTable()
+            {
+                for(auto &value : values)
+                    value = BASE64_INVALID;
+                for(uint8_t a = 0; a < 64; ++a)
+                    values[static_cast<uint8_t>(base64_table[a])] = a;
+            }
+
+            uint8_t values[256];
+        };
+    }
+
     std::string Base64::encode(const std::string &input)
     {
-        static const std::string base64_table = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        return encode(input.data(), input.size());
+    }
 
-        std::string out;
-        out.reserve(input.size() + (input.size() / 3) + 1);
+    std::string Base64::encode(const char *data, size_t size)
+    {
+        //The output's sized up front, and written straight into
+        std::string out((size + 2) / 3 * 4, '\0');
+        auto *in = reinterpret_cast<const uint8_t*>(data);
+        char *pos = &out[0];
         size_t a;
 
-        //Do as many sets of 3 bytes as we can
-        for(a = 0; a < input.size() - 2; a += 3)
+        //Do as many sets of 3 bytes as we can, each of which becomes 4 sets of 6 bits
+        for(a = 0; a + 3 <= size; a += 3)
+        {
+            uint32_t bits = (uint32_t)in[a] << 16 | (uint32_t)in[a + 1] << 8 | in[a + 2];
+            pos[0] = base64_table[bits >> 18];
+            pos[1] = base64_table[(bits >> 12) & 0x3F];
+            pos[2] = base64_table[(bits >> 6) & 0x3F];
+            pos[3] = base64_table[bits & 0x3F];
+            pos += 4;
+        }
+
+        //Then pad out whatever's left over
+        if(a < size)
         {
-            out += base64_table[(input[a] >> 2) & 0x3F]; //Store the first 6 bits of the first byte
-            out += base64_table[((input[a] & 0x3) << 4) | (input[a + 1] & 0xF0) >> 4]; //Store the last 2 bits of the first byte combined with the first 4 bits of the second byte
-            out += base64_table[((input[a + 1] & 0xF) << 2) | (input[a + 2] & 0xC0) >> 6]; //Store the last 4 bits of the second byte combined with the first 2 bits of the third byte
-            out += base64_table[input[a + 2] & 0x3F]; //Store the last 6 bits of the third byte
+            uint32_t bits = (uint32_t)in[a] << 16 | (a + 1 < size ? (uint32_t)in[a + 1] << 8 : 0);
+            pos[0] = base64_table[bits >> 18];
+            pos[1] = base64_table[(bits >> 12) & 0x3F];
+            pos[2] = a + 1 < size ? base64_table[(bits >> 6) & 0x3F] : '=';
+            pos[3] = '=';
         }
 
-        //Check if there's a remainder
-        if(a < input.size())
+        return out;
+    }
+
+    bool Base64::decode(const char *data, size_t size, std::string &out)
+    {
+        if(size % 4 != 0)
+            return false;
+        if(size == 0)
+            return true;
+        static const DecodeTable decode_table;
+
+        size_t padding = data[size - 1] == '=' ? (data[size - 2] == '=' ? 2 : 1) : 0;
+        size_t out_start = out.size();
+        out.resize(out_start + size / 4 * 3 - padding);
+        auto *in = reinterpret_cast<const uint8_t*>(data);
+        char *pos = &out[out_start];
+
+        //Each 4 characters become 3 bytes. Invalid characters have their top bit set, so are caught all at once.
+        size_t whole = padding ? size - 4 : size;
+        for(size_t a = 0; a < whole; a += 4)
         {
-            out += base64_table[(input[a] >> 2) & 0x3F]; //Store first 6 bits of the first byte
-            if(a == input.size() - 2) //There's 2 bytes left
+            uint8_t c0 = decode_table.values[in[a]], c1 = decode_table.values[in[a + 1]];
+            uint8_t c2 = decode_table.values[in[a + 2]], c3 = decode_table.values[in[a + 3]];
+            if((c0 | c1 | c2 | c3) & 0x80)
             {
-                out += base64_table[((input[a] & 0x3) << 4) | (input[a + 1] & 0xF0) >> 4]; //Store last 2 bits of first byte, and first 4 bits of second byte
-                out += base64_table[(input[a + 1] & 0xF) << 2]; //Finally store the last 4 bits of the second byte
-                out += "=";
+                out.resize(out_start);
+                return false;
             }
-            else //There's 1 byte left
+            uint32_t bits = (uint32_t)c0 << 18 | (uint32_t)c1 << 12 | (uint32_t)c2 << 6 | c3;
+            pos[0] = static_cast<char>(bits >> 16);
+            pos[1] = static_cast<char>(bits >> 8);
+            pos[2] = static_cast<char>(bits);
+            pos += 3;
+        }
+
+        //The last 4 characters hold 1 or 2 bytes if they're padded, with the bits left over being 0
+        if(padding)
+        {
+            size_t a = size - 4;
+            uint8_t c0 = decode_table.values[in[a]], c1 = decode_table.values[in[a + 1]];
+            uint8_t c2 = padding == 1 ? decode_table.values[in[a + 2]] : 0;
+            uint32_t bits = (uint32_t)c0 << 18 | (uint32_t)c1 << 12 | (uint32_t)c2 << 6;
+            if(((c0 | c1 | c2) & 0x80) || (bits & (padding == 1 ? 0xFF : 0xFFFF)))
             {
-                out += base64_table[(input[a] & 0x3) << 4]; //Store last 2 bits of first byte
-                out += "==";
+                out.resize(out_start);
+                return false;
             }
+            pos[0] = static_cast<char>(bits >> 16);
+            if(padding == 1)
+                pos[1] = static_cast<char>(bits >> 8);
         }
 
-        return out;
+        return true;
     }
 
+    bool Base64::decode(const std::string &input, std::string &out)
+    {
+        return decode(input.data(), input.size(), out);
+    }
 }
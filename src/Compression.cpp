@@ -0,0 +1,137 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#include <zlib.h>
+#include <stdexcept>
+#include "frnetlib/Compression.h"
+
+#define INFLATE_CHUNK_SIZE 16384 //How much data to try and inflate at once
+#define DEFLATE_CHUNK_SIZE 16384 //How much compressed output to collect at once
+
+namespace fr
+{
+    Inflater::Inflater(Inflater::Format format, uint8_t window_bits)
+    : stream(new z_stream_s{}),
+      stream_ended(false)
+    {
+        int z_window_bits = window_bits;
+        switch(format)
+        {
+            case Format::Zlib:
+                break;
+            case Format::Gzip:
+                z_window_bits += 16;
+                break;
+            case Format::Raw:
+                z_window_bits = -z_window_bits;
+                break;
+            default:
+                z_window_bits += 32;
+                break;
+        }
+
+        int ret = inflateInit2(stream.get(), z_window_bits);
+        if(ret != Z_OK)
+        {
+            throw std::runtime_error("Failed to initialise zlib inflate stream. Returned error: " + std::to_string(ret));
+        }
+    }
+
+    Inflater::Inflater(const Inflater &other)
+    : stream(new z_stream_s{}),
+      stream_ended(other.stream_ended)
+    {
+        int ret = inflateCopy(stream.get(), other.stream.get());
+        if(ret != Z_OK)
+        {
+            throw std::runtime_error("Failed to copy zlib inflate stream. Returned error: " + std::to_string(ret));
+        }
+    }
+
+    Inflater::~Inflater()
+    {
+        inflateEnd(stream.get());
+    }
+
+    Socket::Status Inflater::inflate(const char *data, size_t datasz, std::string &out, size_t max_out)
+    {
+        if(stream_ended)
+            return Socket::Status::Success;
+
+        char buffer[INFLATE_CHUNK_SIZE];
+        size_t produced = 0;
+        stream->next_in = (Bytef*)data;
+        stream->avail_in = static_cast<uInt>(datasz);
+
+        do
+        {
+            stream->next_out = (Bytef*)buffer;
+            stream->avail_out = sizeof(buffer);
+            int ret = ::inflate(stream.get(), Z_NO_FLUSH);
+            if(ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR)
+                return Socket::Status::ParseError;
+
+            //Ensure that the output doesn't exceed the caller's limit before storing it
+            size_t have = sizeof(buffer) - stream->avail_out;
+            produced += have;
+            if(produced > max_out)
+                return Socket::Status::MaxPacketSizeExceeded;
+            out.append(buffer, have);
+
+            if(ret == Z_STREAM_END)
+            {
+                stream_ended = true;
+                return Socket::Status::Success;
+            }
+
+            //Z_BUF_ERROR means no progress could be made, so more input is required
+            if(ret == Z_BUF_ERROR)
+                break;
+        } while(stream->avail_in > 0 || stream->avail_out == 0);
+
+        return Socket::Status::NotEnoughData;
+    }
+
+    Deflater::Deflater(Deflater::Format format, int level, uint8_t window_bits, uint8_t memory_level)
+    : stream(new z_stream_s{})
+    {
+        int z_window_bits = window_bits;
+        if(format == Format::Gzip)
+            z_window_bits += 16;
+        else if(format == Format::Raw)
+            z_window_bits = -z_window_bits;
+
+        int ret = deflateInit2(stream.get(), level, Z_DEFLATED, z_window_bits, memory_level, Z_DEFAULT_STRATEGY);
+        if(ret != Z_OK)
+        {
+            throw std::runtime_error("Failed to initialise zlib deflate stream. Returned error: " + std::to_string(ret));
+        }
+    }
+
+    Deflater::~Deflater()
+    {
+        deflateEnd(stream.get());
+    }
+
+    Socket::Status Deflater::deflate(const char *data, size_t datasz, std::string &out, Deflater::Flush flush)
+    {
+        int z_flush = flush == Flush::Sync ? Z_SYNC_FLUSH : flush == Flush::Finish ? Z_FINISH : Z_NO_FLUSH;
+        char buffer[DEFLATE_CHUNK_SIZE];
+        stream->next_in = (Bytef*)data;
+        stream->avail_in = static_cast<uInt>(datasz);
+
+        //Keep going until zlib has room left over, meaning it's output everything it's going to
+        do
+        {
+            stream->next_out = (Bytef*)buffer;
+            stream->avail_out = sizeof(buffer);
+            int ret = ::deflate(stream.get(), z_flush);
+            if(ret == Z_STREAM_ERROR)
+                return Socket::Status::Error;
+            out.append(buffer, sizeof(buffer) - stream->avail_out);
+        } while(stream->avail_out == 0);
+
+        return Socket::Status::Success;
+    }
+}
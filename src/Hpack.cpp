@@ -0,0 +1,531 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#include <algorithm>
+#include "frnetlib/Hpack.h"
+
+namespace fr
+{
+    namespace
+    {
+        struct HuffmanCode
+        {
+            uint32_t code;
+            uint8_t bits;
+        };
+
+        //RFC 7541 Appendix B. Indexed by symbol, the last entry is EOS.
+        const HuffmanCode huffman_table[257] = {
+                {0x1ff8, 13}, {0x7fffd8, 23}, {0xfffffe2, 28}, {0xfffffe3, 28},
+                {0xfffffe4, 28}, {0xfffffe5, 28}, {0xfffffe6, 28}, {0xfffffe7, 28},
+                {0xfffffe8, 28}, {0xffffea, 24}, {0x3ffffffc, 30}, {0xfffffe9, 28},
+                {0xfffffea, 28}, {0x3ffffffd, 30}, {0xfffffeb, 28}, {0xfffffec, 28},
+                {0xfffffed, 28}, {0xfffffee, 28}, {0xfffffef, 28}, {0xffffff0, 28},
+                {0xffffff1, 28}, {0xffffff2, 28}, {0x3ffffffe, 30}, {0xffffff3, 28},
+                {0xffffff4, 28}, {0xffffff5, 28}, {0xffffff6, 28}, {0xffffff7, 28},
+                {0xffffff8, 28}, {0xffffff9, 28}, {0xffffffa, 28}, {0xffffffb, 28},
+                {0x14, 6}, {0x3f8, 10}, {0x3f9, 10}, {0xffa, 12},
+                {0x1ff9, 13}, {0x15, 6}, {0xf8, 8}, {0x7fa, 11},
+                {0x3fa, 10}, {0x3fb, 10}, {0xf9, 8}, {0x7fb, 11},
+                {0xfa, 8}, {0x16, 6}, {0x17, 6}, {0x18, 6},
+                {0x0, 5}, {0x1, 5}, {0x2, 5}, {0x19, 6},
+                {0x1a, 6}, {0x1b, 6}, {0x1c, 6}, {0x1d, 6},
+                {0x1e, 6}, {0x1f, 6}, {0x5c, 7}, {0xfb, 8},
+                {0x7ffc, 15}, {0x20, 6}, {0xffb, 12}, {0x3fc, 10},
+                {0x1ffa, 13}, {0x21, 6}, {0x5d, 7}, {0x5e, 7},
+                {0x5f, 7}, {0x60, 7}, {0x61, 7}, {0x62, 7},
+                {0x63, 7}, {0x64, 7}, {0x65, 7}, {0x66, 7},
+                {0x67, 7}, {0x68, 7}, {0x69, 7}, {0x6a, 7},
+                {0x6b, 7}, {0x6c, 7}, {0x6d, 7}, {0x6e, 7},
+                {0x6f, 7}, {0x70, 7}, {0x71, 7}, {0x72, 7},
+                {0xfc, 8}, {0x73, 7}, {0xfd, 8}, {0x1ffb, 13},
+                {0x7fff0, 19}, {0x1ffc, 13}, {0x3ffc, 14}, {0x22, 6},
+                {0x7ffd, 15}, {0x3, 5}, {0x23, 6}, {0x4, 5},
+                {0x24, 6}, {0x5, 5}, {0x25, 6}, {0x26, 6},
+                {0x27, 6}, {0x6, 5}, {0x74, 7}, {0x75, 7},
+                {0x28, 6}, {0x29, 6}, {0x2a, 6}, {0x7, 5},
+                {0x2b, 6}, {0x76, 7}, {0x2c, 6}, {0x8, 5},
+                {0x9, 5}, {0x2d, 6}, {0x77, 7}, {0x78, 7},
+                {0x79, 7}, {0x7a, 7}, {0x7b, 7}, {0x7ffe, 15},
+                {0x7fc, 11}, {0x3ffd, 14}, {0x1ffd, 13}, {0xffffffc, 28},
+                {0xfffe6, 20}, {0x3fffd2, 22}, {0xfffe7, 20}, {0xfffe8, 20},
+                {0x3fffd3, 22}, {0x3fffd4, 22}, {0x3fffd5, 22}, {0x7fffd9, 23},
+                {0x3fffd6, 22}, {0x7fffda, 23}, {0x7fffdb, 23}, {0x7fffdc, 23},
+                {0x7fffdd, 23}, {0x7fffde, 23}, {0xffffeb, 24}, {0x7fffdf, 23},
+                {0xffffec, 24}, {0xffffed, 24}, {0x3fffd7, 22}, {0x7fffe0, 23},
+                {0xffffee, 24}, {0x7fffe1, 23}, {0x7fffe2, 23}, {0x7fffe3, 23},
+                {0x7fffe4, 23}, {0x1fffdc, 21}, {0x3fffd8, 22}, {0x7fffe5, 23},
+                {0x3fffd9, 22}, {0x7fffe6, 23}, {0x7fffe7, 23}, {0xffffef, 24},
+                {0x3fffda, 22}, {0x1fffdd, 21}, {0xfffe9, 20}, {0x3fffdb, 22},
+                {0x3fffdc, 22}, {0x7fffe8, 23}, {0x7fffe9, 23}, {0x1fffde, 21},
+                {0x7fffea, 23}, {0x3fffdd, 22}, {0x3fffde, 22}, {0xfffff0, 24},
+                {0x1fffdf, 21}, {0x3fffdf, 22}, {0x7fffeb, 23}, {0x7fffec, 23},
+                {0x1fffe0, 21}, {0x1fffe1, 21}, {0x3fffe0, 22}, {0x1fffe2, 21},
+                {0x7fffed, 23}, {0x3fffe1, 22}, {0x7fffee, 23}, {0x7fffef, 23},
+                {0xfffea, 20}, {0x3fffe2, 22}, {0x3fffe3, 22}, {0x3fffe4, 22},
+                {0x7ffff0, 23}, {0x3fffe5, 22}, {0x3fffe6, 22}, {0x7ffff1, 23},
+                {0x3ffffe0, 26}, {0x3ffffe1, 26}, {0xfffeb, 20}, {0x7fff1, 19},
+                {0x3fffe7, 22}, {0x7ffff2, 23}, {0x3fffe8, 22}, {0x1ffffec, 25},
+                {0x3ffffe2, 26}, {0x3ffffe3, 26}, {0x3ffffe4, 26}, {0x7ffffde, 27},
+                {0x7ffffdf, 27}, {0x3ffffe5, 26}, {0xfffff1, 24}, {0x1ffffed, 25},
+                {0x7fff2, 19}, {0x1fffe3, 21}, {0x3ffffe6, 26}, {0x7ffffe0, 27},
+                {0x7ffffe1, 27}, {0x3ffffe7, 26}, {0x7ffffe2, 27}, {0xfffff2, 24},
+                {0x1fffe4, 21}, {0x1fffe5, 21}, {0x3ffffe8, 26}, {0x3ffffe9, 26},
+                {0xffffffd, 28}, {0x7ffffe3, 27}, {0x7ffffe4, 27}, {0x7ffffe5, 27},
+                {0xfffec, 20}, {0xfffff3, 24}, {0xfffed, 20}, {0x1fffe6, 21},
+                {0x3fffe9, 22}, {0x1fffe7, 21}, {0x1fffe8, 21}, {0x7ffff3, 23},
+                {0x3fffea, 22}, {0x3fffeb, 22}, {0x1ffffee, 25}, {0x1ffffef, 25},
+                {0xfffff4, 24}, {0xfffff5, 24}, {0x3ffffea, 26}, {0x7ffff4, 23},
+                {0x3ffffeb, 26}, {0x7ffffe6, 27}, {0x3ffffec, 26}, {0x3ffffed, 26},
+                {0x7ffffe7, 27}, {0x7ffffe8, 27}, {0x7ffffe9, 27}, {0x7ffffea, 27},
+                {0x7ffffeb, 27}, {0xffffffe, 28}, {0x7ffffec, 27}, {0x7ffffed, 27},
+                {0x7ffffee, 27}, {0x7ffffef, 27}, {0x7fffff0, 27}, {0x3ffffee, 26},
+                {0x3fffffff, 30}
+        };
+
+        //RFC 7541 Appendix A. Index 0 is unused.
+        const Hpack::Header static_table[62] = {
+                {"", ""},
+                {":authority", ""},
+                {":method", "GET"},
+                {":method", "POST"},
+                {":path", "/"},
+                {":path", "/index.html"},
+                {":scheme", "http"},
+                {":scheme", "https"},
+                {":status", "200"},
+                {":status", "204"},
+                {":status", "206"},
+                {":status", "304"},
+                {":status", "400"},
+                {":status", "404"},
+                {":status", "500"},
+                {"accept-charset", ""},
+                {"accept-encoding", "gzip, deflate"},
+                {"accept-language", ""},
+                {"accept-ranges", ""},
+                {"accept", ""},
+                {"access-control-allow-origin", ""},
+                {"age", ""},
+                {"allow", ""},
+                {"authorization", ""},
+                {"cache-control", ""},
+                {"content-disposition", ""},
+                {"content-encoding", ""},
+                {"content-language", ""},
+                {"content-length", ""},
+                {"content-location", ""},
+                {"content-range", ""},
+                {"content-type", ""},
+                {"cookie", ""},
+                {"date", ""},
+                {"etag", ""},
+                {"expect", ""},
+                {"expires", ""},
+                {"from", ""},
+                {"host", ""},
+                {"if-match", ""},
+                {"if-modified-since", ""},
+                {"if-none-match", ""},
+                {"if-range", ""},
+                {"if-unmodified-since", ""},
+                {"last-modified", ""},
+                {"link", ""},
+                {"location", ""},
+                {"max-forwards", ""},
+                {"proxy-authenticate", ""},
+                {"proxy-authorization", ""},
+                {"range", ""},
+                {"referer", ""},
+                {"refresh", ""},
+                {"retry-after", ""},
+                {"server", ""},
+                {"set-cookie", ""},
+                {"strict-transport-security", ""},
+                {"transfer-encoding", ""},
+                {"user-agent", ""},
+                {"vary", ""},
+                {"via", ""},
+                {"www-authenticate", ""},
+        };
+        constexpr size_t STATIC_TABLE_SIZE = 61;
+        constexpr uint16_t HUFFMAN_EOS = 256;
+
+        //A node in the Huffman decoding tree. Leaves have a symbol, other nodes have two children.
+        struct HuffmanNode
+        {
+            int16_t children[2];
+            int16_t symbol;
+        };
+
+        const std::vector<HuffmanNode> &huffman_tree()
+        {
+            static const std::vector<HuffmanNode> tree = []() {
+                std::vector<HuffmanNode> nodes(1, HuffmanNode{{0, 0}, -1});
+                for(int16_t symbol = 0; symbol <= HUFFMAN_EOS; ++symbol)
+                {
+                    const auto &code = huffman_table[symbol];
+                    size_t node = 0;
+                    for(int32_t bit = code.bits - 1; bit >= 0; --bit)
+                    {
+                        auto direction = (code.code >> bit) & 1;
+                        if(nodes[node].children[direction] == 0)
+                        {
+                            nodes[node].children[direction] = static_cast<int16_t>(nodes.size());
+                            nodes.push_back(HuffmanNode{{0, 0}, -1});
+                        }
+                        node = static_cast<size_t>(nodes[node].children[direction]);
+                    }
+                    nodes[node].symbol = symbol;
+                }
+                return nodes;
+            }();
+            return tree;
+        }
+
+        //Headers which shouldn't be added to the compression context, as they might be guessed through it
+        bool is_sensitive(const Hpack::Header &header)
+        {
+            return header.first == "authorization" || header.first == "proxy-authorization" || (header.first == "cookie" && header.second.size() < 20);
+        }
+    }
+
+    void Hpack::encode_integer(uint64_t value, uint8_t prefix_bits, uint8_t flags, std::string &out)
+    {
+        const uint8_t max_prefix = static_cast<uint8_t>((1u << prefix_bits) - 1);
+        if(value < max_prefix)
+        {
+            out.push_back(static_cast<char>(flags | value));
+            return;
+        }
+
+        out.push_back(static_cast<char>(flags | max_prefix));
+        value -= max_prefix;
+        while(value >= 128)
+        {
+            out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    bool Hpack::decode_integer(const uint8_t *&pos, const uint8_t *end, uint8_t prefix_bits, uint64_t &value)
+    {
+        if(pos >= end)
+            return false;
+
+        const uint8_t max_prefix = static_cast<uint8_t>((1u << prefix_bits) - 1);
+        value = *pos++ & max_prefix;
+        if(value < max_prefix)
+            return true;
+
+        //Anything needing more than 56 bits is nonsense, and would overflow
+        for(uint32_t shift = 0; shift <= 56; shift += 7)
+        {
+            if(pos >= end)
+                return false;
+            uint8_t byte = *pos++;
+            value += static_cast<uint64_t>(byte & 0x7F) << shift;
+            if((byte & 0x80) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    void Hpack::huffman_encode(const char *data, size_t size, std::string &out)
+    {
+        uint64_t bits = 0;
+        uint32_t bit_count = 0;
+        for(size_t a = 0; a < size; ++a)
+        {
+            const auto &code = huffman_table[static_cast<uint8_t>(data[a])];
+            bits = (bits << code.bits) | code.code;
+            bit_count += code.bits;
+            while(bit_count >= 8)
+            {
+                bit_count -= 8;
+                out.push_back(static_cast<char>(bits >> bit_count));
+            }
+            bits &= (1u << bit_count) - 1;
+        }
+
+        //Pad the last byte with the most significant bits of EOS, which are all 1s
+        if(bit_count > 0)
+            out.push_back(static_cast<char>((bits << (8 - bit_count)) | (0xFF >> bit_count)));
+    }
+
+    size_t Hpack::huffman_encoded_size(const char *data, size_t size)
+    {
+        size_t bits = 0;
+        for(size_t a = 0; a < size; ++a)
+            bits += huffman_table[static_cast<uint8_t>(data[a])].bits;
+        return (bits + 7) / 8;
+    }
+
+    bool Hpack::huffman_decode(const char *data, size_t size, std::string &out)
+    {
+        const auto &tree = huffman_tree();
+        size_t node = 0;
+        uint32_t pending_bits = 0; //Bits read since the last complete symbol
+        bool pending_ones = true;
+        for(size_t a = 0; a < size; ++a)
+        {
+            auto byte = static_cast<uint8_t>(data[a]);
+            for(int32_t bit = 7; bit >= 0; --bit)
+            {
+                auto direction = (byte >> bit) & 1;
+                node = static_cast<size_t>(tree[node].children[direction]);
+                ++pending_bits;
+                pending_ones &= direction == 1;
+
+                if(tree[node].symbol >= 0)
+                {
+                    if(tree[node].symbol == HUFFMAN_EOS)
+                        return false;
+                    out.push_back(static_cast<char>(tree[node].symbol));
+                    node = 0;
+                    pending_bits = 0;
+                    pending_ones = true;
+                }
+            }
+        }
+
+        //Anything left over must be padding: fewer than 8 bits, and a prefix of EOS
+        return pending_bits < 8 && pending_ones;
+    }
+
+    Hpack::Table::Table(uint32_t max_size_)
+    : size(0),
+      max_size(max_size_)
+    {
+
+    }
+
+    void Hpack::Table::add(std::string name, std::string value)
+    {
+        uint64_t entry_size = name.size() + value.size() + ENTRY_OVERHEAD;
+        if(entry_size > max_size)
+        {
+            entries.clear();
+            size = 0;
+            return;
+        }
+
+        evict(static_cast<uint32_t>(entry_size));
+        entries.emplace_front(std::move(name), std::move(value));
+        size += static_cast<uint32_t>(entry_size);
+    }
+
+    void Hpack::Table::set_max_size(uint32_t size_)
+    {
+        max_size = size_;
+        evict(0);
+    }
+
+    const Hpack::Header *Hpack::Table::get(uint64_t index) const
+    {
+        if(index == 0)
+            return nullptr;
+        if(index <= STATIC_TABLE_SIZE)
+            return &static_table[index];
+        index -= STATIC_TABLE_SIZE + 1;
+        if(index >= entries.size())
+            return nullptr;
+        return &entries[index];
+    }
+
+    uint64_t Hpack::Table::find(const std::string &name, const std::string &value, uint64_t &name_index) const
+    {
+        name_index = 0;
+        for(size_t a = 1; a <= STATIC_TABLE_SIZE; ++a)
+        {
+            if(static_table[a].first == name)
+            {
+                if(static_table[a].second == value)
+                    return a;
+                if(name_index == 0)
+                    name_index = a;
+            }
+        }
+
+        for(size_t a = 0; a < entries.size(); ++a)
+        {
+            if(entries[a].first == name)
+            {
+                if(entries[a].second == value)
+                    return a + STATIC_TABLE_SIZE + 1;
+                if(name_index == 0)
+                    name_index = a + STATIC_TABLE_SIZE + 1;
+            }
+        }
+        return 0;
+    }
+
+    void Hpack::Table::evict(uint32_t required)
+    {
+        while(!entries.empty() && size + required > max_size)
+        {
+            size -= static_cast<uint32_t>(entries.back().first.size() + entries.back().second.size() + ENTRY_OVERHEAD);
+            entries.pop_back();
+        }
+    }
+
+    HpackEncoder::HpackEncoder(uint32_t max_table_size)
+    : table(max_table_size),
+      size_limit(max_table_size),
+      min_pending_size(max_table_size),
+      size_update_pending(false)
+    {
+
+    }
+
+    void HpackEncoder::set_max_table_size(uint32_t size)
+    {
+        size = std::min(size, size_limit);
+        if(size == table.get_max_size() && !size_update_pending)
+            return;
+
+        //If the size shrinks and then grows between blocks, the decoder must see the smallest one first
+        min_pending_size = size_update_pending ? std::min(min_pending_size, size) : std::min(table.get_max_size(), size);
+        size_update_pending = true;
+        table.set_max_size(size);
+    }
+
+    void HpackEncoder::encode(const HeaderList &headers, std::string &out)
+    {
+        if(size_update_pending)
+        {
+            if(min_pending_size < table.get_max_size())
+                encode_integer(min_pending_size, 5, 0x20, out);
+            encode_integer(table.get_max_size(), 5, 0x20, out);
+            size_update_pending = false;
+        }
+
+        for(auto &header : headers)
+        {
+            uint64_t name_index = 0;
+            uint64_t index = table.find(header.first, header.second, name_index);
+            if(index != 0)
+            {
+                encode_integer(index, 7, 0x80, out);
+                continue;
+            }
+
+            if(is_sensitive(header))
+            {
+                encode_integer(name_index, 4, 0x10, out);
+            }
+            else
+            {
+                encode_integer(name_index, 6, 0x40, out);
+                table.add(header.first, header.second);
+            }
+
+            if(name_index == 0)
+                encode_string(header.first, out);
+            encode_string(header.second, out);
+        }
+    }
+
+    void HpackEncoder::encode_string(const std::string &str, std::string &out)
+    {
+        size_t huffman_size = huffman_encoded_size(str.data(), str.size());
+        if(huffman_size < str.size())
+        {
+            encode_integer(huffman_size, 7, 0x80, out);
+            huffman_encode(str.data(), str.size(), out);
+        }
+        else
+        {
+            encode_integer(str.size(), 7, 0x00, out);
+            out.append(str);
+        }
+    }
+
+    HpackDecoder::HpackDecoder(uint32_t max_table_size, size_t max_header_list_size_)
+    : table(max_table_size),
+      size_limit(max_table_size),
+      max_header_list_size(max_header_list_size_)
+    {
+
+    }
+
+    bool HpackDecoder::decode(const char *data, size_t size, HeaderList &headers)
+    {
+        auto pos = reinterpret_cast<const uint8_t*>(data);
+        auto end = pos + size;
+        size_t list_size = 0;
+        bool header_seen = false;
+
+        while(pos < end)
+        {
+            uint8_t first = *pos;
+            uint64_t index = 0;
+            if(first & 0x80) //Indexed header field
+            {
+                if(!decode_integer(pos, end, 7, index))
+                    return false;
+                auto entry = table.get(index);
+                if(!entry)
+                    return false;
+                headers.emplace_back(*entry);
+            }
+            else if((first & 0xE0) == 0x20) //Dynamic table size update, only allowed before any headers
+            {
+                if(header_seen || !decode_integer(pos, end, 5, index) || index > size_limit)
+                    return false;
+                table.set_max_size(static_cast<uint32_t>(index));
+                continue;
+            }
+            else //Literal header field, either with incremental indexing (6 bit index), or without/never indexed (4 bit index)
+            {
+                bool add_to_table = (first & 0x40) != 0;
+                if(!decode_integer(pos, end, add_to_table ? 6 : 4, index))
+                    return false;
+
+                Header header;
+                if(index != 0)
+                {
+                    auto entry = table.get(index);
+                    if(!entry)
+                        return false;
+                    header.first = entry->first;
+                }
+                else if(!decode_string(pos, end, header.first))
+                {
+                    return false;
+                }
+                if(!decode_string(pos, end, header.second))
+                    return false;
+
+                if(add_to_table)
+                    table.add(header.first, header.second);
+                headers.emplace_back(std::move(header));
+            }
+
+            header_seen = true;
+            list_size += headers.back().first.size() + headers.back().second.size() + ENTRY_OVERHEAD;
+            if(list_size > max_header_list_size)
+                return false;
+        }
+        return true;
+    }
+
+    bool HpackDecoder::decode_string(const uint8_t *&pos, const uint8_t *end, std::string &out)
+    {
+        if(pos >= end)
+            return false;
+        bool huffman = (*pos & 0x80) != 0;
+        uint64_t length = 0;
+        if(!decode_integer(pos, end, 7, length) || length > static_cast<uint64_t>(end - pos) || length > max_header_list_size)
+            return false;
+
+        auto str = reinterpret_cast<const char*>(pos);
+        pos += length;
+        if(huffman)
+            return huffman_decode(str, length, out);
+        out.assign(str, length);
+        return true;
+    }
+}
@@ -0,0 +1,1046 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#include <algorithm>
+#include <cstring>
+#include "frnetlib/Http2.h"
+#ifdef USE_SSL
+#include "frnetlib/SSLSocket.h"
+#endif
+
+#define HTTP2_FRAME_HEADER_SIZE 9
+#define HTTP2_DEFAULT_WINDOW_SIZE 65535
+#define HTTP2_DEFAULT_MAX_FRAME_SIZE 16384
+#define HTTP2_MAX_FRAME_SIZE 16777215
+#define HTTP2_MAX_WINDOW_SIZE 2147483647
+#define HTTP2_MAX_STREAM_ID 2147483647 //Stream IDs are 31 bits, and can't be reused
+#define HTTP2_LOCAL_STREAM_WINDOW (1 << 20) //How much each stream may receive before a WINDOW_UPDATE
+#define HTTP2_LOCAL_CONNECTION_WINDOW (1 << 24) //How much the whole connection may receive before a WINDOW_UPDATE
+#define HTTP2_LOCAL_MAX_CONCURRENT_STREAMS 100 //How many requests a client may have in flight at once
+
+namespace fr
+{
+    namespace
+    {
+        const char connection_preface[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+        constexpr size_t connection_preface_size = sizeof(connection_preface) - 1;
+
+        constexpr uint8_t FLAG_END_STREAM = 0x1;
+        constexpr uint8_t FLAG_ACK = 0x1;
+        constexpr uint8_t FLAG_END_HEADERS = 0x4;
+        constexpr uint8_t FLAG_PADDED = 0x8;
+        constexpr uint8_t FLAG_PRIORITY = 0x20;
+
+        enum SettingId : uint16_t
+        {
+            HeaderTableSize = 0x1,
+            EnablePush = 0x2,
+            MaxConcurrentStreams = 0x3,
+            InitialWindowSize = 0x4,
+            MaxFrameSize = 0x5,
+            MaxHeaderListSize = 0x6,
+        };
+
+        inline uint32_t read_uint32(const uint8_t *data)
+        {
+            return (uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 | (uint32_t)data[2] << 8 | data[3];
+        }
+
+        inline void write_uint32(char *data, uint32_t value)
+        {
+            data[0] = static_cast<char>(value >> 24);
+            data[1] = static_cast<char>(value >> 16);
+            data[2] = static_cast<char>(value >> 8);
+            data[3] = static_cast<char>(value);
+        }
+
+        inline void append_setting(std::string &out, uint16_t id, uint32_t value)
+        {
+            char setting[6] = {static_cast<char>(id >> 8), static_cast<char>(id)};
+            write_uint32(setting + 2, value);
+            out.append(setting, sizeof(setting));
+        }
+
+        //Headers which only make sense for a single HTTP/1.1 connection, and are forbidden in HTTP/2
+        bool is_connection_specific(const std::string &name)
+        {
+            return name == "connection" || name == "keep-alive" || name == "proxy-connection"
+                   || name == "transfer-encoding" || name == "upgrade" || name == "te";
+        }
+
+        //Rejects anything which could be used to smuggle extra headers into the HTTP/1.1 text that messages are parsed from
+        bool is_valid_header(const Hpack::Header &header)
+        {
+            if(header.first.empty())
+                return false;
+            for(size_t a = header.first[0] == ':' ? 1 : 0; a < header.first.size(); ++a)
+            {
+                auto c = static_cast<uint8_t>(header.first[a]);
+                if(c <= 0x20 || c >= 0x7f || c == ':' || (c >= 'A' && c <= 'Z'))
+                    return false;
+            }
+            return header.second.find_first_of(std::string("\r\n\0", 3)) == std::string::npos;
+        }
+
+        //Splits a message built by HttpRequest/HttpResponse::construct() into its start line, headers, and body
+        void split_message(const std::string &message, std::string &start_line, Hpack::HeaderList &headers, size_t &body_begin)
+        {
+            size_t line_end = message.find("\r\n");
+            start_line = message.substr(0, line_end);
+            size_t pos = line_end + 2;
+            while(pos < message.size())
+            {
+                line_end = message.find("\r\n", pos);
+                if(line_end == std::string::npos || line_end == pos)
+                    break;
+                size_t colon = message.find(':', pos);
+                if(colon < line_end)
+                {
+                    std::string name = message.substr(pos, colon - pos);
+                    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+                    size_t value_begin = message.find_first_not_of(' ', colon + 1);
+                    value_begin = std::min(value_begin, line_end);
+                    if(!is_connection_specific(name))
+                        headers.emplace_back(std::move(name), message.substr(value_begin, line_end - value_begin));
+                }
+                pos = line_end + 2;
+            }
+            body_begin = std::min(pos + 2, message.size());
+        }
+
+        //Decodes the unpadded base64url used by the HTTP2-Settings header
+        bool base64url_decode(const std::string &input, std::string &out)
+        {
+            uint32_t bits = 0;
+            uint32_t bit_count = 0;
+            for(char c : input)
+            {
+                uint32_t value;
+                if(c >= 'A' && c <= 'Z')
+                    value = static_cast<uint32_t>(c - 'A');
+                else if(c >= 'a' && c <= 'z')
+                    value = static_cast<uint32_t>(c - 'a' + 26);
+                else if(c >= '0' && c <= '9')
+                    value = static_cast<uint32_t>(c - '0' + 52);
+                else if(c == '-')
+                    value = 62;
+                else if(c == '_')
+                    value = 63;
+                else if(c == '=')
+                    break;
+                else
+                    return false;
+
+                bits = (bits << 6) | value;
+                bit_count += 6;
+                if(bit_count >= 8)
+                {
+                    bit_count -= 8;
+                    out.push_back(static_cast<char>(bits >> bit_count));
+                    bits &= (1u << bit_count) - 1;
+                }
+            }
+            return true;
+        }
+    }
+
+    Http2Connection::Http2Connection(Socket &socket_, Role role_)
+    : socket(socket_),
+      role(role_),
+      scheme("http"),
+      input_offset(0),
+      next_stream_id(role_ == Role::Client ? 1 : 2),
+      last_peer_stream_id(0),
+      continuation_stream(0),
+      connection_send_window(HTTP2_DEFAULT_WINDOW_SIZE),
+      connection_receive_window(HTTP2_DEFAULT_WINDOW_SIZE),
+      connection_receive_consumed(0),
+      peer_initial_window_size(HTTP2_DEFAULT_WINDOW_SIZE),
+      peer_max_frame_size(HTTP2_DEFAULT_MAX_FRAME_SIZE),
+      peer_max_concurrent_streams(UINT32_MAX),
+      preface_received(role_ == Role::Client),
+      settings_received(false),
+      goaway_received(false),
+      closed(false)
+    {
+#ifdef USE_SSL
+        if(dynamic_cast<SSLSocket*>(&socket))
+            scheme = "https";
+#endif
+    }
+
+    Socket::Status Http2Connection::handshake()
+    {
+        if(role == Role::Client)
+            output.append(connection_preface, connection_preface_size);
+
+        //Our settings, and a bigger connection window than the default 64KB
+        std::string settings;
+        append_setting(settings, SettingId::MaxConcurrentStreams, HTTP2_LOCAL_MAX_CONCURRENT_STREAMS);
+        append_setting(settings, SettingId::InitialWindowSize, HTTP2_LOCAL_STREAM_WINDOW);
+        append_setting(settings, SettingId::MaxHeaderListSize, MAX_HTTP_HEADER_SIZE);
+        if(role == Role::Client)
+            append_setting(settings, SettingId::EnablePush, 0);
+        queue_frame(FrameType::Settings, 0, 0, settings.data(), settings.size());
+        queue_window_update(0, HTTP2_LOCAL_CONNECTION_WINDOW - HTTP2_DEFAULT_WINDOW_SIZE);
+        connection_receive_window = HTTP2_LOCAL_CONNECTION_WINDOW;
+        return flush();
+    }
+
+    bool Http2Connection::is_upgrade_request(const HttpRequest &request)
+    {
+        return request.header("upgrade") == "h2c" && request.header_exists("http2-settings");
+    }
+
+    Socket::Status Http2Connection::upgrade(const HttpRequest &request)
+    {
+        std::string settings;
+        if(!base64url_decode(request.header("http2-settings"), settings) || apply_settings((const uint8_t*)settings.data(), settings.size()) != ErrorCode::NoError)
+            return Socket::Status::ParseError;
+
+        output = "HTTP/1.1 101 Switching Protocols\r\nconnection: Upgrade\r\nupgrade: h2c\r\n\r\n";
+        auto status = handshake();
+        if(status != Socket::Status::Success && status != Socket::Status::WouldBlock)
+            return status;
+
+        //The upgrade request is implicitly stream 1, which is already half closed by the client
+        last_peer_stream_id = 1;
+        Stream stream(peer_initial_window_size, HTTP2_LOCAL_STREAM_WINDOW);
+        stream.headers_received = true;
+        stream.remote_closed = true;
+        streams.emplace(1, std::move(stream));
+        requests.emplace_back(1, request);
+        return status;
+    }
+
+    Socket::Status Http2Connection::receive_request(HttpRequest &request, uint32_t &stream_id)
+    {
+        while(requests.empty())
+        {
+            if(closed || goaway_received)
+                return Socket::Status::Disconnected;
+            auto status = process();
+            if(status != Socket::Status::Success)
+                return status;
+        }
+
+        stream_id = requests.front().first;
+        request = std::move(requests.front().second);
+        requests.pop_front();
+        return Socket::Status::Success;
+    }
+
+    Socket::Status Http2Connection::send_response(uint32_t stream_id, const HttpResponse &response)
+    {
+        if(streams.find(stream_id) == streams.end() || closed)
+            return Socket::Status::Error;
+
+        std::string message = response.construct("");
+        std::string status_line;
+        Hpack::HeaderList headers;
+        size_t body_begin = 0;
+        split_message(message, status_line, headers, body_begin);
+
+        //The status line looks like: HTTP/1.1 200
+        auto status_begin = status_line.find(' ') + 1;
+        headers.emplace(headers.begin(), ":status", status_line.substr(status_begin, 3));
+        bool has_body = body_begin < message.size();
+        queue_headers(stream_id, headers, !has_body);
+
+        auto status = has_body ? send_body(stream_id, &message[body_begin], message.size() - body_begin) : flush();
+
+        //The response is complete, so there's nothing more to do with the stream. If the
+        //client is still sending the request body, tell it to stop (RFC 7540 section 8.1).
+        auto iter = streams.find(stream_id);
+        if(iter != streams.end())
+        {
+            if(!iter->second.remote_closed)
+            {
+                queue_rst_stream(stream_id, ErrorCode::NoError);
+                status = flush();
+            }
+            streams.erase(iter);
+        }
+        return status;
+    }
+
+    Socket::Status Http2Connection::send_request(const HttpRequest &request, uint32_t &stream_id)
+    {
+        if(closed || goaway_received || next_stream_id > HTTP2_MAX_STREAM_ID)
+            return Socket::Status::Disconnected;
+
+        //Wait for a stream to finish if the server's limit has been reached
+        while(true)
+        {
+            auto open = std::count_if(streams.begin(), streams.end(), [](const std::pair<const uint32_t, Stream> &s) {return !s.second.remote_closed;});
+            if((uint32_t)open < peer_max_concurrent_streams)
+                break;
+            auto status = process();
+            if(status == Socket::Status::WouldBlock)
+                status = wait_for_socket();
+            if(status != Socket::Status::Success)
+                return status;
+        }
+
+        std::string message = request.construct(socket.get_remote_address());
+        std::string request_line;
+        Hpack::HeaderList headers;
+        size_t body_begin = 0;
+        split_message(message, request_line, headers, body_begin);
+
+        //The request line looks like: GET /path?query HTTP/1.1
+        auto path_begin = request_line.find(' ');
+        auto path_end = request_line.rfind(' ');
+        std::string authority;
+        auto host = std::find_if(headers.begin(), headers.end(), [](const Hpack::Header &h) {return h.first == "host";});
+        if(host != headers.end())
+        {
+            authority = std::move(host->second);
+            headers.erase(host);
+        }
+
+        Hpack::HeaderList pseudo_headers = {
+                {":method", request_line.substr(0, path_begin)},
+                {":scheme", scheme},
+                {":authority", std::move(authority)},
+                {":path", request_line.substr(path_begin + 1, path_end - path_begin - 1)},
+        };
+        headers.insert(headers.begin(), pseudo_headers.begin(), pseudo_headers.end());
+
+        stream_id = next_stream_id;
+        next_stream_id += 2;
+        streams.emplace(stream_id, Stream(peer_initial_window_size, HTTP2_LOCAL_STREAM_WINDOW));
+
+        bool has_body = body_begin < message.size();
+        queue_headers(stream_id, headers, !has_body);
+        return has_body ? send_body(stream_id, &message[body_begin], message.size() - body_begin) : flush();
+    }
+
+    Socket::Status Http2Connection::receive_response(uint32_t stream_id, HttpResponse &response)
+    {
+        while(true)
+        {
+            auto iter = streams.find(stream_id);
+            if(iter == streams.end())
+                return Socket::Status::Error;
+
+            Stream &stream = iter->second;
+            if(stream.error != Socket::Status::Success)
+            {
+                auto error = stream.error;
+                streams.erase(iter);
+                return error;
+            }
+
+            if(stream.remote_closed)
+            {
+                bool valid = build_response(stream, response);
+                streams.erase(iter);
+                return valid ? Socket::Status::Success : Socket::Status::ParseError;
+            }
+
+            if(closed)
+                return Socket::Status::Disconnected;
+            auto status = process();
+            if(status != Socket::Status::Success)
+                return status;
+        }
+    }
+
+    Socket::Status Http2Connection::close(ErrorCode error)
+    {
+        if(closed)
+            return Socket::Status::Success;
+
+        char payload[8];
+        write_uint32(payload, last_peer_stream_id);
+        write_uint32(payload + 4, static_cast<uint32_t>(error));
+        queue_frame(FrameType::GoAway, 0, 0, payload, sizeof(payload));
+        closed = true;
+        return flush();
+    }
+
+    Socket::Status Http2Connection::process()
+    {
+        //Compact the buffer, and receive whatever's available
+        if(input_offset > 0)
+        {
+            input.erase(0, input_offset);
+            input_offset = 0;
+        }
+
+        char buffer[RECV_CHUNK_SIZE];
+        size_t received = 0;
+        auto status = socket.receive_raw(buffer, sizeof(buffer), received);
+        if(status != Socket::Status::Success)
+            return status;
+        input.append(buffer, received);
+
+        //Servers must receive the client's preface before anything else
+        if(!preface_received)
+        {
+            size_t compare_size = std::min(input.size(), connection_preface_size);
+            if(input.compare(0, compare_size, connection_preface, compare_size) != 0)
+                return connection_error(ErrorCode::ProtocolError);
+            if(input.size() < connection_preface_size)
+                return Socket::Status::Success;
+            input_offset = connection_preface_size;
+            preface_received = true;
+        }
+
+        //Handle each complete frame
+        while(input.size() - input_offset >= HTTP2_FRAME_HEADER_SIZE && !closed)
+        {
+            auto header = reinterpret_cast<const uint8_t*>(&input[input_offset]);
+            uint32_t length = (uint32_t)header[0] << 16 | (uint32_t)header[1] << 8 | header[2];
+            if(length > HTTP2_DEFAULT_MAX_FRAME_SIZE)
+                return connection_error(ErrorCode::FrameSizeError);
+            if(input.size() - input_offset < HTTP2_FRAME_HEADER_SIZE + length)
+                break;
+
+            auto type = static_cast<FrameType>(header[3]);
+            uint8_t flags = header[4];
+            uint32_t stream_id = read_uint32(header + 5) & 0x7FFFFFFF;
+            input_offset += HTTP2_FRAME_HEADER_SIZE + length;
+
+            status = handle_frame(type, flags, stream_id, header + HTTP2_FRAME_HEADER_SIZE, length);
+            if(status != Socket::Status::Success)
+                return status;
+        }
+
+        //Send any acknowledgements or window updates which were queued while handling the frames. If the socket
+        //can't take them yet, they're sent with whatever's sent next.
+        status = flush();
+        return status == Socket::Status::WouldBlock ? Socket::Status::Success : status;
+    }
+
+    Socket::Status Http2Connection::handle_frame(FrameType type, uint8_t flags, uint32_t stream_id, const uint8_t *payload, uint32_t length)
+    {
+        //The first frame from the peer must be its settings
+        if(!settings_received && type != FrameType::Settings)
+            return connection_error(ErrorCode::ProtocolError);
+
+        //Once a header block has started, nothing but its CONTINUATION frames may be interleaved
+        if(continuation_stream != 0 && (type != FrameType::Continuation || stream_id != continuation_stream))
+            return connection_error(ErrorCode::ProtocolError);
+
+        switch(type)
+        {
+            case FrameType::Data:
+                return handle_data(flags, stream_id, payload, length);
+            case FrameType::Headers:
+                return handle_headers(flags, stream_id, payload, length);
+            case FrameType::Continuation:
+            {
+                if(continuation_stream == 0)
+                    return connection_error(ErrorCode::ProtocolError);
+                //A block which never ends would otherwise grow without limit. The decoded header list can't be
+                //smaller than the block, so one which is already bigger than we advertised can be refused straight away.
+                auto iter = streams.find(stream_id);
+                std::string &block = iter != streams.end() ? iter->second.header_block : orphan_header_block;
+                if(block.size() + length > MAX_HTTP_HEADER_SIZE)
+                    return connection_error(ErrorCode::EnhanceYourCalm);
+                block.append((const char*)payload, length);
+                if(flags & FLAG_END_HEADERS)
+                    return handle_header_block_end(stream_id);
+                return Socket::Status::Success;
+            }
+            case FrameType::Priority:
+                if(stream_id == 0)
+                    return connection_error(ErrorCode::ProtocolError);
+                if(length != 5)
+                    queue_rst_stream(stream_id, ErrorCode::FrameSizeError);
+                return Socket::Status::Success;
+            case FrameType::RstStream:
+            {
+                if(stream_id == 0 || (stream_id >= next_stream_id && stream_id > last_peer_stream_id))
+                    return connection_error(ErrorCode::ProtocolError);
+                if(length != 4)
+                    return connection_error(ErrorCode::FrameSizeError);
+
+                //Clients keep the stream so that receive_response() can report it. Servers have nothing to report to.
+                auto iter = streams.find(stream_id);
+                if(iter != streams.end())
+                {
+                    if(role == Role::Client)
+                        iter->second.error = Socket::Status::Error;
+                    else
+                        streams.erase(iter);
+                }
+                return Socket::Status::Success;
+            }
+            case FrameType::Settings:
+                return handle_settings(flags, stream_id, payload, length);
+            case FrameType::PushPromise:
+                //Push is disabled for clients, and servers can't receive it
+                return connection_error(ErrorCode::ProtocolError);
+            case FrameType::Ping:
+                if(stream_id != 0)
+                    return connection_error(ErrorCode::ProtocolError);
+                if(length != 8)
+                    return connection_error(ErrorCode::FrameSizeError);
+                if(!(flags & FLAG_ACK))
+                    queue_frame(FrameType::Ping, FLAG_ACK, 0, (const char*)payload, length);
+                return Socket::Status::Success;
+            case FrameType::GoAway:
+            {
+                if(stream_id != 0)
+                    return connection_error(ErrorCode::ProtocolError);
+                if(length < 8)
+                    return connection_error(ErrorCode::FrameSizeError);
+
+                //Streams which the peer didn't get around to won't be processed, so fail them
+                goaway_received = true;
+                uint32_t last_stream_id = read_uint32(payload) & 0x7FFFFFFF;
+                for(auto &stream : streams)
+                {
+                    if(stream.first > last_stream_id && role == Role::Client && !stream.second.remote_closed)
+                        stream.second.error = Socket::Status::Error;
+                }
+                return Socket::Status::Success;
+            }
+            case FrameType::WindowUpdate:
+                return handle_window_update(stream_id, payload, length);
+            default:
+                //Unknown frame types must be ignored
+                return Socket::Status::Success;
+        }
+    }
+
+    Socket::Status Http2Connection::handle_data(uint8_t flags, uint32_t stream_id, const uint8_t *payload, uint32_t length)
+    {
+        if(stream_id == 0)
+            return connection_error(ErrorCode::ProtocolError);
+
+        //The whole frame counts against flow control, including any padding
+        connection_receive_window -= length;
+        if(connection_receive_window < 0)
+            return connection_error(ErrorCode::FlowControlError);
+        connection_receive_consumed += length;
+        if(connection_receive_consumed >= HTTP2_LOCAL_CONNECTION_WINDOW / 2)
+        {
+            queue_window_update(0, connection_receive_consumed);
+            connection_receive_window += connection_receive_consumed;
+            connection_receive_consumed = 0;
+        }
+
+        uint32_t padding = 0;
+        if(flags & FLAG_PADDED)
+        {
+            if(length < 1 || payload[0] >= length)
+                return connection_error(ErrorCode::ProtocolError);
+            padding = payload[0] + 1u;
+        }
+
+        //Ignore data for streams that have been closed, but data on streams that were never opened is a protocol error
+        auto iter = streams.find(stream_id);
+        if(iter == streams.end())
+        {
+            if(stream_id > last_peer_stream_id && stream_id >= next_stream_id)
+                return connection_error(ErrorCode::ProtocolError);
+            return Socket::Status::Success;
+        }
+
+        Stream &stream = iter->second;
+        if(stream.remote_closed || !stream.headers_received)
+        {
+            queue_rst_stream(stream_id, ErrorCode::StreamClosed);
+            stream.error = Socket::Status::Error;
+            if(role == Role::Server)
+                streams.erase(iter);
+            return Socket::Status::Success;
+        }
+
+        stream.receive_window -= length;
+        if(stream.receive_window < 0)
+            return connection_error(ErrorCode::FlowControlError);
+
+        //Guard against bodies bigger than the HTTP/1.1 parsers would accept
+        size_t data_size = length - padding;
+        if(stream.body.size() + data_size > MAX_HTTP_BODY_SIZE)
+        {
+            queue_rst_stream(stream_id, ErrorCode::Cancel);
+            stream.error = Socket::Status::HttpBodyTooBig;
+            if(role == Role::Server)
+                streams.erase(iter);
+            return Socket::Status::Success;
+        }
+        stream.body.append((const char*)payload + (padding ? 1 : 0), data_size);
+
+        if(flags & FLAG_END_STREAM)
+        {
+            on_stream_complete(stream_id);
+            return Socket::Status::Success;
+        }
+
+        stream.receive_consumed += length;
+        if(stream.receive_consumed >= HTTP2_LOCAL_STREAM_WINDOW / 2)
+        {
+            queue_window_update(stream_id, stream.receive_consumed);
+            stream.receive_window += stream.receive_consumed;
+            stream.receive_consumed = 0;
+        }
+        return Socket::Status::Success;
+    }
+
+    Socket::Status Http2Connection::handle_headers(uint8_t flags, uint32_t stream_id, const uint8_t *payload, uint32_t length)
+    {
+        if(stream_id == 0)
+            return connection_error(ErrorCode::ProtocolError);
+
+        //Strip the padding and priority fields, to get at the header block fragment
+        uint32_t begin = 0;
+        uint32_t padding = 0;
+        if(flags & FLAG_PADDED)
+        {
+            if(length < 1)
+                return connection_error(ErrorCode::ProtocolError);
+            padding = payload[0];
+            begin = 1;
+        }
+        if(flags & FLAG_PRIORITY)
+            begin += 5;
+        if(begin + padding > length)
+            return connection_error(ErrorCode::ProtocolError);
+        if(length - begin - padding > MAX_HTTP_HEADER_SIZE)
+            return connection_error(ErrorCode::EnhanceYourCalm);
+
+        //Work out which stream the block belongs to. Clients only receive headers on streams they opened,
+        //and servers on odd numbered streams opened by the client.
+        if(role == Role::Client ? (stream_id % 2 == 0 || stream_id >= next_stream_id) : stream_id % 2 == 0)
+            return connection_error(ErrorCode::ProtocolError);
+
+        auto iter = streams.find(stream_id);
+        if(iter == streams.end() && role == Role::Server && stream_id > last_peer_stream_id)
+        {
+            //A new request
+            last_peer_stream_id = stream_id;
+            iter = streams.emplace(stream_id, Stream(peer_initial_window_size, HTTP2_LOCAL_STREAM_WINDOW)).first;
+        }
+        else if(iter != streams.end() && iter->second.remote_closed)
+        {
+            queue_rst_stream(stream_id, ErrorCode::StreamClosed);
+            iter->second.error = Socket::Status::Error;
+            if(role == Role::Server)
+                streams.erase(iter);
+            iter = streams.end();
+        }
+
+        if(iter == streams.end())
+        {
+            //A closed stream. The block must still be decoded to keep the HPACK context in sync.
+            orphan_header_block.assign((const char*)payload + begin, length - begin - padding);
+            if(flags & FLAG_END_HEADERS)
+                return handle_header_block_end(stream_id);
+            continuation_stream = stream_id;
+            return Socket::Status::Success;
+        }
+
+        Stream &stream = iter->second;
+        stream.header_block.assign((const char*)payload + begin, length - begin - padding);
+        stream.end_stream_pending = (flags & FLAG_END_STREAM) != 0;
+        if(flags & FLAG_END_HEADERS)
+            return handle_header_block_end(stream_id);
+        continuation_stream = stream_id;
+        return Socket::Status::Success;
+    }
+
+    Socket::Status Http2Connection::handle_header_block_end(uint32_t stream_id)
+    {
+        continuation_stream = 0;
+        auto iter = streams.find(stream_id);
+        if(iter == streams.end())
+        {
+            Hpack::HeaderList discarded;
+            bool valid = decoder.decode(orphan_header_block.data(), orphan_header_block.size(), discarded);
+            orphan_header_block.clear();
+            return valid ? Socket::Status::Success : connection_error(ErrorCode::CompressionError);
+        }
+
+        Stream &stream = iter->second;
+        Hpack::HeaderList headers;
+        if(!decoder.decode(stream.header_block.data(), stream.header_block.size(), headers))
+            return connection_error(ErrorCode::CompressionError);
+        stream.header_block.clear();
+
+        if(!stream.headers_received)
+        {
+            //Informational responses, such as 100 Continue, are followed by the real response
+            if(role == Role::Client && !headers.empty() && headers[0].first == ":status" && headers[0].second.compare(0, 1, "1") == 0)
+                return Socket::Status::Success;
+            stream.headers = std::move(headers);
+            stream.headers_received = true;
+
+            //Refuse requests beyond the limit we advertised
+            if(role == Role::Server && streams.size() > HTTP2_LOCAL_MAX_CONCURRENT_STREAMS)
+            {
+                queue_rst_stream(stream_id, ErrorCode::RefusedStream);
+                streams.erase(iter);
+                return Socket::Status::Success;
+            }
+        }
+        else
+        {
+            //Trailers. These must end the stream, and can't contain pseudo headers.
+            if(!stream.end_stream_pending)
+                return connection_error(ErrorCode::ProtocolError);
+            for(auto &header : headers)
+            {
+                if(!header.first.empty() && header.first[0] != ':')
+                    stream.headers.emplace_back(std::move(header));
+            }
+        }
+
+        if(stream.end_stream_pending)
+            on_stream_complete(stream_id);
+        return Socket::Status::Success;
+    }
+
+    Socket::Status Http2Connection::handle_settings(uint8_t flags, uint32_t stream_id, const uint8_t *payload, uint32_t length)
+    {
+        if(stream_id != 0)
+            return connection_error(ErrorCode::ProtocolError);
+        if(flags & FLAG_ACK)
+        {
+            if(length != 0)
+                return connection_error(ErrorCode::FrameSizeError);
+            return Socket::Status::Success;
+        }
+
+        auto error = apply_settings(payload, length);
+        if(error != ErrorCode::NoError)
+            return connection_error(error);
+        settings_received = true;
+        queue_frame(FrameType::Settings, FLAG_ACK, 0, nullptr, 0);
+        return Socket::Status::Success;
+    }
+
+    Socket::Status Http2Connection::handle_window_update(uint32_t stream_id, const uint8_t *payload, uint32_t length)
+    {
+        if(length != 4)
+            return connection_error(ErrorCode::FrameSizeError);
+        uint32_t increment = read_uint32(payload) & 0x7FFFFFFF;
+
+        if(stream_id == 0)
+        {
+            connection_send_window += increment;
+            if(increment == 0)
+                return connection_error(ErrorCode::ProtocolError);
+            if(connection_send_window > HTTP2_MAX_WINDOW_SIZE)
+                return connection_error(ErrorCode::FlowControlError);
+            return Socket::Status::Success;
+        }
+
+        auto iter = streams.find(stream_id);
+        if(iter == streams.end())
+            return Socket::Status::Success;
+        iter->second.send_window += increment;
+        if(increment == 0 || iter->second.send_window > HTTP2_MAX_WINDOW_SIZE)
+        {
+            queue_rst_stream(stream_id, increment == 0 ? ErrorCode::ProtocolError : ErrorCode::FlowControlError);
+            iter->second.error = Socket::Status::Error;
+            if(role == Role::Server)
+                streams.erase(iter);
+        }
+        return Socket::Status::Success;
+    }
+
+    Http2Connection::ErrorCode Http2Connection::apply_settings(const uint8_t *payload, size_t length)
+    {
+        if(length % 6 != 0)
+            return ErrorCode::FrameSizeError;
+
+        for(size_t a = 0; a < length; a += 6)
+        {
+            uint16_t id = static_cast<uint16_t>(payload[a] << 8 | payload[a + 1]);
+            uint32_t value = read_uint32(payload + a + 2);
+            switch(id)
+            {
+                case SettingId::HeaderTableSize:
+                    encoder.set_max_table_size(value);
+                    break;
+                case SettingId::EnablePush:
+                    if(value > 1)
+                        return ErrorCode::ProtocolError;
+                    break;
+                case SettingId::MaxConcurrentStreams:
+                    peer_max_concurrent_streams = value;
+                    break;
+                case SettingId::InitialWindowSize:
+                {
+                    //Changes apply retroactively to every open stream
+                    if(value > HTTP2_MAX_WINDOW_SIZE)
+                        return ErrorCode::FlowControlError;
+                    int64_t delta = (int64_t)value - peer_initial_window_size;
+                    for(auto &stream : streams)
+                    {
+                        stream.second.send_window += delta;
+                        if(stream.second.send_window > HTTP2_MAX_WINDOW_SIZE)
+                            return ErrorCode::FlowControlError;
+                    }
+                    peer_initial_window_size = value;
+                    break;
+                }
+                case SettingId::MaxFrameSize:
+                    if(value < HTTP2_DEFAULT_MAX_FRAME_SIZE || value > HTTP2_MAX_FRAME_SIZE)
+                        return ErrorCode::ProtocolError;
+                    peer_max_frame_size = value;
+                    break;
+                default:
+                    //MaxHeaderListSize is advisory, and unknown settings must be ignored
+                    break;
+            }
+        }
+        return ErrorCode::NoError;
+    }
+
+    void Http2Connection::on_stream_complete(uint32_t stream_id)
+    {
+        auto iter = streams.find(stream_id);
+        Stream &stream = iter->second;
+        stream.remote_closed = true;
+        if(role == Role::Client)
+            return;
+
+        //Servers queue the request for receive_request(). Malformed requests get their stream reset,
+        //and those with methods that HttpRequest doesn't support get a NotImplemented response.
+        HttpRequest request;
+        auto result = build_request(stream, request);
+        if(result != Http::RequestStatus::Ok)
+        {
+            if(result == Http::RequestStatus::NotImplemented)
+                queue_headers(stream_id, {{":status", "501"}}, true);
+            else
+                queue_rst_stream(stream_id, ErrorCode::ProtocolError);
+            streams.erase(iter);
+            return;
+        }
+        stream.headers.clear();
+        stream.body.clear();
+        stream.body.shrink_to_fit();
+        requests.emplace_back(stream_id, std::move(request));
+    }
+
+    Http::RequestStatus Http2Connection::build_request(Stream &stream, HttpRequest &request)
+    {
+        const std::string *method = nullptr;
+        const std::string *path = nullptr;
+        const std::string *authority = nullptr;
+        const std::string *request_scheme = nullptr;
+        bool regular_header_seen = false;
+        bool host_seen = false;
+        std::string header_text;
+        std::string cookies;
+
+        for(auto &header : stream.headers)
+        {
+            if(!is_valid_header(header))
+                return Http::RequestStatus::BadRequest;
+
+            if(header.first[0] == ':')
+            {
+                //Pseudo headers must come first, and can't be repeated
+                const std::string **field = header.first == ":method" ? &method
+                                          : header.first == ":path" ? &path
+                                          : header.first == ":authority" ? &authority
+                                          : header.first == ":scheme" ? &request_scheme
+                                          : nullptr;
+                if(regular_header_seen || !field || *field)
+                    return Http::RequestStatus::BadRequest;
+                *field = &header.second;
+                continue;
+            }
+            regular_header_seen = true;
+
+            if(header.first == "te" && header.second == "trailers")
+                continue;
+            if(is_connection_specific(header.first))
+                return Http::RequestStatus::BadRequest;
+            if(header.first == "content-length")
+                continue;
+            if(header.first == "cookie") //Cookies may be split into separate fields for better compression
+            {
+                cookies.append(cookies.empty() ? "" : "; ").append(header.second);
+                continue;
+            }
+            host_seen |= header.first == "host";
+            header_text.append(header.first).append(": ").append(header.second).append("\r\n");
+        }
+
+        if(!method || !path || !request_scheme || path->empty() || (*path)[0] != '/')
+            return Http::RequestStatus::BadRequest;
+        if(Http::string_to_request_type(*method) == Http::RequestType::Unknown)
+            return Http::RequestStatus::NotImplemented;
+        if(authority && !host_seen)
+            header_text.append("host: ").append(*authority).append("\r\n");
+        if(!cookies.empty())
+            header_text.append("cookie: ").append(cookies).append("\r\n");
+
+        //Rebuild it as HTTP/1.1 for the parser. The body length is known, so the client's content-length is replaced.
+        std::string message = *method + " " + *path + " HTTP/1.1\r\n" + header_text + "content-length: " + std::to_string(stream.body.size()) + "\r\n\r\n";
+        message.append(stream.body);
+        return request.parse(message.data(), message.size()) == Socket::Status::Success ? Http::RequestStatus::Ok : Http::RequestStatus::BadRequest;
+    }
+
+    bool Http2Connection::build_response(Stream &stream, HttpResponse &response)
+    {
+        const std::string *status = nullptr;
+        std::string header_text;
+        for(auto &header : stream.headers)
+        {
+            if(!is_valid_header(header))
+                return false;
+            if(header.first[0] == ':')
+            {
+                if(header.first != ":status" || status || !header_text.empty())
+                    return false;
+                status = &header.second;
+                continue;
+            }
+            if(is_connection_specific(header.first) || header.first == "content-length")
+                continue;
+            header_text.append(header.first).append(": ").append(header.second).append("\r\n");
+        }
+
+        if(!status || status->size() != 3 || !std::all_of(status->begin(), status->end(), ::isdigit))
+            return false;
+
+        std::string message = "HTTP/1.1 " + *status + " \r\n" + header_text + "content-length: " + std::to_string(stream.body.size()) + "\r\n\r\n";
+        message.append(stream.body);
+        return response.parse(message.data(), message.size()) == Socket::Status::Success;
+    }
+
+    void Http2Connection::queue_headers(uint32_t stream_id, const Hpack::HeaderList &headers, bool end_stream)
+    {
+        std::string block;
+        encoder.encode(headers, block);
+
+        //The block is split into a HEADERS frame, followed by as many CONTINUATION frames as it takes
+        size_t offset = 0;
+        FrameType type = FrameType::Headers;
+        do
+        {
+            size_t length = std::min<size_t>(block.size() - offset, peer_max_frame_size);
+            uint8_t flags = 0;
+            if(type == FrameType::Headers && end_stream)
+                flags |= FLAG_END_STREAM;
+            if(offset + length == block.size())
+                flags |= FLAG_END_HEADERS;
+            queue_frame(type, flags, stream_id, block.data() + offset, length);
+            offset += length;
+            type = FrameType::Continuation;
+        } while(offset < block.size());
+    }
+
+    Socket::Status Http2Connection::send_body(uint32_t stream_id, const char *data, size_t size)
+    {
+        size_t offset = 0;
+        while(offset < size)
+        {
+            //Look the stream up each time, as it may have been reset while waiting for window updates
+            auto iter = streams.find(stream_id);
+            if(iter == streams.end() || iter->second.error != Socket::Status::Success || closed)
+            {
+                flush();
+                return Socket::Status::Error;
+            }
+
+            Stream &stream = iter->second;
+            int64_t window = std::min(connection_send_window, stream.send_window);
+            if(window > 0)
+            {
+                auto length = static_cast<size_t>(std::min<int64_t>({window, (int64_t)peer_max_frame_size, (int64_t)(size - offset)}));
+                bool last = offset + length == size;
+                queue_frame(FrameType::Data, last ? FLAG_END_STREAM : 0, stream_id, data + offset, length);
+                connection_send_window -= length;
+                stream.send_window -= length;
+                offset += length;
+
+                //Don't let the output buffer grow too much before sending it. If the socket's full, then the
+                //rest of the body's queued, as it's held back by the peer's window anyway.
+                if(output.size() >= HTTP2_DEFAULT_WINDOW_SIZE || last)
+                {
+                    auto status = flush();
+                    if(status != Socket::Status::Success && (status != Socket::Status::WouldBlock || last))
+                        return status;
+                }
+                continue;
+            }
+
+            //The peer's window is full, so send what we have and wait for it to open up
+            auto status = flush();
+            if(status != Socket::Status::Success && status != Socket::Status::WouldBlock)
+                return status;
+            status = process();
+            if(status == Socket::Status::WouldBlock)
+                status = wait_for_socket();
+            if(status != Socket::Status::Success)
+                return status;
+        }
+        return Socket::Status::Success;
+    }
+
+    void Http2Connection::queue_frame(FrameType type, uint8_t flags, uint32_t stream_id, const char *payload, size_t length)
+    {
+        char header[HTTP2_FRAME_HEADER_SIZE];
+        header[0] = static_cast<char>(length >> 16);
+        header[1] = static_cast<char>(length >> 8);
+        header[2] = static_cast<char>(length);
+        header[3] = static_cast<char>(type);
+        header[4] = static_cast<char>(flags);
+        write_uint32(header + 5, stream_id);
+        output.append(header, sizeof(header));
+        if(length > 0)
+            output.append(payload, length);
+    }
+
+    void Http2Connection::queue_rst_stream(uint32_t stream_id, ErrorCode error)
+    {
+        char payload[4];
+        write_uint32(payload, static_cast<uint32_t>(error));
+        queue_frame(FrameType::RstStream, 0, stream_id, payload, sizeof(payload));
+    }
+
+    void Http2Connection::queue_window_update(uint32_t stream_id, uint32_t increment)
+    {
+        char payload[4];
+        write_uint32(payload, increment);
+        queue_frame(FrameType::WindowUpdate, 0, stream_id, payload, sizeof(payload));
+    }
+
+    Socket::Status Http2Connection::flush()
+    {
+        if(output.empty())
+            return Socket::Status::Success;
+
+        //Whatever the socket can't take yet is kept, and sent first next time
+        size_t sent = 0;
+        auto status = socket.send_raw(output.data(), output.size(), sent);
+        if(status == Socket::Status::WouldBlock)
+            output.erase(0, sent);
+        else
+            output.clear();
+        return status;
+    }
+
+    Socket::Status Http2Connection::wait_for_socket()
+    {
+        pollfd poll_descriptor = {socket.get_socket_descriptor(), POLLIN, 0};
+        if(!output.empty())
+            poll_descriptor.events |= POLLOUT;
+        auto timeout = socket.get_receive_timeout();
+        int ret = poll_sockets(&poll_descriptor, 1, timeout == 0 ? -1 : (int)timeout);
+        if(ret == 0)
+            return Socket::Status::Timeout;
+        if(ret < 0 && errno != EINTR)
+            return Socket::Status::Error;
+        return Socket::Status::Success;
+    }
+
+    Socket::Status Http2Connection::connection_error(ErrorCode error)
+    {
+        close(error);
+        return Socket::Status::ParseError;
+    }
+}
@@ -0,0 +1,301 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#include <algorithm>
+#include <cstring>
+#include "frnetlib/HttpClient.h"
+#include "frnetlib/TcpSocket.h"
+#include "frnetlib/Resolver.h"
+#ifdef USE_SSL
+#include "frnetlib/SSLSocket.h"
+#endif
+
+#define DEFAULT_MAX_CONNECTIONS_PER_HOST 6
+#define DEFAULT_IDLE_TIMEOUT 60000 //Milliseconds
+
+namespace fr
+{
+    namespace
+    {
+        //Checks if a comma separated header value contains a token, case insensitively
+        bool has_token(const std::string &value, const char *token)
+        {
+            size_t token_len = strlen(token);
+            size_t pos = 0;
+            while(pos < value.size())
+            {
+                pos = value.find_first_not_of(" \t,", pos);
+                if(pos == std::string::npos)
+                    break;
+                size_t end = std::min(value.find(',', pos), value.size());
+                size_t trimmed_end = value.find_last_not_of(" \t", end - 1) + 1;
+                if(trimmed_end - pos == token_len && std::equal(token, token + token_len, value.begin() + pos, [](char a, char b) {
+                    return a == ::tolower(b);
+                }))
+                {
+                    return true;
+                }
+                pos = end;
+            }
+            return false;
+        }
+    }
+
+    HttpClient::HttpClient(std::shared_ptr<SSLContext> ssl_context_)
+    : ssl_context(std::move(ssl_context_)),
+      max_connections_per_host(DEFAULT_MAX_CONNECTIONS_PER_HOST),
+      idle_timeout(DEFAULT_IDLE_TIMEOUT),
+      connect_timeout(0),
+      receive_timeout(0)
+    {
+
+    }
+
+    Socket::Status HttpClient::request(const URL &url, HttpRequest request, HttpResponse &response)
+    {
+        if(url.get_scheme() != URL::HTTP && url.get_scheme() != URL::HTTPS)
+            return Socket::Status::Error;
+
+        prepare_request(url, request);
+        std::string key = URL::scheme_to_string(url.get_scheme()) + "://" + url.get_host() + ":" + url.get_port();
+        bool decode_content = response.get_content_decoding();
+        auto body_sink = response.get_body_sink();
+        while(true)
+        {
+            Connection connection;
+            bool reused = false;
+            auto status = checkout(key, url, connection, reused);
+            if(status != Socket::Status::Success)
+                return status;
+
+            //Parse straight into the response, so that a body sink can look at its headers as it's called
+            response = HttpResponse();
+            response.set_content_decoding(decode_content);
+            response.set_body_sink(body_sink);
+            bool received = false;
+            status = exchange(*connection.socket, request, response, received);
+            bool reusable = status == Socket::Status::Success && is_reusable(request, response);
+            checkin(key, std::move(connection), reusable);
+
+            //The server might have closed a pooled connection just as it was taken. If nothing came back then
+            //the request probably wasn't processed, but only requests which can safely be repeated are tried again.
+            if(status != Socket::Status::Success && status != Socket::Status::Timeout && reused && !received && is_idempotent(request.get_type()))
+                continue;
+            return status;
+        }
+    }
+
+    void HttpClient::prepare_request(const URL &url, HttpRequest &request)
+    {
+        if(!url.get_path().empty() || !url.get_query().empty())
+            request.set_uri(url.get_path().empty() ? "/?" + url.get_query() : url.get_query().empty() ? url.get_path() : url.get_path() + "?" + url.get_query());
+        if(!request.header_exists("host"))
+        {
+            bool default_port = url.get_port().empty()
+                    || (url.get_scheme() == URL::HTTP && url.get_port() == "80")
+                    || (url.get_scheme() == URL::HTTPS && url.get_port() == "443");
+            request.header("host") = default_port ? url.get_host() : url.get_host() + ":" + url.get_port();
+        }
+    }
+
+    Socket::Status HttpClient::checkout(const std::string &key, const URL &url, Connection &connection, bool &reused)
+    {
+        std::unique_lock<std::mutex> guard(mutex);
+        auto &host = hosts[key];
+        while(true)
+        {
+            //Take the most recently used idle connection, dropping any which have expired or gone bad
+            while(!host.idle.empty())
+            {
+                connection = std::move(host.idle.back());
+                host.idle.pop_back();
+                if(std::chrono::steady_clock::now() - connection.last_used < idle_timeout && is_healthy(*connection.socket))
+                {
+                    reused = true;
+                    return Socket::Status::Success;
+                }
+                connection.socket.reset();
+                --host.open;
+            }
+
+            if(host.open < max_connections_per_host)
+                break;
+            connection_released.wait(guard);
+        }
+
+        //Open a new connection, without holding up other threads while it connects
+        ++host.open;
+        auto timeout = connect_timeout;
+        auto socket_receive_timeout = receive_timeout;
+        auto host_resolver = resolver;
+        guard.unlock();
+        reused = false;
+        auto status = open_connection(url, timeout, socket_receive_timeout, host_resolver.get(), connection);
+        if(status != Socket::Status::Success)
+        {
+            connection.socket.reset();
+            guard.lock();
+            --host.open;
+            connection_released.notify_one();
+        }
+        return status;
+    }
+
+    void HttpClient::checkin(const std::string &key, Connection connection, bool reusable)
+    {
+        if(!reusable)
+            connection.socket.reset();
+
+        std::lock_guard<std::mutex> guard(mutex);
+        auto &host = hosts[key];
+        if(reusable)
+        {
+            connection.last_used = std::chrono::steady_clock::now();
+            host.idle.emplace_back(std::move(connection));
+        }
+        else
+        {
+            --host.open;
+        }
+        connection_released.notify_one();
+    }
+
+    Socket::Status HttpClient::open_connection(const URL &url, std::chrono::seconds timeout, uint32_t socket_receive_timeout, Resolver *host_resolver, Connection &connection)
+    {
+        if(url.get_scheme() == URL::HTTPS)
+        {
+#ifdef USE_SSL
+            if(!ssl_context)
+                return Socket::Status::SSLError;
+            connection.socket.reset(new SSLSocket(ssl_context));
+#else
+            return Socket::Status::SSLError;
+#endif
+        }
+        else
+        {
+            connection.socket.reset(new TcpSocket());
+        }
+
+        const std::string &port = url.get_port().empty() ? (url.get_scheme() == URL::HTTPS ? "443" : "80") : url.get_port();
+        Socket::Status status;
+        if(host_resolver)
+        {
+            std::vector<Address> addresses;
+            status = host_resolver->resolve(url.get_host(), addresses);
+            if(status == Socket::Status::Success)
+                status = connection.socket->connect(url.get_host(), addresses, port, timeout);
+        }
+        else
+        {
+            status = connection.socket->connect(url.get_host(), port, timeout);
+        }
+        if(status != Socket::Status::Success)
+            return status;
+        connection.socket->set_receive_timeout(socket_receive_timeout);
+        return Socket::Status::Success;
+    }
+
+    Socket::Status HttpClient::exchange(Socket &socket, const HttpRequest &request, HttpResponse &response, bool &received)
+    {
+        auto status = socket.send(request);
+        if(status != Socket::Status::Success)
+            return status;
+
+        char recv_buffer[RECV_CHUNK_SIZE];
+        do
+        {
+            size_t received_size = 0;
+            status = socket.receive_raw(recv_buffer, RECV_CHUNK_SIZE, received_size);
+            if(status == Socket::Status::WouldBlock)
+                continue;
+            if(status != Socket::Status::Success)
+                return status;
+            received = true;
+            status = response.parse(recv_buffer, received_size);
+        } while(status == Socket::Status::NotEnoughData || status == Socket::Status::WouldBlock);
+        return status;
+    }
+
+    bool HttpClient::is_healthy(const Socket &socket)
+    {
+        if(!socket.connected())
+            return false;
+
+        //Nothing should arrive on an idle connection, so if it's readable then the server's closed it
+        pollfd poll_descriptor = {socket.get_socket_descriptor(), POLLIN, 0};
+        return poll_sockets(&poll_descriptor, 1, 0) == 0;
+    }
+
+    bool HttpClient::is_reusable(const HttpRequest &request, const HttpResponse &response)
+    {
+        if(has_token(request.header("connection"), "close") || has_token(response.header("connection"), "close"))
+            return false;
+        if(response.get_version() == Http::RequestVersion::V1 && !has_token(response.header("connection"), "keep-alive"))
+            return false;
+
+        //Only keep the connection if the end of the body was known, rather than being marked by the server closing it
+        auto status = static_cast<uint32_t>(response.get_status());
+        return response.is_length_delimited() || status < 200 || status == 204 || status == 304;
+    }
+
+    bool HttpClient::is_idempotent(Http::RequestType type)
+    {
+        //Requests without a type are sent as GETs
+        return type == Http::RequestType::Unknown || type == Http::RequestType::Get || type == Http::RequestType::Put || type == Http::RequestType::Delete;
+    }
+
+    void HttpClient::set_max_connections_per_host(size_t max)
+    {
+        if(max == 0)
+            throw std::logic_error("HttpClient needs to allow at least one connection per host");
+        std::lock_guard<std::mutex> guard(mutex);
+        max_connections_per_host = max;
+        connection_released.notify_all();
+    }
+
+    void HttpClient::set_idle_timeout(std::chrono::milliseconds timeout)
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        idle_timeout = timeout;
+    }
+
+    void HttpClient::set_connect_timeout(std::chrono::seconds timeout)
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        connect_timeout = timeout;
+    }
+
+    void HttpClient::set_resolver(std::shared_ptr<Resolver> resolver_)
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        resolver = std::move(resolver_);
+    }
+
+    void HttpClient::set_receive_timeout(uint32_t timeout)
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        receive_timeout = timeout;
+    }
+
+    void HttpClient::close_idle_connections()
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        for(auto &host : hosts)
+        {
+            host.second.open -= host.second.idle.size();
+            host.second.idle.clear();
+        }
+        connection_released.notify_all();
+    }
+
+    size_t HttpClient::get_idle_connection_count() const
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        size_t count = 0;
+        for(auto &host : hosts)
+            count += host.second.idle.size();
+        return count;
+    }
+}
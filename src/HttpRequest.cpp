@@ -9,13 +9,19 @@ namespace fr
 {
      HttpRequest::HttpRequest()
     : header_ended(false),
-      content_length(0)
+      content_length(0),
+      multipart_streaming(false),
+      multipart_received(0)
     {
 
     }
 
     fr::Socket::Status HttpRequest::parse(const char *request, size_t requestsz)
     {
+        //Multipart bodies go straight to the parser, rather than being stored
+        if(multipart_streaming)
+            return parse_multipart_body(request, requestsz);
+
         body.append(request, requestsz);
 
         //Ensure that the whole header has been parsed first
@@ -51,6 +57,20 @@ namespace fr
 
             //Leave things after the header intact
             body.erase(0, header_end + header_end_size);
+
+            //Start streaming the body if it's multipart, and there's somewhere to stream it to
+            auto content_type = header_data.find("content-type");
+            if(multipart_parser && content_type != header_data.end() && content_type->second.size() >= 10
+               && std::equal(content_type->second.begin(), content_type->second.begin() + 10, "multipart/", [](char a, char b) {
+                   return ::tolower(a) == b;
+               }))
+            {
+                multipart_parser->set_boundary(MultipartParser::get_parameter(content_type->second, "boundary"));
+                multipart_streaming = true;
+                std::string initial;
+                initial.swap(body);
+                return parse_multipart_body(initial.data(), initial.size());
+            }
         }
 
         //Ensure that body doesn't exceed maximum length
@@ -59,17 +79,48 @@ namespace fr
             return fr::Socket::Status::HttpBodyTooBig;
         }
 
-        //If we've got the whole request, parse the POST if it exists
+        //If we've got the whole request, note if there's a form to parse when it's needed
         if(body.size() >= content_length)
         {
             if(request_type == RequestType::Post)
-                parse_post_body();
+            {
+                auto content_type = header_data.find("content-type");
+                pending_form = content_type == header_data.end() || (content_type->second.size() >= 33
+                    && std::equal(content_type->second.begin(), content_type->second.begin() + 33, "application/x-www-form-urlencoded", [](char a, char b) {
+                        return ::tolower(a) == b;
+                    }));
+                if(pending_form)
+                    set_arguments_pending();
+            }
             return fr::Socket::Status::Success;
         }
 
         return fr::Socket::Status::NotEnoughData;
     }
 
+    fr::Socket::Status HttpRequest::parse_multipart_body(const char *data, size_t datasz)
+    {
+        //Don't read past the end of the body. Without a content length, the closing boundary is the end.
+        if(content_length != 0)
+            datasz = std::min(datasz, content_length - multipart_received);
+        multipart_received += datasz;
+
+        auto status = multipart_parser->parse(data, datasz);
+        if(content_length == 0 || (status != fr::Socket::Status::NotEnoughData && status != fr::Socket::Status::Success))
+            return status;
+
+        //Anything after the closing boundary still needs to be received, and
+        //running out of body before the closing boundary means it's malformed.
+        if(multipart_received < content_length)
+            return fr::Socket::Status::NotEnoughData;
+        return status == fr::Socket::Status::Success ? status : fr::Socket::Status::ParseError;
+    }
+
+    void HttpRequest::set_multipart_parser(std::shared_ptr<MultipartParser> parser)
+    {
+        multipart_parser = std::move(parser);
+    }
+
     bool HttpRequest::parse_header(int64_t header_end_pos)
     {
         try
@@ -106,6 +157,8 @@ namespace fr
 
     std::string HttpRequest::construct(const std::string &host) const
     {
+        parse_pending_arguments();
+
         //Add HTTP header
         std::string request = request_type_to_string(request_type == Http::RequestType::Unknown ? Http::RequestType::Get : request_type) + " " + uri;
         if(!get_data.empty())
@@ -134,7 +187,7 @@ namespace fr
         for(auto iter = post_data.begin(); iter != post_data.end();)
         {
             post_string += iter->first + "=" + iter->second;
-            if(++iter != get_data.end())
+            if(++iter != post_data.end())
                 post_string += "&";
         }
         if(!post_string.empty())
@@ -162,30 +215,6 @@ namespace fr
         return request;
     }
 
-    void HttpRequest::parse_post_body()
-    {
-        //Find beginning of post data
-        auto post_begin = body.find_first_not_of("\r\n");
-        if(post_begin == std::string::npos)
-            post_begin = body.find_first_not_of('\n');
-
-        //Find end of post data
-        auto post_end = body.rfind("\r\n\r\n");
-        if(post_end == std::string::npos)
-            post_end = body.rfind("\n\n");
-
-        //Sanity check
-        if(post_begin == post_end || post_begin == std::string::npos)
-            return;
-
-        //Split up the body and store each argument name and value
-        auto post = parse_argument_list(body.substr(post_begin, body.size() - post_begin - (body.size() - post_end)));
-        for(auto &c : post)
-        {
-            this->post(std::move(c.first)) = std::move(c.second);
-        }
-    }
-
     Http::RequestType HttpRequest::parse_header_type(const std::string &str)
     {
         //Find the request type
@@ -207,16 +236,12 @@ namespace fr
         }
         --uri_end;
 
-        //Parse GET variables
+        //GET variables are only parsed if they're used
         auto get_begin = str.find('?');
-        if(get_begin != std::string::npos)
+        if(get_begin != std::string::npos && get_begin < uri_end)
         {
-            auto get_vars = parse_argument_list(str.substr(get_begin, uri_end - get_begin));
-            for(auto &c : get_vars)
-            {
-                std::transform(c.first.begin(), c.first.end(), c.first.begin(), ::tolower);
-                get_data.emplace(std::move(c.first), std::move(c.second));
-            }
+            pending_query = str.substr(get_begin + 1, uri_end - get_begin - 1);
+            set_arguments_pending();
             set_uri(str.substr(uri_begin, get_begin - uri_begin));
         }
         else
@@ -3,7 +3,12 @@
 //
 
 #include <iostream>
+#include <cstdlib>
+#include <algorithm>
 #include "frnetlib/HttpResponse.h"
+#ifdef USE_ZLIB
+#include "frnetlib/Compression.h"
+#endif
 
 namespace fr
 {
@@ -46,46 +51,138 @@ namespace fr
             body.erase(0, header_end + header_end_size);
         }
 
-        //Ensure that body doesn't exceed maximum length
-        if(body.size() > MAX_HTTP_BODY_SIZE)
+        //Ensure that body doesn't exceed maximum length. Streamed bodies are passed on as they arrive, so only what's pending counts.
+        if(!body_sink && body.size() > MAX_HTTP_BODY_SIZE)
             return fr::Socket::Status::HttpBodyTooBig;
 
         //Check if chunked encoding
         if(transfer_encodings.find(TransferEncoding::Chunked) != transfer_encodings.end())
         {
-            //It's chunked, find the length of the chunk in hex!
-            unsigned int chunk_len = 1;
-            while(chunk_len > 0 && chunk_offset < body.size())
+            //De-chunk as much as has arrived. Everything before chunk_offset has been de-chunked, and a chunk's data
+            //is taken as it arrives, rather than once the whole chunk is here, so that big chunks can be streamed.
+            auto state = fr::Socket::Status::NotEnoughData;
+            while(true)
             {
+                if(in_chunk)
+                {
+                    size_t available = std::min(chunk_remaining, body.size() - chunk_offset);
+                    chunk_offset += available;
+                    chunk_remaining -= available;
+                    if(chunk_remaining > 0 || body.size() - chunk_offset < 2)
+                        break;
+                    body.erase(chunk_offset, 2); //delete \r\n after chunk
+                    in_chunk = false;
+                }
+
+                //Find the length of the next chunk in hex!
                 auto length_end = body.find("\r\n", chunk_offset);
                 if(length_end == std::string::npos)
-                    return fr::Socket::Status::NotEnoughData;
-                std::string hex_length = body.substr(chunk_offset, length_end - chunk_offset);
-                chunk_len = std::stoul(hex_length, nullptr, 16);
-
-                //If the current chunk hasn't fully been received yet then ask for more data
-                if(body.size() - length_end < chunk_len + 4) //+4 because of the \r\n after the hex value and the chunk end
-                    return fr::Socket::Status::NotEnoughData;
-
-                //Now we have the full chunk, erase the padding \r\n
-                body.erase(chunk_offset + hex_length.size() + chunk_len + 2, 2); //delete \r\n after chunk
-                body.erase(chunk_offset, hex_length.size() + 2); //delete both hex length and following \r\n
-                chunk_offset += chunk_len;
+                    break;
+                char *hex_end = nullptr;
+                chunk_remaining = std::strtoull(&body[chunk_offset], &hex_end, 16);
+                if(hex_end == &body[chunk_offset])
+                    return fr::Socket::Status::ParseError;
+
+                //If this chunk is 0, we have everything, once the empty line after it arrives
+                if(chunk_remaining == 0)
+                {
+                    if(body.size() - length_end < 4)
+                        break;
+                    body.erase(chunk_offset, length_end + 4 - chunk_offset);
+                    state = fr::Socket::Status::Success;
+                    break;
+                }
+
+                body.erase(chunk_offset, length_end + 2 - chunk_offset); //delete both hex length and following \r\n
+                in_chunk = true;
+            }
+
+            //Decode whatever has been de-chunked so far
+            if(inflater.value)
+            {
+                auto inflate_state = inflate_body(chunk_offset);
+                if(inflate_state != fr::Socket::Status::Success)
+                    return inflate_state;
+                chunk_offset = decoded_offset;
             }
 
-            //If this chunk is 0, we have everything!
-            if(chunk_len == 0)
-                return fr::Socket::Status::Success;
-            return fr::Socket::Status::NotEnoughData;
+            //Anything after the last chunk isn't part of this response
+            if(state == fr::Socket::Status::Success && body.size() > chunk_offset)
+            {
+                excess_data.assign(body, chunk_offset, std::string::npos);
+                body.resize(chunk_offset);
+            }
+
+            if(!drain_body(chunk_offset))
+                return fr::Socket::Status::Error;
+            return state;
+        }
+
+        //If the body is encoded, then decode as much as we've got, up to the content length
+        if(inflater.value)
+        {
+            size_t available = body.size() - decoded_offset;
+            if(content_length > 0 && content_received + available > content_length)
+            {
+                available = content_length - content_received;
+                excess_data.assign(body, decoded_offset + available, std::string::npos);
+                body.resize(decoded_offset + available);
+            }
+            content_received += available;
+
+            auto inflate_state = inflate_body(body.size());
+            if(inflate_state != fr::Socket::Status::Success)
+                return inflate_state;
+            if(!drain_body(decoded_offset))
+                return fr::Socket::Status::Error;
+            return content_received < content_length ? fr::Socket::Status::NotEnoughData : fr::Socket::Status::Success;
         }
 
         //Cut off any data if it exceeds content length, provided that a content length is specified
-        if(content_length > 0 && body.size() > content_length)
-            body.resize(content_length);
-        else if(body.size() < content_length)
-            return fr::Socket::Status::NotEnoughData;
-        return fr::Socket::Status::Success;
+        bool has_length = header_data.find("content-length") != header_data.end();
+        if(has_length && content_received + body.size() > content_length)
+        {
+            excess_data.assign(body, content_length - content_received, std::string::npos);
+            body.resize(content_length - content_received);
+        }
+
+        if(body_sink)
+        {
+            content_received += body.size();
+            if(!drain_body(body.size()))
+                return fr::Socket::Status::Error;
+            return has_length && content_received < content_length ? fr::Socket::Status::NotEnoughData : fr::Socket::Status::Success;
+        }
+        return body.size() < content_length ? fr::Socket::Status::NotEnoughData : fr::Socket::Status::Success;
+    }
+
+    bool HttpResponse::drain_body(size_t end)
+    {
+        if(!body_sink || end == 0)
+            return true;
 
+        bool accepted = body_sink(body.data(), end);
+        body.erase(0, end);
+        decoded_offset = 0;
+        chunk_offset -= std::min(chunk_offset, end);
+        return accepted;
+    }
+
+    fr::Socket::Status HttpResponse::inflate_body(size_t payload_end)
+    {
+#ifdef USE_ZLIB
+        std::string decoded;
+        auto status = inflater.value->inflate(&body[decoded_offset], payload_end - decoded_offset, decoded, MAX_HTTP_BODY_SIZE - decoded_offset);
+        if(status == fr::Socket::Status::MaxPacketSizeExceeded)
+            return fr::Socket::Status::HttpBodyTooBig;
+        if(status == fr::Socket::Status::ParseError)
+            return fr::Socket::Status::ParseError;
+
+        //Swap the encoded data for the decoded data
+        body.replace(decoded_offset, payload_end - decoded_offset, decoded);
+        decoded_offset += decoded.size();
+#endif
+        return fr::Socket::Status::Success;
     }
 
     std::string HttpResponse::construct(const std::string &host) const
@@ -150,6 +247,22 @@ namespace fr
             auto length_header_iter = header_data.find("content-length");
             if(length_header_iter != header_data.end())
                 content_length = std::stoull(length_header_iter->second);
+            length_delimited = length_header_iter != header_data.end() || transfer_encodings.find(TransferEncoding::Chunked) != transfer_encodings.end();
+
+#ifdef USE_ZLIB
+            //Prepare to decode the body if it's encoded, and we've been asked to
+            auto encoding_header_iter = header_data.find("content-encoding");
+            if(decode_content && encoding_header_iter != header_data.end())
+            {
+                auto encoding = string_to_transfer_encoding(encoding_header_iter->second);
+                if(encoding == TransferEncoding::Gzip || encoding == TransferEncoding::Deflate)
+                {
+                    inflater.value = std::make_shared<Inflater>(Inflater::Format::Auto);
+                    header_data.erase(encoding_header_iter);
+                    header_data.erase("content-length");
+                }
+            }
+#endif
         }
         catch(const std::exception &e)
         {
@@ -157,4 +270,20 @@ namespace fr
         }
         return true;
     }
+    HttpResponse::InflaterPtr::InflaterPtr(const InflaterPtr &other)
+    {
+        *this = other;
+    }
+
+    HttpResponse::InflaterPtr &HttpResponse::InflaterPtr::operator=(const InflaterPtr &other)
+    {
+        if(this == &other)
+            return *this;
+#ifdef USE_ZLIB
+        value = other.value ? std::make_shared<Inflater>(*other.value) : nullptr;
+#else
+        value = nullptr; //There's never anything to decode without zlib
+#endif
+        return *this;
+    }
 }
\ No newline at end of file
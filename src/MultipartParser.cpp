@@ -0,0 +1,231 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#include <algorithm>
+#include "frnetlib/MultipartParser.h"
+
+#define MAX_BOUNDARY_LENGTH 70 //RFC 2046 5.1.1
+
+namespace fr
+{
+    MultipartParser::MultipartParser(const std::string &boundary)
+    {
+        set_boundary(boundary);
+    }
+
+    void MultipartParser::set_boundary(const std::string &boundary)
+    {
+        delimiter = "\r\n--" + boundary;
+        state = State::Preamble;
+
+        //The first boundary doesn't have to be preceded by a CRLF, so pretend that one was received
+        buffer = "\r\n";
+
+        //Build the Boyer-Moore-Horspool bad character table. Each byte maps to how far
+        //the search can skip when that byte is at the end of the window and it doesn't match.
+        for(auto &skip : skip_table)
+            skip = delimiter.size();
+        for(size_t a = 0; a + 1 < delimiter.size(); ++a)
+            skip_table[static_cast<uint8_t>(delimiter[a])] = delimiter.size() - 1 - a;
+    }
+
+    Socket::Status MultipartParser::parse(const char *data, size_t datasz)
+    {
+        if(delimiter.size() <= 4 || delimiter.size() > 4 + MAX_BOUNDARY_LENGTH)
+            return Socket::Status::ParseError;
+        if(state == State::Finished)
+            return Socket::Status::Success;
+
+        buffer.append(data, datasz);
+
+        //Work through the buffer, and only remove what's been consumed once at the end
+        size_t pos = 0;
+        Socket::Status status = Socket::Status::NotEnoughData;
+        while(status == Socket::Status::NotEnoughData)
+        {
+            if(state == State::Preamble || state == State::Data)
+            {
+                auto delimiter_pos = find_delimiter(pos);
+                if(delimiter_pos == std::string::npos)
+                {
+                    //The end of the buffer could be the start of a delimiter, so keep hold of that much
+                    size_t keep = delimiter.size() - 1;
+                    if(buffer.size() - pos > keep)
+                    {
+                        if(state == State::Data && part_data_callback)
+                            part_data_callback(&buffer[pos], buffer.size() - pos - keep);
+                        pos = buffer.size() - keep;
+                    }
+                    break;
+                }
+
+                if(state == State::Data)
+                {
+                    if(delimiter_pos > pos && part_data_callback)
+                        part_data_callback(&buffer[pos], delimiter_pos - pos);
+                    if(part_end_callback)
+                        part_end_callback();
+                }
+                pos = delimiter_pos + delimiter.size();
+                state = State::BoundaryEnd;
+            }
+            else if(state == State::BoundaryEnd)
+            {
+                //A "--" after the boundary marks the end of the body
+                if(buffer.size() - pos < 2)
+                    break;
+                if(buffer.compare(pos, 2, "--") == 0)
+                {
+                    pos = buffer.size();
+                    state = State::Finished;
+                    status = Socket::Status::Success;
+                    break;
+                }
+
+                //Otherwise there might be some whitespace, and then the CRLF which starts the next part's headers
+                while(pos < buffer.size() && (buffer[pos] == ' ' || buffer[pos] == '\t'))
+                    ++pos;
+                if(buffer.size() - pos < 2)
+                    break;
+                if(buffer.compare(pos, 2, "\r\n") != 0)
+                {
+                    status = Socket::Status::ParseError;
+                    break;
+                }
+                pos += 2;
+                state = State::Headers;
+            }
+            else if(state == State::Headers)
+            {
+                //A part with no headers at all
+                if(buffer.size() - pos < 2)
+                    break;
+                if(buffer.compare(pos, 2, "\r\n") == 0)
+                {
+                    begin_part(pos, pos);
+                    pos += 2;
+                    state = State::Data;
+                    continue;
+                }
+
+                auto header_end = buffer.find("\r\n\r\n", pos);
+                if(header_end == std::string::npos)
+                {
+                    if(buffer.size() - pos > MAX_HTTP_HEADER_SIZE)
+                        status = Socket::Status::HttpHeaderTooBig;
+                    break;
+                }
+                if(header_end - pos > MAX_HTTP_HEADER_SIZE)
+                {
+                    status = Socket::Status::HttpHeaderTooBig;
+                    break;
+                }
+
+                begin_part(pos, header_end);
+                pos = header_end + 4;
+                state = State::Data;
+            }
+        }
+
+        buffer.erase(0, pos);
+        return status;
+    }
+
+    size_t MultipartParser::find_delimiter(size_t offset) const
+    {
+        const size_t last = delimiter.size() - 1;
+        const char *haystack = buffer.data();
+        while(offset + last < buffer.size())
+        {
+            size_t a = last;
+            while(haystack[offset + a] == delimiter[a])
+            {
+                if(a-- == 0)
+                    return offset;
+            }
+            offset += skip_table[static_cast<uint8_t>(haystack[offset + last])];
+        }
+        return std::string::npos;
+    }
+
+    void MultipartParser::begin_part(size_t header_begin, size_t header_end)
+    {
+        Headers headers;
+        while(header_begin < header_end)
+        {
+            auto line_end = buffer.find("\r\n", header_begin);
+            if(line_end == std::string::npos || line_end > header_end)
+                line_end = header_end;
+
+            auto colon = buffer.find(':', header_begin);
+            if(colon < line_end)
+            {
+                std::string name = buffer.substr(header_begin, colon - header_begin);
+                std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+                auto value_begin = buffer.find_first_not_of(" \t", colon + 1);
+                auto value_end = buffer.find_last_not_of(" \t", line_end - 1);
+                if(value_begin < line_end && value_end != std::string::npos && value_end >= value_begin)
+                    headers[name] = buffer.substr(value_begin, value_end - value_begin + 1);
+                else
+                    headers[name];
+            }
+            header_begin = line_end + 2;
+        }
+
+        if(part_begin_callback)
+            part_begin_callback(headers);
+    }
+
+    std::string MultipartParser::get_parameter(const std::string &header_value, const std::string &name)
+    {
+        //Parameters come after the first ';', as 'name=value' or 'name="quoted value"'
+        size_t pos = header_value.find(';');
+        while(pos < header_value.size())
+        {
+            pos = header_value.find_first_not_of("; \t", pos);
+            if(pos == std::string::npos)
+                break;
+
+            auto name_end = header_value.find_first_of("=;", pos);
+            if(name_end == std::string::npos)
+                break;
+            auto trimmed_end = header_value.find_last_not_of(" \t", name_end - 1) + 1;
+            bool matches = trimmed_end - pos == name.size()
+                    && std::equal(name.begin(), name.end(), header_value.begin() + pos, [](char a, char b) {
+                        return ::tolower(a) == ::tolower(b);
+                    });
+
+            pos = name_end;
+            if(header_value[pos] == ';')
+                continue;
+
+            //Read the value, unescaping it if it's quoted
+            std::string value;
+            pos = header_value.find_first_not_of(" \t", pos + 1);
+            if(pos == std::string::npos)
+                break;
+            if(header_value[pos] == '"')
+            {
+                for(++pos; pos < header_value.size() && header_value[pos] != '"'; ++pos)
+                {
+                    if(header_value[pos] == '\\' && pos + 1 < header_value.size())
+                        ++pos;
+                    value += header_value[pos];
+                }
+                ++pos;
+            }
+            else
+            {
+                auto value_end = std::min(header_value.find(';', pos), header_value.size());
+                value = header_value.substr(pos, header_value.find_last_not_of(" \t", value_end - 1) + 1 - pos);
+                pos = value_end;
+            }
+
+            if(matches)
+                return value;
+        }
+        return {};
+    }
+}
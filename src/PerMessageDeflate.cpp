@@ -0,0 +1,385 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include "frnetlib/PerMessageDeflate.h"
+#ifdef USE_ZLIB
+#include "frnetlib/Compression.h"
+#define COMPRESSION_SUPPORTED true
+#else
+#define COMPRESSION_SUPPORTED false
+#endif
+
+#define EXTENSION_NAME "permessage-deflate"
+#define MIN_DEFLATE_WINDOW_BITS 9 //zlib can't make raw deflate streams with a window of 8 bits
+#define MIN_INFLATE_WINDOW_BITS 9 //Inflate with at least this, in case the other end rounded 8 bits up too
+#define DEFAULT_MEMORY_LEVEL 8 //zlib's default deflate memory level
+#define INFLATE_OVERHEAD 7168 //zlib's estimate of an inflate stream's memory, besides its window
+
+namespace fr
+{
+#ifdef USE_ZLIB
+    struct PerMessageDeflate::Streams
+    {
+        std::unique_ptr<Deflater> deflater;
+        std::unique_ptr<Inflater> inflater;
+    };
+#else
+    struct PerMessageDeflate::Streams {};
+#endif
+
+    namespace
+    {
+        //An extension from a Sec-WebSocket-Extensions header, and its parameters in order
+        struct Extension
+        {
+            std::string name;
+            std::vector<std::pair<std::string, std::string>> params;
+        };
+
+        std::string trim(const std::string &str)
+        {
+            auto start = str.find_first_not_of(" \t");
+            if(start == std::string::npos)
+                return "";
+            return str.substr(start, str.find_last_not_of(" \t") - start + 1);
+        }
+
+        std::vector<std::string> split(const std::string &str, char delimiter)
+        {
+            std::vector<std::string> parts;
+            size_t start = 0;
+            while(true)
+            {
+                auto end = str.find(delimiter, start);
+                parts.emplace_back(trim(str.substr(start, end - start)));
+                if(end == std::string::npos)
+                    return parts;
+                start = end + 1;
+            }
+        }
+
+        //Splits a header into its extensions, like "permessage-deflate; client_max_window_bits, x-other"
+        std::vector<Extension> parse_extensions(const std::string &header)
+        {
+            std::vector<Extension> extensions;
+            for(auto &offer : split(header, ','))
+            {
+                auto parts = split(offer, ';');
+                Extension extension;
+                extension.name = parts[0];
+                for(size_t a = 1; a < parts.size(); ++a)
+                {
+                    auto equals = parts[a].find('=');
+                    std::string value = equals == std::string::npos ? "" : trim(parts[a].substr(equals + 1));
+                    if(value.size() >= 2 && value.front() == '"' && value.back() == '"')
+                        value = value.substr(1, value.size() - 2);
+                    extension.params.emplace_back(trim(parts[a].substr(0, equals)), value);
+                }
+                extensions.emplace_back(std::move(extension));
+            }
+            return extensions;
+        }
+
+        //Parses a window bits parameter. Returns 0 if it's invalid.
+        uint8_t parse_window_bits(const std::string &value)
+        {
+            if(value.empty() || value.size() > 2 || value.find_first_not_of("0123456789") != std::string::npos)
+                return 0;
+            auto bits = std::stoi(value);
+            return bits >= 8 && bits <= 15 ? static_cast<uint8_t>(bits) : 0;
+        }
+
+        size_t deflate_memory(uint8_t window_bits, uint8_t memory_level)
+        {
+            return (size_t(1) << (window_bits + 2)) + (size_t(1) << (memory_level + 9));
+        }
+
+        size_t inflate_memory(uint8_t window_bits)
+        {
+            return (size_t(1) << std::max<uint8_t>(window_bits, MIN_INFLATE_WINDOW_BITS)) + INFLATE_OVERHEAD;
+        }
+    }
+
+    PerMessageDeflate::PerMessageDeflate()
+    : enabled(false),
+      compression_level(-1),
+      max_window_bits(15),
+      peer_max_window_bits(15),
+      no_context_takeover(false),
+      peer_no_context_takeover(false),
+      memory_limit(0),
+      min_size(0),
+      active(false),
+      deflate_window_bits(15),
+      deflate_memory_level(DEFAULT_MEMORY_LEVEL),
+      inflate_window_bits(15),
+      deflate_no_context_takeover(false),
+      inflate_no_context_takeover(false)
+    {
+
+    }
+
+    PerMessageDeflate::~PerMessageDeflate() = default;
+
+    void PerMessageDeflate::set_max_window_bits(uint8_t bits)
+    {
+        if(bits < MIN_DEFLATE_WINDOW_BITS || bits > 15)
+            throw std::logic_error("permessage-deflate window bits must be between 9 and 15");
+        max_window_bits = bits;
+    }
+
+    void PerMessageDeflate::set_peer_max_window_bits(uint8_t bits)
+    {
+        if(bits < 8 || bits > 15)
+            throw std::logic_error("permessage-deflate peer window bits must be between 8 and 15");
+        peer_max_window_bits = bits;
+    }
+
+    size_t PerMessageDeflate::get_memory_usage() const
+    {
+        if(!active)
+            return 0;
+        return deflate_memory(deflate_window_bits, deflate_memory_level) + inflate_memory(inflate_window_bits);
+    }
+
+    std::string PerMessageDeflate::offer() const
+    {
+        uint8_t own_bits = max_window_bits, peer_bits = peer_max_window_bits, level = DEFAULT_MEMORY_LEVEL;
+        if(!enabled || !COMPRESSION_SUPPORTED || !fit_memory_limit(own_bits, peer_bits, level, true))
+            return "";
+
+        //The server can always be asked for a smaller window, and client_max_window_bits says that it can ask us
+        std::string extension = EXTENSION_NAME "; client_max_window_bits";
+        if(peer_bits < 15)
+            extension += "; server_max_window_bits=" + std::to_string(peer_bits);
+        if(no_context_takeover)
+            extension += "; client_no_context_takeover";
+        if(peer_no_context_takeover)
+            extension += "; server_no_context_takeover";
+        return extension;
+    }
+
+    bool PerMessageDeflate::accept_offer(const std::string &extensions, std::string &response)
+    {
+        reset();
+        if(!enabled || !COMPRESSION_SUPPORTED)
+            return false;
+
+        //Take the first offer we can meet. Any with unknown or repeated parameters are skipped.
+        for(auto &extension : parse_extensions(extensions))
+        {
+            if(extension.name != EXTENSION_NAME)
+                continue;
+
+            uint8_t own_bits = max_window_bits, peer_bits = 15, level = DEFAULT_MEMORY_LEVEL;
+            bool own_no_takeover = no_context_takeover, peer_no_takeover = peer_no_context_takeover;
+            bool peer_adjustable = false, valid = true;
+            std::vector<std::string> seen;
+            for(auto &param : extension.params)
+            {
+                valid = std::find(seen.begin(), seen.end(), param.first) == seen.end();
+                seen.emplace_back(param.first);
+                if(param.first == "server_no_context_takeover")
+                {
+                    valid &= param.second.empty();
+                    own_no_takeover = true;
+                }
+                else if(param.first == "client_no_context_takeover")
+                {
+                    valid &= param.second.empty();
+                    peer_no_takeover = true;
+                }
+                else if(param.first == "server_max_window_bits")
+                {
+                    uint8_t bits = parse_window_bits(param.second);
+                    valid &= bits >= MIN_DEFLATE_WINDOW_BITS;
+                    own_bits = std::min(own_bits, bits);
+                }
+                else if(param.first == "client_max_window_bits")
+                {
+                    uint8_t bits = param.second.empty() ? 15 : parse_window_bits(param.second);
+                    valid &= bits != 0;
+                    peer_adjustable = true;
+                    peer_bits = std::min(peer_max_window_bits, bits);
+                }
+                else
+                {
+                    valid = false;
+                }
+                if(!valid)
+                    break;
+            }
+            if(!valid || !fit_memory_limit(own_bits, peer_bits, level, peer_adjustable))
+                continue;
+
+            response = EXTENSION_NAME;
+            if(own_no_takeover)
+                response += "; server_no_context_takeover";
+            if(peer_no_takeover)
+                response += "; client_no_context_takeover";
+            if(own_bits < 15)
+                response += "; server_max_window_bits=" + std::to_string(own_bits);
+            if(peer_adjustable && peer_bits < 15)
+                response += "; client_max_window_bits=" + std::to_string(peer_bits);
+
+            active = true;
+            deflate_window_bits = own_bits;
+            deflate_memory_level = level;
+            inflate_window_bits = std::max<uint8_t>(peer_bits, MIN_INFLATE_WINDOW_BITS);
+            deflate_no_context_takeover = own_no_takeover;
+            inflate_no_context_takeover = peer_no_takeover;
+            return true;
+        }
+        return false;
+    }
+
+    bool PerMessageDeflate::accept_response(const std::string &extensions)
+    {
+        reset();
+
+        //The server can only accept the one extension that we offered
+        auto accepted = parse_extensions(extensions);
+        if(!enabled || !COMPRESSION_SUPPORTED || accepted.size() != 1 || accepted[0].name != EXTENSION_NAME)
+            return false;
+
+        uint8_t own_bits = max_window_bits, requested_bits = peer_max_window_bits, level = DEFAULT_MEMORY_LEVEL;
+        if(!fit_memory_limit(own_bits, requested_bits, level, true))
+            return false;
+
+        uint8_t peer_bits = 15;
+        bool own_no_takeover = no_context_takeover, peer_no_takeover = false;
+        std::vector<std::string> seen;
+        for(auto &param : accepted[0].params)
+        {
+            if(std::find(seen.begin(), seen.end(), param.first) != seen.end())
+                return false;
+            seen.emplace_back(param.first);
+            if(param.first == "server_no_context_takeover" && param.second.empty())
+            {
+                peer_no_takeover = true;
+            }
+            else if(param.first == "client_no_context_takeover" && param.second.empty())
+            {
+                own_no_takeover = true;
+            }
+            else if(param.first == "server_max_window_bits")
+            {
+                peer_bits = parse_window_bits(param.second);
+                if(peer_bits == 0)
+                    return false;
+            }
+            else if(param.first == "client_max_window_bits")
+            {
+                uint8_t bits = parse_window_bits(param.second);
+                if(bits < MIN_DEFLATE_WINDOW_BITS)
+                    return false;
+                own_bits = std::min(own_bits, bits);
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        //The server mustn't use a bigger window than we asked for
+        if(peer_bits > requested_bits)
+            return false;
+
+        active = true;
+        deflate_window_bits = own_bits;
+        deflate_memory_level = level;
+        inflate_window_bits = std::max<uint8_t>(peer_bits, MIN_INFLATE_WINDOW_BITS);
+        deflate_no_context_takeover = own_no_takeover;
+        inflate_no_context_takeover = peer_no_takeover;
+        return true;
+    }
+
+    void PerMessageDeflate::reset()
+    {
+        active = false;
+        streams.reset();
+    }
+
+    Socket::Status PerMessageDeflate::compress(const char *data, size_t size, bool final, std::string &out)
+    {
+#ifdef USE_ZLIB
+        if(!active)
+            return Socket::Status::Error;
+        if(!streams)
+            streams.reset(new Streams());
+        if(!streams->deflater)
+            streams->deflater.reset(new Deflater(Deflater::Format::Raw, compression_level, deflate_window_bits, deflate_memory_level));
+
+        auto status = streams->deflater->deflate(data, size, out, final ? Deflater::Flush::Sync : Deflater::Flush::None);
+        if(status != Socket::Status::Success || !final)
+            return status;
+
+        //Each message ends with a sync flush, but its trailing 0x00 0x00 0xFF 0xFF isn't sent
+        out.resize(out.size() - 4);
+        if(deflate_no_context_takeover)
+            streams->deflater.reset();
+        return Socket::Status::Success;
+#else
+        return Socket::Status::Error;
+#endif
+    }
+
+    Socket::Status PerMessageDeflate::decompress(const char *data, size_t size, bool final, std::string &out, size_t max_out)
+    {
+#ifdef USE_ZLIB
+        if(!active)
+            return Socket::Status::Error;
+        if(!streams)
+            streams.reset(new Streams());
+        if(!streams->inflater)
+            streams->inflater.reset(new Inflater(Inflater::Format::Raw, inflate_window_bits));
+
+        //Put back the end of the sync flush which the sender left off
+        static const char tail[] = {0x00, 0x00, (char)0xFF, (char)0xFF};
+        size_t start = out.size();
+        auto status = streams->inflater->inflate(data, size, out, max_out);
+        if(final && status == Socket::Status::NotEnoughData)
+            status = streams->inflater->inflate(tail, sizeof(tail), out, max_out - (out.size() - start));
+
+        //Start afresh after each message if the sender doesn't keep its context, or after the stream's
+        //been ended with a final block
+        if(status == Socket::Status::NotEnoughData || status == Socket::Status::Success)
+        {
+            if(final && (inflate_no_context_takeover || streams->inflater->finished()))
+                streams->inflater.reset();
+            return Socket::Status::Success;
+        }
+        streams->inflater.reset();
+        return status;
+#else
+        return Socket::Status::Error;
+#endif
+    }
+
+    bool PerMessageDeflate::fit_memory_limit(uint8_t &own_bits, uint8_t &peer_bits, uint8_t &level, bool peer_adjustable) const
+    {
+        if(memory_limit == 0)
+            return true;
+
+        while(deflate_memory(own_bits, level) + inflate_memory(peer_bits) > memory_limit)
+        {
+            size_t window = own_bits > MIN_DEFLATE_WINDOW_BITS ? size_t(1) << (own_bits + 2) : 0;
+            size_t hash = level > 1 ? size_t(1) << (level + 9) : 0;
+            size_t peer_window = peer_adjustable && peer_bits > MIN_INFLATE_WINDOW_BITS ? size_t(1) << peer_bits : 0;
+            if(window == 0 && hash == 0 && peer_window == 0)
+                return false;
+
+            if(window >= hash && window >= peer_window)
+                --own_bits;
+            else if(hash >= peer_window)
+                --level;
+            else
+                --peer_bits;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,205 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include "frnetlib/RangeDownloader.h"
+
+#define DEFAULT_SEGMENT_COUNT 4
+#define DEFAULT_MAX_ATTEMPTS 3
+#define MIN_SEGMENT_SIZE 65536 //Objects aren't split up any smaller than this
+
+namespace fr
+{
+#ifndef _WIN32
+    namespace
+    {
+        //Writes all of a buffer to a file at an offset
+        bool write_at(int32_t fd, const char *data, size_t size, uint64_t offset)
+        {
+            while(size > 0)
+            {
+                ssize_t written = ::pwrite(fd, data, size, (off_t)offset);
+                if(written < 0 && errno == EINTR)
+                    continue;
+                if(written <= 0)
+                    return false;
+                data += written;
+                size -= written;
+                offset += written;
+            }
+            return true;
+        }
+    }
+#endif
+
+    RangeDownloader::RangeDownloader(HttpClient &client_)
+    : client(client_),
+      segment_count(DEFAULT_SEGMENT_COUNT),
+      max_attempts(DEFAULT_MAX_ATTEMPTS)
+    {
+
+    }
+
+    Socket::Status RangeDownloader::download(const URL &url, int32_t fd, const HttpRequest &request)
+    {
+#ifndef _WIN32
+        //Ask for the first byte to find out how big the object is. A server which doesn't support
+        //ranges will send the whole object instead, which is written out as it arrives.
+        HttpRequest probe = request;
+        probe.header("range") = "bytes=0-0";
+        HttpResponse response;
+        uint64_t written = 0;
+        response.set_body_sink([&](const char *data, size_t size) {
+            if(response.get_status() != Http::RequestStatus::Ok && response.get_status() != Http::RequestStatus::PartialContent)
+                return true;
+            if(!write_at(fd, data, size, written))
+                return false;
+            written += size;
+            return true;
+        });
+        auto status = client.request(url, probe, response);
+        if(status != Socket::Status::Success)
+            return status;
+        if(response.get_status() == Http::RequestStatus::Ok)
+            return ::ftruncate(fd, (off_t)written) == 0 ? Socket::Status::Success : Socket::Status::Error;
+
+        uint64_t first = 0, total = 0;
+        if(response.get_status() != Http::RequestStatus::PartialContent && response.get_status() != Http::RequestStatus::RequestedRangeNotSatisfiable)
+            return Socket::Status::Error;
+        if(!parse_content_range(response.header("content-range"), first, total) || (first != 0 && first != total))
+            return Socket::Status::ParseError;
+        if(::ftruncate(fd, (off_t)total) != 0)
+            return Socket::Status::Error;
+        if(written >= total)
+            return Socket::Status::Success;
+
+        //If the object changes between requests, then the server should send all of the new one
+        //instead of the range, which the segments treat as an error.
+        HttpRequest segment_request = request;
+        if(response.header_exists("etag") && response.header("etag").compare(0, 2, "W/") != 0) //Weak ETags aren't allowed
+            segment_request.header("if-range") = response.header("etag");
+        else if(response.header_exists("last-modified"))
+            segment_request.header("if-range") = response.header("last-modified");
+
+        //Split up what's left, and download each piece in parallel
+        uint64_t remaining = total - written;
+        size_t count = std::max<size_t>(std::min<uint64_t>(segment_count, remaining / MIN_SEGMENT_SIZE), 1);
+        std::atomic<bool> failed(false);
+        Socket::Status failure = Socket::Status::Success;
+        auto run_segment = [&](size_t index) {
+            uint64_t begin = written + remaining * index / count;
+            uint64_t end = written + remaining * (index + 1) / count;
+            auto segment_status = download_segment(url, fd, segment_request, begin, end, total, failed);
+
+            //Only the first failure is reported, as the others are likely to have been caused by it
+            bool expected = false;
+            if(segment_status != Socket::Status::Success && failed.compare_exchange_strong(expected, true))
+                failure = segment_status;
+        };
+
+        std::vector<std::thread> threads;
+        for(size_t a = 1; a < count; ++a)
+            threads.emplace_back(run_segment, a);
+        run_segment(0);
+        for(auto &thread : threads)
+            thread.join();
+        return failure;
+#else
+        return Socket::Status::Error;
+#endif
+    }
+
+    Socket::Status RangeDownloader::download_segment(const URL &url, int32_t fd, const HttpRequest &request, uint64_t begin,
+                                                     uint64_t end, uint64_t total, const std::atomic<bool> &failed)
+    {
+#ifndef _WIN32
+        auto status = Socket::Status::Error;
+        for(size_t attempt = 0; attempt < max_attempts && begin < end && !failed; ++attempt)
+        {
+            //Only ask for what hasn't been received yet
+            HttpRequest segment = request;
+            segment.header("range") = "bytes=" + std::to_string(begin) + "-" + std::to_string(end - 1);
+
+            HttpResponse response;
+            bool checked = false, rejected = false;
+            response.set_body_sink([&](const char *data, size_t size) {
+                //Make sure that the server's sending the range that was asked for, before writing any of it
+                if(!checked)
+                {
+                    uint64_t range_first = 0, range_total = 0;
+                    rejected = response.get_status() != Http::RequestStatus::PartialContent
+                            || !parse_content_range(response.header("content-range"), range_first, range_total)
+                            || range_first != begin || range_total != total;
+                    checked = true;
+                }
+                if(rejected || failed || size > end - begin || !write_at(fd, data, size, begin))
+                    return false;
+                begin += size;
+                return true;
+            });
+
+            status = client.request(url, segment, response);
+            if(rejected)
+                return Socket::Status::Error;
+            if(status == Socket::Status::Success && begin < end)
+                status = Socket::Status::Disconnected;
+        }
+        return begin < end ? status : Socket::Status::Success;
+#else
+        return Socket::Status::Error;
+#endif
+    }
+
+    bool RangeDownloader::parse_content_range(const std::string &value, uint64_t &first, uint64_t &total)
+    {
+        if(value.compare(0, 6, "bytes ") != 0)
+            return false;
+
+        const char *pos = value.c_str() + 6;
+        char *end = nullptr;
+        bool satisfied = *pos != '*';
+        uint64_t last = 0;
+        if(satisfied)
+        {
+            first = std::strtoull(pos, &end, 10);
+            if(end == pos || *end != '-')
+                return false;
+            pos = end + 1;
+            last = std::strtoull(pos, &end, 10);
+            if(end == pos || last < first)
+                return false;
+        }
+        else
+        {
+            end = const_cast<char*>(pos + 1);
+        }
+
+        if(*end != '/')
+            return false;
+        pos = end + 1;
+        total = std::strtoull(pos, &end, 10);
+        if(end == pos || *end != '\0')
+            return false;
+        if(!satisfied)
+            first = total;
+        return !satisfied || last < total;
+    }
+
+    void RangeDownloader::set_segment_count(size_t count)
+    {
+        if(count == 0)
+            throw std::logic_error("RangeDownloader needs at least one segment");
+        segment_count = count;
+    }
+
+    void RangeDownloader::set_max_attempts(size_t attempts)
+    {
+        if(attempts == 0)
+            throw std::logic_error("RangeDownloader needs to try each segment at least once");
+        max_attempts = attempts;
+    }
+}
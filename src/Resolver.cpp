@@ -0,0 +1,574 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <algorithm>
+#include "frnetlib/Resolver.h"
+
+#define DNS_PORT 53
+#define DNS_ATTEMPTS 2 //How many times each nameserver is tried
+#define DNS_HEADER_SIZE 12
+#define DNS_MAX_MESSAGE_SIZE 512 //The most that can be sent over UDP without EDNS
+#define DNS_TYPE_A 1
+#define DNS_TYPE_AAAA 28
+#define DNS_CLASS_IN 1
+#define DNS_RCODE_NOERROR 0
+#define DNS_RCODE_NXDOMAIN 3
+#define DNS_FLAG_TC 0x02 //Set in the third byte of a response which was truncated to fit
+#define DEFAULT_NDOTS 1 //Names with fewer dots than this have the search domains tried first
+#define MAX_NDOTS 15
+#define DEFAULT_DNS_TIMEOUT 2000 //Milliseconds
+#define DEFAULT_RESOLVER_CACHE_SIZE 512
+#define SYSTEM_LOOKUP_TTL 60 //Seconds to cache getaddrinfo() results for, as it doesn't give TTLs
+
+namespace fr
+{
+    namespace
+    {
+        struct Query
+        {
+            uint16_t id;
+            uint16_t type;
+            std::string message;
+            bool answered;
+        };
+
+        inline uint16_t read_uint16(const uint8_t *data)
+        {
+            return (uint16_t)((data[0] << 8) | data[1]);
+        }
+
+        inline uint32_t read_uint32(const uint8_t *data)
+        {
+            return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+        }
+
+        //Encodes a host name as a sequence of length prefixed labels. Returns false if it's not a valid name.
+        bool encode_name(const std::string &host, std::string &out)
+        {
+            size_t begin = 0;
+            while(begin < host.size())
+            {
+                size_t end = std::min(host.find('.', begin), host.size());
+                if(end == begin || end - begin > 63)
+                    return false;
+                out += (char)(end - begin);
+                out.append(host, begin, end - begin);
+                begin = end + 1;
+            }
+            out += '\0';
+            return out.size() > 1 && out.size() <= 255;
+        }
+
+        //Builds a query for one type of record
+        Query build_query(const std::string &encoded_name, uint16_t type, uint16_t id)
+        {
+            Query query = {id, type, std::string(DNS_HEADER_SIZE, '\0'), false};
+            query.message[0] = (char)(id >> 8);
+            query.message[1] = (char)id;
+            query.message[2] = 0x01; //Recursion desired
+            query.message[5] = 1; //One question
+            query.message += encoded_name;
+            query.message += (char)(type >> 8);
+            query.message += (char)type;
+            query.message += '\0';
+            query.message += (char)DNS_CLASS_IN;
+            return query;
+        }
+
+        //Moves past a (possibly compressed) name. Returns false if it runs off the end of the message.
+        bool skip_name(const uint8_t *data, size_t size, size_t &pos)
+        {
+            while(pos < size)
+            {
+                uint8_t length = data[pos];
+                if((length & 0xC0) == 0xC0)
+                {
+                    pos += 2;
+                    return pos <= size;
+                }
+                pos += 1 + length;
+                if(length == 0)
+                    return pos <= size;
+            }
+            return false;
+        }
+
+        //Parses a response to a query, adding its addresses. Returns false if it isn't a valid response to the query.
+        bool parse_response(const uint8_t *data, size_t size, const Query &query, std::vector<Address> &addresses, uint32_t &ttl, uint8_t &rcode, bool &truncated)
+        {
+            //The header and question should match the query, apart from the flags and counts
+            size_t question_size = query.message.size() - DNS_HEADER_SIZE;
+            if(size < query.message.size() || read_uint16(data) != query.id || !(data[2] & 0x80) || read_uint16(data + 4) != 1)
+                return false;
+            if(!std::equal(query.message.begin() + DNS_HEADER_SIZE, query.message.end(), data + DNS_HEADER_SIZE, [](char a, uint8_t b) {
+                return ::tolower((uint8_t)a) == ::tolower(b);
+            }))
+            {
+                return false;
+            }
+
+            rcode = data[3] & 0x0F;
+            truncated = (data[2] & DNS_FLAG_TC) != 0;
+            if(truncated)
+                return true;
+            size_t answers = read_uint16(data + 6);
+            size_t pos = DNS_HEADER_SIZE + question_size;
+            for(size_t a = 0; a < answers; ++a)
+            {
+                if(!skip_name(data, size, pos) || size - pos < 10)
+                    return false;
+                uint16_t type = read_uint16(data + pos);
+                uint16_t record_class = read_uint16(data + pos + 2);
+                uint32_t record_ttl = read_uint32(data + pos + 4);
+                uint16_t length = read_uint16(data + pos + 8);
+                pos += 10;
+                if(size - pos < length)
+                    return false;
+
+                //Any CNAMEs which led to the addresses are in here too, and their TTLs count as well
+                if(record_class == DNS_CLASS_IN)
+                {
+                    ttl = std::min(ttl, record_ttl);
+                    if(type == DNS_TYPE_A && query.type == DNS_TYPE_A && length == sizeof(in_addr))
+                    {
+                        sockaddr_in address = {};
+                        address.sin_family = AF_INET;
+                        memcpy(&address.sin_addr, data + pos, sizeof(in_addr));
+                        addresses.emplace_back((sockaddr*)&address, sizeof(address));
+                    }
+                    else if(type == DNS_TYPE_AAAA && query.type == DNS_TYPE_AAAA && length == sizeof(in6_addr))
+                    {
+                        sockaddr_in6 address = {};
+                        address.sin6_family = AF_INET6;
+                        memcpy(&address.sin6_addr, data + pos, sizeof(in6_addr));
+                        addresses.emplace_back((sockaddr*)&address, sizeof(address));
+                    }
+                }
+                pos += length;
+            }
+            return true;
+        }
+
+        std::string to_lower(std::string str)
+        {
+            std::transform(str.begin(), str.end(), str.begin(), ::tolower);
+            return str;
+        }
+    }
+
+    Resolver::Resolver(size_t threads)
+    : ndots(DEFAULT_NDOTS),
+      timeout(DEFAULT_DNS_TIMEOUT),
+      max_cache_size(DEFAULT_RESOLVER_CACHE_SIZE),
+      thread_count(threads),
+      stopping(false)
+    {
+        if(thread_count == 0)
+            throw std::logic_error("Resolver needs at least one thread");
+        load_system_config();
+    }
+
+    Resolver::~Resolver()
+    {
+        //Finish off any lookups which are still queued
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            stopping = true;
+        }
+        job_ready.notify_all();
+        for(auto &worker : workers)
+            worker.join();
+    }
+
+    Socket::Status Resolver::resolve(const std::string &host_, std::vector<Address> &addresses, int family)
+    {
+        addresses.clear();
+
+        //Numeric addresses don't need looking up
+        Address numeric;
+        if(Address::parse(host_, numeric))
+        {
+            if(family != AF_UNSPEC && numeric.get_family() != family)
+                return Socket::Status::AddressLookupFailure;
+            addresses.emplace_back(numeric);
+            return Socket::Status::Success;
+        }
+
+        //Names are case insensitive, and a trailing dot means that the name is absolute, so no search domains are tried
+        std::string host = to_lower(host_);
+        bool absolute = !host.empty() && host.back() == '.';
+        if(absolute)
+            host.pop_back();
+        std::string key = std::to_string(family) + ":" + host;
+
+        std::unique_lock<std::mutex> guard(mutex);
+        auto hosts_iter = hosts.find(host);
+        if(hosts_iter != hosts.end())
+        {
+            for(auto &address : hosts_iter->second)
+            {
+                if(family == AF_UNSPEC || address.get_family() == family)
+                    addresses.emplace_back(address);
+            }
+            if(!addresses.empty())
+                return Socket::Status::Success;
+        }
+
+        auto cache_iter = cache_index.find(key);
+        if(cache_iter != cache_index.end())
+        {
+            if(std::chrono::steady_clock::now() < cache_iter->second->expiry)
+            {
+                cache.splice(cache.begin(), cache, cache_iter->second);
+                addresses = cache.front().addresses;
+                return Socket::Status::Success;
+            }
+            cache.erase(cache_iter->second);
+            cache_index.erase(cache_iter);
+        }
+
+        //Relative names are tried with each search domain appended, before the name itself if it has fewer than
+        //'ndots' dots, or after it otherwise, like the system's resolver does
+        std::vector<std::string> names;
+        if(!absolute)
+        {
+            for(auto &domain : search_domains)
+                names.emplace_back(host + "." + domain);
+        }
+        if((size_t)std::count(host.begin(), host.end(), '.') >= ndots)
+            names.insert(names.begin(), host);
+        else
+            names.emplace_back(host);
+
+        //Look it up without holding up other threads
+        auto servers = nameservers;
+        auto query_timeout = timeout;
+        guard.unlock();
+
+        //If every name times out then so does the lookup, otherwise it failed
+        uint32_t ttl = SYSTEM_LOOKUP_TTL;
+        auto status = Socket::Status::Timeout;
+        bool timed_out = true;
+        for(auto &name : names)
+        {
+            ttl = SYSTEM_LOOKUP_TTL;
+            status = servers.empty() ? query_system(name, family, addresses) : query(name, family, servers, query_timeout, addresses, ttl);
+            if(status == Socket::Status::Success)
+                break;
+            timed_out &= status == Socket::Status::Timeout;
+        }
+        if(status != Socket::Status::Success && !timed_out)
+            status = Socket::Status::AddressLookupFailure;
+        if(status == Socket::Status::Success)
+            cache_insert(key, addresses, ttl);
+        return status;
+    }
+
+    void Resolver::resolve_async(const std::string &host, Callback callback, int family)
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        if(workers.empty())
+        {
+            for(size_t a = 0; a < thread_count; ++a)
+                workers.emplace_back(&Resolver::run_worker, this);
+        }
+
+        jobs.emplace_back([this, host, family, callback]() {
+            std::vector<Address> addresses;
+            auto status = resolve(host, addresses, family);
+            callback(status, addresses);
+        });
+        job_ready.notify_one();
+    }
+
+    void Resolver::run_worker()
+    {
+        std::unique_lock<std::mutex> guard(mutex);
+        while(true)
+        {
+            job_ready.wait(guard, [this]() {
+                return stopping || !jobs.empty();
+            });
+            if(jobs.empty())
+                return;
+
+            auto job = std::move(jobs.front());
+            jobs.pop_front();
+            guard.unlock();
+            job();
+            guard.lock();
+        }
+    }
+
+    Socket::Status Resolver::query(const std::string &host, int family, const std::vector<Address> &servers,
+                                   std::chrono::milliseconds query_timeout, std::vector<Address> &addresses, uint32_t &ttl)
+    {
+        std::string encoded_name;
+        if(!encode_name(host, encoded_name))
+            return Socket::Status::AddressLookupFailure;
+
+        //Ask for both types of address at once, if both are wanted
+        static thread_local std::mt19937 random_engine(std::random_device{}());
+        std::vector<Query> queries;
+        if(family != AF_INET)
+            queries.emplace_back(build_query(encoded_name, DNS_TYPE_AAAA, (uint16_t)random_engine()));
+        if(family != AF_INET6)
+            queries.emplace_back(build_query(encoded_name, DNS_TYPE_A, (uint16_t)random_engine()));
+
+        std::vector<Address> found[2];
+        ttl = UINT32_MAX;
+        size_t answered = 0;
+        bool any_answered = false;
+        for(size_t attempt = 0; attempt < DNS_ATTEMPTS && answered < queries.size(); ++attempt)
+        {
+            for(const auto &server : servers)
+            {
+                //Connecting the socket means that only the nameserver's responses are received
+                Address server_address = server;
+                if(server_address.get_port() == 0)
+                    server_address.set_port(DNS_PORT);
+                auto descriptor = ::socket(server_address.get_family(), SOCK_DGRAM, 0);
+                if(descriptor < 0)
+                    continue;
+                if(::connect(descriptor, server_address.get(), server_address.get_length()) != 0)
+                {
+                    ::closesocket(descriptor);
+                    continue;
+                }
+                for(auto &query : queries)
+                {
+                    if(!query.answered)
+                        ::send(descriptor, query.message.data(), query.message.size(), 0);
+                }
+
+                //Wait for the answers, until the timeout
+                bool server_failed = false;
+                auto deadline = std::chrono::steady_clock::now() + query_timeout;
+                while(answered < queries.size())
+                {
+                    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+                    if(remaining.count() <= 0)
+                        break;
+                    pollfd poll_descriptor = {descriptor, POLLIN, 0};
+                    int ret = poll_sockets(&poll_descriptor, 1, (int)remaining.count());
+                    if(ret < 0 && errno == EINTR)
+                        continue;
+                    if(ret <= 0)
+                        break;
+
+                    uint8_t response[DNS_MAX_MESSAGE_SIZE];
+                    auto received = ::recv(descriptor, (char*)response, sizeof(response), 0);
+                    if(received < 0 && errno == EINTR)
+                        continue;
+                    if(received < 0)
+                        break;
+
+                    for(size_t a = 0; a < queries.size(); ++a)
+                    {
+                        uint8_t rcode = 0;
+                        bool truncated = false;
+                        std::vector<Address> records;
+                        uint32_t record_ttl = ttl;
+                        if(queries[a].answered || !parse_response(response, (size_t)received, queries[a], records, record_ttl, rcode, truncated))
+                            continue;
+                        any_answered = true;
+
+                        //Answers which don't fit in a UDP response need TCP, so leave those to the system's resolver
+                        if(truncated)
+                        {
+                            ::closesocket(descriptor);
+                            addresses.clear();
+                            ttl = SYSTEM_LOOKUP_TTL;
+                            return query_system(host, family, addresses);
+                        }
+
+                        //Only a definite answer ends the query. Anything else, such as SERVFAIL or REFUSED, means
+                        //that this server can't help, so the next one's tried.
+                        if(rcode != DNS_RCODE_NOERROR && rcode != DNS_RCODE_NXDOMAIN)
+                        {
+                            server_failed = true;
+                            break;
+                        }
+
+                        //A name which doesn't exist won't have the other type of address either
+                        queries[a].answered = true;
+                        ++answered;
+                        if(rcode == DNS_RCODE_NXDOMAIN)
+                            answered = queries.size();
+                        else
+                        {
+                            found[a] = std::move(records);
+                            ttl = record_ttl;
+                        }
+                        break;
+                    }
+                    if(server_failed)
+                        break;
+                }
+                ::closesocket(descriptor);
+                if(answered >= queries.size())
+                    break;
+            }
+        }
+
+        for(auto &list : found)
+            addresses.insert(addresses.end(), list.begin(), list.end());
+        if(!addresses.empty())
+            return Socket::Status::Success;
+        return any_answered ? Socket::Status::AddressLookupFailure : Socket::Status::Timeout;
+    }
+
+    Socket::Status Resolver::query_system(const std::string &host, int family, std::vector<Address> &addresses)
+    {
+        addrinfo hints = {};
+        hints.ai_family = family;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo *info = nullptr;
+        int ret = getaddrinfo(host.c_str(), nullptr, &hints, &info);
+        if(ret != 0)
+        {
+            errno = ret;
+            return Socket::Status::AddressLookupFailure;
+        }
+
+        for(addrinfo *c = info; c != nullptr; c = c->ai_next)
+        {
+            if(c->ai_family != AF_INET && c->ai_family != AF_INET6)
+                continue;
+            Address address(c->ai_addr, (socklen_t)c->ai_addrlen);
+            if(std::find(addresses.begin(), addresses.end(), address) == addresses.end())
+                addresses.emplace_back(address);
+        }
+        freeaddrinfo(info);
+        return addresses.empty() ? Socket::Status::AddressLookupFailure : Socket::Status::Success;
+    }
+
+    void Resolver::load_system_config()
+    {
+        std::string line;
+        std::ifstream resolv_conf("/etc/resolv.conf");
+        while(std::getline(resolv_conf, line))
+        {
+            std::istringstream words(line);
+            std::string keyword, value;
+            Address address;
+            if(!(words >> keyword))
+                continue;
+            if(keyword == "nameserver" && words >> value && Address::parse(value, address))
+            {
+                nameservers.emplace_back(address);
+            }
+            else if(keyword == "search" || keyword == "domain")
+            {
+                //Whichever of these comes last is used
+                search_domains.clear();
+                while(words >> value)
+                {
+                    value = to_lower(value);
+                    if(!value.empty() && value.back() == '.')
+                        value.pop_back();
+                    if(!value.empty())
+                        search_domains.emplace_back(value);
+                }
+            }
+            else if(keyword == "options")
+            {
+                while(words >> value)
+                {
+                    if(value.compare(0, 6, "ndots:") == 0)
+                        ndots = std::min<size_t>(strtoul(value.c_str() + 6, nullptr, 10), MAX_NDOTS);
+                }
+            }
+        }
+
+        //Each line is an address followed by its names, with comments starting at a '#'
+        std::ifstream hosts_file("/etc/hosts");
+        while(std::getline(hosts_file, line))
+        {
+            std::istringstream words(line.substr(0, line.find('#')));
+            std::string value, name;
+            Address address;
+            if(!(words >> value) || !Address::parse(value, address))
+                continue;
+            while(words >> name)
+            {
+                auto &addresses = hosts[to_lower(name)];
+                if(std::find(addresses.begin(), addresses.end(), address) == addresses.end())
+                    addresses.emplace_back(address);
+            }
+        }
+    }
+
+    void Resolver::cache_insert(const std::string &key, const std::vector<Address> &addresses, uint32_t ttl)
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        if(ttl == 0 || max_cache_size == 0)
+            return;
+
+        //Another thread might have looked it up at the same time
+        auto iter = cache_index.find(key);
+        if(iter != cache_index.end())
+        {
+            cache.erase(iter->second);
+            cache_index.erase(iter);
+        }
+        while(cache.size() >= max_cache_size)
+        {
+            cache_index.erase(cache.back().key);
+            cache.pop_back();
+        }
+
+        cache.push_front({key, addresses, std::chrono::steady_clock::now() + std::chrono::seconds(ttl)});
+        cache_index.emplace(key, cache.begin());
+    }
+
+    void Resolver::set_nameservers(std::vector<Address> nameservers_)
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        nameservers = std::move(nameservers_);
+    }
+
+    void Resolver::set_search_domains(std::vector<std::string> domains, size_t ndots_)
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        search_domains.clear();
+        for(auto &domain : domains)
+        {
+            domain = to_lower(domain);
+            if(!domain.empty() && domain.back() == '.')
+                domain.pop_back();
+            if(!domain.empty())
+                search_domains.emplace_back(std::move(domain));
+        }
+        ndots = std::min<size_t>(ndots_, MAX_NDOTS);
+    }
+
+    void Resolver::set_timeout(std::chrono::milliseconds timeout_)
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        timeout = timeout_;
+    }
+
+    void Resolver::set_cache_size(size_t entries)
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        max_cache_size = entries;
+        while(cache.size() > max_cache_size)
+        {
+            cache_index.erase(cache.back().key);
+            cache.pop_back();
+        }
+    }
+
+    void Resolver::clear_cache()
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        cache.clear();
+        cache_index.clear();
+    }
+}
@@ -147,6 +147,26 @@ namespace fr
         return Socket::Status::Success;
     }
 
+    void SSLListener::set_alpn_protocols(std::vector<std::string> protocols)
+    {
+        //mbedtls wants a null terminated list, which must stay valid for as long as the config
+        alpn_protocols = std::move(protocols);
+        alpn_list.clear();
+        for(auto &protocol : alpn_protocols)
+            alpn_list.emplace_back(protocol.c_str());
+        alpn_list.emplace_back(nullptr);
+        if(alpn_protocols.empty())
+            return;
+
+#ifdef MBEDTLS_SSL_ALPN
+        int error = mbedtls_ssl_conf_alpn_protocols(&conf, alpn_list.data());
+        if(error != 0)
+        {
+            throw std::runtime_error("mbedtls_ssl_conf_alpn_protocols() returned: " + std::to_string(error));
+        }
+#endif
+    }
+
     void SSLListener::shutdown()
     {
         ::shutdown(listen_fd.fd, 0);
@@ -158,6 +158,20 @@ namespace fr
     }
 
     Socket::Status SSLSocket::connect(const std::string &address, const std::string &port, std::chrono::seconds timeout)
+    {
+        return connect_with(address, [&](TcpSocket &socket) {
+            return socket.connect(address, port, timeout);
+        });
+    }
+
+    Socket::Status SSLSocket::connect(const std::string &host, const std::vector<Address> &addresses, const std::string &port, std::chrono::seconds timeout)
+    {
+        return connect_with(host, [&](TcpSocket &socket) {
+            return socket.connect(host, addresses, port, timeout);
+        });
+    }
+
+    Socket::Status SSLSocket::connect_with(const std::string &address, const std::function<Socket::Status(TcpSocket&)> &open)
     {
         //Initialise mbedtls stuff
         ssl.reset(ssl_create());
@@ -167,7 +181,7 @@ namespace fr
         //Open the descriptor, and then steal it. This is a hack.
         {
             fr::TcpSocket socket;
-            auto ret = socket.connect(address, port, timeout);
+            auto ret = open(socket);
             if(ret != fr::Socket::Status::Success)
                 return ret;
             ssl_socket_descriptor->fd = socket.get_socket_descriptor();
@@ -186,6 +200,13 @@ namespace fr
         mbedtls_ssl_conf_authmode(&conf, should_verify ? MBEDTLS_SSL_VERIFY_REQUIRED : MBEDTLS_SSL_VERIFY_NONE);
         mbedtls_ssl_conf_ca_chain(&conf, &ssl_context->cacert, nullptr);
         mbedtls_ssl_conf_rng(&conf, mbedtls_ctr_drbg_random, &ssl_context->ctr_drbg);
+#ifdef MBEDTLS_SSL_ALPN
+        if(!alpn_list.empty() && (error = mbedtls_ssl_conf_alpn_protocols(&conf, alpn_list.data())) != 0)
+        {
+            errno = error;
+            return Socket::Status::SSLError;
+        }
+#endif
 
         if((error = mbedtls_ssl_setup(ssl.get(), &conf)) != 0)
         {
@@ -243,6 +264,30 @@ namespace fr
         should_verify = should_verify_;
     }
 
+    void SSLSocket::set_alpn_protocols(std::vector<std::string> protocols)
+    {
+        //mbedtls wants a null terminated list, which must stay valid for as long as the config
+        alpn_protocols = std::move(protocols);
+        alpn_list.clear();
+        for(auto &protocol : alpn_protocols)
+            alpn_list.emplace_back(protocol.c_str());
+        if(!alpn_list.empty())
+            alpn_list.emplace_back(nullptr);
+    }
+
+    std::string SSLSocket::get_alpn_protocol() const
+    {
+#ifdef MBEDTLS_SSL_ALPN
+        if(ssl)
+        {
+            const char *protocol = mbedtls_ssl_get_alpn_protocol(ssl.get());
+            if(protocol)
+                return protocol;
+        }
+#endif
+        return "";
+    }
+
     fr::Socket::Status SSLSocket::set_blocking(bool should_block)
     {
         int ret = mbedtls_net_set_block(ssl_socket_descriptor.get());
@@ -19,10 +19,17 @@
 --------------------------------------------------------------------
 */
 
+#include <cstring>
+#include <algorithm>
 #include "frnetlib/Sha1.h"
-#include <sstream>
-#include <iomanip>
-#include <fstream>
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define FRNETLIB_SHA_NI
+#include <cpuid.h>
+#include <immintrin.h>
+#elif defined(__aarch64__) && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_SHA2))
+#define FRNETLIB_ARM_SHA1
+#include <arm_neon.h>
+#endif
 
 
 namespace fr
@@ -31,21 +38,6 @@ namespace fr
     static const size_t BLOCK_BYTES = BLOCK_INTS * 4;
 
 
-    static void reset(uint32_t digest[], std::string &buffer, uint64_t &transforms)
-    {
-        /* Sha1 initialization constants */
-        digest[0] = 0x67452301;
-        digest[1] = 0xefcdab89;
-        digest[2] = 0x98badcfe;
-        digest[3] = 0x10325476;
-        digest[4] = 0xc3d2e1f0;
-
-        /* Reset counters */
-        buffer = "";
-        transforms = 0;
-    }
-
-
     static uint32_t rol(const uint32_t value, const size_t bits)
     {
         return (value << bits) | (value >> (32 - bits));
@@ -115,7 +107,7 @@ namespace fr
  * Hash a single 512-bit block. This is the core of the algorithm.
  */
 
-    static void transform(uint32_t digest[], uint32_t block[BLOCK_INTS], uint64_t &transforms)
+    static void transform(uint32_t digest[], uint32_t block[BLOCK_INTS])
     {
         /* Copy digest[] to working vars */
         uint32_t a = digest[0];
@@ -212,15 +204,14 @@ namespace fr
         digest[2] += c;
         digest[3] += d;
         digest[4] += e;
-
-        /* Count the number of transformations */
-        transforms++;
     }
 
 
-    static void buffer_to_block(const std::string &buffer, uint32_t block[BLOCK_INTS])
+
+
+    static void buffer_to_block(const char *buffer, uint32_t block[BLOCK_INTS])
     {
-        /* Convert the std::string (byte buffer) to a uint32_t array (MSB) */
+        /* Convert the byte buffer to a uint32_t array (MSB) */
         for(size_t i = 0; i < BLOCK_INTS; i++)
         {
             block[i] = (buffer[4 * i + 3] & 0xff)
@@ -231,35 +222,179 @@ namespace fr
     }
 
 
+    static void transform_blocks(uint32_t digest[], const char *data, size_t blocks)
+    {
+        for(size_t a = 0; a < blocks; ++a)
+        {
+            uint32_t block[BLOCK_INTS];
+            buffer_to_block(data + a * BLOCK_BYTES, block);
+            transform(digest, block);
+        }
+    }
+
+
+#ifdef FRNETLIB_SHA_NI
+/*
+ * Hash blocks with the SHA-NI instructions. Each group of 4 rounds takes the next 4 words of the
+ * message schedule, the first 16 of which are the block itself, and the rest derived from those before.
+ */
+
+#define SHA_NI_ROUNDS(k, function)                                                                  \
+    if(k >= 4)                                                                                      \
+        msg[k % 4] = _mm_sha1msg2_epu32(_mm_xor_si128(_mm_sha1msg1_epu32(msg[k % 4], msg[(k + 1) % 4]), msg[(k + 2) % 4]), msg[(k + 3) % 4]); \
+    e1 = _mm_sha1nexte_epu32(e0, msg[k % 4]);                                                       \
+    e0 = abcd;                                                                                      \
+    abcd = _mm_sha1rnds4_epu32(abcd, e1, function);
+
+    __attribute__((target("sha,sse4.1")))
+    static void transform_blocks_sha_ni(uint32_t digest[], const char *data, size_t blocks)
+    {
+        const __m128i byte_swap = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+        __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(digest)), 0x1B);
+        __m128i e = _mm_set_epi32(digest[4], 0, 0, 0);
+
+        for(size_t a = 0; a < blocks; ++a, data += BLOCK_BYTES)
+        {
+            __m128i abcd_save = abcd;
+            __m128i e_save = e;
+            __m128i msg[4];
+            for(size_t b = 0; b < 4; ++b)
+                msg[b] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + b * 16)), byte_swap);
+
+            //The first group adds E directly, and the rest work it out from the group before
+            __m128i e0 = abcd;
+            __m128i e1 = _mm_add_epi32(e, msg[0]);
+            abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+            SHA_NI_ROUNDS(1, 0) SHA_NI_ROUNDS(2, 0) SHA_NI_ROUNDS(3, 0) SHA_NI_ROUNDS(4, 0)
+            SHA_NI_ROUNDS(5, 1) SHA_NI_ROUNDS(6, 1) SHA_NI_ROUNDS(7, 1) SHA_NI_ROUNDS(8, 1) SHA_NI_ROUNDS(9, 1)
+            SHA_NI_ROUNDS(10, 2) SHA_NI_ROUNDS(11, 2) SHA_NI_ROUNDS(12, 2) SHA_NI_ROUNDS(13, 2) SHA_NI_ROUNDS(14, 2)
+            SHA_NI_ROUNDS(15, 3) SHA_NI_ROUNDS(16, 3) SHA_NI_ROUNDS(17, 3) SHA_NI_ROUNDS(18, 3) SHA_NI_ROUNDS(19, 3)
+
+            e = _mm_sha1nexte_epu32(e0, e_save);
+            abcd = _mm_add_epi32(abcd, abcd_save);
+        }
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(digest), _mm_shuffle_epi32(abcd, 0x1B));
+        digest[4] = static_cast<uint32_t>(_mm_extract_epi32(e, 3));
+    }
+
+    static bool has_sha_ni()
+    {
+        unsigned int eax, ebx, ecx, edx;
+        if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_SSE4_1))
+            return false;
+        return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & (1u << 29)); //The SHA extensions bit
+    }
+#endif
+
+
+#ifdef FRNETLIB_ARM_SHA1
+/*
+ * Hash blocks with the ARMv8 crypto extension's SHA1 instructions, which are laid out
+ * much like SHA-NI's. Each round function has its own instruction.
+ */
+
+#define ARM_SHA1_ROUNDS(k, instruction, constant)                                                   \
+    if(k >= 4)                                                                                      \
+        msg[k % 4] = vsha1su1q_u32(vsha1su0q_u32(msg[k % 4], msg[(k + 1) % 4], msg[(k + 2) % 4]), msg[(k + 3) % 4]); \
+    e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));                                                       \
+    abcd = instruction(abcd, e0, vaddq_u32(msg[k % 4], vdupq_n_u32(constant)));                      \
+    e0 = e1;
+
+    static void transform_blocks_arm(uint32_t digest[], const char *data, size_t blocks)
+    {
+        uint32x4_t abcd = vld1q_u32(digest);
+        uint32_t e = digest[4];
+
+        for(size_t a = 0; a < blocks; ++a, data += BLOCK_BYTES)
+        {
+            uint32x4_t abcd_save = abcd;
+            uint32x4_t msg[4];
+            for(size_t b = 0; b < 4; ++b)
+                msg[b] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(data + b * 16))));
+
+            uint32_t e0 = e, e1;
+            ARM_SHA1_ROUNDS(0, vsha1cq_u32, 0x5a827999) ARM_SHA1_ROUNDS(1, vsha1cq_u32, 0x5a827999)
+            ARM_SHA1_ROUNDS(2, vsha1cq_u32, 0x5a827999) ARM_SHA1_ROUNDS(3, vsha1cq_u32, 0x5a827999)
+            ARM_SHA1_ROUNDS(4, vsha1cq_u32, 0x5a827999) ARM_SHA1_ROUNDS(5, vsha1pq_u32, 0x6ed9eba1)
+            ARM_SHA1_ROUNDS(6, vsha1pq_u32, 0x6ed9eba1) ARM_SHA1_ROUNDS(7, vsha1pq_u32, 0x6ed9eba1)
+            ARM_SHA1_ROUNDS(8, vsha1pq_u32, 0x6ed9eba1) ARM_SHA1_ROUNDS(9, vsha1pq_u32, 0x6ed9eba1)
+            ARM_SHA1_ROUNDS(10, vsha1mq_u32, 0x8f1bbcdc) ARM_SHA1_ROUNDS(11, vsha1mq_u32, 0x8f1bbcdc)
+            ARM_SHA1_ROUNDS(12, vsha1mq_u32, 0x8f1bbcdc) ARM_SHA1_ROUNDS(13, vsha1mq_u32, 0x8f1bbcdc)
+            ARM_SHA1_ROUNDS(14, vsha1mq_u32, 0x8f1bbcdc) ARM_SHA1_ROUNDS(15, vsha1pq_u32, 0xca62c1d6)
+            ARM_SHA1_ROUNDS(16, vsha1pq_u32, 0xca62c1d6) ARM_SHA1_ROUNDS(17, vsha1pq_u32, 0xca62c1d6)
+            ARM_SHA1_ROUNDS(18, vsha1pq_u32, 0xca62c1d6) ARM_SHA1_ROUNDS(19, vsha1pq_u32, 0xca62c1d6)
+
+            e += e0;
+            abcd = vaddq_u32(abcd, abcd_save);
+        }
+
+        vst1q_u32(digest, abcd);
+        digest[4] = e;
+    }
+#endif
+
+
+/*
+ * Hash whole blocks, with whichever implementation the CPU supports
+ */
+
+    static void process_blocks(uint32_t digest[], const char *data, size_t blocks)
+    {
+#if defined(FRNETLIB_SHA_NI)
+        static const bool sha_ni = has_sha_ni();
+        if(sha_ni)
+            return transform_blocks_sha_ni(digest, data, blocks);
+#elif defined(FRNETLIB_ARM_SHA1)
+        return transform_blocks_arm(digest, data, blocks);
+#endif
+        transform_blocks(digest, data, blocks);
+    }
+
+
     Sha1::Sha1()
     {
-        reset(digest, buffer, transforms);
+        reset();
     }
 
 
-    void Sha1::update(const std::string &s)
+    void Sha1::reset()
     {
-        std::istringstream is(s);
-        update(is);
+        /* Sha1 initialization constants */
+        digest[0] = 0x67452301;
+        digest[1] = 0xefcdab89;
+        digest[2] = 0x98badcfe;
+        digest[3] = 0x10325476;
+        digest[4] = 0xc3d2e1f0;
+
+        /* Reset counters */
+        buffer_size = 0;
+        total_size = 0;
     }
 
 
-    void Sha1::update(std::istream &is)
+    void Sha1::update(const char *data, size_t size)
     {
-        while(true)
+        total_size += size;
+
+        /* Top up a partial block first, then hash as many whole blocks as possible straight from the input */
+        if(buffer_size > 0)
         {
-            char sbuf[BLOCK_BYTES];
-            is.read(sbuf, BLOCK_BYTES - buffer.size());
-            buffer.append(sbuf, is.gcount());
-            if(buffer.size() != BLOCK_BYTES)
-            {
+            size_t piece = std::min(size, BLOCK_BYTES - buffer_size);
+            memcpy(buffer + buffer_size, data, piece);
+            buffer_size += piece;
+            data += piece;
+            size -= piece;
+            if(buffer_size < BLOCK_BYTES)
                 return;
-            }
-            uint32_t block[BLOCK_INTS];
-            buffer_to_block(buffer, block);
-            transform(digest, block, transforms);
-            buffer.clear();
+            process_blocks(digest, buffer, 1);
+            buffer_size = 0;
         }
+
+        size_t blocks = size / BLOCK_BYTES;
+        process_blocks(digest, data, blocks);
+        buffer_size = size - blocks * BLOCK_BYTES;
+        memcpy(buffer, data + blocks * BLOCK_BYTES, buffer_size);
     }
 
 
@@ -267,34 +402,46 @@ namespace fr
  * Add padding and finish up
  */
 
-    void Sha1::final()
+    void Sha1::final(char *out)
     {
         /* Total number of hashed bits */
-        uint64_t total_bits = (transforms * BLOCK_BYTES + buffer.size()) * 8;
-
-        /* Padding */
-        buffer += static_cast<char>(0x80);
-        size_t orig_size = buffer.size();
-        while(buffer.size() < BLOCK_BYTES)
+        uint64_t total_bits = total_size * 8;
+
+        /* Padding, with the length in the last 8 bytes of the last block, which may need to be an extra one */
+        char padding[BLOCK_BYTES * 2] = {};
+        memcpy(padding, buffer, buffer_size);
+        padding[buffer_size] = static_cast<char>(0x80);
+        size_t padded_size = buffer_size + 1 + 8 > BLOCK_BYTES ? BLOCK_BYTES * 2 : BLOCK_BYTES;
+        for(size_t i = 0; i < 8; i++)
         {
-            buffer += static_cast<char>(0x00);
+            padding[padded_size - 1 - i] = static_cast<char>(total_bits >> (i * 8));
         }
+        process_blocks(digest, padding, padded_size / BLOCK_BYTES);
 
-        uint32_t block[BLOCK_INTS];
-        buffer_to_block(buffer, block);
-
-        if(orig_size > BLOCK_BYTES - 8)
+        /* Output the digest in network byte order */
+        for(size_t i = 0; i < 5; i++)
         {
-            transform(digest, block, transforms);
-            for(size_t i = 0; i < BLOCK_INTS - 2; i++)
-            {
-                block[i] = 0;
-            }
+            out[4 * i + 0] = static_cast<char>(digest[i] >> 24);
+            out[4 * i + 1] = static_cast<char>(digest[i] >> 16);
+            out[4 * i + 2] = static_cast<char>(digest[i] >> 8);
+            out[4 * i + 3] = static_cast<char>(digest[i]);
         }
+        reset();
+    }
 
-        /* Append total_bits, split this uint64_t into two uint32_t */
-        block[BLOCK_INTS - 1] = total_bits;
-        block[BLOCK_INTS - 2] = (total_bits >> 32);
-        transform(digest, block, transforms);
+
+    void Sha1::sha1_digest(const char *data, size_t size, char *out)
+    {
+        Sha1 ctx;
+        ctx.update(data, size);
+        ctx.final(out);
+    }
+
+
+    std::string Sha1::sha1_digest(const std::string &input)
+    {
+        char out[DIGEST_SIZE];
+        sha1_digest(input.data(), input.size(), out);
+        return std::string(out, sizeof(out));
     }
-}
\ No newline at end of file
+}
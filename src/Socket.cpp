@@ -6,6 +6,7 @@
 #include <csignal>
 #include <iostream>
 #include <vector>
+#include <algorithm>
 #ifdef USE_SSL
 #include <mbedtls/error.h>
 #endif
@@ -13,6 +14,8 @@
 #include "frnetlib/Socket.h"
 #include "frnetlib/Sendable.h"
 
+#define SEND_FILE_CHUNK_SIZE 16384 //How much of a file to read at once, when it can't be sent directly
+
 namespace fr
 {
     Socket::Socket()
@@ -58,6 +61,52 @@ namespace fr
         return Socket::Status::Success;
     }
 
+    Socket::Status Socket::send_file(int32_t fd, uint64_t offset, size_t count, size_t &sent)
+    {
+#ifndef _WIN32
+        char buffer[SEND_FILE_CHUNK_SIZE];
+        while(sent < count)
+        {
+            ssize_t read = ::pread(fd, buffer, std::min(sizeof(buffer), count - sent), (off_t)(offset + sent));
+            if(read < 0 && errno == EINTR)
+                continue;
+            if(read <= 0)
+                return Socket::Status::Error;
+
+            size_t chunk_sent = 0;
+            Status status = send_raw(buffer, (size_t)read, chunk_sent);
+            sent += chunk_sent;
+            if(status != Socket::Status::Success)
+                return status;
+        }
+        return Socket::Status::Success;
+#else
+        return Socket::Status::Error;
+#endif
+    }
+
+    Socket::Status Socket::send_gather(const Buffer *buffers, size_t count, size_t &sent)
+    {
+        //Skip past what's already been sent, then send the rest a buffer at a time
+        size_t skip = sent;
+        for(size_t a = 0; a < count; ++a)
+        {
+            if(skip >= buffers[a].size)
+            {
+                skip -= buffers[a].size;
+                continue;
+            }
+
+            size_t buffer_sent = skip;
+            Status status = send_raw(buffers[a].data, buffers[a].size, buffer_sent);
+            sent += buffer_sent - skip;
+            skip = 0;
+            if(status != Socket::Status::Success)
+                return status;
+        }
+        return Socket::Status::Success;
+    }
+
     void Socket::shutdown()
     {
         ::shutdown(get_socket_descriptor(), SHUT_RDWR);
@@ -155,6 +204,10 @@ namespace fr
                 return "No Route To Host";
             case Socket::Status::Timeout:
                 return "Timeout";
+            case Socket::Status::Connecting:
+                return "Connecting";
+            case Socket::Status::InvalidPayload:
+                return "Invalid Payload";
             default:
                 return "Unknown";
         }
@@ -27,7 +27,7 @@ namespace fr
         close(epoll_fd);
     }
 
-    void SocketSelector::add(const std::shared_ptr<fr::SocketDescriptor> &socket, void *opaque)
+    void SocketSelector::add(const std::shared_ptr<fr::SocketDescriptor> &socket, void *opaque, bool want_write)
     {
         int32_t descriptor = socket->get_socket_descriptor();
         if(!socket->connected())
@@ -42,7 +42,7 @@ namespace fr
         }
 
         epoll_event event = {0};
-        event.events = EPOLLIN | EPOLLHUP | EPOLLERR | EPOLLRDHUP;
+        event.events = EPOLLIN | EPOLLHUP | EPOLLERR | EPOLLRDHUP | (want_write ? EPOLLOUT : 0);
         event.data.ptr = &added_iter.first->second;
 
         if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, descriptor, &event) < 0)
@@ -52,6 +52,33 @@ namespace fr
         }
     }
 
+    void SocketSelector::set_write_interest(const std::shared_ptr<fr::SocketDescriptor> &socket, bool want_write)
+    {
+        auto iter = added_sockets.find((uintptr_t)socket.get());
+        if(iter == added_sockets.end())
+        {
+            throw std::logic_error("Can't change a socket which hasn't been added");
+        }
+
+        epoll_event event = {0};
+        event.events = EPOLLIN | EPOLLHUP | EPOLLERR | EPOLLRDHUP | (want_write ? EPOLLOUT : 0);
+        event.data.ptr = &iter->second;
+
+        //If the socket's descriptor was replaced, then closing the old one will have removed it from EPOLL already.
+        //The new one might have been given the same number, so it can't be told apart from the old one except by EPOLL.
+        int32_t descriptor = socket->get_socket_descriptor();
+        int ret = -1;
+        if(descriptor == iter->second.descriptor)
+            ret = epoll_ctl(epoll_fd, EPOLL_CTL_MOD, descriptor, &event);
+        if(ret < 0 && (descriptor != iter->second.descriptor || errno == ENOENT))
+            ret = epoll_ctl(epoll_fd, EPOLL_CTL_ADD, descriptor, &event);
+        if(ret < 0)
+        {
+            throw std::runtime_error("Failed to change socket: " + std::to_string(descriptor) + ". Errno: " + std::to_string(errno));
+        }
+        iter->second.descriptor = descriptor;
+    }
+
     std::vector<std::pair<std::shared_ptr<fr::SocketDescriptor>, void *>>
     SocketSelector::wait(std::chrono::milliseconds timeout)
     {
@@ -83,7 +110,8 @@ namespace fr
             return nullptr;
         }
 
-        if(epoll_ctl(epoll_fd, EPOLL_CTL_DEL, iter->second.descriptor, nullptr) < 0)
+        //A descriptor which has since been closed was removed from EPOLL when it closed, and its number might now belong to another socket
+        if(socket->get_socket_descriptor() == iter->second.descriptor && epoll_ctl(epoll_fd, EPOLL_CTL_DEL, iter->second.descriptor, nullptr) < 0 && errno != ENOENT)
         {
             throw std::runtime_error("Failed to remove socket: " + std::to_string(iter->second.descriptor) + ". Errno: " + std::to_string(errno));
         }
@@ -0,0 +1,323 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <ctime>
+#include <cinttypes>
+#include "frnetlib/StaticFileHandler.h"
+
+namespace fr
+{
+    namespace
+    {
+        //Closes a file descriptor when it goes out of scope
+        struct FileGuard
+        {
+            explicit FileGuard(int32_t fd_)
+            : fd(fd_)
+            {}
+            ~FileGuard()
+            {
+                if(fd > -1)
+                    ::close(fd);
+            }
+
+            int32_t fd;
+        };
+
+        bool parse_range_value(const std::string &str, size_t begin, size_t end, uint64_t &out)
+        {
+            if(begin >= end)
+                return false;
+            out = 0;
+            for(size_t a = begin; a < end; ++a)
+            {
+                if(str[a] < '0' || str[a] > '9')
+                    return false;
+                uint64_t next = out * 10 + (str[a] - '0');
+                if(next < out)
+                    return false;
+                out = next;
+            }
+            return true;
+        }
+    }
+
+    StaticFileHandler::MappedFile::~MappedFile()
+    {
+        munmap(data, size);
+    }
+
+    StaticFileHandler::StaticFileHandler(std::string root_, std::string index_file_)
+    : root(std::move(root_)),
+      index_file(std::move(index_file_)),
+      max_cached_file_size(0),
+      max_cache_size(0),
+      cache_size(0)
+    {
+        while(!root.empty() && root.back() == '/')
+            root.pop_back();
+    }
+
+    StaticFileHandler::~StaticFileHandler()
+    {
+
+    }
+
+    void StaticFileHandler::set_cache_limits(size_t max_file_size, size_t max_cache_size_)
+    {
+        std::lock_guard<std::mutex> guard(cache_lock);
+        max_cached_file_size = max_file_size;
+        max_cache_size = max_cache_size_;
+        if(max_cached_file_size == 0)
+        {
+            cache.clear();
+            cache_lru.clear();
+            cache_size = 0;
+        }
+    }
+
+    Socket::Status StaticFileHandler::serve(Socket &socket, const HttpRequest &request)
+    {
+        return serve(socket, request, request.get_uri());
+    }
+
+    Socket::Status StaticFileHandler::serve(Socket &socket, const HttpRequest &request, const std::string &path)
+    {
+        if(request.get_type() != Http::RequestType::Get)
+            return send_status(socket, Http::RequestStatus::MethodNotAllowed);
+
+        //Build the file path, refusing to escape the root directory. '+' is literal in paths, so only percent decode.
+        std::string filepath = root;
+        std::string decoded = path;
+        if(!Http::url_decode_in_place(decoded, false))
+            return send_status(socket, Http::RequestStatus::BadRequest);
+        size_t segment_begin = 0;
+        while(segment_begin < decoded.size())
+        {
+            size_t segment_end = decoded.find('/', segment_begin);
+            if(segment_end == std::string::npos)
+                segment_end = decoded.size();
+            size_t segment_len = segment_end - segment_begin;
+            if(decoded.compare(segment_begin, segment_len, "..") == 0 || decoded.find('\0', segment_begin) < segment_end)
+                return send_status(socket, Http::RequestStatus::NotFound);
+            if(segment_len > 0 && decoded.compare(segment_begin, segment_len, ".") != 0)
+                filepath.append("/").append(decoded, segment_begin, segment_len);
+            segment_begin = segment_end + 1;
+        }
+
+        //Open it, serving the index file for directories
+        FileGuard file(::open(filepath.c_str(), O_RDONLY | O_CLOEXEC));
+        struct stat info = {};
+        if(file.fd < 0 || fstat(file.fd, &info) != 0)
+            return send_status(socket, Http::RequestStatus::NotFound);
+        if(S_ISDIR(info.st_mode))
+        {
+            if(index_file.empty())
+                return send_status(socket, Http::RequestStatus::NotFound);
+            filepath.append("/").append(index_file);
+            ::close(file.fd);
+            file.fd = ::open(filepath.c_str(), O_RDONLY | O_CLOEXEC);
+            if(file.fd < 0 || fstat(file.fd, &info) != 0)
+                return send_status(socket, Http::RequestStatus::NotFound);
+        }
+        if(!S_ISREG(info.st_mode))
+            return send_status(socket, Http::RequestStatus::NotFound);
+
+        //Work out the validators
+        auto file_size = static_cast<uint64_t>(info.st_size);
+        char etag_buffer[64];
+        snprintf(etag_buffer, sizeof(etag_buffer), "\"%" PRIx64 "-%" PRIx64 "\"", (uint64_t)info.st_mtime, file_size);
+        std::string etag = etag_buffer;
+        std::string last_modified = format_http_date(info.st_mtime);
+
+        HttpResponse response;
+        response.header("etag") = etag;
+        response.header("last-modified") = last_modified;
+        response.header("accept-ranges") = "bytes";
+
+        //Check if the client's copy is still valid
+        bool not_modified = false;
+        if(request.header_exists("if-none-match"))
+        {
+            not_modified = etag_matches(request.header("if-none-match"), etag);
+        }
+        else if(request.header_exists("if-modified-since"))
+        {
+            time_t since = parse_http_date(request.header("if-modified-since"));
+            not_modified = since != -1 && info.st_mtime <= since;
+        }
+        if(not_modified)
+        {
+            response.set_status(Http::RequestStatus::NotModified);
+            return socket.send(response);
+        }
+
+        //Check if a single byte range has been requested. Multiple ranges aren't supported, so those get the whole file.
+        uint64_t range_begin = 0;
+        uint64_t range_length = file_size;
+        if(request.header_exists("range"))
+        {
+            //If-Range needs a strong comparison, so weak tags never match
+            const std::string &range = request.header("range");
+            bool if_range_valid = true;
+            if(request.header_exists("if-range"))
+            {
+                const std::string &if_range = request.header("if-range");
+                if_range_valid = (if_range.compare(0, 2, "W/") != 0 && if_range == etag) || if_range == last_modified;
+            }
+            if(if_range_valid && range.compare(0, 6, "bytes=") == 0 && range.find(',') == std::string::npos)
+            {
+                auto dash_pos = range.find('-', 6);
+                if(dash_pos != std::string::npos)
+                {
+                    uint64_t first = 0, last = 0;
+                    bool has_first = parse_range_value(range, 6, dash_pos, first);
+                    bool has_last = parse_range_value(range, dash_pos + 1, range.size(), last);
+                    bool satisfiable = true;
+                    if(has_first && (has_last || dash_pos + 1 == range.size()) && (!has_last || last >= first)) //bytes=first-[last]
+                    {
+                        satisfiable = first < file_size;
+                        range_begin = first;
+                        range_length = satisfiable ? (has_last ? std::min(last, file_size - 1) : file_size - 1) - first + 1 : 0;
+                    }
+                    else if(dash_pos == 6 && has_last) //bytes=-suffix_length
+                    {
+                        satisfiable = last > 0 && file_size > 0;
+                        range_length = std::min(last, file_size);
+                        range_begin = file_size - range_length;
+                    }
+
+                    if(!satisfiable)
+                    {
+                        response.set_status(Http::RequestStatus::RequestedRangeNotSatisfiable);
+                        response.header("content-range") = "bytes */" + std::to_string(file_size);
+                        response.set_body("416");
+                        return socket.send(response);
+                    }
+                    if(range_length != file_size)
+                    {
+                        response.set_status(Http::RequestStatus::PartialContent);
+                        response.header("content-range") = "bytes " + std::to_string(range_begin) + "-" + std::to_string(range_begin + range_length - 1) + "/" + std::to_string(file_size);
+                    }
+                }
+            }
+        }
+
+        //Send the header, and then the body straight from the file
+        response.header("content-type") = Http::get_mimetype(filepath);
+        response.header("content-length") = std::to_string(range_length);
+        Socket::Status status = socket.send(response);
+        if(status != Socket::Status::Success || range_length == 0)
+            return status;
+
+        size_t sent = 0;
+        auto mapped = get_mapped_file(filepath, file.fd, file_size, info.st_mtime, info.st_ino);
+        do
+        {
+            if(mapped)
+                status = socket.send_raw(static_cast<const char*>(mapped->data) + range_begin, range_length, sent);
+            else
+                status = socket.send_file(file.fd, range_begin, range_length, sent);
+        } while(status == Socket::Status::WouldBlock);
+        return status;
+    }
+
+    std::shared_ptr<StaticFileHandler::MappedFile> StaticFileHandler::get_mapped_file(const std::string &path, int32_t fd, size_t size, time_t modified, uint64_t inode)
+    {
+        std::lock_guard<std::mutex> guard(cache_lock);
+        if(size > max_cached_file_size || size == 0)
+            return nullptr;
+
+        //Use the cached copy if it's still up to date
+        auto iter = cache.find(path);
+        if(iter != cache.end())
+        {
+            auto &cached = iter->second;
+            if(cached->size == size && cached->modified == modified && cached->inode == inode)
+            {
+                cache_lru.splice(cache_lru.begin(), cache_lru, cached->lru_position);
+                return cached;
+            }
+
+            cache_size -= cached->size;
+            cache_lru.erase(cached->lru_position);
+            cache.erase(iter);
+        }
+
+        //Else map it, and make room for it
+        void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(data == MAP_FAILED)
+            return nullptr;
+        auto mapped = std::make_shared<MappedFile>(data, size, modified, inode);
+
+        while(!cache_lru.empty() && cache_size + size > max_cache_size)
+        {
+            auto evict = cache.find(cache_lru.back());
+            cache_size -= evict->second->size;
+            cache.erase(evict);
+            cache_lru.pop_back();
+        }
+
+        if(size <= max_cache_size)
+        {
+            cache_lru.emplace_front(path);
+            mapped->lru_position = cache_lru.begin();
+            cache.emplace(path, mapped);
+            cache_size += size;
+        }
+        return mapped;
+    }
+
+    Socket::Status StaticFileHandler::send_status(Socket &socket, Http::RequestStatus status)
+    {
+        HttpResponse response;
+        response.set_status(status);
+        response.set_body(std::to_string((uint32_t)status));
+        if(status == Http::RequestStatus::MethodNotAllowed)
+            response.header("allow") = "GET";
+        return socket.send(response);
+    }
+
+    bool StaticFileHandler::etag_matches(const std::string &header, const std::string &etag)
+    {
+        size_t pos = 0;
+        while(pos < header.size())
+        {
+            pos = header.find_first_not_of(" \t,", pos);
+            if(pos == std::string::npos)
+                break;
+            size_t end = header.find(',', pos);
+            if(end == std::string::npos)
+                end = header.size();
+            size_t value_end = header.find_last_not_of(" \t", end - 1) + 1;
+
+            //Weak comparison, so ignore any W/ prefix
+            size_t value_begin = header.compare(pos, 2, "W/") == 0 ? pos + 2 : pos;
+            if(header.compare(value_begin, value_end - value_begin, "*") == 0 || header.compare(value_begin, value_end - value_begin, etag) == 0)
+                return true;
+            pos = end + 1;
+        }
+        return false;
+    }
+
+    std::string StaticFileHandler::format_http_date(time_t time)
+    {
+        struct tm tm = {};
+        gmtime_r(&time, &tm);
+        char buffer[64];
+        size_t len = strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+        return std::string(buffer, len);
+    }
+
+    time_t StaticFileHandler::parse_http_date(const std::string &date)
+    {
+        struct tm tm = {};
+        const char *end = strptime(date.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+        if(!end)
+            return -1;
+        return timegm(&tm);
+    }
+}
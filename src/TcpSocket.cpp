@@ -3,16 +3,26 @@
 //
 
 #include <iostream>
+#include <algorithm>
 #include <frnetlib/SocketSelector.h>
 #include <frnetlib/TcpSocket.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
 #define DEFAULT_SOCKET_TIMEOUT 20
+#define GATHER_MAX_BUFFERS 16 //The most buffers to pass to each sendmsg() call
+#define CONNECTION_ATTEMPT_DELAY 250 //Milliseconds to wait for a connection attempt, before racing it against the next address
 
 namespace fr
 {
 
     TcpSocket::TcpSocket() noexcept
     : socket_descriptor(-1),
-      is_blocking(true)
+      is_blocking(true),
+      is_connecting(false)
     {
 
     }
@@ -51,6 +61,103 @@ namespace fr
         return Socket::Status::Success;
     }
 
+    Socket::Status TcpSocket::send_file(int32_t fd, uint64_t offset, size_t count, size_t &sent)
+    {
+#ifdef __linux__
+        while(sent < count)
+        {
+            off_t file_offset = (off_t)(offset + sent);
+            ssize_t status = ::sendfile(socket_descriptor, fd, &file_offset, count - sent);
+            if(status > 0)
+            {
+                sent += status;
+                continue;
+            }
+
+            if(status == 0) //The file is shorter than expected
+                return Socket::Status::Error;
+            if(errno == EWOULDBLOCK)
+            {
+                if(is_blocking)
+                {
+                    return Socket::Status::Timeout;
+                }
+                return Socket::Status::WouldBlock;
+            }
+            else if(errno == EINTR)
+            {
+                continue;
+            }
+            else if(errno == EINVAL || errno == ENOSYS) //The file doesn't support sendfile, so fall back to copying it
+            {
+                return Socket::send_file(fd, offset, count, sent);
+            }
+
+            return Socket::Status::SendError;
+        }
+        return Socket::Status::Success;
+#else
+        return Socket::send_file(fd, offset, count, sent);
+#endif
+    }
+
+    Socket::Status TcpSocket::send_gather(const Buffer *buffers, size_t count, size_t &sent)
+    {
+#ifndef _WIN32
+        size_t total = 0;
+        for(size_t a = 0; a < count; ++a)
+            total += buffers[a].size;
+
+        while(sent < total)
+        {
+            //Describe what's left to send, starting part way through a buffer if need be
+            iovec vectors[GATHER_MAX_BUFFERS];
+            size_t vector_count = 0;
+            size_t skip = sent;
+            for(size_t a = 0; a < count && vector_count < GATHER_MAX_BUFFERS; ++a)
+            {
+                if(skip >= buffers[a].size)
+                {
+                    skip -= buffers[a].size;
+                    continue;
+                }
+                vectors[vector_count].iov_base = const_cast<char*>(buffers[a].data + skip);
+                vectors[vector_count].iov_len = buffers[a].size - skip;
+                ++vector_count;
+                skip = 0;
+            }
+
+            msghdr message = {};
+            message.msg_iov = vectors;
+            message.msg_iovlen = vector_count;
+            ssize_t status = ::sendmsg(socket_descriptor, &message, 0);
+            if(status >= 0)
+            {
+                sent += status;
+                continue;
+            }
+
+            if(errno == EWOULDBLOCK)
+            {
+                if(is_blocking)
+                {
+                    return Socket::Status::Timeout;
+                }
+                return Socket::Status::WouldBlock;
+            }
+            else if(errno == EINTR)
+            {
+                continue;
+            }
+
+            return Socket::Status::SendError;
+        }
+        return Socket::Status::Success;
+#else
+        return Socket::send_gather(buffers, count, sent);
+#endif
+    }
+
     void TcpSocket::close_socket()
     {
         if(socket_descriptor > -1)
@@ -58,6 +165,8 @@ namespace fr
             ::closesocket(socket_descriptor);
             socket_descriptor = -1;
         }
+        is_connecting = false;
+        connect_queue.clear();
     }
 
     Socket::Status TcpSocket::receive_raw(void *data, size_t buffer_size, size_t &received)
@@ -110,6 +219,122 @@ namespace fr
     }
 
     Socket::Status TcpSocket::connect(const std::string &address, const std::string &port, std::chrono::seconds timeout)
+    {
+        std::vector<Address> addresses;
+        auto status = lookup(address, port, addresses);
+        if(status != Socket::Status::Success)
+            return status;
+        return connect_addresses(address, addresses, port, timeout);
+    }
+
+    Socket::Status TcpSocket::connect(const std::string &host, const std::vector<Address> &addresses, const std::string &port, std::chrono::seconds timeout)
+    {
+        std::vector<Address> targets;
+        auto status = set_ports(addresses, port, targets);
+        if(status != Socket::Status::Success)
+            return status;
+        return connect_addresses(host, targets, port, timeout);
+    }
+
+    Socket::Status TcpSocket::connect_async(const std::string &address, const std::string &port)
+    {
+        close_socket();
+        std::vector<Address> addresses;
+        auto status = lookup(address, port, addresses);
+        if(status != Socket::Status::Success)
+            return status;
+
+        connect_queue.assign(addresses.begin(), addresses.end());
+        connect_remote = address + ":" + port;
+        return start_connect();
+    }
+
+    Socket::Status TcpSocket::connect_async(const std::string &host, const std::vector<Address> &addresses, const std::string &port)
+    {
+        close_socket();
+        std::vector<Address> targets;
+        auto status = set_ports(addresses, port, targets);
+        if(status != Socket::Status::Success)
+            return status;
+
+        connect_queue.assign(targets.begin(), targets.end());
+        connect_remote = host + ":" + port;
+        return start_connect();
+    }
+
+    Socket::Status TcpSocket::finish_connect()
+    {
+        if(!is_connecting)
+            return connected() ? Socket::Status::Success : Socket::Status::Disconnected;
+
+        //A failed attempt moves on to the next address
+        int error = 0;
+        socklen_t len = sizeof(error);
+        if(getsockopt(socket_descriptor, SOL_SOCKET, SO_ERROR, (char*)&error, &len) == -1 || error != 0)
+            return start_connect();
+
+        //No error might just mean that it's not finished yet
+        sockaddr_storage peer = {};
+        len = sizeof(peer);
+        if(getpeername(socket_descriptor, (sockaddr*)&peer, &len) != 0)
+            return Socket::Status::Connecting;
+
+        is_connecting = false;
+        connect_queue.clear();
+        return on_connected(connect_remote);
+    }
+
+    Socket::Status TcpSocket::start_connect()
+    {
+        while(!connect_queue.empty())
+        {
+            Address address = connect_queue.front();
+            connect_queue.pop_front();
+            if(socket_descriptor > -1)
+                ::closesocket(socket_descriptor);
+
+            socket_descriptor = ::socket(address.get_family(), SOCK_STREAM, IPPROTO_TCP);
+            if(socket_descriptor < 0 || !set_unix_socket_blocking(socket_descriptor, true, false))
+                continue;
+
+            int ret = ::connect(socket_descriptor, address.get(), address.get_length());
+            if(ret == 0)
+            {
+                is_connecting = false;
+                connect_queue.clear();
+                return on_connected(connect_remote);
+            }
+#ifdef _WIN32
+            if(WSAGetLastError() == WSAEWOULDBLOCK)
+#else
+            if(errno == EINPROGRESS)
+#endif
+            {
+                is_connecting = true;
+                return Socket::Status::Connecting;
+            }
+        }
+
+        close_socket();
+        return Socket::Status::NoRouteToHost;
+    }
+
+    Socket::Status TcpSocket::on_connected(const std::string &remote_address)
+    {
+        //Connects are made in non-blocking mode, so go back to blocking if that's what's wanted
+        if(is_blocking && !set_unix_socket_blocking(socket_descriptor, false, true))
+        {
+            close_socket();
+            return Socket::Status::Error;
+        }
+
+        //Update state now we've got a valid socket descriptor
+        set_remote_address(remote_address);
+        reconfigure_socket();
+        return Socket::Status::Success;
+    }
+
+    Socket::Status TcpSocket::lookup(const std::string &address, const std::string &port, std::vector<Address> &addresses) const
     {
         //Setup required structures
         int ret = 0;
@@ -130,70 +355,147 @@ namespace fr
             return Socket::Status::AddressLookupFailure;
         }
 
-        //Try to connect to results returned by getaddrinfo until we succeed/run out of things
-        addrinfo *c;
-        for(c = info; c != nullptr; c = c->ai_next)
+        for(addrinfo *c = info; c != nullptr; c = c->ai_next)
         {
-            //Get the socket for this entry
-            socket_descriptor = ::socket(c->ai_family, c->ai_socktype, c->ai_protocol);
-            if(socket_descriptor == INVALID_SOCKET)
-                continue;
+            if(c->ai_family == AF_INET || c->ai_family == AF_INET6)
+                addresses.emplace_back(c->ai_addr, (socklen_t)c->ai_addrlen);
+        }
+
+        //We're done with this now, cleanup
+        freeaddrinfo(info);
+        return Socket::Status::Success;
+    }
 
+    Socket::Status TcpSocket::set_ports(const std::vector<Address> &addresses, const std::string &port, std::vector<Address> &targets) const
+    {
+        char *port_end = nullptr;
+        unsigned long port_number = strtoul(port.c_str(), &port_end, 10);
+        if(port.empty() || *port_end != '\0' || port_number > UINT16_MAX)
+            return Socket::Status::AddressLookupFailure;
 
-            //Put it into non-blocking mode, to allow for a custom connect timeout
-            if(!set_unix_socket_blocking(socket_descriptor, true, false))
+        for(const auto &address : addresses)
+        {
+            if(ai_family != AF_UNSPEC && address.get_family() != ai_family)
                 continue;
+            targets.emplace_back(address);
+            targets.back().set_port((uint16_t)port_number);
+        }
+        return Socket::Status::Success;
+    }
+
+    Socket::Status TcpSocket::connect_addresses(const std::string &host, const std::vector<Address> &addresses, const std::string &port, std::chrono::seconds timeout)
+    {
+        close_socket();
 
-            //Try and connect
-            ret = ::connect(socket_descriptor, c->ai_addr, c->ai_addrlen);
+        //Alternate between address families, starting with the preferred one, so that a broken family costs at most one attempt delay
+        std::vector<Address> ordered;
+        std::vector<Address> others;
+        for(const auto &address : addresses)
+        {
+            if(address.get_family() == addresses.front().get_family())
+                ordered.emplace_back(address);
+            else
+                others.emplace_back(address);
+        }
+        for(size_t a = 0; a < others.size(); ++a)
+            ordered.insert(ordered.begin() + std::min(a * 2 + 1, ordered.size()), others[a]);
+
+        //Race connection attempts, starting a new one whenever the last fails, or hasn't connected after CONNECTION_ATTEMPT_DELAY
+        struct Attempt
+        {
+            int32_t descriptor;
+            std::chrono::steady_clock::time_point expiry;
+        };
+        auto attempt_timeout = std::chrono::seconds(timeout.count() == 0 ? DEFAULT_SOCKET_TIMEOUT : timeout.count());
+        std::vector<Attempt> attempts;
+        auto next = ordered.begin();
+        auto next_start = std::chrono::steady_clock::now();
+        while(socket_descriptor < 0 && (next != ordered.end() || !attempts.empty()))
+        {
+            auto now = std::chrono::steady_clock::now();
+            while(next != ordered.end() && (now >= next_start || attempts.empty()))
+            {
+                int32_t descriptor = ::socket(next->get_family(), SOCK_STREAM, IPPROTO_TCP);
+                const Address &address = *next++;
+                if(descriptor < 0)
+                    continue;
+
+                //Put it into non-blocking mode, to allow for a custom connect timeout
+                if(!set_unix_socket_blocking(descriptor, true, false))
+                {
+                    ::closesocket(descriptor);
+                    continue;
+                }
+
+                int ret = ::connect(descriptor, address.get(), address.get_length());
 #ifdef _WIN32
-            if(ret < 0 && WSAGetLastError() != WSAEWOULDBLOCK)
+                if(ret < 0 && WSAGetLastError() != WSAEWOULDBLOCK)
 #else
-            if(ret < 0 && errno != EINPROGRESS)
+                if(ret < 0 && errno != EINPROGRESS)
 #endif
-            {
-                continue;
+                {
+                    ::closesocket(descriptor);
+                    continue;
+                }
+
+                attempts.push_back({descriptor, now + attempt_timeout});
+                next_start = now + std::chrono::milliseconds(CONNECTION_ATTEMPT_DELAY);
+                if(ret == 0) //It connected immediately
+                    break;
             }
-            else if(ret == 0) //If it connected immediately then break out of the connect loop
+
+            //Wait for an attempt to finish, or for it to be time to start another
+            if(attempts.empty())
+                continue;
+            auto wake = next != ordered.end() ? next_start : now + attempt_timeout;
+            std::vector<pollfd> poll_descriptors;
+            poll_descriptors.reserve(attempts.size());
+            for(auto &attempt : attempts)
             {
-                break;
+                wake = std::min(wake, attempt.expiry);
+                poll_descriptors.push_back({attempt.descriptor, POLLOUT, 0});
             }
 
-            //Wait for the socket to do something/expire
-            timeval tv = {};
-            tv.tv_sec = timeout.count() == 0 ? DEFAULT_SOCKET_TIMEOUT : timeout.count();
-            tv.tv_usec = 0;
-            fd_set set = {};
-            FD_ZERO(&set);
-            FD_SET(socket_descriptor, &set);
-            ret = select(socket_descriptor + 1, nullptr, &set, nullptr, &tv);
-            if(ret <= 0)
-                continue;
+            //Round the wait up, so that it doesn't wake just before it's due and spin
+            auto wait = std::chrono::duration_cast<std::chrono::microseconds>(std::max(wake - now, std::chrono::steady_clock::duration::zero()));
+            if(poll_sockets(poll_descriptors.data(), poll_descriptors.size(), (int)((wait.count() + 999) / 1000)) < 0 && errno != EINTR)
+                break;
 
-            //Verify that we're connected
-            socklen_t len = sizeof(ret);
-            if(getsockopt(socket_descriptor, SOL_SOCKET, SO_ERROR, (char*)&ret, &len) == -1)
-                continue;
-            if(ret != 0)
-                continue;
+            //Keep the first to connect, and drop any which have failed or expired. A failed connect is writable too.
+            now = std::chrono::steady_clock::now();
+            size_t index = 0;
+            for(auto attempt = attempts.begin(); attempt != attempts.end(); ++index)
+            {
+                if(poll_descriptors[index].revents != 0)
+                {
+                    int error = 0;
+                    socklen_t len = sizeof(error);
+                    if(socket_descriptor < 0 && getsockopt(attempt->descriptor, SOL_SOCKET, SO_ERROR, (char*)&error, &len) == 0 && error == 0)
+                    {
+                        socket_descriptor = attempt->descriptor;
+                        attempt = attempts.erase(attempt);
+                        continue;
+                    }
+                }
+                else if(now < attempt->expiry)
+                {
+                    ++attempt;
+                    continue;
+                }
 
-            break;
+                ::closesocket(attempt->descriptor);
+                attempt = attempts.erase(attempt);
+                next_start = now; //Don't wait to try the next address
+            }
         }
 
-        //We're done with this now, cleanup
-        freeaddrinfo(info);
-        if(c == nullptr)
-            return Socket::Status::NoRouteToHost;
-
-        //Turn back to blocking mode
-        if(!set_unix_socket_blocking(socket_descriptor, false, true))
-            return Socket::Status::Error;
+        //Cancel the attempts which lost
+        for(auto &attempt : attempts)
+            ::closesocket(attempt.descriptor);
 
-        //Update state now we've got a valid socket descriptor
-        set_remote_address(address + ":" + port);
-        reconfigure_socket();
-
-        return Socket::Status::Success;
+        if(socket_descriptor < 0)
+            return Socket::Status::NoRouteToHost;
+        return on_connected(host + ":" + port);
     }
 
     Socket::Status TcpSocket::set_blocking(bool should_block)
@@ -10,16 +10,6 @@
 namespace fr
 {
 
-    std::unordered_map<std::string, URL::Scheme> URL::scheme_string_map = {
-            {"http",    URL::HTTP},
-            {"https",   URL::HTTPS},
-            {"sftp",    URL::FTP},
-            {"mailto",  URL::MAILTO},
-            {"irc",     URL::IRC},
-            {"sftp",    URL::SFTP},
-            {"unknown", URL::Unknown}
-    };
-
     URL::URL(const std::string &url)
     {
         parse(url);
@@ -36,8 +26,7 @@ namespace fr
         pos = url.find("://");
         if(pos != std::string::npos)
         {
-            auto scheme_pos = scheme_string_map.find(to_lower(url.substr(0, pos)));
-            scheme = (scheme_pos == scheme_string_map.end()) ? URL::Unknown : scheme_pos->second;
+            scheme = string_to_scheme(url.c_str(), pos);
             parse_offset = pos + 3; // skip the ://
         }
 
@@ -84,7 +73,7 @@ namespace fr
                     port = "21";
                     break;
                 case URL::SFTP:
-                    port = "25";
+                    port = "22";
                     break;
                 default:
                     break;
@@ -130,21 +119,51 @@ namespace fr
 
     URL::Scheme URL::string_to_scheme(const std::string &scheme)
     {
-        auto iter = scheme_string_map.find(to_lower(scheme));
-        if(iter == scheme_string_map.end())
-            return URL::Unknown;
-        return iter->second;
+        return string_to_scheme(scheme.c_str(), scheme.size());
     }
 
-    const std::string &URL::scheme_to_string(URL::Scheme scheme)
+    URL::Scheme URL::string_to_scheme(const char *scheme, size_t length)
     {
-        auto iter = std::find_if(scheme_string_map.begin(), scheme_string_map.end(), [&](const auto &i)
+        auto equals = [&](const char *lowercase) {
+            return std::equal(scheme, scheme + length, lowercase, [](char a, char b) {
+                return ::tolower(a) == b;
+            });
+        };
+
+        //Only schemes of the right length need comparing
+        switch(length)
         {
-            return i.second == scheme;
-        });
+            case 3:
+                if(equals("ftp"))
+                    return URL::FTP;
+                if(equals("irc"))
+                    return URL::IRC;
+                break;
+            case 4:
+                if(equals("http"))
+                    return URL::HTTP;
+                if(equals("sftp"))
+                    return URL::SFTP;
+                break;
+            case 5:
+                if(equals("https"))
+                    return URL::HTTPS;
+                break;
+            case 6:
+                if(equals("mailto"))
+                    return URL::MAILTO;
+                break;
+            default:
+                break;
+        }
+        return URL::Unknown;
+    }
 
-        if(iter == scheme_string_map.end())
+    const std::string &URL::scheme_to_string(URL::Scheme scheme)
+    {
+        static const std::string scheme_strings[URL::Unknown + 1] = {"http", "https", "ftp", "mailto", "irc", "sftp", "unknown"};
+        if(scheme < URL::HTTP || scheme > URL::Unknown)
             throw std::logic_error("Unknown URL::Scheme value " + std::to_string(scheme));
-        return iter->first;
+        return scheme_strings[scheme];
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,151 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#include <cstring>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+#include "frnetlib/Utf8Validator.h"
+
+#define ASCII_WORD_MASK 0x8080808080808080ULL //The top bit of each byte in a word, which is only set outside of ASCII
+
+namespace fr
+{
+    namespace
+    {
+        //Gets where the run of ASCII starting at 'offset' ends
+        size_t skip_ascii(const char *data, size_t offset, size_t size)
+        {
+#if defined(__SSE2__) || defined(_M_X64)
+            for(; offset + 16 <= size; offset += 16)
+            {
+                //Each bit of the mask is the top bit of a byte, so the first one set is where the run ends
+                __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset));
+                int mask = _mm_movemask_epi8(block);
+                if(mask != 0)
+                {
+                    for(; (mask & 1) == 0; mask >>= 1)
+                        ++offset;
+                    return offset;
+                }
+            }
+#endif
+            for(; offset + sizeof(uint64_t) <= size; offset += sizeof(uint64_t))
+            {
+                uint64_t word;
+                memcpy(&word, data + offset, sizeof(word));
+                if(word & ASCII_WORD_MASK)
+                    break;
+            }
+            while(offset < size && static_cast<uint8_t>(data[offset]) < 0x80)
+                ++offset;
+            return offset;
+        }
+    }
+
+    Utf8Validator::Utf8Validator()
+    {
+        reset();
+    }
+
+    bool Utf8Validator::update(const char *data, size_t size)
+    {
+        size_t a = 0;
+        if(valid && needed > 0)
+            continue_character(data, size, a);
+
+        while(valid && a < size)
+        {
+            auto lead = static_cast<uint8_t>(data[a]);
+            if(lead < 0x80)
+            {
+                a = skip_ascii(data, a + 1, size);
+                continue;
+            }
+
+            //The lead byte says how many continuation bytes follow, and some limit the first of them,
+            //to rule out overlong encodings, surrogates (U+D800 to U+DFFF), and anything past U+10FFFF
+            lower = 0x80;
+            upper = 0xBF;
+            if(lead >= 0xC2 && lead <= 0xDF)
+            {
+                needed = 1;
+            }
+            else if(lead >= 0xE0 && lead <= 0xEF)
+            {
+                needed = 2;
+                if(lead == 0xE0)
+                    lower = 0xA0;
+                else if(lead == 0xED)
+                    upper = 0x9F;
+            }
+            else if(lead >= 0xF0 && lead <= 0xF4)
+            {
+                needed = 3;
+                if(lead == 0xF0)
+                    lower = 0x90;
+                else if(lead == 0xF4)
+                    upper = 0x8F;
+            }
+            else
+            {
+                valid = false;
+                break;
+            }
+            ++a;
+
+            //Usually the whole character's here, so it can be checked in one go. Otherwise it's finished in the next piece.
+            if(a + needed > size)
+            {
+                continue_character(data, size, a);
+                break;
+            }
+            auto second = static_cast<uint8_t>(data[a]);
+            valid = second >= lower && second <= upper;
+            for(size_t b = 1; b < needed; ++b)
+                valid &= (static_cast<uint8_t>(data[a + b]) & 0xC0) == 0x80;
+            a += needed;
+            needed = 0;
+        }
+        return valid;
+    }
+
+    void Utf8Validator::continue_character(const char *data, size_t size, size_t &offset)
+    {
+        while(needed > 0 && offset < size)
+        {
+            auto byte = static_cast<uint8_t>(data[offset++]);
+            if(byte < lower || byte > upper)
+            {
+                valid = false;
+                return;
+            }
+            --needed;
+            lower = 0x80;
+            upper = 0xBF;
+        }
+    }
+
+    bool Utf8Validator::finish()
+    {
+        bool result = valid && needed == 0;
+        reset();
+        return result;
+    }
+
+    void Utf8Validator::reset()
+    {
+        needed = 0;
+        lower = 0x80;
+        upper = 0xBF;
+        valid = true;
+    }
+
+    bool Utf8Validator::validate(const char *data, size_t size)
+    {
+        Utf8Validator validator;
+        validator.update(data, size);
+        return validator.finish();
+    }
+}
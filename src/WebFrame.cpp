@@ -2,31 +2,64 @@
 // Created by fred on 01/03/18.
 //
 
+#include <cstring>
+#include <algorithm>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
 #include "frnetlib/WebFrame.h"
 #include "frnetlib/WebSocket.h"
 
+#define MAX_HEADER_SIZE 14 //The size of a frame header with a 64bit length and a masking key
+#define MASK_CHUNK_SIZE 16384 //How much of a client frame's payload to mask at once, whilst sending it
+
 namespace fr
 {
     uint32_t WebFrame::current_mask_key = static_cast<uint32_t>(std::time(nullptr));
 
     WebFrame::WebFrame(WebFrame::Opcode type)
     : opcode(type),
-      final(true)
+      final(true),
+      rsv1(false),
+      header(),
+      header_received(0),
+      header_size(0),
+      payload_length(0),
+      mask_key(0)
     {
 
     }
 
     fr::Socket::Status WebFrame::send(Socket *socket) const
     {
-        if(!socket)
-            return Socket::Status::Error;
+        return send_payload(socket, payload.data(), payload.size());
+    }
+
+    std::string WebFrame::construct() const
+    {
+        char header[MAX_HEADER_SIZE];
+        uint32_t mask_key = is_client() ? ++current_mask_key : 0;
+        size_t header_size = construct_header(header, payload.size(), mask_key);
+
+        std::string frame;
+        frame.reserve(header_size + payload.size());
+        frame.append(header, header_size).append(payload);
+        if(is_client())
+            apply_mask(&frame[header_size], payload.size(), mask_key);
+        return frame;
+    }
 
+    size_t WebFrame::construct_header(char *header, size_t size, uint32_t mask_key) const
+    {
         uint16_t first_2bytes = 0;
-        std::string buffer;
+        size_t header_size = 0;
 
         //Set fin bit. Bit 1.
         first_2bytes |= final << 15;
 
+        //Set RSV1 bit, used by extensions. Bit 2.
+        first_2bytes |= rsv1 << 14;
+
         //Set opcode bit
         first_2bytes |= (uint8_t)opcode << 8;
 
@@ -34,157 +67,294 @@ namespace fr
         first_2bytes |= is_client() << 7;
 
         //Set payload length
-        if(payload.size() <= 125)
-            first_2bytes |= payload.size();
+        if(size <= 125)
+            first_2bytes |= size;
         else
-            first_2bytes |= (payload.size() < std::numeric_limits<uint16_t>::max()) ? 126 : 127;
+            first_2bytes |= (size < std::numeric_limits<uint16_t>::max()) ? 126 : 127;
         first_2bytes = htons(first_2bytes);
-        buffer.append((char*)&first_2bytes, sizeof(first_2bytes));
+        memcpy(header + header_size, &first_2bytes, sizeof(first_2bytes));
+        header_size += sizeof(first_2bytes);
 
         //Set additional payload bits if large enough
-        if(payload.size() > 125)
+        if(size > 125)
         {
-            if(payload.size() < std::numeric_limits<uint16_t>::max()) //16bit length
+            if(size < std::numeric_limits<uint16_t>::max()) //16bit length
             {
-                auto len = htons(static_cast<uint16_t>(payload.size()));
-                buffer.append((char*)&len, sizeof(len));
+                auto len = htons(static_cast<uint16_t>(size));
+                memcpy(header + header_size, &len, sizeof(len));
+                header_size += sizeof(len);
             }
             else //64bit length
             {
-                uint64_t len = fr_htonll(payload.size());
-                buffer.append((char*)&len, sizeof(len));
+                uint64_t len = fr_htonll(size);
+                memcpy(header + header_size, &len, sizeof(len));
+                header_size += sizeof(len);
             }
         }
 
-        //Add a masking key if we're the client
+        //Clients add a masking key
         if(is_client())
         {
-            union
-            {
-                uint32_t mask_key;
-                char str_mask_key[4];
-            } mask_union{};
+            memcpy(header + header_size, &mask_key, sizeof(mask_key));
+            header_size += sizeof(mask_key);
+        }
+        return header_size;
+    }
 
-            mask_union.mask_key = ++current_mask_key;
-            buffer.append((char*)&mask_union.mask_key, sizeof(mask_union.mask_key));
+    fr::Socket::Status WebFrame::send_payload(Socket *socket, const char *data, size_t size) const
+    {
+        if(!socket)
+            return Socket::Status::Error;
+
+        char header[MAX_HEADER_SIZE];
+        uint32_t mask_key = is_client() ? ++current_mask_key : 0;
+        size_t header_size = construct_header(header, size, mask_key);
 
-            //Encode the payload using the mask key
-            for(size_t a = 0; a < payload.size(); ++a)
+        auto send_all = [socket](const Socket::Buffer *buffers, size_t count) {
+            size_t sent = 0;
+            fr::Socket::Status state;
+            do
             {
-                payload[a] = payload[a] ^ mask_union.str_mask_key[a % 4];
-            }
+                state = socket->send_gather(buffers, count, sent);
+            } while(state == fr::Socket::Status::WouldBlock);
+            return state;
+        };
+
+        //Servers send the payload as it is, straight after the header
+        if(!is_client())
+        {
+            Socket::Buffer buffers[] = {{header, header_size}, {data, size}};
+            return send_all(buffers, 2);
         }
 
-        buffer.append(payload);
-        size_t sent = 0;
-        fr::Socket::Status state;
+        //Clients encode the payload with their masking key. This is done a piece at a time,
+        //on the stack, so that the frame's own payload is left as it is without copying all of it.
+        char masked[MASK_CHUNK_SIZE];
+        size_t offset = 0;
         do
         {
-            state = socket->send_raw(buffer.c_str(), buffer.size(), sent);
-        } while(state == fr::Socket::Status::WouldBlock);
-        return state;
+            size_t piece = std::min(size - offset, sizeof(masked));
+            memcpy(masked, data + offset, piece);
+            apply_mask(masked, piece, mask_key, offset);
+
+            Socket::Buffer buffers[] = {{header, offset == 0 ? header_size : 0}, {masked, piece}};
+            auto state = send_all(buffers, 2);
+            if(state != fr::Socket::Status::Success)
+                return state;
+            offset += piece;
+        } while(offset < size);
+        return fr::Socket::Status::Success;
+    }
+
+    namespace
+    {
+        //Once part of the frame has been received, the rest must follow
+        Socket::Status receive_all(Socket *socket, void *dest, size_t size, bool first)
+        {
+            Socket::Status status;
+            do
+            {
+                status = socket->receive_all(dest, size);
+            } while(!first && status == fr::Socket::Status::WouldBlock);
+            if(!first && status == fr::Socket::Status::Timeout)
+                status = fr::Socket::Status::Disconnected;
+            return status;
+        }
     }
 
     Socket::Status WebFrame::receive(Socket *socket)
+    {
+        if(!socket)
+            return Socket::Status::Error;
+        return receive(socket, socket->get_max_receive_size());
+    }
+
+    Socket::Status WebFrame::receive(Socket *socket, uint64_t max_payload_size)
+    {
+        auto status = receive_header(socket, max_payload_size);
+        if(status != fr::Socket::Status::Success)
+            return status;
+
+        //Then receive the payload straight into place
+        payload.resize(payload_length, '\0');
+        return receive_payload(socket, &payload[0], payload_length, 0);
+    }
+
+    Socket::Status WebFrame::receive_header(Socket *socket, uint64_t max_payload_size)
     {
         if(!socket)
             return Socket::Status::Error;
         payload.clear();
+        header_received = 0;
+        header_size = 0;
+
+        //Receive the header, only asking for as much as the parser needs next, so that nothing after the frame is read.
+        //The length's checked against the limit before anything's allocated for the payload.
+        char buffer[sizeof(header)];
         Socket::Status status;
+        size_t consumed = 0;
+        while(header_size == 0 || header_received < header_size)
+        {
+            size_t needed = (header_size == 0 ? 2 : header_size) - header_received;
+            status = receive_all(socket, buffer, needed, header_received == 0);
+            if(status != fr::Socket::Status::Success)
+                return status;
+            status = parse(buffer, needed, consumed, max_payload_size);
+            if(status != fr::Socket::Status::NotEnoughData)
+                break;
+        }
+        header_received = 0;
+        header_size = 0;
+        return status == fr::Socket::Status::NotEnoughData ? fr::Socket::Status::Success : status;
+    }
 
-        uint16_t first_2bytes;
-        status = socket->receive_all(&first_2bytes, sizeof(first_2bytes));
+    Socket::Status WebFrame::receive_payload(Socket *socket, char *dest, size_t size, uint64_t offset)
+    {
+        if(size == 0)
+            return fr::Socket::Status::Success;
+        auto status = receive_all(socket, dest, size, false);
         if(status != fr::Socket::Status::Success)
             return status;
-        first_2bytes = ntohs(first_2bytes);
 
-        //Extract fin bit. Read bit 1.
-        final = static_cast<bool>((first_2bytes >> 15) & 0x1);
+        //Decode the payload if the mask bit is set
+        if(header[1] & 0x80)
+            apply_mask(dest, size, mask_key, (size_t)offset);
+        return fr::Socket::Status::Success;
+    }
 
-        //Extract opcode. Read bits 4-7
-        opcode = static_cast<Opcode>((first_2bytes >> 8) & 0xF);
+    Socket::Status WebFrame::parse(const char *data, size_t size, size_t &consumed, uint64_t max_payload_size)
+    {
+        consumed = 0;
 
-        //Extract mask, if we're the server then messages should always be masked. Read bit 9
-        auto mask = static_cast<bool>((first_2bytes >> 7) & 0x1);
-        if(mask == is_client())
+        //Collect the header, which is only known to be complete once its first two bytes say how long it is
+        while(header_size == 0 || header_received < header_size)
         {
-            return fr::Socket::Status::Error;
+            size_t needed = (header_size == 0 ? 2 : header_size) - header_received;
+            size_t available = std::min(needed, size - consumed);
+            memcpy(header + header_received, data + consumed, available);
+            header_received += available;
+            consumed += available;
+            if(available < needed)
+                return fr::Socket::Status::NotEnoughData;
+
+            if(header_size == 0)
+            {
+                //Extract mask, if we're the server then messages should always be masked. Read bit 9
+                auto mask = static_cast<bool>((header[1] >> 7) & 0x1);
+                if(mask == is_client())
+                    return fr::Socket::Status::Error;
+
+                //The length is longer than 7 bit if it's 126 (16bit) or 127 (64bit)
+                auto short_length = header[1] & 0x7F;
+                header_size = 2 + (short_length == 126 ? 2 : short_length == 127 ? 8 : 0) + (mask ? 4 : 0);
+                if(header_received < header_size)
+                    continue;
+            }
+
+            auto status = parse_header(max_payload_size);
+            if(status != fr::Socket::Status::Success)
+                return status;
         }
 
+        //Decode the payload as it arrives, if the mask bit is set
+        size_t available = (size_t)std::min<uint64_t>(payload_length - payload.size(), size - consumed);
+        size_t offset = payload.size();
+        payload.append(data + consumed, available);
+        consumed += available;
+        if(header[1] & 0x80)
+            apply_mask(&payload[offset], available, mask_key, offset);
+        if(payload.size() < payload_length)
+            return fr::Socket::Status::NotEnoughData;
+
+        //Ready for the next frame
+        header_received = 0;
+        header_size = 0;
+        return fr::Socket::Status::Success;
+    }
 
-        //Extract payload length. Read bits 9-15
-        auto payload_length = static_cast<uint64_t>(first_2bytes & 0x7F);
-        if(payload_length == 126) //Length is longer than 7 bit, so read 16bit length
+    Socket::Status WebFrame::parse_header(uint64_t max_payload_size)
+    {
+        //Extract fin bit. Read bit 1.
+        final = static_cast<bool>((header[0] >> 7) & 0x1);
+
+        //Extract RSV1 bit. Read bit 2.
+        rsv1 = static_cast<bool>((header[0] >> 6) & 0x1);
+
+        //Extract opcode. Read bits 4-7
+        opcode = static_cast<Opcode>(header[0] & 0xF);
+
+        //Extract payload length. Read bits 9-15, and the 16 or 64 bits after if they're needed
+        size_t pos = 2;
+        payload_length = static_cast<uint64_t>(header[1] & 0x7F);
+        if(payload_length == 126)
         {
             uint16_t length;
-            do
-            {
-                status = socket->receive_all(&length, sizeof(length));
-            } while(status == fr::Socket::Status::WouldBlock);
-            if(status == fr::Socket::Status::Timeout)
-                status = fr::Socket::Status::Disconnected;
+            memcpy(&length, header + pos, sizeof(length));
             payload_length = ntohs(length);
-            if(status != fr::Socket::Status::Success)
-                return status;
+            pos += sizeof(length);
         }
-        else if(payload_length == 127) //Length is longer than 16 bit, so read 64bit length
+        else if(payload_length == 127)
         {
-            do
-            {
-                status = socket->receive_all(&payload_length, sizeof(payload_length));
-            } while(status == fr::Socket::Status::WouldBlock);
-            if(status == fr::Socket::Status::Timeout)
-                status = fr::Socket::Status::Disconnected;
+            memcpy(&payload_length, header + pos, sizeof(payload_length));
             payload_length = fr_ntohll(payload_length);
-            if(status != fr::Socket::Status::Success)
-                return status;
+            pos += sizeof(payload_length);
         }
 
         //Verify that payload length isn't too large
-        if(socket->get_max_receive_size() && payload_length > socket->get_max_receive_size())
+        if(max_payload_size && payload_length > max_payload_size)
         {
             return Socket::Status::MaxPacketSizeExceeded;
         }
 
         //Read masking key if the mask bit is set
-        union
-        {
-            uint32_t mask_key;
-            char str_mask_key[4];
-        } mask_union{};
-        if(mask)
+        if(header[1] & 0x80)
         {
-            do
-            {
-                status = socket->receive_all(&mask_union.mask_key, 4);
-            } while(status == fr::Socket::Status::WouldBlock);
-            if(status == fr::Socket::Status::Timeout)
-                status = fr::Socket::Status::Disconnected;
-            if(status != fr::Socket::Status::Success)
-                return status;
+            memcpy(&mask_key, header + pos, sizeof(mask_key));
         }
+        payload.clear();
+        return Socket::Status::Success;
+    }
 
-        //Read payload
-        payload.resize(payload_length, '\0');
-        do
-        {
-            status = socket->receive_all(&payload[0], payload_length);
-        } while(status == fr::Socket::Status::WouldBlock);
-        if(status == fr::Socket::Status::Timeout)
-            status = fr::Socket::Status::Disconnected;
-        if(status != fr::Socket::Status::Success)
-            return status;
+    void WebFrame::apply_mask(char *data, size_t size, uint32_t mask_key, size_t offset)
+    {
+        char key[sizeof(mask_key)];
+        memcpy(key, &mask_key, sizeof(key));
 
-        //Decode the payload if the mask bit is set
-        if(mask)
+        //Go a byte at a time until the data is word aligned
+        size_t a = 0;
+        for(; a < size && reinterpret_cast<uintptr_t>(data + a) % sizeof(uint64_t) != 0; ++a)
+            data[a] ^= key[(offset + a) % 4];
+
+        //Then do whole blocks at once, with the key repeated and rotated to line up with where they start
+        char pattern[16];
+        for(size_t b = 0; b < sizeof(pattern); ++b)
+            pattern[b] = key[(offset + a + b) % 4];
+
+#if defined(__SSE2__) || defined(_M_X64)
+        __m128i wide_pattern = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern));
+        for(; a + 32 <= size; a += 32)
         {
-            for(size_t a = 0; a < payload_length; ++a)
-            {
-                payload[a] = payload[a] ^ mask_union.str_mask_key[a % 4];
-            }
+            auto *block = reinterpret_cast<__m128i*>(data + a);
+            __m128i first = _mm_xor_si128(_mm_loadu_si128(block), wide_pattern);
+            __m128i second = _mm_xor_si128(_mm_loadu_si128(block + 1), wide_pattern);
+            _mm_storeu_si128(block, first);
+            _mm_storeu_si128(block + 1, second);
+        }
+#endif
 
+        uint64_t word_pattern;
+        memcpy(&word_pattern, pattern, sizeof(word_pattern));
+        for(; a + sizeof(uint64_t) <= size; a += sizeof(uint64_t))
+        {
+            uint64_t word;
+            memcpy(&word, data + a, sizeof(word));
+            word ^= word_pattern;
+            memcpy(data + a, &word, sizeof(word));
         }
-        return fr::Socket::Status::Success;
+
+        //And whatever's left over
+        for(; a < size; ++a)
+            data[a] ^= key[(offset + a) % 4];
     }
 
 }
@@ -0,0 +1,273 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#include <algorithm>
+#include "frnetlib/WebSocketHub.h"
+
+#define DEFAULT_CONNECTION_BUDGET 4194304 //How many bytes may be queued to a connection before it's evicted
+#define HUB_GATHER_BUFFERS 16 //The most queued frames to send at once
+
+namespace fr
+{
+    WebSocketHub::WebSocketHub()
+    : budget(DEFAULT_CONNECTION_BUDGET)
+    {
+
+    }
+
+    void WebSocketHub::add(const std::shared_ptr<Socket> &socket)
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        auto &connection = connections[socket.get()];
+        connection.socket = socket;
+    }
+
+    void WebSocketHub::remove(const std::shared_ptr<Socket> &socket)
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        erase(socket.get());
+    }
+
+    void WebSocketHub::subscribe(const std::shared_ptr<Socket> &socket, const std::string &topic)
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        auto &connection = connections[socket.get()];
+        connection.socket = socket;
+        if(topics[topic].insert(socket.get()).second)
+            connection.topics.emplace_back(topic);
+    }
+
+    void WebSocketHub::unsubscribe(const std::shared_ptr<Socket> &socket, const std::string &topic)
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        auto connection = connections.find(socket.get());
+        auto subscribers = topics.find(topic);
+        if(connection == connections.end() || subscribers == topics.end() || subscribers->second.erase(socket.get()) == 0)
+            return;
+
+        auto &subscribed = connection->second.topics;
+        subscribed.erase(std::find(subscribed.begin(), subscribed.end(), topic));
+        if(subscribers->second.empty())
+            topics.erase(subscribers);
+    }
+
+    size_t WebSocketHub::broadcast(const WebFrame &frame)
+    {
+        //The frame's constructed once, and shared between every connection's queue
+        auto data = std::make_shared<const std::string>(frame.construct());
+        std::vector<Event> events;
+        size_t count = 0;
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            for(auto &connection : connections)
+                count += enqueue(connection.second, data, events);
+            remove_evicted(events);
+        }
+        dispatch(events);
+        return count;
+    }
+
+    size_t WebSocketHub::publish(const std::string &topic, const WebFrame &frame)
+    {
+        auto data = std::make_shared<const std::string>(frame.construct());
+        std::vector<Event> events;
+        size_t count = 0;
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            auto subscribers = topics.find(topic);
+            if(subscribers == topics.end())
+                return 0;
+            for(auto *socket : subscribers->second)
+                count += enqueue(connections[socket], data, events);
+            remove_evicted(events);
+        }
+        dispatch(events);
+        return count;
+    }
+
+    bool WebSocketHub::send(const std::shared_ptr<Socket> &socket, const WebFrame &frame)
+    {
+        auto data = std::make_shared<const std::string>(frame.construct());
+        std::vector<Event> events;
+        bool queued;
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            auto connection = connections.find(socket.get());
+            if(connection == connections.end())
+                return false;
+            queued = enqueue(connection->second, data, events);
+            remove_evicted(events);
+        }
+        dispatch(events);
+        return queued;
+    }
+
+    void WebSocketHub::flush(const std::shared_ptr<Socket> &socket)
+    {
+        std::vector<Event> events;
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            auto connection = connections.find(socket.get());
+            if(connection == connections.end())
+                return;
+            write(connection->second, events);
+            remove_evicted(events);
+        }
+        dispatch(events);
+    }
+
+    void WebSocketHub::flush()
+    {
+        std::vector<Event> events;
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            for(auto &connection : connections)
+            {
+                if(!connection.second.queue.empty())
+                    write(connection.second, events);
+            }
+            remove_evicted(events);
+        }
+        dispatch(events);
+    }
+
+    bool WebSocketHub::has_pending(const std::shared_ptr<Socket> &socket) const
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        auto connection = connections.find(socket.get());
+        return connection != connections.end() && !connection->second.queue.empty();
+    }
+
+    size_t WebSocketHub::size() const
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        return connections.size();
+    }
+
+    void WebSocketHub::set_budget(size_t bytes)
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        budget = bytes;
+    }
+
+    void WebSocketHub::set_evict_handler(WebSocketHub::EvictHandler handler)
+    {
+        evict_handler = std::move(handler);
+    }
+
+    void WebSocketHub::set_write_interest_handler(WebSocketHub::WriteInterestHandler handler)
+    {
+        write_interest_handler = std::move(handler);
+    }
+
+    bool WebSocketHub::enqueue(Connection &connection, const std::shared_ptr<const std::string> &frame, std::vector<Event> &events)
+    {
+        if(connection.evicted)
+            return false;
+        if(budget && connection.queued + frame->size() > budget)
+        {
+            evict(connection, Socket::Status::MaxPacketSizeExceeded, events);
+            return false;
+        }
+
+        //If there's a backlog, then the connection's already waiting to become writable
+        bool idle = connection.queue.empty();
+        connection.queue.emplace_back(frame);
+        connection.queued += frame->size();
+        if(idle)
+            write(connection, events);
+        return true;
+    }
+
+    void WebSocketHub::write(Connection &connection, std::vector<Event> &events)
+    {
+        while(!connection.queue.empty() && !connection.evicted)
+        {
+            Socket::Buffer buffers[HUB_GATHER_BUFFERS];
+            size_t count = 0;
+            for(auto iter = connection.queue.begin(); iter != connection.queue.end() && count < HUB_GATHER_BUFFERS; ++iter, ++count)
+            {
+                size_t skip = count == 0 ? connection.offset : 0;
+                buffers[count] = {(*iter)->data() + skip, (*iter)->size() - skip};
+            }
+
+            //Drop whatever's been sent from the front of the queue
+            size_t sent = 0;
+            auto status = connection.socket->send_gather(buffers, count, sent);
+            connection.queued -= sent;
+            sent += connection.offset;
+            while(!connection.queue.empty() && sent >= connection.queue.front()->size())
+            {
+                sent -= connection.queue.front()->size();
+                connection.queue.pop_front();
+            }
+            connection.offset = sent;
+
+            if(status == Socket::Status::WouldBlock)
+            {
+                if(!connection.want_write)
+                {
+                    connection.want_write = true;
+                    events.push_back({connection.socket, false, status, true});
+                }
+                return;
+            }
+            if(status != Socket::Status::Success)
+            {
+                evict(connection, status, events);
+                return;
+            }
+        }
+
+        if(connection.want_write)
+        {
+            connection.want_write = false;
+            events.push_back({connection.socket, false, Socket::Status::Success, false});
+        }
+    }
+
+    void WebSocketHub::evict(Connection &connection, Socket::Status reason, std::vector<Event> &events)
+    {
+        connection.evicted = true;
+        events.push_back({connection.socket, true, reason, false});
+    }
+
+    void WebSocketHub::remove_evicted(const std::vector<Event> &events)
+    {
+        for(auto &event : events)
+        {
+            if(!event.evicted)
+                continue;
+            event.socket->shutdown();
+            erase(event.socket.get());
+        }
+    }
+
+    void WebSocketHub::erase(Socket *socket)
+    {
+        auto connection = connections.find(socket);
+        if(connection == connections.end())
+            return;
+
+        for(auto &topic : connection->second.topics)
+        {
+            auto subscribers = topics.find(topic);
+            subscribers->second.erase(socket);
+            if(subscribers->second.empty())
+                topics.erase(subscribers);
+        }
+        connections.erase(connection);
+    }
+
+    void WebSocketHub::dispatch(const std::vector<Event> &events)
+    {
+        for(auto &event : events)
+        {
+            if(event.evicted && evict_handler)
+                evict_handler(event.socket, event.reason);
+            else if(!event.evicted && write_interest_handler)
+                write_interest_handler(event.socket, event.want_write);
+        }
+    }
+}
@@ -0,0 +1,70 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#include <vector>
+#include "frnetlib/WebSocketKeepalive.h"
+
+namespace fr
+{
+    void WebSocketKeepalive::run(std::chrono::steady_clock::time_point now)
+    {
+        //Take out what's due, so that checks and handlers run without the lock held
+        std::vector<Check> due;
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            auto end = checks.upper_bound(now);
+            for(auto iter = checks.begin(); iter != end; ++iter)
+                due.emplace_back(std::move(iter->second));
+            checks.erase(checks.begin(), end);
+        }
+
+        for(auto &check : due)
+        {
+            auto deadline = check(now);
+            if(deadline != std::chrono::steady_clock::time_point::max())
+                schedule(deadline, std::move(check));
+        }
+    }
+
+    std::chrono::milliseconds WebSocketKeepalive::time_until_next(std::chrono::steady_clock::time_point now) const
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        if(checks.empty())
+            return std::chrono::milliseconds(-1);
+        if(checks.begin()->first <= now)
+            return std::chrono::milliseconds(0);
+
+        //Round up, so that the deadline's passed when the wait ends
+        auto remaining = checks.begin()->first - now;
+        auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(remaining);
+        if(milliseconds < remaining)
+            ++milliseconds;
+        return milliseconds;
+    }
+
+    size_t WebSocketKeepalive::size() const
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        return checks.size();
+    }
+
+    void WebSocketKeepalive::set_close_handler(WebSocketKeepalive::CloseHandler handler)
+    {
+        close_handler = std::move(handler);
+    }
+
+    void WebSocketKeepalive::schedule(std::chrono::steady_clock::time_point deadline, WebSocketKeepalive::Check check)
+    {
+        if(deadline == std::chrono::steady_clock::time_point::max())
+            return;
+        std::lock_guard<std::mutex> guard(mutex);
+        checks.emplace(deadline, std::move(check));
+    }
+
+    void WebSocketKeepalive::closed(const std::shared_ptr<Socket> &socket, Socket::Status reason)
+    {
+        if(close_handler)
+            close_handler(socket, reason);
+    }
+}
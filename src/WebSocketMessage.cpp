@@ -0,0 +1,284 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include "frnetlib/WebSocketMessage.h"
+
+#define DEFAULT_FRAGMENT_SIZE 65536 //The largest frame payload to send, unless set otherwise
+#define SINK_CHUNK_SIZE 65536 //How much of a frame to receive at once, when it's going to a payload sink
+
+namespace fr
+{
+    WebSocketMessage::WebSocketMessage(WebFrame::Opcode type)
+    : opcode(type),
+      fragment_size(DEFAULT_FRAGMENT_SIZE),
+      max_size(0),
+      validate_utf8(false),
+      partial_opcode(WebFrame::Opcode::Text),
+      partial_size(0),
+      partial_compressed(false),
+      in_message(false)
+    {
+
+    }
+
+    void WebSocketMessage::set_fragment_size(size_t size)
+    {
+        if(size == 0)
+            throw std::logic_error("WebSocket messages can't be split into empty fragments");
+        fragment_size = size;
+    }
+
+    Socket::Status WebSocketMessage::send(Socket *socket) const
+    {
+        return send(socket, nullptr);
+    }
+
+    Socket::Status WebSocketMessage::send(Socket *socket, PerMessageDeflate *compression) const
+    {
+        size_t offset = 0;
+        do
+        {
+            auto status = send_fragment(socket, offset, compression);
+            if(status != Socket::Status::Success)
+                return status;
+        } while(offset < payload.size());
+        return Socket::Status::Success;
+    }
+
+    Socket::Status WebSocketMessage::send_fragment(Socket *socket, size_t &offset, PerMessageDeflate *compression) const
+    {
+        //Control frames can't be fragmented, or compressed
+        bool control = opcode >= WebFrame::Opcode::Disconnect;
+        bool compress = !control && compression && compression->should_compress(payload.size());
+        size_t size = control ? payload.size() - offset : std::min(payload.size() - offset, fragment_size);
+
+        MessageFrame message_frame;
+        message_frame.client = is_client();
+        message_frame.set_opcode(offset == 0 ? opcode : WebFrame::Opcode::Continuation);
+        message_frame.set_final(offset + size == payload.size());
+        Socket::Status status;
+        if(compress)
+        {
+            //Each fragment carries whatever the compressor's output for its part of the payload, which may be nothing
+            std::string compressed;
+            status = compression->compress(payload.data() + offset, size, message_frame.is_final(), compressed);
+            if(status != Socket::Status::Success)
+                return status;
+            message_frame.set_compressed(offset == 0);
+            status = message_frame.send_payload(socket, compressed.data(), compressed.size());
+        }
+        else
+        {
+            status = message_frame.send_payload(socket, payload.data() + offset, size);
+        }
+        if(status == Socket::Status::Success)
+            offset += size;
+        return status;
+    }
+
+    Socket::Status WebSocketMessage::receive(Socket *socket)
+    {
+        return receive(socket, nullptr);
+    }
+
+    Socket::Status WebSocketMessage::receive(Socket *socket, PerMessageDeflate *compression)
+    {
+        if(!socket)
+            return Socket::Status::Error;
+
+        //Frames are limited by whichever's smaller of the message's and the socket's limits, before they're allocated
+        uint64_t socket_max = socket->get_max_receive_size();
+        uint64_t limit = max_size && socket_max ? std::min(max_size, socket_max) : std::max(max_size, socket_max);
+
+        //A partial message is kept if nothing more has arrived, to be carried on with next time
+        while(true)
+        {
+            frame.client = is_client();
+            auto status = frame.receive_header(socket, limit);
+            if(status != Socket::Status::Success)
+                return status;
+
+            //Data going to a sink is passed on a piece at a time, as it arrives, rather than a frame at a time
+            if(payload_sink && frame.get_opcode() < WebFrame::Opcode::Disconnect)
+            {
+                status = start_frame(compression);
+                uint64_t offset = 0;
+                while(status == Socket::Status::Success)
+                {
+                    size_t piece = (size_t)std::min<uint64_t>(frame.payload_length - offset, SINK_CHUNK_SIZE);
+                    frame.payload.resize(piece);
+                    status = frame.receive_payload(socket, &frame.payload[0], piece, offset);
+                    if(status != Socket::Status::Success)
+                        break;
+                    offset += piece;
+                    status = add_to_sink(frame.payload.data(), piece, frame.is_final() && offset == frame.payload_length, limit, compression);
+                    if(offset == frame.payload_length)
+                        break;
+                }
+                frame.payload.clear();
+                if(status != Socket::Status::Success)
+                    return status;
+                if(frame.is_final())
+                    return finish_message();
+                continue;
+            }
+
+            frame.payload.resize(frame.payload_length);
+            status = frame.receive_payload(socket, &frame.payload[0], frame.payload_length, 0);
+            if(status != Socket::Status::Success)
+                return status;
+            status = add_frame(limit, compression);
+            if(status != Socket::Status::NotEnoughData)
+                return status;
+        }
+    }
+
+    Socket::Status WebSocketMessage::parse(const char *data, size_t size, size_t &consumed, PerMessageDeflate *compression, uint64_t max_message_size)
+    {
+        //As with receive(), whichever's smaller of the two limits applies
+        uint64_t limit = max_size && max_message_size ? std::min(max_size, max_message_size) : std::max(max_size, max_message_size);
+        consumed = 0;
+        while(true)
+        {
+            size_t frame_consumed = 0;
+            frame.client = is_client();
+            auto status = frame.parse(data + consumed, size - consumed, frame_consumed, limit);
+            consumed += frame_consumed;
+            if(status != Socket::Status::Success)
+                return status;
+
+            status = add_frame(limit, compression);
+            if(status != Socket::Status::NotEnoughData || consumed == size)
+                return status;
+        }
+    }
+
+    Socket::Status WebSocketMessage::add_frame(uint64_t max_message_size, PerMessageDeflate *compression)
+    {
+        //Control frames can arrive between the fragments of a message, and are never fragmented or compressed themselves
+        auto frame_opcode = frame.get_opcode();
+        if(frame_opcode >= WebFrame::Opcode::Disconnect)
+        {
+            if(!frame.is_final() || frame.is_compressed())
+                return Socket::Status::Error;
+            opcode = frame_opcode;
+            payload = std::move(frame.payload);
+            return Socket::Status::Success;
+        }
+
+        auto status = start_frame(compression);
+        if(status != Socket::Status::Success)
+            return status;
+        if(payload_sink)
+        {
+            status = add_to_sink(frame.payload.data(), frame.payload.size(), frame.is_final(), max_message_size, compression);
+            if(status != Socket::Status::Success)
+                return status;
+            return frame.is_final() ? finish_message() : Socket::Status::NotEnoughData;
+        }
+
+        if(partial_compressed)
+        {
+            //Inflate straight onto the end of the message
+            size_t out_start = partial.size();
+            uint64_t limit = max_message_size ? max_message_size - partial.size() : std::numeric_limits<size_t>::max();
+            status = compression->decompress(frame.payload.data(), frame.payload.size(), frame.is_final(), partial, (size_t)limit);
+            if(status == Socket::Status::Success && !check_text(partial.data() + out_start, partial.size() - out_start, frame.is_final()))
+                status = Socket::Status::InvalidPayload;
+            if(status != Socket::Status::Success)
+            {
+                in_message = false;
+                partial.clear();
+                return status;
+            }
+            partial_size = partial.size();
+        }
+        else if(!check_text(frame.payload.data(), frame.payload.size(), frame.is_final()))
+        {
+            in_message = false;
+            partial.clear();
+            return Socket::Status::InvalidPayload;
+        }
+        else
+        {
+            partial_size += frame.payload.size();
+            if(max_message_size && partial_size > max_message_size)
+            {
+                in_message = false;
+                partial.clear();
+                return Socket::Status::MaxPacketSizeExceeded;
+            }
+            if(partial.empty() && partial.capacity() < frame.payload.size())
+                partial = std::move(frame.payload);
+            else
+                partial.append(frame.payload);
+        }
+
+        if(!frame.is_final())
+            return Socket::Status::NotEnoughData;
+        return finish_message();
+    }
+
+    Socket::Status WebSocketMessage::start_frame(PerMessageDeflate *compression)
+    {
+        //A message starts with a Text or Binary frame, followed by Continuations. Only the first
+        //frame says whether it's compressed, and only if compression has been negotiated.
+        auto frame_opcode = frame.get_opcode();
+        if((frame_opcode == WebFrame::Opcode::Continuation) != in_message)
+            return Socket::Status::Error;
+        if(frame.is_compressed() && (in_message || !compression || !compression->is_active()))
+            return Socket::Status::Error;
+        if(!in_message)
+        {
+            in_message = true;
+            partial_opcode = frame_opcode;
+            partial_size = 0;
+            partial_compressed = frame.is_compressed();
+            validator.reset();
+        }
+        return Socket::Status::Success;
+    }
+
+    Socket::Status WebSocketMessage::add_to_sink(const char *data, size_t size, bool last, uint64_t max_message_size, PerMessageDeflate *compression)
+    {
+        //Compressed data's inflated a piece at a time too, so the limit applies to each piece's worth
+        std::string inflated;
+        auto status = Socket::Status::Success;
+        if(partial_compressed)
+        {
+            uint64_t limit = max_message_size ? max_message_size : std::numeric_limits<size_t>::max();
+            status = compression->decompress(data, size, last, inflated, (size_t)limit);
+            data = inflated.data();
+            size = inflated.size();
+        }
+        if(status == Socket::Status::Success && !check_text(data, size, last))
+            status = Socket::Status::InvalidPayload;
+        if(status == Socket::Status::Success && !payload_sink(data, size))
+            status = Socket::Status::Error;
+        if(status != Socket::Status::Success)
+            in_message = false;
+        return status;
+    }
+
+    bool WebSocketMessage::check_text(const char *data, size_t size, bool last)
+    {
+        //Text is checked a piece at a time, before it's added to the message
+        if(!validate_utf8 || partial_opcode != WebFrame::Opcode::Text)
+            return true;
+        return validator.update(data, size) && (!last || validator.finish());
+    }
+
+    Socket::Status WebSocketMessage::finish_message()
+    {
+        //The message is complete, so hand it over
+        in_message = false;
+        opcode = partial_opcode;
+        payload.swap(partial);
+        partial.clear();
+        return Socket::Status::Success;
+    }
+}
@@ -0,0 +1,180 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#ifndef _WIN32
+#include <gtest/gtest.h>
+#include <thread>
+#include <atomic>
+#include <frnetlib/TcpListener.h>
+#include <frnetlib/TcpSocket.h>
+#include <frnetlib/AsyncHttpClient.h>
+
+namespace
+{
+    //Accepts a connection, and waits for 'expected' requests to arrive on it before answering any of them,
+    //which only works if the client pipelines them. The responses all go in one send, with each request's URI
+    //as the body, alternating between content-length and chunked. The connection is closed after 'close_after'
+    //responses, if it's non-zero. Returns the number of requests received.
+    size_t answer_pipelined(fr::TcpListener &listener, size_t expected, size_t close_after)
+    {
+        fr::TcpSocket client;
+        if(listener.accept(client) != fr::Socket::Status::Success)
+            return 0;
+
+        std::string received;
+        std::vector<std::string> uris;
+        while(uris.size() < expected)
+        {
+            char buffer[1024];
+            size_t size = 0;
+            if(client.receive_raw(buffer, sizeof(buffer), size) != fr::Socket::Status::Success)
+                return uris.size();
+            received.append(buffer, size);
+
+            size_t end;
+            while((end = received.find("\r\n\r\n")) != std::string::npos)
+            {
+                auto uri_begin = received.find(' ') + 1;
+                uris.emplace_back(received.substr(uri_begin, received.find(' ', uri_begin) - uri_begin));
+                received.erase(0, end + 4);
+            }
+        }
+
+        std::string responses;
+        for(size_t a = 0; a < uris.size() && (close_after == 0 || a < close_after); ++a)
+        {
+            std::string connection = a + 1 == close_after ? "connection: close\r\n" : "";
+            if(a % 2 == 0)
+                responses += "HTTP/1.1 200 OK\r\n" + connection + "content-length: " + std::to_string(uris[a].size()) + "\r\n\r\n" + uris[a];
+            else
+                responses += "HTTP/1.1 200 OK\r\n" + connection + "transfer-encoding: chunked\r\n\r\n" + std::to_string(uris[a].size()) + "\r\n" + uris[a] + "\r\n0\r\n\r\n";
+        }
+        size_t sent = 0;
+        client.send_raw(responses.data(), responses.size(), sent);
+        if(close_after != 0)
+            client.disconnect();
+        else
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        return uris.size();
+    }
+}
+
+TEST(AsyncHttpClientTest, pipelining)
+{
+    fr::TcpListener listener;
+    ASSERT_EQ(listener.listen("9101"), fr::Socket::Status::Success);
+    std::thread server([&]() {
+        ASSERT_EQ(answer_pipelined(listener, 5, 0), 5);
+    });
+
+    //All five requests should go on one connection, and complete in order
+    fr::AsyncHttpClient client;
+    std::vector<std::string> bodies;
+    for(size_t a = 0; a < 5; ++a)
+    {
+        client.request(fr::URL("http://127.0.0.1:9101/" + std::to_string(a)), {}, [&](fr::Socket::Status status, fr::HttpResponse &response) {
+            ASSERT_EQ(status, fr::Socket::Status::Success);
+            bodies.emplace_back(response.get_body());
+        });
+    }
+    while(client.poll(std::chrono::seconds(5)) > 0)
+        ASSERT_EQ(client.get_connection_count(), 1);
+    server.join();
+    ASSERT_EQ(bodies, std::vector<std::string>({"/0", "/1", "/2", "/3", "/4"}));
+}
+
+TEST(AsyncHttpClientTest, connection_close)
+{
+    fr::TcpListener listener;
+    ASSERT_EQ(listener.listen("9102"), fr::Socket::Status::Success);
+    std::thread server([&]() {
+        //The server only answers the first request before closing the connection, so the
+        //other two have to be sent again, even though they've been sent once already.
+        ASSERT_EQ(answer_pipelined(listener, 3, 1), 3);
+        ASSERT_EQ(answer_pipelined(listener, 2, 0), 2);
+    });
+
+    fr::AsyncHttpClient client;
+    std::vector<std::string> bodies;
+    for(size_t a = 0; a < 3; ++a)
+    {
+        client.request(fr::URL("http://127.0.0.1:9102/" + std::to_string(a)), {}, [&](fr::Socket::Status status, fr::HttpResponse &response) {
+            ASSERT_EQ(status, fr::Socket::Status::Success);
+            bodies.emplace_back(response.get_body());
+        });
+    }
+    client.run();
+    server.join();
+    ASSERT_EQ(bodies, std::vector<std::string>({"/0", "/1", "/2"}));
+}
+
+TEST(AsyncHttpClientTest, multiple_hosts)
+{
+    //Two servers which answer one request at a time
+    std::vector<std::unique_ptr<fr::TcpListener>> listeners;
+    std::vector<std::thread> servers;
+    std::atomic<size_t> requests(0);
+    for(auto port : {"9103", "9104"})
+    {
+        listeners.emplace_back(new fr::TcpListener());
+        ASSERT_EQ(listeners.back()->listen(port), fr::Socket::Status::Success);
+        servers.emplace_back([&requests, &listener = *listeners.back()]() {
+            fr::TcpSocket client;
+            if(listener.accept(client) != fr::Socket::Status::Success)
+                return;
+            fr::HttpRequest request;
+            while(client.receive(request) == fr::Socket::Status::Success)
+            {
+                ++requests;
+                fr::HttpResponse response;
+                response.set_body(request.get_uri());
+                if(client.send(response) != fr::Socket::Status::Success)
+                    return;
+                request = {};
+            }
+        });
+    }
+
+    {
+        //One thread should be able to drive both, with callbacks adding more requests as they go
+        fr::AsyncHttpClient client;
+        client.set_max_pipeline_depth(1);
+        size_t completed = 0;
+        std::function<void(const std::string &, size_t)> fetch = [&](const std::string &port, size_t remaining) {
+            std::string path = "/" + port + "/" + std::to_string(remaining);
+            client.request(fr::URL("http://127.0.0.1:" + port + path), {}, [&, port, path, remaining](fr::Socket::Status status, fr::HttpResponse &response) {
+                ASSERT_EQ(status, fr::Socket::Status::Success);
+                ASSERT_EQ(response.get_body(), path);
+                ++completed;
+                if(remaining > 0)
+                    fetch(port, remaining - 1);
+            });
+        };
+        fetch("9103", 4);
+        fetch("9104", 4);
+        client.run();
+        ASSERT_EQ(completed, 10);
+        ASSERT_EQ(client.get_connection_count(), 2);
+
+        //Requests which can't be made fail through their callbacks
+        std::vector<fr::Socket::Status> failures;
+        auto record = [&](fr::Socket::Status status, fr::HttpResponse &) {
+            failures.emplace_back(status);
+        };
+        client.request(fr::URL("https://127.0.0.1:9103/"), {}, record);
+        client.request(fr::URL("irc://127.0.0.1:9103/"), {}, record);
+        client.request(fr::URL("http://127.0.0.1:9199/"), {}, record);
+        client.run();
+        ASSERT_EQ(failures.size(), 3);
+        ASSERT_EQ(failures[0], fr::Socket::Status::SSLError);
+        ASSERT_EQ(failures[1], fr::Socket::Status::Error);
+        ASSERT_NE(failures[2], fr::Socket::Status::Success);
+    }
+
+    listeners.clear();
+    for(auto &server : servers)
+        server.join();
+    ASSERT_EQ(requests, 10);
+}
+#endif
@@ -0,0 +1,51 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#include <gtest/gtest.h>
+#include <frnetlib/Base64.h>
+
+TEST(Base64Test, encode)
+{
+    //The examples from RFC 4648 section 10
+    std::vector<std::pair<std::string, std::string>> examples = {
+            {"", ""}, {"f", "Zg=="}, {"fo", "Zm8="}, {"foo", "Zm9v"},
+            {"foob", "Zm9vYg=="}, {"fooba", "Zm9vYmE="}, {"foobar", "Zm9vYmFy"},
+    };
+    for(auto &example : examples)
+    {
+        ASSERT_EQ(fr::Base64::encode(example.first), example.second);
+        std::string decoded;
+        ASSERT_TRUE(fr::Base64::decode(example.second, decoded));
+        ASSERT_EQ(decoded, example.first);
+    }
+
+    //Every byte value survives the round trip
+    std::string bytes;
+    for(size_t a = 0; a < 256; ++a)
+        bytes += static_cast<char>(a);
+    std::string encoded = fr::Base64::encode(bytes);
+    ASSERT_EQ(encoded.substr(0, 20), "AAECAwQFBgcICQoLDA0O");
+    ASSERT_EQ(encoded.substr(encoded.size() - 8), "/P3+/w==");
+    std::string decoded = "prefix";
+    ASSERT_TRUE(fr::Base64::decode(encoded, decoded));
+    ASSERT_EQ(decoded, "prefix" + bytes);
+}
+
+TEST(Base64Test, decode_invalid)
+{
+    std::vector<std::string> invalid = {
+            "Zg", //Unpadded
+            "Zg=", "Zm9vY", "Zm9v====",
+            "Zm9v Yg==", "Zm9v\nYmFy", //Whitespace
+            "Zm-v", "Zm_v", "Zm9\xff",
+            "Z===", "=m9v", "Zm=v", "Zg==Zm9v", //Misplaced padding
+            "Zh==", "Zm9=", //Bits left over which aren't 0
+    };
+    for(auto &input : invalid)
+    {
+        std::string out = "untouched";
+        ASSERT_FALSE(fr::Base64::decode(input, out)) << input;
+        ASSERT_EQ(out, "untouched");
+    }
+}
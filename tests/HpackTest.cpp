@@ -0,0 +1,165 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#include <gtest/gtest.h>
+#include <frnetlib/Hpack.h>
+
+namespace
+{
+    std::string from_hex(const std::string &hex)
+    {
+        std::string out;
+        for(size_t a = 0; a + 1 < hex.size(); a += 2)
+            out.push_back(static_cast<char>(std::stoul(hex.substr(a, 2), nullptr, 16)));
+        return out;
+    }
+}
+
+TEST(HpackTest, integer_coding)
+{
+    //RFC 7541 C.1
+    std::string out;
+    fr::Hpack::encode_integer(10, 5, 0, out);
+    ASSERT_EQ(out, from_hex("0a"));
+    out.clear();
+    fr::Hpack::encode_integer(1337, 5, 0, out);
+    ASSERT_EQ(out, from_hex("1f9a0a"));
+    out.clear();
+    fr::Hpack::encode_integer(42, 8, 0, out);
+    ASSERT_EQ(out, from_hex("2a"));
+
+    uint64_t value = 0;
+    std::string encoded = from_hex("1f9a0a");
+    auto pos = reinterpret_cast<const uint8_t*>(encoded.data());
+    ASSERT_TRUE(fr::Hpack::decode_integer(pos, pos + encoded.size(), 5, value));
+    ASSERT_EQ(value, 1337);
+
+    //Truncated and overflowing integers
+    pos = reinterpret_cast<const uint8_t*>(encoded.data());
+    ASSERT_FALSE(fr::Hpack::decode_integer(pos, pos + 2, 5, value));
+    encoded = from_hex("1fffffffffffffffffffff01");
+    pos = reinterpret_cast<const uint8_t*>(encoded.data());
+    ASSERT_FALSE(fr::Hpack::decode_integer(pos, pos + encoded.size(), 5, value));
+}
+
+TEST(HpackTest, huffman)
+{
+    std::string encoded;
+    fr::Hpack::huffman_encode("www.example.com", 15, encoded);
+    ASSERT_EQ(encoded, from_hex("f1e3c2e5f23a6ba0ab90f4ff"));
+    ASSERT_EQ(fr::Hpack::huffman_encoded_size("www.example.com", 15), encoded.size());
+
+    std::string all_bytes;
+    for(int a = 0; a < 256; ++a)
+        all_bytes.push_back(static_cast<char>(a));
+    encoded.clear();
+    fr::Hpack::huffman_encode(all_bytes.data(), all_bytes.size(), encoded);
+    std::string decoded;
+    ASSERT_TRUE(fr::Hpack::huffman_decode(encoded.data(), encoded.size(), decoded));
+    ASSERT_EQ(decoded, all_bytes);
+
+    //Padding longer than 7 bits, padding which isn't all 1s, and an explicit EOS
+    decoded.clear();
+    ASSERT_FALSE(fr::Hpack::huffman_decode("\xff", 1, decoded));
+    ASSERT_FALSE(fr::Hpack::huffman_decode("\x00", 1, decoded));
+    ASSERT_FALSE(fr::Hpack::huffman_decode("\xff\xff\xff\xff", 4, decoded));
+}
+
+TEST(HpackTest, decode_requests)
+{
+    //RFC 7541 C.4, requests with Huffman coding sharing one dynamic table
+    fr::HpackDecoder decoder;
+    fr::Hpack::HeaderList headers;
+    std::string block = from_hex("828684418cf1e3c2e5f23a6ba0ab90f4ff");
+    ASSERT_TRUE(decoder.decode(block.data(), block.size(), headers));
+    ASSERT_EQ(headers, fr::Hpack::HeaderList({{":method", "GET"}, {":scheme", "http"}, {":path", "/"}, {":authority", "www.example.com"}}));
+    ASSERT_EQ(decoder.get_table_size(), 57);
+
+    headers.clear();
+    block = from_hex("828684be5886a8eb10649cbf");
+    ASSERT_TRUE(decoder.decode(block.data(), block.size(), headers));
+    ASSERT_EQ(headers.back(), fr::Hpack::Header("cache-control", "no-cache"));
+    ASSERT_EQ(headers[3], fr::Hpack::Header(":authority", "www.example.com"));
+    ASSERT_EQ(decoder.get_table_size(), 110);
+
+    headers.clear();
+    block = from_hex("828785bf408825a849e95ba97d7f8925a849e95bb8e8b4bf");
+    ASSERT_TRUE(decoder.decode(block.data(), block.size(), headers));
+    ASSERT_EQ(headers, fr::Hpack::HeaderList({{":method", "GET"}, {":scheme", "https"}, {":path", "/index.html"}, {":authority", "www.example.com"}, {"custom-key", "custom-value"}}));
+    ASSERT_EQ(decoder.get_table_size(), 164);
+}
+
+TEST(HpackTest, decode_responses_with_eviction)
+{
+    //RFC 7541 C.6, responses with a 256 byte table, so older entries get evicted
+    fr::HpackDecoder decoder(256);
+    fr::Hpack::HeaderList headers;
+    std::string block = from_hex("488264025885aec3771a4b6196d07abe941054d444a8200595040b8166e082a62d1bff6e919d29ad171863c78f0b97c8e9ae82ae43d3");
+    ASSERT_TRUE(decoder.decode(block.data(), block.size(), headers));
+    ASSERT_EQ(headers, fr::Hpack::HeaderList({{":status", "302"}, {"cache-control", "private"}, {"date", "Mon, 21 Oct 2013 20:13:21 GMT"}, {"location", "https://www.example.com"}}));
+    ASSERT_EQ(decoder.get_table_size(), 222);
+
+    headers.clear();
+    block = from_hex("4883640effc1c0bf");
+    ASSERT_TRUE(decoder.decode(block.data(), block.size(), headers));
+    ASSERT_EQ(headers[0], fr::Hpack::Header(":status", "307"));
+    ASSERT_EQ(headers[3], fr::Hpack::Header("location", "https://www.example.com"));
+    ASSERT_EQ(decoder.get_table_size(), 222);
+
+    headers.clear();
+    block = from_hex("88c16196d07abe941054d444a8200595040b8166e084a62d1bffc05a839bd9ab77ad94e7821dd7f2e6c7b335dfdfcd5b3960d5af27087f3672c1ab270fb5291f9587316065c003ed4ee5b1063d5007");
+    ASSERT_TRUE(decoder.decode(block.data(), block.size(), headers));
+    ASSERT_EQ(headers, fr::Hpack::HeaderList({{":status", "200"}, {"cache-control", "private"}, {"date", "Mon, 21 Oct 2013 20:13:22 GMT"}, {"location", "https://www.example.com"},
+                                              {"content-encoding", "gzip"}, {"set-cookie", "foo=ASDJKHQKBZXOQWEOPIUAXQWEOIU; max-age=3600; version=1"}}));
+    ASSERT_EQ(decoder.get_table_size(), 215);
+}
+
+TEST(HpackTest, decode_errors)
+{
+    fr::Hpack::HeaderList headers;
+    for(auto &hex : {"80", "be", "3fe201", "823fe101", "4085", "0f"})
+    {
+        fr::HpackDecoder fresh(256);
+        std::string block = from_hex(hex);
+        ASSERT_FALSE(fresh.decode(block.data(), block.size(), headers)) << hex;
+    }
+
+    //Header lists larger than the limit
+    fr::HpackDecoder limited(4096, 64);
+    std::string block = from_hex("400a637573746f6d2d6b65790c637573746f6d2d76616c7565400a637573746f6d2d6b65790c637573746f6d2d76616c7565");
+    ASSERT_FALSE(limited.decode(block.data(), block.size(), headers));
+}
+
+TEST(HpackTest, encoder_round_trip)
+{
+    fr::HpackEncoder encoder;
+    fr::HpackDecoder decoder;
+    fr::Hpack::HeaderList headers = {{":method", "GET"}, {":scheme", "https"}, {":path", "/index.html"}, {":authority", "www.example.com"},
+                                     {"custom-key", "custom-value"}, {"authorization", "Basic c2VjcmV0"}, {"accept-encoding", "gzip, deflate"}};
+
+    std::string first, second;
+    encoder.encode(headers, first);
+    encoder.encode(headers, second);
+    ASSERT_LT(second.size(), first.size());
+    //Everything should be indexed, other than the never indexed authorization value
+    ASSERT_EQ(second.size(), (headers.size() - 1) + 3 + fr::Hpack::huffman_encoded_size("Basic c2VjcmV0", 14));
+
+    for(auto block : {first, second})
+    {
+        fr::Hpack::HeaderList decoded;
+        ASSERT_TRUE(decoder.decode(block.data(), block.size(), decoded));
+        ASSERT_EQ(decoded, headers);
+    }
+
+    //Table size changes must be signalled, and respected by both sides
+    encoder.set_max_table_size(0);
+    encoder.set_max_table_size(100);
+    std::string third;
+    encoder.encode(headers, third);
+    ASSERT_EQ(static_cast<uint8_t>(third[0]), 0x20);
+    fr::Hpack::HeaderList decoded;
+    ASSERT_TRUE(decoder.decode(third.data(), third.size(), decoded));
+    ASSERT_EQ(decoded, headers);
+    ASSERT_LE(decoder.get_table_size(), 100);
+}
@@ -0,0 +1,229 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <frnetlib/TcpListener.h>
+#include <frnetlib/TcpSocket.h>
+#include <frnetlib/Http2.h>
+
+TEST(Http2Test, multiplexed_requests)
+{
+    fr::TcpListener listener;
+    ASSERT_EQ(listener.listen("9097"), fr::Socket::Status::Success);
+    const std::string upload(3 * 1024 * 1024, 'u'); //Bigger than the stream window, so flow control has to kick in
+    const std::string download(200 * 1024, 'd');
+
+    std::thread server([&]() {
+        fr::TcpSocket client;
+        ASSERT_EQ(listener.accept(client), fr::Socket::Status::Success);
+        fr::Http2Connection connection(client, fr::Http2Connection::Role::Server);
+        ASSERT_EQ(connection.handshake(), fr::Socket::Status::Success);
+
+        //Receive all of the requests, and then respond in reverse order
+        std::vector<std::pair<uint32_t, fr::HttpRequest>> requests;
+        for(size_t a = 0; a < 3; ++a)
+        {
+            fr::HttpRequest request;
+            uint32_t stream_id = 0;
+            ASSERT_EQ(connection.receive_request(request, stream_id), fr::Socket::Status::Success);
+            requests.emplace_back(stream_id, request);
+        }
+
+        for(auto iter = requests.rbegin(); iter != requests.rend(); ++iter)
+        {
+            auto &request = iter->second;
+            fr::HttpResponse response;
+            if(request.get_type() == fr::Http::RequestType::Post)
+                response.set_body(std::to_string(request.get_body().size()) + (request.get_body() == upload ? " ok" : " bad"));
+            else if(request.get_uri() == "/large")
+                response.set_body(download);
+            else
+                response.set_body(request.get_uri() + "?a=" + request.get("a") + " " + request.header("x-custom") + " " + request.header("host"));
+            response.header("x-stream") = std::to_string(iter->first);
+            ASSERT_EQ(connection.send_response(iter->first, response), fr::Socket::Status::Success);
+        }
+        ASSERT_EQ(connection.close(), fr::Socket::Status::Success);
+    });
+
+    fr::TcpSocket socket;
+    ASSERT_EQ(socket.connect("127.0.0.1", "9097", std::chrono::seconds(5)), fr::Socket::Status::Success);
+    fr::Http2Connection connection(socket, fr::Http2Connection::Role::Client);
+    ASSERT_EQ(connection.handshake(), fr::Socket::Status::Success);
+
+    fr::HttpRequest small, large, post;
+    small.set_uri("/small");
+    small.get("a") = "b";
+    small.header("x-custom") = "value";
+    small.header("host") = "example.com";
+    large.set_uri("/large");
+    post.set_uri("/upload");
+    post.set_type(fr::Http::RequestType::Post);
+    post.set_body(upload);
+
+    uint32_t small_id = 0, large_id = 0, post_id = 0;
+    ASSERT_EQ(connection.send_request(small, small_id), fr::Socket::Status::Success);
+    ASSERT_EQ(connection.send_request(large, large_id), fr::Socket::Status::Success);
+    ASSERT_EQ(connection.send_request(post, post_id), fr::Socket::Status::Success);
+    ASSERT_EQ(small_id, 1);
+    ASSERT_EQ(large_id, 3);
+    ASSERT_EQ(post_id, 5);
+
+    fr::HttpResponse response;
+    ASSERT_EQ(connection.receive_response(small_id, response), fr::Socket::Status::Success);
+    ASSERT_EQ(response.get_status(), fr::Http::RequestStatus::Ok);
+    ASSERT_EQ(response.get_body(), "/small?a=b value example.com");
+    ASSERT_EQ(response.header("x-stream"), "1");
+
+    response = {};
+    ASSERT_EQ(connection.receive_response(large_id, response), fr::Socket::Status::Success);
+    ASSERT_EQ(response.get_body(), download);
+
+    response = {};
+    ASSERT_EQ(connection.receive_response(post_id, response), fr::Socket::Status::Success);
+    ASSERT_EQ(response.get_body(), std::to_string(upload.size()) + " ok");
+
+    ASSERT_EQ(connection.receive_response(post_id, response), fr::Socket::Status::Error);
+    server.join();
+}
+
+TEST(Http2Test, bad_preface)
+{
+    fr::TcpListener listener;
+    ASSERT_EQ(listener.listen("9098"), fr::Socket::Status::Success);
+
+    std::thread server([&]() {
+        fr::TcpSocket client;
+        ASSERT_EQ(listener.accept(client), fr::Socket::Status::Success);
+        fr::Http2Connection connection(client, fr::Http2Connection::Role::Server);
+        ASSERT_EQ(connection.handshake(), fr::Socket::Status::Success);
+        fr::HttpRequest request;
+        uint32_t stream_id = 0;
+        ASSERT_EQ(connection.receive_request(request, stream_id), fr::Socket::Status::ParseError);
+    });
+
+    //An HTTP/1.1 request instead of the preface should be rejected with GOAWAY
+    fr::TcpSocket socket;
+    ASSERT_EQ(socket.connect("127.0.0.1", "9098", std::chrono::seconds(5)), fr::Socket::Status::Success);
+    fr::HttpRequest request;
+    ASSERT_EQ(socket.send(request), fr::Socket::Status::Success);
+    server.join();
+
+    char buffer[256];
+    ASSERT_EQ(socket.receive_all(buffer, (9 + 3 * 6) + (9 + 4)), fr::Socket::Status::Success); //The server's SETTINGS, then WINDOW_UPDATE
+    ASSERT_EQ(socket.receive_all(buffer, 9), fr::Socket::Status::Success);
+    ASSERT_EQ(buffer[3], 0x7); //GOAWAY
+}
+
+TEST(Http2Test, non_blocking_send)
+{
+    fr::TcpListener listener;
+    ASSERT_EQ(listener.listen("9133"), fr::Socket::Status::Success);
+    const std::string download(900 * 1024, 'd'); //Fits in the stream window, but not in the socket's send buffer
+
+    std::thread server([&]() {
+        fr::TcpSocket client;
+        ASSERT_EQ(listener.accept(client), fr::Socket::Status::Success);
+        fr::Http2Connection connection(client, fr::Http2Connection::Role::Server);
+        ASSERT_EQ(connection.handshake(), fr::Socket::Status::Success);
+        fr::HttpRequest request;
+        uint32_t stream_id = 0;
+        ASSERT_EQ(connection.receive_request(request, stream_id), fr::Socket::Status::Success);
+
+        //Whatever the socket can't take is left for flush(), rather than being spun on
+        int buffer_size = 16 * 1024;
+        ASSERT_EQ(setsockopt(client.get_socket_descriptor(), SOL_SOCKET, SO_SNDBUF, (const char*)&buffer_size, sizeof(buffer_size)), 0);
+        client.set_blocking(false);
+        fr::HttpResponse response;
+        response.set_body(download);
+        auto status = connection.send_response(stream_id, response);
+        ASSERT_EQ(status, fr::Socket::Status::WouldBlock);
+        while(status == fr::Socket::Status::WouldBlock)
+        {
+            ASSERT_TRUE(connection.has_pending_output());
+            pollfd descriptor = {client.get_socket_descriptor(), POLLOUT, 0};
+            ASSERT_EQ(fr::poll_sockets(&descriptor, 1, 5000), 1);
+            status = connection.flush();
+        }
+        ASSERT_EQ(status, fr::Socket::Status::Success);
+        ASSERT_FALSE(connection.has_pending_output());
+    });
+
+    fr::TcpSocket socket;
+    ASSERT_EQ(socket.connect("127.0.0.1", "9133", std::chrono::seconds(5)), fr::Socket::Status::Success);
+    fr::Http2Connection connection(socket, fr::Http2Connection::Role::Client);
+    ASSERT_EQ(connection.handshake(), fr::Socket::Status::Success);
+    fr::HttpRequest request;
+    request.set_uri("/large");
+    uint32_t stream_id = 0;
+    ASSERT_EQ(connection.send_request(request, stream_id), fr::Socket::Status::Success);
+
+    //Let the server fill up the socket before reading anything
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    fr::HttpResponse response;
+    ASSERT_EQ(connection.receive_response(stream_id, response), fr::Socket::Status::Success);
+    ASSERT_EQ(response.get_body(), download);
+    server.join();
+}
+
+TEST(Http2Test, continuation_flood)
+{
+    fr::TcpListener listener;
+    ASSERT_EQ(listener.listen("9134"), fr::Socket::Status::Success);
+
+    std::thread server([&]() {
+        fr::TcpSocket client;
+        ASSERT_EQ(listener.accept(client), fr::Socket::Status::Success);
+        fr::Http2Connection connection(client, fr::Http2Connection::Role::Server);
+        ASSERT_EQ(connection.handshake(), fr::Socket::Status::Success);
+        fr::HttpRequest request;
+        uint32_t stream_id = 0;
+        ASSERT_EQ(connection.receive_request(request, stream_id), fr::Socket::Status::ParseError);
+
+        //Read whatever else was sent, so that closing doesn't reset the connection before the GOAWAY arrives
+        char buffer[RECV_CHUNK_SIZE];
+        size_t received = 0;
+        while(client.receive_raw(buffer, sizeof(buffer), received) == fr::Socket::Status::Success);
+    });
+
+    fr::TcpSocket socket;
+    ASSERT_EQ(socket.connect("127.0.0.1", "9134", std::chrono::seconds(5)), fr::Socket::Status::Success);
+    auto frame = [](uint8_t type, uint8_t flags, uint32_t stream_id, const std::string &payload) {
+        std::string data = {(char)(payload.size() >> 16), (char)(payload.size() >> 8), (char)payload.size(), (char)type, (char)flags,
+                            (char)(stream_id >> 24), (char)(stream_id >> 16), (char)(stream_id >> 8), (char)stream_id};
+        return data + payload;
+    };
+
+    //A header block which never ends, sent until the server gives up on it
+    std::string data = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n" + frame(0x4, 0, 0, "") + frame(0x1, 0, 1, std::string(1000, '\0'));
+    size_t sent = 0;
+    ASSERT_EQ(socket.send_raw(data.data(), data.size(), sent), fr::Socket::Status::Success);
+    data = frame(0x9, 0, 1, std::string(16384, '\0'));
+    for(size_t a = 0; a < 100; ++a)
+    {
+        sent = 0;
+        if(socket.send_raw(data.data(), data.size(), sent) != fr::Socket::Status::Success)
+            break;
+    }
+
+    //Skip the server's settings and acknowledgements, until it sends GOAWAY with ENHANCE_YOUR_CALM
+    while(true)
+    {
+        char header[9];
+        ASSERT_EQ(socket.receive_all(header, sizeof(header)), fr::Socket::Status::Success);
+        std::string payload(((size_t)(uint8_t)header[0] << 16) | ((size_t)(uint8_t)header[1] << 8) | (uint8_t)header[2], '\0');
+        if(!payload.empty())
+        {
+            ASSERT_EQ(socket.receive_all(&payload[0], payload.size()), fr::Socket::Status::Success);
+        }
+        if(header[3] == 0x7)
+        {
+            ASSERT_EQ(payload.size(), 8);
+            ASSERT_EQ(payload[7], 0xb);
+            break;
+        }
+    }
+    socket.disconnect();
+    server.join();
+}
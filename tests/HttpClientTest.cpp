@@ -0,0 +1,184 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <atomic>
+#include <frnetlib/TcpListener.h>
+#include <frnetlib/TcpSocket.h>
+#include <frnetlib/HttpClient.h>
+
+namespace
+{
+    //Accepts 'connections' connections, and echoes the URI of each request back on them
+    void serve(fr::TcpListener &listener, size_t connections, std::atomic<size_t> &requests)
+    {
+        std::vector<std::thread> threads;
+        for(size_t a = 0; a < connections; ++a)
+        {
+            auto client = std::make_shared<fr::TcpSocket>();
+            if(listener.accept(*client) != fr::Socket::Status::Success)
+                break;
+            threads.emplace_back([client, &requests]() {
+                while(true)
+                {
+                    fr::HttpRequest request;
+                    if(client->receive(request) != fr::Socket::Status::Success)
+                        return;
+                    ++requests;
+
+                    fr::HttpResponse response;
+                    response.set_body(request.get_uri());
+                    if(request.get_uri() == "/close")
+                        response.header("connection") = "close";
+                    if(request.get_uri() == "/slow")
+                        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                    if(client->send(response) != fr::Socket::Status::Success)
+                        return;
+
+                    //Either say that the connection is closing, or just drop it
+                    if(request.get_uri() == "/close" || request.get_uri() == "/drop")
+                    {
+                        client->disconnect();
+                        return;
+                    }
+                }
+            });
+        }
+
+        for(auto &thread : threads)
+            thread.join();
+    }
+}
+
+TEST(HttpClientTest, connection_reuse)
+{
+    fr::TcpListener listener;
+    ASSERT_EQ(listener.listen("9099"), fr::Socket::Status::Success);
+    std::atomic<size_t> requests(0);
+    std::thread server([&]() {
+        serve(listener, 4, requests);
+    });
+
+    {
+        fr::HttpClient client;
+        fr::HttpResponse response;
+
+        //Sequential requests should share one connection
+        for(size_t a = 0; a < 5; ++a)
+        {
+            fr::HttpRequest request;
+            request.get("ignored") = "value";
+            ASSERT_EQ(client.request(fr::URL("http://127.0.0.1:9099/path?a=" + std::to_string(a)), request, response), fr::Socket::Status::Success);
+            ASSERT_EQ(response.get_body(), "/path");
+            ASSERT_EQ(client.get_idle_connection_count(), 1);
+        }
+
+        //Connections which the server closes aren't kept
+        ASSERT_EQ(client.request(fr::URL("http://127.0.0.1:9099/close"), {}, response), fr::Socket::Status::Success);
+        ASSERT_EQ(client.get_idle_connection_count(), 0);
+        ASSERT_EQ(client.request(fr::URL("http://127.0.0.1:9099/"), {}, response), fr::Socket::Status::Success);
+
+        //Nor are those which have been idle for too long
+        client.set_idle_timeout(std::chrono::milliseconds(0));
+        ASSERT_EQ(client.request(fr::URL("http://127.0.0.1:9099/drop"), {}, response), fr::Socket::Status::Success);
+        client.set_idle_timeout(std::chrono::seconds(60));
+
+        //Or those which were closed while in the pool
+        ASSERT_EQ(client.get_idle_connection_count(), 1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        ASSERT_EQ(client.request(fr::URL("http://127.0.0.1:9099/last"), {}, response), fr::Socket::Status::Success);
+        ASSERT_EQ(response.get_body(), "/last");
+        ASSERT_EQ(client.get_idle_connection_count(), 1);
+
+        ASSERT_EQ(client.request(fr::URL("https://127.0.0.1:9099/"), {}, response), fr::Socket::Status::SSLError);
+        ASSERT_EQ(client.request(fr::URL("irc://127.0.0.1:9099/"), {}, response), fr::Socket::Status::Error);
+    }
+
+    server.join();
+    ASSERT_EQ(requests, 9);
+}
+
+TEST(HttpClientTest, connection_limit)
+{
+    fr::TcpListener listener;
+    ASSERT_EQ(listener.listen("9100"), fr::Socket::Status::Success);
+    std::atomic<size_t> requests(0);
+    std::thread server([&]() {
+        serve(listener, 1, requests);
+    });
+
+    {
+        //With one connection allowed, concurrent requests have to take turns on it
+        fr::HttpClient client;
+        client.set_max_connections_per_host(1);
+        std::vector<std::thread> threads;
+        for(size_t a = 0; a < 4; ++a)
+        {
+            threads.emplace_back([&]() {
+                for(size_t b = 0; b < 3; ++b)
+                {
+                    fr::HttpResponse response;
+                    EXPECT_EQ(client.request(fr::URL("http://127.0.0.1:9100/slow"), {}, response), fr::Socket::Status::Success);
+                    EXPECT_EQ(response.get_body(), "/slow");
+                }
+            });
+        }
+        for(auto &thread : threads)
+            thread.join();
+        ASSERT_EQ(client.get_idle_connection_count(), 1);
+    }
+
+    server.join();
+    ASSERT_EQ(requests, 12);
+}
+
+TEST(HttpClientTest, stale_connection_retry)
+{
+    fr::TcpListener listener;
+    ASSERT_EQ(listener.listen("9131"), fr::Socket::Status::Success);
+    std::atomic<size_t> requests(0);
+    std::thread server([&]() {
+        //Answer one request on each connection, then hang up on the next without answering it
+        for(size_t a = 0; a < 2; ++a)
+        {
+            fr::TcpSocket client;
+            if(listener.accept(client) != fr::Socket::Status::Success)
+                return;
+            for(size_t b = 0; b < 2; ++b)
+            {
+                fr::HttpRequest request;
+                if(client.receive(request) != fr::Socket::Status::Success)
+                    return;
+                ++requests;
+                if(b == 1)
+                    break;
+                fr::HttpResponse response;
+                response.set_body(request.get_uri());
+                if(client.send(response) != fr::Socket::Status::Success)
+                    return;
+            }
+            client.disconnect();
+        }
+    });
+
+    {
+        fr::HttpClient client;
+        client.set_receive_timeout(5000);
+        fr::HttpResponse response;
+        ASSERT_EQ(client.request(fr::URL("http://127.0.0.1:9131/first"), {}, response), fr::Socket::Status::Success);
+
+        //A GET can safely be sent again on a new connection
+        ASSERT_EQ(client.request(fr::URL("http://127.0.0.1:9131/second"), {}, response), fr::Socket::Status::Success);
+        ASSERT_EQ(response.get_body(), "/second");
+
+        //But a POST might have been acted on, so it isn't
+        fr::HttpRequest request;
+        request.set_type(fr::Http::RequestType::Post);
+        ASSERT_EQ(client.request(fr::URL("http://127.0.0.1:9131/third"), request, response), fr::Socket::Status::Disconnected);
+    }
+
+    server.join();
+    ASSERT_EQ(requests, 4);
+}
@@ -1,4 +1,6 @@
 #include "gtest/gtest.h"
+#include <thread>
+#include <atomic>
 #include <frnetlib/HttpRequest.h>
 
 TEST(HttpRequestTest, get_request_parse)
@@ -246,4 +248,72 @@ TEST(HttpRequestTest, awkward_parse2)
     ASSERT_EQ(request.get_uri(), "/my/url");
     ASSERT_EQ(request.get("Bob"), "10");
     ASSERT_EQ(request.post("Test"), "bob");
-}
\ No newline at end of file
+}
+TEST(HttpRequestTest, lazy_argument_parse)
+{
+    std::string request_data = "POST /search?Q=first&q=second&flag&&empty= HTTP/1.1\r\n"
+            "Content-Type: application/x-www-form-urlencoded; charset=utf-8\r\n"
+            "Content-Length: 15\r\n"
+            "\r\n"
+            "a=1&A=2&b=x%20y";
+
+    fr::HttpRequest request;
+    ASSERT_EQ(request.parse(request_data.c_str(), request_data.size()), fr::Socket::Status::Success);
+    ASSERT_EQ(request.get_uri(), "/search");
+    ASSERT_EQ(request.get("q"), "first");
+    ASSERT_TRUE(request.get_exists("flag"));
+    ASSERT_TRUE(request.get_exists("empty"));
+    ASSERT_EQ(request.post("a"), "2");
+    ASSERT_EQ(request.post("b"), "x%20y");
+
+    //Re-sending a received request should keep its arguments
+    fr::HttpRequest copy;
+    std::string constructed = request.construct("localhost");
+    ASSERT_EQ(copy.parse(constructed.c_str(), constructed.size()), fr::Socket::Status::Success);
+    ASSERT_EQ(copy.get("q"), "first");
+}
+
+TEST(HttpRequestTest, binary_post_body)
+{
+    //Bodies which aren't forms shouldn't be parsed as one
+    std::string binary(1024 * 1024, '\0');
+    for(size_t a = 0; a < binary.size(); ++a)
+        binary[a] = static_cast<char>((a * 7919) ^ (a >> 8));
+    std::string request_data = "POST /upload HTTP/1.1\r\n"
+            "Content-Type: application/octet-stream\r\n"
+            "Content-Length: " + std::to_string(binary.size()) + "\r\n\r\n" + binary;
+
+    fr::HttpRequest request;
+    ASSERT_EQ(request.parse(request_data.c_str(), request_data.size()), fr::Socket::Status::Success);
+    ASSERT_FALSE(request.post_exists(std::string(1, binary[0])));
+    ASSERT_EQ(request.get_body(), binary);
+}
+
+TEST(HttpRequestTest, concurrent_const_access)
+{
+    std::string request_data = "POST /search?q=first HTTP/1.1\r\n"
+            "Content-Length: 3\r\n"
+            "\r\n"
+            "a=1";
+
+    fr::HttpRequest received;
+    ASSERT_EQ(received.parse(request_data.c_str(), request_data.size()), fr::Socket::Status::Success);
+
+    //Copies which haven't been read yet parse their own arguments
+    const fr::HttpRequest request = received;
+    ASSERT_TRUE(received.get_exists("q"));
+
+    //Const readers can share a request, even though the first of them parses its arguments
+    std::atomic<size_t> found(0);
+    std::vector<std::thread> threads;
+    for(size_t a = 0; a < 4; ++a)
+    {
+        threads.emplace_back([&]() {
+            if(request.get_exists("q") && request.post_exists("a") && request.construct("localhost").find("?q=first") != std::string::npos)
+                ++found;
+        });
+    }
+    for(auto &thread : threads)
+        thread.join();
+    ASSERT_EQ(found, 4);
+}
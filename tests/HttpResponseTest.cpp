@@ -3,6 +3,7 @@
 //
 
 #include <gtest/gtest.h>
+#include <sstream>
 #include <frnetlib/HttpResponse.h>
 
 TEST(HttpResponseTest, response_parse_v1)
@@ -204,6 +205,80 @@ TEST(HttpResponseTest, body_length_test)
     ASSERT_EQ(response.parse(buff.c_str(), buff.size()), fr::Socket::Status::HttpBodyTooBig);
 }
 
+TEST(HttpResponseTest, excess_data_test)
+{
+    //Whatever follows the end of a response is kept aside, rather than being lost or added to the body
+    const std::string next = "HTTP/1.1 200 OK\r\n";
+    const std::string raw_responses[] = {
+            "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello" + next,
+            "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n" + next,
+            "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nhello\r\n0\r\n\r\n" + next
+    };
+    for(auto &raw_response : raw_responses)
+    {
+        fr::HttpResponse response;
+        ASSERT_EQ(response.parse(raw_response.c_str(), raw_response.size()), fr::Socket::Status::Success);
+        ASSERT_EQ(response.get_excess_data(), next);
+        ASSERT_TRUE(response.get_body().empty() || response.get_body() == "hello");
+        ASSERT_TRUE(response.is_length_delimited());
+    }
+
+    //Without a length, the body runs until the connection closes
+    const std::string unterminated = "HTTP/1.1 200 OK\r\n\r\nhello";
+    fr::HttpResponse response;
+    ASSERT_EQ(response.parse(unterminated.c_str(), unterminated.size()), fr::Socket::Status::Success);
+    ASSERT_FALSE(response.is_length_delimited());
+}
+
+TEST(HttpResponseTest, body_sink_test)
+{
+    //Bodies bigger than MAX_HTTP_BODY_SIZE can be streamed, without being stored
+    std::string streamed;
+    size_t streamed_size = 0;
+    fr::HttpResponse response;
+    response.set_body_sink([&](const char *data, size_t size) {
+        streamed_size += size;
+        return true;
+    });
+    const std::string header = "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(MAX_HTTP_BODY_SIZE * 2) + "\r\n\r\n";
+    ASSERT_EQ(response.parse(header.c_str(), header.size()), fr::Socket::Status::NotEnoughData);
+    const std::string piece(RECV_CHUNK_SIZE, 'a');
+    for(size_t a = 0; a < MAX_HTTP_BODY_SIZE * 2 / RECV_CHUNK_SIZE - 1; ++a)
+        ASSERT_EQ(response.parse(piece.c_str(), piece.size()), fr::Socket::Status::NotEnoughData);
+    ASSERT_EQ(response.parse(piece.c_str(), piece.size()), fr::Socket::Status::Success);
+    ASSERT_EQ(streamed_size, MAX_HTTP_BODY_SIZE * 2);
+    ASSERT_TRUE(response.get_body().empty());
+
+    //Chunks are de-chunked before being passed on, even when they arrive a byte at a time
+    const std::string raw_response =
+            "HTTP/1.1 200 OK\r\n"
+            "Transfer-Encoding: chunked\r\n"
+            "\r\n"
+            "7\r\n"
+            "Mozilla\r\n"
+            "9;extension=1\r\n"
+            "Developer\r\n"
+            "0\r\n"
+            "\r\n";
+    response = {};
+    response.set_body_sink([&](const char *data, size_t size) {
+        streamed.append(data, size);
+        return true;
+    });
+    for(size_t a = 0; a < raw_response.size() - 1; ++a)
+        ASSERT_EQ(response.parse(&raw_response[a], 1), fr::Socket::Status::NotEnoughData);
+    ASSERT_EQ(response.parse(&raw_response.back(), 1), fr::Socket::Status::Success);
+    ASSERT_EQ(streamed, "MozillaDeveloper");
+    ASSERT_TRUE(response.get_body().empty());
+
+    //The sink can stop the parse
+    response = {};
+    response.set_body_sink([&](const char *data, size_t size) {
+        return false;
+    });
+    ASSERT_EQ(response.parse(raw_response.c_str(), raw_response.size()), fr::Socket::Status::Error);
+}
+
 TEST(HttpResponseTest, HttpResponseConstruction)
 {
     {
@@ -231,4 +306,128 @@ TEST(HttpResponseTest, HttpResponseConstruction)
         ASSERT_EQ(response.get_version(), fr::Http::RequestVersion::V1);
     }
 
-}
\ No newline at end of file
+}
+#ifdef USE_ZLIB
+#include <zlib.h>
+
+static std::string compress_body(const std::string &input, int window_bits)
+{
+    z_stream stream{};
+    deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY);
+    std::string out(deflateBound(&stream, input.size()), '\0');
+    stream.next_in = (Bytef*)input.data();
+    stream.avail_in = (uInt)input.size();
+    stream.next_out = (Bytef*)&out[0];
+    stream.avail_out = (uInt)out.size();
+    deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return out;
+}
+
+TEST(HttpResponseTest, parse_gzip_response_test)
+{
+    const std::string response_body = "MozillaDeveloperNetwork MozillaDeveloperNetwork MozillaDeveloperNetwork";
+    const std::string encoded = compress_body(response_body, MAX_WBITS + 16);
+    const std::string raw_response =
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Type: text/plain\r\n"
+            "Content-Encoding: gzip\r\n"
+            "Content-Length: " + std::to_string(encoded.size()) + "\r\n"
+            "\r\n" + encoded;
+
+    //Without decoding, the body should be stored verbatim
+    fr::HttpResponse test;
+    ASSERT_EQ(test.parse(raw_response.c_str(), raw_response.size()), fr::Socket::Status::Success);
+    ASSERT_EQ(test.get_body(), encoded);
+
+    //Now decode it, a byte at a time to test that it's incremental
+    test = {};
+    test.set_content_decoding(true);
+    for(size_t a = 0; a < raw_response.size() - 1; ++a)
+    {
+        ASSERT_EQ(test.parse(&raw_response[a], 1), fr::Socket::Status::NotEnoughData);
+    }
+    ASSERT_EQ(test.parse(&raw_response.back(), 1), fr::Socket::Status::Success);
+    ASSERT_EQ(test.get_body(), response_body);
+    ASSERT_FALSE(test.header_exists("content-encoding"));
+    ASSERT_FALSE(test.header_exists("content-length"));
+    ASSERT_TRUE(test.is_length_delimited());
+}
+
+TEST(HttpResponseTest, parse_chunked_deflate_response_test)
+{
+    const std::string response_body(100000, 'a');
+    const std::string encoded = compress_body(response_body, MAX_WBITS);
+    const size_t split = encoded.size() / 2;
+
+    std::stringstream chunk1, chunk2;
+    chunk1 << std::hex << split;
+    chunk2 << std::hex << encoded.size() - split;
+    const std::string raw_response =
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Encoding: deflate\r\n"
+            "Transfer-Encoding: chunked\r\n"
+            "\r\n" +
+            chunk1.str() + "\r\n" + encoded.substr(0, split) + "\r\n" +
+            chunk2.str() + "\r\n" + encoded.substr(split) + "\r\n"
+            "0\r\n"
+            "\r\n";
+
+    fr::HttpResponse test;
+    test.set_content_decoding(true);
+    ASSERT_EQ(test.parse(raw_response.c_str(), raw_response.size() - 10), fr::Socket::Status::NotEnoughData);
+    ASSERT_EQ(test.parse(raw_response.c_str() + raw_response.size() - 10, 10), fr::Socket::Status::Success);
+    ASSERT_EQ(test.get_body(), response_body);
+}
+
+TEST(HttpResponseTest, copy_while_decoding_test)
+{
+    const std::string response_body(10000, 'b');
+    const std::string encoded = compress_body(response_body, MAX_WBITS + 16);
+    const std::string raw_response =
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Encoding: gzip\r\n"
+            "Content-Length: " + std::to_string(encoded.size()) + "\r\n"
+            "\r\n" + encoded;
+    const size_t split = raw_response.size() - encoded.size() / 2;
+
+    //A copy taken partway through has its own decoder, so both can carry on from there
+    fr::HttpResponse test;
+    test.set_content_decoding(true);
+    ASSERT_EQ(test.parse(raw_response.c_str(), split), fr::Socket::Status::NotEnoughData);
+    fr::HttpResponse copy = test;
+    ASSERT_EQ(test.parse(raw_response.c_str() + split, raw_response.size() - split), fr::Socket::Status::Success);
+    ASSERT_EQ(copy.parse(raw_response.c_str() + split, raw_response.size() - split), fr::Socket::Status::Success);
+    ASSERT_EQ(test.get_body(), response_body);
+    ASSERT_EQ(copy.get_body(), response_body);
+}
+
+TEST(HttpResponseTest, gzip_bomb_test)
+{
+    const std::string encoded = compress_body(std::string(MAX_HTTP_BODY_SIZE + 1, '\0'), MAX_WBITS + 16);
+    const std::string raw_response =
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Encoding: gzip\r\n"
+            "Content-Length: " + std::to_string(encoded.size()) + "\r\n"
+            "\r\n" + encoded;
+
+    fr::HttpResponse test;
+    test.set_content_decoding(true);
+    ASSERT_EQ(test.parse(raw_response.c_str(), raw_response.size()), fr::Socket::Status::HttpBodyTooBig);
+}
+
+TEST(HttpResponseTest, corrupt_gzip_test)
+{
+    const std::string raw_response =
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Encoding: gzip\r\n"
+            "Content-Length: 12\r\n"
+            "\r\n"
+            "not gzipped!";
+
+    fr::HttpResponse test;
+    test.set_content_decoding(true);
+    ASSERT_EQ(test.parse(raw_response.c_str(), raw_response.size()), fr::Socket::Status::ParseError);
+}
+#endif
@@ -32,6 +32,9 @@ TEST(HttpTest, test_string_to_request_type)
             {fr::Http::RequestType::Unknown, "U"},
             {fr::Http::RequestType::Unknown, "dwaouidhwi"},
             {fr::Http::RequestType::Unknown, "get"},
+            {fr::Http::RequestType::Unknown, "ABC"},
+            {fr::Http::RequestType::Post, "POST / HTTP/1.1"},
+            {fr::Http::RequestType::Partial, "P"},
     };
 
     for(auto &str : strings)
@@ -44,12 +47,33 @@ TEST(HttpTest, test_url_encode)
 {
     std::string source = "1\"!£FEW$\"931-90%%+-&*0(du%a90dj09=_da.A~";
     ASSERT_EQ(fr::Http::url_encode(source), "1%22!%C2%A3FEW%24%22931-90%25%25%2B-%26*0(du%25a90dj09%3D_da.A~");
+
+    std::string encoded = "q=";
+    fr::Http::url_encode("a b/c", 5, encoded);
+    ASSERT_EQ(encoded, "q=a+b%2Fc");
+    ASSERT_EQ(fr::Http::url_decode(encoded), "q=a b/c");
 }
 
 TEST(HttpTest, test_url_decode)
 {
     std::string source = "1%22!%C2%A3FEW%24%22931-90%25%25%2B-%26*0(du%25a90dj09%3D_da.A~";
     ASSERT_EQ(fr::Http::url_decode(source), "1\"!£FEW$\"931-90%%+-&*0(du%a90dj09=_da.A~");
+
+    //Lowercase hex, spaces, and invalid or truncated escapes which are left as they are
+    std::string decoded = "prefix:";
+    ASSERT_TRUE(fr::Http::url_decode("%c2%a3+%7e", 10, decoded));
+    ASSERT_EQ(decoded, "prefix:£ ~");
+    decoded.clear();
+    ASSERT_FALSE(fr::Http::url_decode("a%zz%4", 6, decoded));
+    ASSERT_EQ(decoded, "a%zz%4");
+    ASSERT_EQ(fr::Http::url_decode("100%"), "100%");
+
+    std::string in_place = "a+b%3Dc%2";
+    ASSERT_FALSE(fr::Http::url_decode_in_place(in_place));
+    ASSERT_EQ(in_place, "a b=c%2");
+    in_place = "nothing_to_do";
+    ASSERT_TRUE(fr::Http::url_decode_in_place(in_place));
+    ASSERT_EQ(in_place, "nothing_to_do");
 }
 
 TEST(HttpTest, test_get_mimetype)
@@ -57,6 +81,11 @@ TEST(HttpTest, test_get_mimetype)
     ASSERT_EQ(fr::Http::get_mimetype(".html"), "text/html");
     ASSERT_EQ(fr::Http::get_mimetype("my_file.html"), "text/html");
     ASSERT_EQ(fr::Http::get_mimetype("file.some_random_type"), "application/octet-stream");
+    ASSERT_EQ(fr::Http::get_mimetype("photo.JPG"), "image/jpeg");
+    ASSERT_EQ(fr::Http::get_mimetype("archive.tar.gz"), fr::Http::get_mimetype("gz"));
+    ASSERT_EQ(fr::Http::get_mimetype("png"), "image/png");
+    ASSERT_EQ(fr::Http::get_mimetype("file.pn"), "application/octet-stream");
+    ASSERT_EQ(fr::Http::get_mimetype("file."), "application/octet-stream");
 }
 
 TEST(HttpTest, test_string_to_transfer_encoding)
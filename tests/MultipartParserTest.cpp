@@ -0,0 +1,158 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#include <gtest/gtest.h>
+#include <frnetlib/MultipartParser.h>
+#include <frnetlib/HttpRequest.h>
+
+namespace
+{
+    struct Part
+    {
+        fr::MultipartParser::Headers headers;
+        std::string data;
+        bool ended = false;
+    };
+
+    void collect(fr::MultipartParser &parser, std::vector<Part> &parts)
+    {
+        parser.on_part_begin([&](const fr::MultipartParser::Headers &headers) {
+            parts.emplace_back();
+            parts.back().headers = headers;
+        });
+        parser.on_part_data([&](const char *data, size_t size) {
+            parts.back().data.append(data, size);
+        });
+        parser.on_part_end([&]() {
+            parts.back().ended = true;
+        });
+    }
+
+    const std::string body =
+            "preamble, which is ignored\r\n"
+            "--AaB03x\r\n"
+            "Content-Disposition: form-data; name=\"field\"\r\n"
+            "\r\n"
+            "value\r\n"
+            "--AaB03x  \r\n"
+            "content-disposition: form-data; name=\"file\"; filename=\"a \\\"b\\\".txt\"\r\n"
+            "Content-Type:   text/plain  \r\n"
+            "\r\n"
+            "--AaB03 \r\n--AaB03\r\n--AaB03y\r\n"
+            "--AaB03x\r\n"
+            "\r\n"
+            "no headers\r\n"
+            "--AaB03x--\r\n"
+            "epilogue, which is also ignored";
+}
+
+TEST(MultipartParserTest, parse)
+{
+    //The result should be the same no matter how the body is split up
+    for(size_t chunk_size : {body.size(), (size_t)1, (size_t)7})
+    {
+        fr::MultipartParser parser("AaB03x");
+        std::vector<Part> parts;
+        collect(parser, parts);
+
+        //Everything after the closing boundary should be ignored
+        fr::Socket::Status status = fr::Socket::Status::NotEnoughData;
+        size_t finished_at = 0;
+        for(size_t a = 0; a < body.size(); a += chunk_size)
+        {
+            status = parser.parse(&body[a], std::min(chunk_size, body.size() - a));
+            if(status == fr::Socket::Status::NotEnoughData)
+                ASSERT_EQ(finished_at, 0);
+            else if(finished_at == 0)
+                finished_at = a + chunk_size;
+        }
+        ASSERT_EQ(status, fr::Socket::Status::Success);
+        ASSERT_GE(finished_at, body.find("--AaB03x--") + 10);
+        ASSERT_TRUE(parser.finished());
+
+        ASSERT_EQ(parts.size(), 3);
+        ASSERT_EQ(parts[0].headers.at("content-disposition"), "form-data; name=\"field\"");
+        ASSERT_EQ(parts[0].data, "value");
+        ASSERT_EQ(parts[1].headers.at("content-type"), "text/plain");
+        ASSERT_EQ(parts[1].data, "--AaB03 \r\n--AaB03\r\n--AaB03y");
+        ASSERT_TRUE(parts[2].headers.empty());
+        ASSERT_EQ(parts[2].data, "no headers");
+        for(auto &part : parts)
+            ASSERT_TRUE(part.ended);
+    }
+}
+
+TEST(MultipartParserTest, get_parameter)
+{
+    ASSERT_EQ(fr::MultipartParser::get_parameter("multipart/form-data; boundary=AaB03x", "boundary"), "AaB03x");
+    ASSERT_EQ(fr::MultipartParser::get_parameter("multipart/form-data;BOUNDARY = \"a;b\" ", "boundary"), "a;b");
+    ASSERT_EQ(fr::MultipartParser::get_parameter("form-data; name=\"file\"; filename=\"a \\\"b\\\".txt\"", "filename"), "a \"b\".txt");
+    ASSERT_EQ(fr::MultipartParser::get_parameter("form-data; filename=\"x\"", "name"), "");
+    ASSERT_EQ(fr::MultipartParser::get_parameter("form-data; name", "name"), "");
+    ASSERT_EQ(fr::MultipartParser::get_parameter("boundary=abc", "boundary"), "");
+}
+
+TEST(MultipartParserTest, malformed)
+{
+    //The body ends before the closing boundary
+    std::vector<Part> parts;
+    fr::MultipartParser unfinished("AaB03x");
+    collect(unfinished, parts);
+    ASSERT_EQ(unfinished.parse(body.data(), 90), fr::Socket::Status::NotEnoughData);
+    ASSERT_FALSE(unfinished.finished());
+    ASSERT_EQ(parts.size(), 1);
+    ASSERT_FALSE(parts.back().ended);
+
+    //Junk after a boundary
+    fr::MultipartParser junk("AaB03x");
+    ASSERT_EQ(junk.parse("--AaB03xjunk\r\n", 14), fr::Socket::Status::ParseError);
+
+    //Headers which never end
+    fr::MultipartParser endless("AaB03x");
+    std::string headers = "--AaB03x\r\n" + std::string(MAX_HTTP_HEADER_SIZE, 'h');
+    ASSERT_EQ(endless.parse(headers.data(), headers.size()), fr::Socket::Status::NotEnoughData);
+    ASSERT_EQ(endless.parse("hh", 2), fr::Socket::Status::HttpHeaderTooBig);
+
+    //No boundary
+    fr::MultipartParser empty;
+    ASSERT_EQ(empty.parse(body.data(), body.size()), fr::Socket::Status::ParseError);
+}
+
+TEST(MultipartParserTest, http_request)
+{
+    const std::string header =
+            "POST /upload HTTP/1.1\r\n"
+            "Content-Type: multipart/form-data; boundary=AaB03x\r\n"
+            "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n";
+    const std::string raw_request = header + body;
+
+    auto parser = std::make_shared<fr::MultipartParser>();
+    std::vector<Part> parts;
+    collect(*parser, parts);
+
+    fr::HttpRequest request;
+    request.set_multipart_parser(parser);
+    ASSERT_EQ(request.parse(raw_request.data(), header.size() + 100), fr::Socket::Status::NotEnoughData);
+    ASSERT_EQ(request.parse(raw_request.data() + header.size() + 100, body.size() - 110), fr::Socket::Status::NotEnoughData);
+    ASSERT_TRUE(parser->finished());
+    ASSERT_EQ(request.parse(raw_request.data() + raw_request.size() - 10, 10), fr::Socket::Status::Success);
+
+    ASSERT_EQ(parts.size(), 3);
+    ASSERT_EQ(parts[1].data, "--AaB03 \r\n--AaB03\r\n--AaB03y");
+    ASSERT_TRUE(request.get_body().empty());
+    ASSERT_EQ(request.get_uri(), "/upload");
+
+    //Running out of body before the closing boundary
+    fr::HttpRequest truncated;
+    truncated.set_multipart_parser(std::make_shared<fr::MultipartParser>());
+    std::string short_request = "POST / HTTP/1.1\r\nContent-Type: multipart/form-data; boundary=AaB03x\r\nContent-Length: 60\r\n\r\n" + body;
+    ASSERT_EQ(truncated.parse(short_request.data(), short_request.size()), fr::Socket::Status::ParseError);
+
+    //Other content types are unaffected
+    fr::HttpRequest form;
+    form.set_multipart_parser(parser);
+    std::string form_request = "POST / HTTP/1.1\r\nContent-Type: application/x-www-form-urlencoded\r\nContent-Length: 3\r\n\r\na=b";
+    ASSERT_EQ(form.parse(form_request.data(), form_request.size()), fr::Socket::Status::Success);
+    ASSERT_EQ(form.get_body(), "a=b");
+}
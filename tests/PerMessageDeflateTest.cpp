@@ -0,0 +1,194 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#ifdef USE_ZLIB
+#include <gtest/gtest.h>
+#include <thread>
+#include <frnetlib/PerMessageDeflate.h>
+#include <frnetlib/WebSocket.h>
+#include <frnetlib/TcpSocket.h>
+#include <frnetlib/TcpListener.h>
+
+namespace
+{
+    //Negotiates between a client and a server, returning the server's response
+    std::string negotiate(fr::PerMessageDeflate &client, fr::PerMessageDeflate &server)
+    {
+        std::string response;
+        EXPECT_TRUE(server.accept_offer(client.offer(), response));
+        EXPECT_TRUE(client.accept_response(response));
+        return response;
+    }
+}
+
+TEST(PerMessageDeflateTest, compress)
+{
+    fr::PerMessageDeflate client, server;
+    client.set_enabled(true);
+    server.set_enabled(true);
+    ASSERT_EQ(negotiate(client, server), "permessage-deflate");
+    ASSERT_TRUE(client.is_active());
+    ASSERT_TRUE(server.is_active());
+
+    //The examples from RFC 7692 section 7.2.3, where the second message refers back to the first
+    std::string first, second;
+    ASSERT_EQ(client.compress("Hello", 5, true, first), fr::Socket::Status::Success);
+    ASSERT_EQ(client.compress("Hello", 5, true, second), fr::Socket::Status::Success);
+    ASSERT_EQ(first, std::string("\xf2\x48\xcd\xc9\xc9\x07\x00", 7));
+    ASSERT_EQ(second, std::string("\xf2\x00\x11\x00\x00", 5));
+
+    std::string out;
+    ASSERT_EQ(server.decompress(first.data(), first.size(), true, out, 100), fr::Socket::Status::Success);
+    ASSERT_EQ(server.decompress(second.data(), second.size(), true, out, 100), fr::Socket::Status::Success);
+    ASSERT_EQ(out, "HelloHello");
+
+    //Without context takeover, each message stands alone
+    fr::PerMessageDeflate alone_client, alone_server;
+    alone_client.set_enabled(true);
+    alone_client.set_no_context_takeover(true);
+    alone_server.set_enabled(true);
+    ASSERT_EQ(negotiate(alone_client, alone_server), "permessage-deflate; client_no_context_takeover");
+    first.clear();
+    second.clear();
+    ASSERT_EQ(alone_client.compress("Hello", 5, true, first), fr::Socket::Status::Success);
+    ASSERT_EQ(alone_client.compress("Hello", 5, true, second), fr::Socket::Status::Success);
+    ASSERT_EQ(first, second);
+
+    //Decompression bombs are stopped at the limit
+    std::string bomb, inflated;
+    std::string zeros(1000000, '\0');
+    ASSERT_EQ(client.compress(zeros.data(), zeros.size(), true, bomb), fr::Socket::Status::Success);
+    ASSERT_LT(bomb.size(), 2000);
+    ASSERT_EQ(server.decompress(bomb.data(), bomb.size(), true, inflated, 500000), fr::Socket::Status::MaxPacketSizeExceeded);
+}
+
+TEST(PerMessageDeflateTest, negotiation)
+{
+    fr::PerMessageDeflate server;
+    std::string response;
+
+    //Nothing's accepted unless it's enabled
+    ASSERT_FALSE(server.accept_offer("permessage-deflate", response));
+    server.set_enabled(true);
+
+    //Offers with unknown, repeated or invalid parameters are skipped, in favour of later ones
+    ASSERT_TRUE(server.accept_offer("x-webkit-deflate-frame, permessage-deflate; unknown, permessage-deflate; client_max_window_bits; client_max_window_bits, "
+                                    "permessage-deflate; server_max_window_bits=8, permessage-deflate; server_max_window_bits=\"10\"; client_max_window_bits", response));
+    ASSERT_EQ(response, "permessage-deflate; server_max_window_bits=10");
+    ASSERT_FALSE(server.accept_offer("permessage-deflate; server_max_window_bits=16", response));
+    ASSERT_FALSE(server.is_active());
+
+    //The client's window can only be limited if it says it supports it
+    server.set_peer_max_window_bits(12);
+    server.set_peer_no_context_takeover(true);
+    ASSERT_TRUE(server.accept_offer("permessage-deflate; server_no_context_takeover", response));
+    ASSERT_EQ(response, "permessage-deflate; server_no_context_takeover; client_no_context_takeover");
+    ASSERT_TRUE(server.accept_offer("permessage-deflate; client_max_window_bits=14", response));
+    ASSERT_EQ(response, "permessage-deflate; client_no_context_takeover; client_max_window_bits=12");
+
+    //Clients check that the response is something that they offered
+    fr::PerMessageDeflate client;
+    client.set_enabled(true);
+    client.set_peer_max_window_bits(11);
+    ASSERT_EQ(client.offer(), "permessage-deflate; client_max_window_bits; server_max_window_bits=11");
+    ASSERT_FALSE(client.accept_response("permessage-deflate; server_max_window_bits=12"));
+    ASSERT_FALSE(client.accept_response("permessage-deflate; client_max_window_bits=8"));
+    ASSERT_FALSE(client.accept_response("permessage-deflate; unknown"));
+    ASSERT_FALSE(client.accept_response("permessage-deflate, permessage-deflate"));
+    ASSERT_FALSE(client.accept_response("x-webkit-deflate-frame"));
+    ASSERT_TRUE(client.accept_response("permessage-deflate; server_max_window_bits=10; client_max_window_bits=9"));
+    ASSERT_TRUE(client.is_active());
+}
+
+TEST(PerMessageDeflateTest, memory_limit)
+{
+    fr::PerMessageDeflate client, server;
+    client.set_enabled(true);
+    server.set_enabled(true);
+    negotiate(client, server);
+    ASSERT_GT(server.get_memory_usage(), 256 * 1024);
+
+    //The windows and memory level shrink to fit the limit
+    client.set_memory_limit(64 * 1024);
+    server.set_memory_limit(48 * 1024);
+    std::string response = negotiate(client, server);
+    ASSERT_NE(response.find("server_max_window_bits"), std::string::npos);
+    ASSERT_LE(client.get_memory_usage(), 64 * 1024);
+    ASSERT_LE(server.get_memory_usage(), 48 * 1024);
+
+    //They still work together
+    std::string message(100000, 'a'), compressed, out;
+    ASSERT_EQ(server.compress(message.data(), message.size(), true, compressed), fr::Socket::Status::Success);
+    ASSERT_EQ(client.decompress(compressed.data(), compressed.size(), true, out, message.size()), fr::Socket::Status::Success);
+    ASSERT_EQ(out, message);
+
+    //And compression's declined if it can't fit at all
+    server.set_memory_limit(1024);
+    ASSERT_FALSE(server.accept_offer(client.offer(), response));
+}
+
+TEST(PerMessageDeflateTest, websocket)
+{
+    fr::TcpListener listener;
+    ASSERT_EQ(listener.listen("9121"), fr::Socket::Status::Success);
+
+    std::string payload;
+    for(size_t a = 0; payload.size() < 200000; ++a)
+        payload += "{\"symbol\":\"FRN\",\"price\":" + std::to_string(100 + a % 37) + ",\"volume\":" + std::to_string(a % 1000) + "}\n";
+
+    std::thread client_thread([&]() {
+        fr::WebSocket<fr::TcpSocket> socket;
+        socket.get_compression().set_enabled(true);
+        ASSERT_EQ(socket.connect("127.0.0.1", "9121", {}), fr::Socket::Status::Success);
+        ASSERT_TRUE(socket.get_compression().is_active());
+
+        fr::ClientWebSocketMessage message;
+        message.set_payload(payload);
+        message.set_fragment_size(50000);
+        ASSERT_EQ(socket.send(message), fr::Socket::Status::Success);
+        ASSERT_EQ(socket.send(message), fr::Socket::Status::Success);
+
+        //Messages below the minimum size go as they are
+        socket.get_compression().set_min_size(100);
+        message.set_payload("small");
+        ASSERT_EQ(socket.send(message), fr::Socket::Status::Success);
+
+        fr::ClientWebSocketMessage reply;
+        ASSERT_EQ(socket.receive(reply), fr::Socket::Status::Success);
+        ASSERT_EQ(reply.get_payload(), payload);
+    });
+
+    fr::WebSocket<fr::TcpSocket> socket;
+    socket.get_compression().set_enabled(true);
+    ASSERT_EQ(listener.accept(socket), fr::Socket::Status::Success);
+    ASSERT_TRUE(socket.get_compression().is_active());
+
+    //On the wire, the first message is a fraction of the size, with RSV1 set on its first frame
+    size_t wire_size = 0;
+    std::string decompressed;
+    for(bool first = true;; first = false)
+    {
+        fr::ServerWebFrame frame;
+        ASSERT_EQ(socket.receive(frame), fr::Socket::Status::Success);
+        ASSERT_EQ(frame.is_compressed(), first);
+        wire_size += frame.get_payload().size();
+        ASSERT_EQ(socket.get_compression().decompress(frame.get_payload().data(), frame.get_payload().size(), frame.is_final(), decompressed, payload.size()), fr::Socket::Status::Success);
+        if(frame.is_final())
+            break;
+    }
+    ASSERT_EQ(decompressed, payload);
+    ASSERT_LT(wire_size, payload.size() / 8);
+
+    //The rest are decompressed by the socket
+    fr::ServerWebSocketMessage message;
+    ASSERT_EQ(socket.receive(message), fr::Socket::Status::Success);
+    ASSERT_EQ(message.get_payload(), payload);
+    ASSERT_EQ(socket.receive(message), fr::Socket::Status::Success);
+    ASSERT_EQ(message.get_payload(), "small");
+
+    message.set_payload(payload);
+    ASSERT_EQ(socket.send(message), fr::Socket::Status::Success);
+    client_thread.join();
+}
+#endif
@@ -0,0 +1,152 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#ifndef _WIN32
+#include <gtest/gtest.h>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <cstdio>
+#include <cinttypes>
+#include <frnetlib/TcpListener.h>
+#include <frnetlib/TcpSocket.h>
+#include <frnetlib/RangeDownloader.h>
+
+namespace
+{
+    //Serves a 300KB object, over as many connections as are made, until 'stop' is set. '/norange' ignores
+    //range headers, '/changing' acts as if the object changes after the first request, and the first request
+    //for the range starting at 'drop_offset' has the connection dropped half way through.
+    class RangeServer
+    {
+    public:
+        explicit RangeServer(const std::string &port, uint64_t drop_offset_ = 0)
+        : drop_offset(drop_offset_)
+        {
+            for(size_t a = 0; a < 300000; ++a)
+                object += (char)(a % 251);
+            if(listener.listen(port) != fr::Socket::Status::Success)
+                throw std::runtime_error("Failed to listen");
+            acceptor = std::thread([this, port]() {
+                while(true)
+                {
+                    auto client = std::make_shared<fr::TcpSocket>();
+                    if(listener.accept(*client) != fr::Socket::Status::Success || stop)
+                        break;
+                    handlers.emplace_back([this, client]() {
+                        handle(*client);
+                    });
+                }
+            });
+            this->port = port;
+        }
+
+        ~RangeServer()
+        {
+            //Wake up the acceptor
+            stop = true;
+            fr::TcpSocket waker;
+            waker.connect("127.0.0.1", port, {});
+            acceptor.join();
+            for(auto &handler : handlers)
+                handler.join();
+        }
+
+        std::string object;
+        std::vector<std::string> ranges;
+        std::mutex mutex;
+
+    private:
+        void handle(fr::TcpSocket &client)
+        {
+            fr::HttpRequest request;
+            while(client.receive(request) == fr::Socket::Status::Success)
+            {
+                fr::HttpResponse response;
+                response.header("etag") = "\"v1\"";
+                response.set_body(object);
+
+                uint64_t first = 0, last = 0;
+                std::string range = request.header("range");
+                bool changed = request.get_uri() == "/changing" && request.header("if-range") == "\"v1\"";
+                if(request.get_uri() != "/norange" && !changed && sscanf(range.c_str(), "bytes=%" SCNu64 "-%" SCNu64 "", &first, &last) == 2)
+                {
+                    std::lock_guard<std::mutex> guard(mutex);
+                    ranges.emplace_back(range);
+                    response.set_status(fr::Http::RequestStatus::PartialContent);
+                    response.header("content-range") = "bytes " + std::to_string(first) + "-" + std::to_string(last) + "/" + std::to_string(object.size());
+                    response.set_body(object.substr(first, last - first + 1));
+                }
+
+                std::string data = response.construct("");
+                if(drop_offset != 0 && first == drop_offset)
+                {
+                    drop_offset = 0;
+                    size_t sent = 0;
+                    client.send_raw(data.data(), data.size() - response.get_body().size() / 2, sent);
+                    return;
+                }
+                size_t sent = 0;
+                if(client.send_raw(data.data(), data.size(), sent) != fr::Socket::Status::Success)
+                    return;
+                request = {};
+            }
+        }
+
+        fr::TcpListener listener;
+        std::string port;
+        std::atomic<bool> stop{false};
+        std::atomic<uint64_t> drop_offset;
+        std::thread acceptor;
+        std::vector<std::thread> handlers;
+    };
+
+    std::string read_file(FILE *file)
+    {
+        std::string contents(1000000, '\0');
+        contents.resize(pread(fileno(file), &contents[0], contents.size(), 0));
+        return contents;
+    }
+}
+
+TEST(RangeDownloaderTest, segmented_download)
+{
+    //The third segment's connection gets dropped, so it should be resumed from where it got to
+    RangeServer server("9106", 1 + 299999 / 2);
+    std::unique_ptr<FILE, decltype(&fclose)> file(tmpfile(), &fclose);
+    {
+        fr::HttpClient client;
+        fr::RangeDownloader downloader(client);
+        ASSERT_EQ(downloader.download(fr::URL("http://127.0.0.1:9106/object"), fileno(file.get())), fr::Socket::Status::Success);
+    }
+    ASSERT_EQ(read_file(file.get()), server.object);
+
+    std::sort(server.ranges.begin(), server.ranges.end());
+    ASSERT_EQ(server.ranges.size(), 6);
+    ASSERT_EQ(server.ranges[0], "bytes=0-0");
+    ASSERT_EQ(server.ranges[1], "bytes=1-74999");
+    ASSERT_EQ(server.ranges[4], "bytes=225000-299999");
+    ASSERT_EQ(server.ranges[2].compare(0, 13, "bytes=150000-"), 0);
+    ASSERT_GT(server.ranges[3].compare(0, 13, "bytes=150000-"), 0);
+}
+
+TEST(RangeDownloaderTest, unsupported)
+{
+    RangeServer server("9107");
+    std::unique_ptr<FILE, decltype(&fclose)> file(tmpfile(), &fclose);
+    {
+        //Servers without range support send the whole object at once
+        fr::HttpClient client;
+        fr::RangeDownloader downloader(client);
+        ASSERT_EQ(fwrite("old contents, which are longer", 1, 30, file.get()), 30);
+        fflush(file.get());
+        ASSERT_EQ(downloader.download(fr::URL("http://127.0.0.1:9107/norange"), fileno(file.get())), fr::Socket::Status::Success);
+        ASSERT_EQ(read_file(file.get()), server.object);
+
+        //Objects which change mid-download are given up on
+        ASSERT_EQ(downloader.download(fr::URL("http://127.0.0.1:9107/changing"), fileno(file.get())), fr::Socket::Status::Error);
+        ASSERT_THROW(downloader.set_segment_count(0), std::logic_error);
+    }
+}
+#endif
@@ -0,0 +1,319 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#ifndef _WIN32
+#include <gtest/gtest.h>
+#include <thread>
+#include <atomic>
+#include <future>
+#include <map>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <frnetlib/Resolver.h>
+#include <frnetlib/TcpListener.h>
+#include <frnetlib/TcpSocket.h>
+
+namespace
+{
+    //A DNS server on 127.0.0.1, which knows about a few names under '.test', and counts the queries for each.
+    //A failing server answers everything with SERVFAIL.
+    class StubDnsServer
+    {
+    public:
+        explicit StubDnsServer(uint16_t port, bool failing = false)
+        : failing(failing)
+        {
+            descriptor = ::socket(AF_INET, SOCK_DGRAM, 0);
+            sockaddr_in address = {};
+            address.sin_family = AF_INET;
+            address.sin_port = htons(port);
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            if(::bind(descriptor, (sockaddr*)&address, sizeof(address)) != 0)
+                throw std::runtime_error("Failed to bind stub DNS server");
+            thread = std::thread(&StubDnsServer::run, this);
+        }
+
+        ~StubDnsServer()
+        {
+            stop = true;
+            thread.join();
+            ::close(descriptor);
+        }
+
+        size_t get_queries(const std::string &name)
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            return queries[name];
+        }
+
+    private:
+        void run()
+        {
+            while(!stop)
+            {
+                timeval tv = {0, 10000};
+                fd_set set;
+                FD_ZERO(&set);
+                FD_SET(descriptor, &set);
+                if(select(descriptor + 1, &set, nullptr, nullptr, &tv) <= 0)
+                    continue;
+
+                char query[512];
+                sockaddr_storage from = {};
+                socklen_t from_length = sizeof(from);
+                auto size = recvfrom(descriptor, query, sizeof(query), 0, (sockaddr*)&from, &from_length);
+                if(size < 12)
+                    continue;
+
+                //Read the name out of the question
+                std::string name;
+                size_t pos = 12;
+                while(pos < (size_t)size && query[pos] != 0)
+                {
+                    if(!name.empty())
+                        name += '.';
+                    name.append(query + pos + 1, (size_t)query[pos]);
+                    pos += query[pos] + 1;
+                }
+                uint16_t type = (uint16_t)(((uint8_t)query[pos + 1] << 8) | (uint8_t)query[pos + 2]);
+                std::string response(query, pos + 5);
+                {
+                    std::lock_guard<std::mutex> guard(mutex);
+                    ++queries[name];
+                }
+                if(name == "silent.test")
+                    continue;
+
+                response[2] = (char)(name == "truncated.test" ? 0x83 : 0x81);
+                response[3] = (char)(failing ? 0x82 : name == "missing.test" ? 0x83 : 0x80);
+                uint16_t answers = 0;
+                uint16_t owner = 0xC00C; //A pointer to the name in the question
+                if(name == "alias.test")
+                {
+                    //Points to example.test, which has a shorter TTL
+                    add_record(response, owner, 5, 300, std::string("\x07" "example" "\x04" "test", 13) + '\0');
+                    owner = (uint16_t)(0xC000 | (response.size() - 14));
+                    ++answers;
+                }
+                if(name == "example.test" || name == "alias.test")
+                {
+                    if(type == 1)
+                    {
+                        add_record(response, owner, 1, 1, std::string("\x0A\x00\x00\x01", 4));
+                        add_record(response, owner, 1, 1, std::string("\x0A\x00\x00\x02", 4));
+                        answers += 2;
+                    }
+                    else if(type == 28)
+                    {
+                        add_record(response, owner, 28, 1, std::string(15, '\0') + '\x01');
+                        answers += 1;
+                    }
+                }
+                response[6] = (char)(answers >> 8);
+                response[7] = (char)answers;
+                sendto(descriptor, response.data(), response.size(), 0, (sockaddr*)&from, from_length);
+            }
+        }
+
+        static void add_record(std::string &response, uint16_t owner, uint16_t type, uint32_t ttl, const std::string &data)
+        {
+            char header[12] = {(char)(owner >> 8), (char)owner, (char)(type >> 8), (char)type, 0, 1,
+                               (char)(ttl >> 24), (char)(ttl >> 16), (char)(ttl >> 8), (char)ttl,
+                               (char)(data.size() >> 8), (char)data.size()};
+            response.append(header, sizeof(header));
+            response += data;
+        }
+
+        int descriptor;
+        bool failing;
+        std::atomic<bool> stop{false};
+        std::thread thread;
+        std::mutex mutex;
+        std::map<std::string, size_t> queries;
+    };
+
+    std::vector<std::string> to_strings(const std::vector<fr::Address> &addresses)
+    {
+        std::vector<std::string> strings;
+        for(auto &address : addresses)
+            strings.emplace_back(address.to_string());
+        return strings;
+    }
+
+    std::shared_ptr<fr::Resolver> make_resolver(uint16_t port)
+    {
+        fr::Address nameserver;
+        fr::Address::parse("127.0.0.1", nameserver);
+        nameserver.set_port(port);
+        auto resolver = std::make_shared<fr::Resolver>();
+        resolver->set_nameservers({nameserver});
+        resolver->set_search_domains({});
+        return resolver;
+    }
+}
+
+TEST(ResolverTest, address)
+{
+    fr::Address address;
+    ASSERT_EQ(address.get_family(), AF_UNSPEC);
+    ASSERT_TRUE(fr::Address::parse("127.0.0.1", address));
+    ASSERT_EQ(address.get_family(), AF_INET);
+    address.set_port(80);
+    ASSERT_EQ(address.get_port(), 80);
+    ASSERT_EQ(address.to_string(), "127.0.0.1");
+    ASSERT_TRUE(fr::Address::parse("::1", address));
+    ASSERT_EQ(address.get_family(), AF_INET6);
+    ASSERT_EQ(address.to_string(), "::1");
+    ASSERT_FALSE(fr::Address::parse("localhost", address));
+}
+
+TEST(ResolverTest, resolve)
+{
+    StubDnsServer server(9108);
+    auto resolver = make_resolver(9108);
+    std::vector<fr::Address> addresses;
+
+    //Both types of address are asked for, and cached for as long as their TTL
+    ASSERT_EQ(resolver->resolve("example.test", addresses), fr::Socket::Status::Success);
+    ASSERT_EQ(to_strings(addresses), std::vector<std::string>({"::1", "10.0.0.1", "10.0.0.2"}));
+    ASSERT_EQ(server.get_queries("example.test"), 2);
+    ASSERT_EQ(resolver->resolve("EXAMPLE.test.", addresses), fr::Socket::Status::Success);
+    ASSERT_EQ(addresses.size(), 3);
+    ASSERT_EQ(server.get_queries("example.test"), 2);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    ASSERT_EQ(resolver->resolve("example.test", addresses), fr::Socket::Status::Success);
+    ASSERT_EQ(server.get_queries("example.test"), 4);
+
+    //Only one type of address
+    ASSERT_EQ(resolver->resolve("example.test", addresses, AF_INET), fr::Socket::Status::Success);
+    ASSERT_EQ(to_strings(addresses), std::vector<std::string>({"10.0.0.1", "10.0.0.2"}));
+    ASSERT_EQ(server.get_queries("example.test"), 5);
+
+    //Following a CNAME, with compressed names
+    ASSERT_EQ(resolver->resolve("alias.test", addresses, AF_INET6), fr::Socket::Status::Success);
+    ASSERT_EQ(to_strings(addresses), std::vector<std::string>({"::1"}));
+
+    //Failures
+    resolver->set_timeout(std::chrono::milliseconds(50));
+    ASSERT_EQ(resolver->resolve("missing.test", addresses), fr::Socket::Status::AddressLookupFailure);
+    ASSERT_EQ(resolver->resolve("silent.test", addresses), fr::Socket::Status::Timeout);
+    ASSERT_EQ(server.get_queries("silent.test"), 4);
+    ASSERT_EQ(resolver->resolve("bad..name", addresses), fr::Socket::Status::AddressLookupFailure);
+
+    //Numeric addresses are passed straight through
+    ASSERT_EQ(resolver->resolve("192.168.0.1", addresses), fr::Socket::Status::Success);
+    ASSERT_EQ(to_strings(addresses), std::vector<std::string>({"192.168.0.1"}));
+    ASSERT_EQ(resolver->resolve("192.168.0.1", addresses, AF_INET6), fr::Socket::Status::AddressLookupFailure);
+}
+
+TEST(ResolverTest, server_failures)
+{
+    StubDnsServer failing_server(9128, true);
+    StubDnsServer server(9129);
+    auto resolver = make_resolver(9128);
+    fr::Address failing_nameserver, nameserver;
+    fr::Address::parse("127.0.0.1", failing_nameserver);
+    failing_nameserver.set_port(9128);
+    fr::Address::parse("127.0.0.1", nameserver);
+    nameserver.set_port(9129);
+    resolver->set_nameservers({failing_nameserver, nameserver});
+    std::vector<fr::Address> addresses;
+
+    //SERVFAIL moves on to the next nameserver, rather than ending the lookup
+    ASSERT_EQ(resolver->resolve("example.test", addresses, AF_INET), fr::Socket::Status::Success);
+    ASSERT_EQ(to_strings(addresses), std::vector<std::string>({"10.0.0.1", "10.0.0.2"}));
+    ASSERT_EQ(failing_server.get_queries("example.test"), 1);
+    ASSERT_EQ(server.get_queries("example.test"), 1);
+
+    //A truncated answer is left to the system's resolver, and isn't cached as if it were complete
+    resolver->set_nameservers({nameserver});
+    ASSERT_NE(resolver->resolve("truncated.test", addresses), fr::Socket::Status::Success);
+    ASSERT_NE(resolver->resolve("truncated.test", addresses), fr::Socket::Status::Success);
+    ASSERT_EQ(server.get_queries("truncated.test"), 4);
+}
+
+TEST(ResolverTest, search_domains)
+{
+    StubDnsServer server(9130);
+    auto resolver = make_resolver(9130);
+    std::vector<fr::Address> addresses;
+
+    //Names with fewer dots than ndots have the search domains tried first
+    resolver->set_search_domains({"TEST."});
+    ASSERT_EQ(resolver->resolve("example", addresses, AF_INET), fr::Socket::Status::Success);
+    ASSERT_EQ(to_strings(addresses), std::vector<std::string>({"10.0.0.1", "10.0.0.2"}));
+    ASSERT_EQ(server.get_queries("example.test"), 1);
+
+    //Absolute names are never searched
+    ASSERT_EQ(resolver->resolve("alias.", addresses, AF_INET), fr::Socket::Status::AddressLookupFailure);
+    ASSERT_EQ(server.get_queries("alias"), 1);
+    ASSERT_EQ(server.get_queries("alias.test"), 0);
+
+    //Names with enough dots are tried as they are first, then with the search domains
+    resolver->set_search_domains({"test"}, 2);
+    ASSERT_EQ(resolver->resolve("alias.test", addresses, AF_INET6), fr::Socket::Status::Success);
+    ASSERT_EQ(server.get_queries("alias.test.test"), 1);
+    ASSERT_EQ(server.get_queries("alias.test"), 1);
+    resolver->set_search_domains({"test"}, 1);
+    ASSERT_EQ(resolver->resolve("missing.test", addresses, AF_INET6), fr::Socket::Status::AddressLookupFailure);
+    ASSERT_EQ(server.get_queries("missing.test"), 1);
+    ASSERT_EQ(server.get_queries("missing.test.test"), 1);
+}
+
+TEST(ResolverTest, cache_size)
+{
+    StubDnsServer server(9110);
+    auto resolver = make_resolver(9110);
+    std::vector<fr::Address> addresses;
+
+    //With room for one host, the least recently used is dropped
+    resolver->set_cache_size(1);
+    ASSERT_EQ(resolver->resolve("example.test", addresses, AF_INET), fr::Socket::Status::Success);
+    ASSERT_EQ(resolver->resolve("alias.test", addresses, AF_INET), fr::Socket::Status::Success);
+    ASSERT_EQ(resolver->resolve("alias.test", addresses, AF_INET), fr::Socket::Status::Success);
+    ASSERT_EQ(resolver->resolve("example.test", addresses, AF_INET), fr::Socket::Status::Success);
+    ASSERT_EQ(server.get_queries("example.test"), 2);
+    ASSERT_EQ(server.get_queries("alias.test"), 1);
+
+    resolver->clear_cache();
+    ASSERT_EQ(resolver->resolve("example.test", addresses, AF_INET), fr::Socket::Status::Success);
+    ASSERT_EQ(server.get_queries("example.test"), 3);
+}
+
+TEST(ResolverTest, resolve_async)
+{
+    StubDnsServer server(9111);
+    auto resolver = make_resolver(9111);
+
+    std::promise<std::vector<std::string>> result;
+    resolver->resolve_async("example.test", [&](fr::Socket::Status status, const std::vector<fr::Address> &addresses) {
+        EXPECT_EQ(status, fr::Socket::Status::Success);
+        result.set_value(to_strings(addresses));
+    }, AF_INET);
+    auto future = result.get_future();
+    ASSERT_EQ(future.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    ASSERT_EQ(future.get(), std::vector<std::string>({"10.0.0.1", "10.0.0.2"}));
+}
+
+TEST(ResolverTest, connect_resolved)
+{
+    fr::TcpListener listener;
+    ASSERT_EQ(listener.listen("9109"), fr::Socket::Status::Success);
+    std::thread server([&]() {
+        fr::TcpSocket client;
+        listener.accept(client);
+    });
+
+    //Addresses which don't work are skipped over
+    fr::Address unroutable, loopback;
+    ASSERT_TRUE(fr::Address::parse("ff02::1", unroutable));
+    ASSERT_TRUE(fr::Address::parse("127.0.0.1", loopback));
+    fr::TcpSocket socket;
+    ASSERT_EQ(socket.connect("some.host", {unroutable, loopback}, "9109", {}), fr::Socket::Status::Success);
+    ASSERT_EQ(socket.get_remote_address(), "some.host:9109");
+    server.join();
+
+    ASSERT_EQ(socket.connect("some.host", {loopback}, "http", {}), fr::Socket::Status::AddressLookupFailure);
+}
+#endif
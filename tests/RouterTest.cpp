@@ -0,0 +1,116 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#include <gtest/gtest.h>
+#include <frnetlib/Router.h>
+
+TEST(RouterTest, static_routes)
+{
+    fr::Router<int> router;
+    router.add(fr::Http::RequestType::Get, "/", 1);
+    router.add(fr::Http::RequestType::Get, "/users", 2);
+    router.add(fr::Http::RequestType::Get, "/user", 3);
+    router.add(fr::Http::RequestType::Get, "/users/list", 4);
+    router.add(fr::Http::RequestType::Post, "/users", 5);
+    router.add(fr::Http::RequestType::Get, "/about", 6);
+
+    fr::Router<int>::Match match;
+    ASSERT_EQ(*router.match(fr::Http::RequestType::Get, "/", match), 1);
+    ASSERT_EQ(*router.match(fr::Http::RequestType::Get, "/users", match), 2);
+    ASSERT_EQ(*router.match(fr::Http::RequestType::Get, "/user", match), 3);
+    ASSERT_EQ(*router.match(fr::Http::RequestType::Get, "/users/list", match), 4);
+    ASSERT_EQ(*router.match(fr::Http::RequestType::Post, "/users", match), 5);
+    ASSERT_EQ(*router.match(fr::Http::RequestType::Get, "/about", match), 6);
+    ASSERT_EQ(match.size(), 0);
+
+    ASSERT_EQ(router.match(fr::Http::RequestType::Get, "/users/", match), nullptr);
+    ASSERT_FALSE(match.is_method_not_allowed());
+    ASSERT_EQ(router.match(fr::Http::RequestType::Get, "/use", match), nullptr);
+    ASSERT_EQ(router.match(fr::Http::RequestType::Get, "/nope", match), nullptr);
+    ASSERT_EQ(router.match(fr::Http::RequestType::Delete, "/users", match), nullptr);
+    ASSERT_TRUE(match.is_method_not_allowed());
+}
+
+TEST(RouterTest, parameter_routes)
+{
+    fr::Router<int> router;
+    router.add(fr::Http::RequestType::Get, "/users/:id", 1);
+    router.add(fr::Http::RequestType::Get, "/users/new", 2);
+    router.add(fr::Http::RequestType::Get, "/users/:id/posts/:post", 3);
+    router.add(fr::Http::RequestType::Get, "/static/*path", 4);
+
+    //Parameters point into the URI, so it must outlive the match
+    fr::Router<int>::Match match;
+    std::string uri;
+    ASSERT_EQ(*router.match(fr::Http::RequestType::Get, uri = "/users/new", match), 2);
+    ASSERT_EQ(match.size(), 0);
+
+    ASSERT_EQ(*router.match(fr::Http::RequestType::Get, uri = "/users/newer", match), 1);
+    ASSERT_EQ(match.size(), 1);
+    ASSERT_TRUE(match.get("id") == "newer");
+
+    ASSERT_EQ(*router.match(fr::Http::RequestType::Get, uri = "/users/10/posts/hello", match), 3);
+    ASSERT_EQ(match.size(), 2);
+    ASSERT_EQ(match.get("id").to_string(), "10");
+    ASSERT_EQ(match[1].to_string(), "hello");
+    ASSERT_FALSE(match.exists("path"));
+    ASSERT_THROW(match.get("path"), std::out_of_range);
+
+    ASSERT_EQ(*router.match(fr::Http::RequestType::Get, uri = "/static/css/site.css", match), 4);
+    ASSERT_EQ(match.get("path").to_string(), "css/site.css");
+    ASSERT_EQ(*router.match(fr::Http::RequestType::Get, uri = "/static/", match), 4);
+    ASSERT_EQ(match.get("path").to_string(), "");
+
+    ASSERT_EQ(router.match(fr::Http::RequestType::Get, uri = "/users/", match), nullptr);
+    ASSERT_EQ(router.match(fr::Http::RequestType::Get, uri = "/users/10/posts", match), nullptr);
+    ASSERT_EQ(match.size(), 0);
+}
+
+TEST(RouterTest, backtracking)
+{
+    fr::Router<int> router;
+    router.add(fr::Http::RequestType::Get, "/a/b/c", 1);
+    router.add(fr::Http::RequestType::Get, "/a/:x/d", 2);
+
+    fr::Router<int>::Match match;
+    std::string uri;
+    ASSERT_EQ(*router.match(fr::Http::RequestType::Get, uri = "/a/b/c", match), 1);
+    ASSERT_EQ(*router.match(fr::Http::RequestType::Get, uri = "/a/b/d", match), 2);
+    ASSERT_EQ(match.get("x").to_string(), "b");
+}
+
+TEST(RouterTest, invalid_routes)
+{
+    fr::Router<int> router;
+    router.add(fr::Http::RequestType::Get, "/users/:id", 1);
+    ASSERT_THROW(router.add(fr::Http::RequestType::Get, "/users/:id", 1), std::logic_error);
+    ASSERT_THROW(router.add(fr::Http::RequestType::Get, "/users/:name", 1), std::logic_error);
+    ASSERT_THROW(router.add(fr::Http::RequestType::Get, "users", 1), std::logic_error);
+    ASSERT_THROW(router.add(fr::Http::RequestType::Get, "/users:id", 1), std::logic_error);
+    ASSERT_THROW(router.add(fr::Http::RequestType::Get, "/files/:", 1), std::logic_error);
+    ASSERT_THROW(router.add(fr::Http::RequestType::Get, "/a/*x/b", 1), std::logic_error);
+    ASSERT_THROW(router.add(fr::Http::RequestType::Unknown, "/", 1), std::logic_error);
+    ASSERT_NO_THROW(router.add(fr::Http::RequestType::Post, "/users/:id", 1));
+}
+
+TEST(RouterTest, route_table_and_request)
+{
+    using Handler = std::function<std::string()>;
+    fr::Router<Handler> router = {
+            {fr::Http::RequestType::Get, "/hello/:name", []() {return std::string("get");}},
+            {fr::Http::RequestType::Post, "/hello/:name", []() {return std::string("post");}},
+    };
+
+    const std::string raw_request =
+            "POST /hello/fred?a=b HTTP/1.1\r\n"
+            "\r\n";
+    fr::HttpRequest request;
+    ASSERT_EQ(request.parse(raw_request.c_str(), raw_request.size()), fr::Socket::Status::Success);
+
+    fr::Router<Handler>::Match match;
+    auto handler = router.match(request, match);
+    ASSERT_NE(handler, nullptr);
+    ASSERT_EQ((*handler)(), "post");
+    ASSERT_EQ(match.get("name").to_string(), "fred");
+}
@@ -0,0 +1,71 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#include <gtest/gtest.h>
+#include <frnetlib/Sha1.h>
+#include <frnetlib/Base64.h>
+
+namespace
+{
+    std::string to_hex(const std::string &digest)
+    {
+        static const char hex[] = "0123456789abcdef";
+        std::string out;
+        for(unsigned char c : digest)
+        {
+            out += hex[c >> 4];
+            out += hex[c & 0xF];
+        }
+        return out;
+    }
+
+    //Bytes which aren't the same repeated, so that blocks being mixed up shows
+    std::string make_input(size_t size)
+    {
+        std::string input;
+        for(size_t a = 0; a < size; ++a)
+            input += static_cast<char>(a * 7 + 3);
+        return input;
+    }
+}
+
+TEST(Sha1Test, digest)
+{
+    ASSERT_EQ(to_hex(fr::Sha1::sha1_digest("")), "da39a3ee5e6b4b0d3255bfef95601890afd80709");
+    ASSERT_EQ(to_hex(fr::Sha1::sha1_digest("abc")), "a9993e364706816aba3e25717850c26c9cd0d89d");
+    ASSERT_EQ(to_hex(fr::Sha1::sha1_digest("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq")), "84983e441c3bd26ebaae4aa1f95129e5e54670f1");
+    ASSERT_EQ(to_hex(fr::Sha1::sha1_digest(std::string(1000000, 'a'))), "34aa973cd4c4daa4f61eeb2bdbad27316534016f");
+
+    //Either side of where the padding needs an extra block
+    std::vector<std::pair<size_t, std::string>> sizes = {
+            {55, "ddf57317ef34bfee3b6df83d359098930eb278bc"},
+            {56, "a0d492bb0fc889d0eca3bc137066ab6f4f74f369"},
+            {63, "c55856749bef509bdfe6bfebfc7bf4e793e82132"},
+            {64, "bede92be29c3874e1b54ddc77988d606fc857a8e"},
+            {65, "b05a80522b053d6dc7e0a517d0e70212c7dad11f"},
+            {119, "504e27376a6e0f0dba8295b85cb25dc4dfa17d23"},
+            {1000, "4231a8a50a10fa9758db8ec71fdef855b751048a"},
+    };
+    for(auto &size : sizes)
+        ASSERT_EQ(to_hex(fr::Sha1::sha1_digest(make_input(size.first))), size.second) << size.first;
+
+    //The WebSocket handshake example from RFC 6455
+    ASSERT_EQ(fr::Base64::encode(fr::Sha1::sha1_digest("dGhlIHNhbXBsZSBub25jZQ==258EAFA5-E914-47DA-95CA-C5AB0DC85B11")), "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+}
+
+TEST(Sha1Test, update)
+{
+    //Hashing in pieces gives the same digest wherever the input's split
+    std::string input = make_input(200);
+    std::string expected = fr::Sha1::sha1_digest(input);
+    fr::Sha1 sha1;
+    for(size_t split = 0; split <= input.size(); split += 7)
+    {
+        char digest[fr::Sha1::DIGEST_SIZE];
+        sha1.update(input.data(), split);
+        sha1.update(input.data() + split, input.size() - split);
+        sha1.final(digest);
+        ASSERT_EQ(std::string(digest, sizeof(digest)), expected) << split;
+    }
+}
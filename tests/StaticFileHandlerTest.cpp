@@ -0,0 +1,182 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#ifndef _WIN32
+#include <gtest/gtest.h>
+#include <fstream>
+#include <thread>
+#include <sys/stat.h>
+#include <frnetlib/TcpListener.h>
+#include <frnetlib/StaticFileHandler.h>
+
+class StaticFileHandlerTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        char dir_template[] = "/tmp/frnetlib_static_XXXXXX";
+        root = mkdtemp(dir_template);
+        mkdir((root + "/sub").c_str(), 0700);
+        contents = "0123456789abcdefghijklmnopqrstuvwxyz";
+        std::ofstream(root + "/file.txt") << contents;
+        std::ofstream(root + "/sub/index.html") << "<h1>index</h1>";
+        std::ofstream(root + "/c++ notes.txt") << "plus";
+        ASSERT_EQ(listener.listen("9096"), fr::Socket::Status::Success);
+    }
+
+    void TearDown() override
+    {
+        unlink((root + "/file.txt").c_str());
+        unlink((root + "/sub/index.html").c_str());
+        unlink((root + "/c++ notes.txt").c_str());
+        rmdir((root + "/sub").c_str());
+        rmdir(root.c_str());
+    }
+
+    //Sends a request to the handler over a real connection, and returns the response
+    fr::HttpResponse request(fr::StaticFileHandler &handler, fr::HttpRequest request)
+    {
+        std::thread server([&]() {
+            fr::TcpSocket client;
+            ASSERT_EQ(listener.accept(client), fr::Socket::Status::Success);
+            fr::HttpRequest received;
+            ASSERT_EQ(client.receive(received), fr::Socket::Status::Success);
+            ASSERT_EQ(handler.serve(client, received), fr::Socket::Status::Success);
+        });
+
+        fr::TcpSocket socket;
+        fr::HttpResponse response;
+        EXPECT_EQ(socket.connect("127.0.0.1", "9096", std::chrono::seconds(5)), fr::Socket::Status::Success);
+        EXPECT_EQ(socket.send(request), fr::Socket::Status::Success);
+        EXPECT_EQ(socket.receive(response), fr::Socket::Status::Success);
+        server.join();
+        return response;
+    }
+
+    fr::TcpListener listener;
+    std::string root;
+    std::string contents;
+};
+
+TEST_F(StaticFileHandlerTest, serve_file)
+{
+    fr::StaticFileHandler handler(root);
+    fr::HttpRequest req;
+    req.set_uri("/file.txt");
+    auto response = request(handler, req);
+    ASSERT_EQ(response.get_status(), fr::Http::RequestStatus::Ok);
+    ASSERT_EQ(response.get_body(), contents);
+    ASSERT_EQ(response.header("content-type"), "text/plain");
+    ASSERT_EQ(response.header("accept-ranges"), "bytes");
+    ASSERT_FALSE(response.header("etag").empty());
+
+    //Directories should serve their index
+    req.set_uri("/sub/");
+    response = request(handler, req);
+    ASSERT_EQ(response.get_status(), fr::Http::RequestStatus::Ok);
+    ASSERT_EQ(response.get_body(), "<h1>index</h1>");
+
+    //'+' is literal in paths, only percent escapes get decoded
+    req.set_uri("/c++%20notes.txt");
+    response = request(handler, req);
+    ASSERT_EQ(response.get_status(), fr::Http::RequestStatus::Ok);
+    ASSERT_EQ(response.get_body(), "plus");
+}
+
+TEST_F(StaticFileHandlerTest, not_found)
+{
+    fr::StaticFileHandler handler(root + "/sub");
+    fr::HttpRequest req;
+    req.set_uri("/../file.txt");
+    ASSERT_EQ(request(handler, req).get_status(), fr::Http::RequestStatus::NotFound);
+    req.set_uri("/%2e%2e/file.txt");
+    ASSERT_EQ(request(handler, req).get_status(), fr::Http::RequestStatus::NotFound);
+    req.set_uri("/missing.txt");
+    ASSERT_EQ(request(handler, req).get_status(), fr::Http::RequestStatus::NotFound);
+    req.set_uri("/index.html");
+    req.set_type(fr::Http::RequestType::Post);
+    ASSERT_EQ(request(handler, req).get_status(), fr::Http::RequestStatus::MethodNotAllowed);
+}
+
+TEST_F(StaticFileHandlerTest, not_modified)
+{
+    fr::StaticFileHandler handler(root);
+    fr::HttpRequest req;
+    req.set_uri("/file.txt");
+    auto response = request(handler, req);
+    std::string etag = response.header("etag");
+    std::string last_modified = response.header("last-modified");
+
+    req.header("if-none-match") = "\"nope\", W/" + etag;
+    response = request(handler, req);
+    ASSERT_EQ(response.get_status(), fr::Http::RequestStatus::NotModified);
+    ASSERT_EQ(response.get_body(), "");
+
+    req.header("if-none-match") = "\"nope\"";
+    ASSERT_EQ(request(handler, req).get_status(), fr::Http::RequestStatus::Ok);
+
+    req = {};
+    req.set_uri("/file.txt");
+    req.header("if-modified-since") = last_modified;
+    ASSERT_EQ(request(handler, req).get_status(), fr::Http::RequestStatus::NotModified);
+    req.header("if-modified-since") = fr::StaticFileHandler::format_http_date(fr::StaticFileHandler::parse_http_date(last_modified) - 10);
+    ASSERT_EQ(request(handler, req).get_status(), fr::Http::RequestStatus::Ok);
+}
+
+TEST_F(StaticFileHandlerTest, ranges)
+{
+    fr::StaticFileHandler handler(root);
+    handler.set_cache_limits(1024, 4096);
+    const std::vector<std::pair<std::string, std::string>> ranges = {
+            {"bytes=0-9", "0123456789"},
+            {"bytes=30-", "uvwxyz"},
+            {"bytes=-3", "xyz"},
+            {"bytes=34-100", "yz"},
+    };
+
+    for(size_t pass = 0; pass < 2; ++pass) //Once to populate the cache, once to use it
+    {
+        for(auto &range : ranges)
+        {
+            fr::HttpRequest req;
+            req.set_uri("/file.txt");
+            req.header("range") = range.first;
+            auto response = request(handler, req);
+            ASSERT_EQ(response.get_status(), fr::Http::RequestStatus::PartialContent);
+            ASSERT_EQ(response.get_body(), range.second);
+        }
+    }
+
+    fr::HttpRequest req;
+    req.set_uri("/file.txt");
+    req.header("range") = "bytes=0-9";
+    auto response = request(handler, req);
+    ASSERT_EQ(response.header("content-range"), "bytes 0-9/36");
+
+    req.header("range") = "bytes=36-";
+    response = request(handler, req);
+    ASSERT_EQ(response.get_status(), fr::Http::RequestStatus::RequestedRangeNotSatisfiable);
+    ASSERT_EQ(response.header("content-range"), "bytes */36");
+
+    //Invalid, multiple and stale ranges should all get the whole file
+    for(auto &range : {"bytes=9-0", "bytes=0-1,4-5", "lines=0-1"})
+    {
+        req.header("range") = range;
+        response = request(handler, req);
+        ASSERT_EQ(response.get_status(), fr::Http::RequestStatus::Ok);
+        ASSERT_EQ(response.get_body(), contents);
+    }
+
+    req.header("range") = "bytes=0-1";
+    req.header("if-range") = "\"stale\"";
+    ASSERT_EQ(request(handler, req).get_body(), contents);
+
+    //If-Range uses strong comparison, so a weak version of the current tag doesn't count
+    std::string etag = response.header("etag");
+    req.header("if-range") = etag;
+    ASSERT_EQ(request(handler, req).get_body(), "01");
+    req.header("if-range") = "W/" + etag;
+    ASSERT_EQ(request(handler, req).get_body(), contents);
+}
+#endif
@@ -0,0 +1,164 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#ifndef _WIN32
+#include <gtest/gtest.h>
+#include <thread>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <frnetlib/TcpSocket.h>
+#include <frnetlib/SocketSelector.h>
+
+namespace
+{
+    int32_t listen_on(const std::string &ip, uint16_t port, int backlog)
+    {
+        int32_t descriptor = ::socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        setsockopt(descriptor, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        inet_pton(AF_INET, ip.c_str(), &address.sin_addr);
+        if(::bind(descriptor, (sockaddr*)&address, sizeof(address)) != 0 || ::listen(descriptor, backlog) != 0)
+            throw std::runtime_error("Failed to listen on " + ip);
+        return descriptor;
+    }
+}
+
+TEST(TcpSocketTest, connect_races_addresses)
+{
+    //127.0.0.2 never completes a handshake, as its accept queue is full and SYNs are dropped
+    int32_t stalled = listen_on("127.0.0.2", 9112, 0);
+    std::vector<int32_t> fillers;
+    for(size_t a = 0; a < 4; ++a)
+    {
+        fillers.emplace_back(::socket(AF_INET, SOCK_STREAM, 0));
+        fr::set_unix_socket_blocking(fillers.back(), true, false);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(9112);
+        inet_pton(AF_INET, "127.0.0.2", &address.sin_addr);
+        ::connect(fillers.back(), (sockaddr*)&address, sizeof(address));
+    }
+    int32_t working = listen_on("127.0.0.1", 9112, 8);
+
+    //The stalled address is raced against the next, rather than waiting out the timeout
+    fr::Address first, second;
+    ASSERT_TRUE(fr::Address::parse("127.0.0.2", first));
+    ASSERT_TRUE(fr::Address::parse("127.0.0.1", second));
+    fr::TcpSocket socket;
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_EQ(socket.connect("some.host", {first, second}, "9112", std::chrono::seconds(10)), fr::Socket::Status::Success);
+    ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+
+    sockaddr_in peer = {};
+    socklen_t length = sizeof(peer);
+    ASSERT_EQ(getpeername(socket.get_socket_descriptor(), (sockaddr*)&peer, &length), 0);
+    ASSERT_EQ(fr::Address((sockaddr*)&peer, length).to_string(), "127.0.0.1");
+
+    //Refused addresses are moved past immediately
+    socket.disconnect();
+    ::close(working);
+    start = std::chrono::steady_clock::now();
+    ASSERT_EQ(socket.connect("some.host", {second, second}, "9112", {}), fr::Socket::Status::NoRouteToHost);
+    ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(200));
+    ASSERT_FALSE(socket.connected());
+
+    for(auto filler : fillers)
+        ::close(filler);
+    ::close(stalled);
+}
+
+TEST(TcpSocketTest, connect_async)
+{
+    int32_t listener = listen_on("127.0.0.1", 9113, 128);
+
+    //Nobody's listening on 127.0.0.2, so each socket has to move on to its second address
+    fr::Address refused, working;
+    ASSERT_TRUE(fr::Address::parse("127.0.0.2", refused));
+    ASSERT_TRUE(fr::Address::parse("127.0.0.1", working));
+
+    fr::SocketSelector selector;
+    std::vector<std::shared_ptr<fr::TcpSocket>> sockets;
+    for(size_t a = 0; a < 64; ++a)
+    {
+        sockets.emplace_back(std::make_shared<fr::TcpSocket>());
+        auto status = sockets.back()->connect_async("some.host", {refused, working}, "9113");
+        ASSERT_TRUE(status == fr::Socket::Status::Connecting || status == fr::Socket::Status::Success) << fr::Socket::status_to_string(status);
+        selector.add(sockets.back(), sockets.back().get(), true);
+    }
+
+    size_t connected = 0;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while(connected < sockets.size() && std::chrono::steady_clock::now() < deadline)
+    {
+        for(auto &event : selector.wait(std::chrono::milliseconds(100)))
+        {
+            auto *socket = static_cast<fr::TcpSocket*>(event.second);
+            if(!socket->connecting())
+                continue;
+            auto status = socket->finish_connect();
+            if(status == fr::Socket::Status::Connecting)
+            {
+                selector.set_write_interest(event.first, true);
+                continue;
+            }
+            ASSERT_EQ(status, fr::Socket::Status::Success);
+            selector.set_write_interest(event.first, false);
+            ++connected;
+        }
+    }
+    ASSERT_EQ(connected, sockets.size());
+    for(auto &socket : sockets)
+    {
+        ASSERT_TRUE(socket->connected());
+        ASSERT_EQ(socket->get_remote_address(), "some.host:9113");
+        ASSERT_TRUE(socket->get_blocking());
+        selector.remove(socket);
+    }
+
+    //And when there's nothing left to try
+    ::close(listener);
+    fr::TcpSocket socket;
+    auto status = socket.connect_async("some.host", {working}, "9113");
+    if(status == fr::Socket::Status::Connecting)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        status = socket.finish_connect();
+    }
+    ASSERT_EQ(status, fr::Socket::Status::NoRouteToHost);
+    ASSERT_FALSE(socket.connected());
+    ASSERT_EQ(socket.finish_connect(), fr::Socket::Status::Disconnected);
+}
+
+TEST(TcpSocketTest, send_gather)
+{
+    int32_t listener = listen_on("127.0.0.1", 9116, 8);
+    fr::TcpSocket socket;
+    ASSERT_EQ(socket.connect("127.0.0.1", "9116", {}), fr::Socket::Status::Success);
+    int32_t server = ::accept(listener, nullptr, nullptr);
+    ASSERT_GE(server, 0);
+
+    //Picks up from part way through, as if the first few bytes had already gone
+    std::string large(1000000, 'x');
+    fr::Socket::Buffer buffers[] = {{"head", 4}, {"", 0}, {"er ", 3}, {large.data(), large.size()}, {" tail", 5}};
+    size_t sent = 2;
+    std::string received;
+    std::thread reader([&]() {
+        char buffer[65536];
+        ssize_t size;
+        while((size = ::recv(server, buffer, sizeof(buffer), 0)) > 0)
+            received.append(buffer, (size_t)size);
+    });
+    ASSERT_EQ(socket.send_gather(buffers, 5, sent), fr::Socket::Status::Success);
+    ASSERT_EQ(sent, 4 + 3 + large.size() + 5);
+    socket.disconnect();
+    reader.join();
+    ASSERT_EQ(received, "ader " + large + " tail");
+
+    ::close(server);
+    ::close(listener);
+}
+#endif
@@ -112,4 +112,12 @@ TEST(URLTest, test_path_only_parse)
         ASSERT_EQ(url.get_host(), "bob.com");
         ASSERT_EQ(url.get_path(), "/trob");
     }
-}
\ No newline at end of file
+}
+TEST(URLTest, scheme_conversion)
+{
+    for(auto scheme : {fr::URL::HTTP, fr::URL::HTTPS, fr::URL::FTP, fr::URL::MAILTO, fr::URL::IRC, fr::URL::SFTP})
+        ASSERT_EQ(fr::URL::string_to_scheme(fr::URL::scheme_to_string(scheme)), scheme);
+    ASSERT_EQ(fr::URL::string_to_scheme("HtTpS"), fr::URL::HTTPS);
+    ASSERT_EQ(fr::URL::string_to_scheme("gopher"), fr::URL::Unknown);
+    ASSERT_EQ(fr::URL("sftp://example.com").get_port(), "22");
+}
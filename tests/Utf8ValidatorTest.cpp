@@ -0,0 +1,64 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#include <gtest/gtest.h>
+#include <frnetlib/Utf8Validator.h>
+
+TEST(Utf8ValidatorTest, validate)
+{
+    std::vector<std::string> valid = {
+            "",
+            "plain ascii, long enough to be checked a block at a time",
+            "caf\xC3\xA9",
+            "\xE2\x82\xAC \xED\x9F\xBF \xEE\x80\x80", //U+20AC, U+D7FF (just below the surrogates), U+E000
+            "\xF0\x90\x80\x80 \xF4\x8F\xBF\xBF", //U+10000 and U+10FFFF
+            std::string(100, 'a') + "\xCE\xBA\xE1\xBD\xB9\xCF\x83\xCE\xBC\xCE\xB5" + std::string(100, 'b'),
+    };
+    std::vector<std::string> invalid = {
+            "\x80",
+            "\xBF",
+            "\xC0\x80", //Overlong
+            "\xC1\xBF",
+            "\xE0\x9F\xBF",
+            "\xF0\x8F\xBF\xBF",
+            "\xED\xA0\x80", //Surrogate
+            "\xF4\x90\x80\x80", //Above U+10FFFF
+            "\xF5\x80\x80\x80",
+            "\xFF",
+            "\xC3", //Truncated
+            "\xE2\x82",
+            "\xC3\x41",
+            std::string(40, 'a') + "\xE2\x82\xAC\xE2\x82" + std::string(40, 'a'),
+    };
+
+    for(auto &text : valid)
+        ASSERT_TRUE(fr::Utf8Validator::validate(text.data(), text.size())) << text;
+    for(auto &text : invalid)
+        ASSERT_FALSE(fr::Utf8Validator::validate(text.data(), text.size())) << text;
+}
+
+TEST(Utf8ValidatorTest, pieces)
+{
+    //Splitting the text anywhere, including part way through a character, doesn't change the result
+    std::string valid = std::string(30, 'a') + "\xE2\x82\xAC\xF0\x9F\x98\x80" + std::string(30, 'b') + "\xC3\xA9";
+    std::string invalid = std::string(30, 'a') + "\xE2\x82\xAC\xF0\x9F\x98" + std::string(30, 'b');
+    fr::Utf8Validator validator;
+    for(size_t split = 0; split <= valid.size(); ++split)
+    {
+        ASSERT_TRUE(validator.update(valid.data(), split));
+        ASSERT_TRUE(validator.update(valid.data() + split, valid.size() - split));
+        ASSERT_TRUE(validator.finish()) << split;
+    }
+    for(size_t split = 0; split <= invalid.size(); ++split)
+    {
+        validator.update(invalid.data(), split);
+        validator.update(invalid.data() + split, invalid.size() - split);
+        ASSERT_FALSE(validator.finish()) << split;
+    }
+
+    //A character left unfinished is only an error once the text ends
+    ASSERT_TRUE(validator.update("\xF0\x9F", 2));
+    ASSERT_FALSE(validator.finish());
+    ASSERT_TRUE(validator.finish());
+}
@@ -0,0 +1,204 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <frnetlib/WebFrame.h>
+#include <frnetlib/TcpSocket.h>
+#include <frnetlib/TcpListener.h>
+
+namespace
+{
+    //Builds a frame's wire format by hand
+    std::string make_frame(uint8_t first_byte, const std::string &payload, bool masked)
+    {
+        std::string frame(1, (char)first_byte);
+        uint8_t mask_bit = masked ? 0x80 : 0;
+        if(payload.size() <= 125)
+        {
+            frame += (char)(mask_bit | payload.size());
+        }
+        else if(payload.size() <= 0xFFFF)
+        {
+            frame += (char)(mask_bit | 126);
+            frame += (char)(payload.size() >> 8);
+            frame += (char)payload.size();
+        }
+        else
+        {
+            frame += (char)(mask_bit | 127);
+            for(int shift = 56; shift >= 0; shift -= 8)
+                frame += (char)((uint64_t)payload.size() >> shift);
+        }
+
+        std::string body = payload;
+        if(masked)
+        {
+            const uint32_t mask_key = 0xA1B2C3D4;
+            frame.append((const char*)&mask_key, sizeof(mask_key));
+            fr::WebFrame::apply_mask(&body[0], body.size(), mask_key);
+        }
+        return frame + body;
+    }
+}
+
+TEST(WebFrameTest, apply_mask)
+{
+    const uint32_t mask_key = 0x78563412;
+    char key[4];
+    memcpy(key, &mask_key, sizeof(key));
+    std::string data(200, '\0');
+    for(size_t a = 0; a < data.size(); ++a)
+        data[a] = (char)(a * 7);
+
+    //Every combination of size, alignment and offset should match the plain byte-at-a-time mask
+    for(size_t start = 0; start < 16; ++start)
+    {
+        for(size_t size = 0; size < data.size() - start; size += 3)
+        {
+            for(size_t offset = 0; offset < 4; ++offset)
+            {
+                std::string masked = data;
+                fr::WebFrame::apply_mask(&masked[start], size, mask_key, offset);
+                for(size_t a = 0; a < masked.size(); ++a)
+                {
+                    char expected = data[a];
+                    if(a >= start && a < start + size)
+                        expected ^= key[(offset + a - start) % 4];
+                    ASSERT_EQ(masked[a], expected) << "start " << start << ", size " << size << ", offset " << offset;
+                }
+
+                fr::WebFrame::apply_mask(&masked[start], size, mask_key, offset);
+                ASSERT_EQ(masked, data);
+            }
+        }
+    }
+}
+
+TEST(WebFrameTest, send_receive)
+{
+    fr::TcpListener listener;
+    ASSERT_EQ(listener.listen("9114"), fr::Socket::Status::Success);
+
+    std::string payload(100000, '\0');
+    for(size_t a = 0; a < payload.size(); ++a)
+        payload[a] = (char)(a % 251);
+
+    std::thread client_thread([&]() {
+        fr::TcpSocket socket;
+        ASSERT_EQ(socket.connect("127.0.0.1", "9114", {}), fr::Socket::Status::Success);
+
+        //Sending doesn't leave the payload masked, so the same frame can be sent again
+        fr::ClientWebFrame frame;
+        frame.set_opcode(fr::WebFrame::Opcode::Binary);
+        frame.set_payload(payload);
+        ASSERT_EQ(socket.send(frame), fr::Socket::Status::Success);
+        ASSERT_EQ(frame.get_payload(), payload);
+        ASSERT_EQ(socket.send(frame), fr::Socket::Status::Success);
+    });
+
+    fr::TcpSocket socket;
+    ASSERT_EQ(listener.accept(socket), fr::Socket::Status::Success);
+    for(size_t a = 0; a < 2; ++a)
+    {
+        fr::ServerWebFrame frame;
+        ASSERT_EQ(socket.receive(frame), fr::Socket::Status::Success);
+        ASSERT_EQ(frame.get_opcode(), fr::WebFrame::Opcode::Binary);
+        ASSERT_EQ(frame.get_payload(), payload);
+    }
+    client_thread.join();
+}
+
+TEST(WebFrameTest, server_send)
+{
+    fr::TcpListener listener;
+    ASSERT_EQ(listener.listen("9115"), fr::Socket::Status::Success);
+
+    std::thread server_thread([&]() {
+        fr::TcpSocket socket;
+        ASSERT_EQ(listener.accept(socket), fr::Socket::Status::Success);
+        for(size_t size : {0, 125, 126, 65535, 3000000})
+        {
+            fr::ServerWebFrame frame;
+            frame.set_payload(std::string(size, (char)size));
+            ASSERT_EQ(socket.send(frame), fr::Socket::Status::Success);
+        }
+    });
+
+    fr::TcpSocket socket;
+    ASSERT_EQ(socket.connect("127.0.0.1", "9115", {}), fr::Socket::Status::Success);
+    for(size_t size : {0, 125, 126, 65535, 3000000})
+    {
+        fr::ClientWebFrame frame;
+        ASSERT_EQ(socket.receive(frame), fr::Socket::Status::Success);
+        ASSERT_EQ(frame.get_payload(), std::string(size, (char)size));
+    }
+    server_thread.join();
+}
+
+TEST(WebFrameTest, parse)
+{
+    std::string large(70000, '\0');
+    for(size_t a = 0; a < large.size(); ++a)
+        large[a] = (char)(a % 253);
+    std::string stream = make_frame(0x81, "hello", true) + make_frame(0x02, large, true) + make_frame(0x80, "", true) + make_frame(0x89, "ping", true);
+
+    //However the data's split up, the same frames come out of it
+    for(size_t chunk_size : {1, 3, 7, 1000, 1000000})
+    {
+        std::vector<fr::ServerWebFrame> frames;
+        fr::ServerWebFrame frame;
+        for(size_t pos = 0; pos < stream.size(); pos += chunk_size)
+        {
+            const char *chunk = stream.data() + pos;
+            size_t size = std::min(chunk_size, stream.size() - pos);
+            while(true)
+            {
+                size_t consumed = 0;
+                auto status = frame.parse(chunk, size, consumed);
+                if(status == fr::Socket::Status::NotEnoughData)
+                {
+                    ASSERT_EQ(consumed, size);
+                    break;
+                }
+                ASSERT_EQ(status, fr::Socket::Status::Success);
+                frames.emplace_back(frame);
+                chunk += consumed;
+                size -= consumed;
+                if(size == 0)
+                    break;
+            }
+        }
+
+        ASSERT_EQ(frames.size(), 4) << "chunk size " << chunk_size;
+        ASSERT_EQ(frames[0].get_payload(), "hello");
+        ASSERT_EQ(frames[0].get_opcode(), fr::WebFrame::Opcode::Text);
+        ASSERT_TRUE(frames[0].is_final());
+        ASSERT_EQ(frames[1].get_payload(), large);
+        ASSERT_EQ(frames[1].get_opcode(), fr::WebFrame::Opcode::Binary);
+        ASSERT_FALSE(frames[1].is_final());
+        ASSERT_EQ(frames[2].get_payload(), "");
+        ASSERT_EQ(frames[2].get_opcode(), fr::WebFrame::Opcode::Continuation);
+        ASSERT_EQ(frames[3].get_payload(), "ping");
+        ASSERT_EQ(frames[3].get_opcode(), fr::WebFrame::Opcode::Ping);
+    }
+}
+
+TEST(WebFrameTest, parse_invalid)
+{
+    size_t consumed = 0;
+
+    //Clients must mask what they send, and servers mustn't
+    fr::ServerWebFrame server_frame;
+    std::string frame = make_frame(0x81, "hello", false);
+    ASSERT_EQ(server_frame.parse(frame.data(), frame.size(), consumed), fr::Socket::Status::Error);
+    fr::ClientWebFrame client_frame;
+    frame = make_frame(0x81, "hello", true);
+    ASSERT_EQ(client_frame.parse(frame.data(), frame.size(), consumed), fr::Socket::Status::Error);
+
+    //The length is checked before any of the payload arrives
+    fr::ServerWebFrame limited_frame;
+    frame = make_frame(0x82, std::string(1000, 'a'), true);
+    ASSERT_EQ(limited_frame.parse(frame.data(), 8, consumed, 999), fr::Socket::Status::MaxPacketSizeExceeded);
+}
@@ -0,0 +1,153 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <frnetlib/WebSocketHub.h>
+#include <frnetlib/WebSocket.h>
+#include <frnetlib/TcpSocket.h>
+#include <frnetlib/TcpListener.h>
+
+namespace
+{
+    using ServerSocket = std::shared_ptr<fr::WebSocket<fr::TcpSocket>>;
+    using ClientSocket = std::unique_ptr<fr::WebSocket<fr::TcpSocket>>;
+
+    //Connects 'count' clients, returning the non-blocking server side of each
+    std::vector<ServerSocket> connect_clients(fr::TcpListener &listener, const std::string &port, std::vector<ClientSocket> &clients, size_t count)
+    {
+        clients.resize(count);
+        std::thread connector([&]() {
+            for(auto &client : clients)
+            {
+                client.reset(new fr::WebSocket<fr::TcpSocket>());
+                ASSERT_EQ(client->connect("127.0.0.1", port, {}), fr::Socket::Status::Success);
+            }
+        });
+
+        std::vector<ServerSocket> servers;
+        for(size_t a = 0; a < count; ++a)
+        {
+            auto server = std::make_shared<fr::WebSocket<fr::TcpSocket>>();
+            EXPECT_EQ(listener.accept(*server), fr::Socket::Status::Success);
+            server->set_blocking(false);
+            servers.emplace_back(std::move(server));
+        }
+        connector.join();
+        return servers;
+    }
+
+    fr::ServerWebFrame make_frame(const std::string &payload)
+    {
+        fr::ServerWebFrame frame;
+        frame.set_payload(payload);
+        return frame;
+    }
+}
+
+TEST(WebSocketHubTest, topics)
+{
+    fr::TcpListener listener;
+    ASSERT_EQ(listener.listen("9122"), fr::Socket::Status::Success);
+    std::vector<ClientSocket> clients;
+    auto servers = connect_clients(listener, "9122", clients, 20);
+
+    //Everyone gets broadcasts, and half of them are subscribed to a topic
+    fr::WebSocketHub hub;
+    for(size_t a = 0; a < servers.size(); ++a)
+    {
+        hub.add(servers[a]);
+        if(a % 2 == 0)
+            hub.subscribe(servers[a], "even");
+    }
+    hub.subscribe(servers[0], "first");
+    hub.unsubscribe(servers[0], "first");
+    ASSERT_EQ(hub.size(), 20);
+
+    ASSERT_EQ(hub.broadcast(make_frame("everyone")), 20);
+    ASSERT_EQ(hub.publish("even", make_frame("even")), 10);
+    ASSERT_EQ(hub.publish("first", make_frame("first")), 0);
+    ASSERT_TRUE(hub.send(servers[1], make_frame("just you")));
+    ASSERT_EQ(hub.broadcast(make_frame("end")), 20);
+
+    for(size_t a = 0; a < clients.size(); ++a)
+    {
+        std::vector<std::string> expected = {"everyone"};
+        if(a % 2 == 0)
+            expected.emplace_back("even");
+        if(a == 1)
+            expected.emplace_back("just you");
+        expected.emplace_back("end");
+        for(auto &payload : expected)
+        {
+            fr::ClientWebFrame frame;
+            ASSERT_EQ(clients[a]->receive(frame), fr::Socket::Status::Success);
+            ASSERT_EQ(frame.get_payload(), payload);
+        }
+    }
+
+    //Removing a connection drops its subscriptions
+    hub.remove(servers[0]);
+    ASSERT_EQ(hub.size(), 19);
+    ASSERT_EQ(hub.publish("even", make_frame("even")), 9);
+    ASSERT_FALSE(hub.send(servers[0], make_frame("gone")));
+}
+
+TEST(WebSocketHubTest, slow_consumers)
+{
+    fr::TcpListener listener;
+    ASSERT_EQ(listener.listen("9123"), fr::Socket::Status::Success);
+    std::vector<ClientSocket> clients;
+    auto servers = connect_clients(listener, "9123", clients, 2);
+
+    fr::WebSocketHub hub;
+    hub.set_budget(8 * 1024 * 1024);
+    std::vector<std::pair<std::shared_ptr<fr::Socket>, bool>> write_interest;
+    std::vector<std::pair<std::shared_ptr<fr::Socket>, fr::Socket::Status>> evicted;
+    hub.set_write_interest_handler([&](const std::shared_ptr<fr::Socket> &socket, bool want_write) {
+        write_interest.emplace_back(socket, want_write);
+    });
+    hub.set_evict_handler([&](const std::shared_ptr<fr::Socket> &socket, fr::Socket::Status reason) {
+        evicted.emplace_back(socket, reason);
+    });
+    hub.add(servers[0]);
+    hub.add(servers[1]);
+
+    //Neither client is reading, so frames back up until both need to wait to be writable
+    std::string payload(256 * 1024, 'a');
+    while(write_interest.size() < 2)
+        ASSERT_EQ(hub.broadcast(make_frame(payload)), 2);
+    ASSERT_TRUE(hub.has_pending(servers[0]));
+    ASSERT_TRUE(write_interest[0].second);
+
+    //The first client catches up, whilst the second never does, and is evicted once it's over budget
+    std::thread reader([&]() {
+        while(true)
+        {
+            fr::ClientWebFrame frame;
+            ASSERT_EQ(clients[0]->receive(frame), fr::Socket::Status::Success);
+            if(frame.get_payload() == "end")
+                break;
+            ASSERT_EQ(frame.get_payload(), payload);
+        }
+    });
+    while(evicted.empty())
+    {
+        ASSERT_GE(hub.broadcast(make_frame(payload)), 1);
+        hub.flush();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(evicted.size(), 1);
+    ASSERT_EQ(evicted[0].first, servers[1]);
+    ASSERT_EQ(evicted[0].second, fr::Socket::Status::MaxPacketSizeExceeded);
+    ASSERT_EQ(hub.size(), 1);
+
+    //Once the first client's read everything, it no longer needs to wait
+    ASSERT_TRUE(hub.send(servers[0], make_frame("end")));
+    while(hub.has_pending(servers[0]))
+        hub.flush();
+    reader.join();
+    ASSERT_EQ(write_interest.back().first, servers[0]);
+    ASSERT_FALSE(write_interest.back().second);
+}
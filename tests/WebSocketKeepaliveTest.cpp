@@ -0,0 +1,148 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <atomic>
+#include <frnetlib/WebSocketKeepalive.h>
+#include <frnetlib/TcpSocket.h>
+#include <frnetlib/TcpListener.h>
+#include <frnetlib/SocketSelector.h>
+
+TEST(WebSocketKeepaliveTest, dead_peers)
+{
+    fr::TcpListener listener;
+    ASSERT_EQ(listener.listen("9125"), fr::Socket::Status::Success);
+
+    //One client answers pings as it reads, and the other never reads anything
+    std::atomic<size_t> pings(0);
+    std::thread responsive_client([&]() {
+        fr::WebSocket<fr::TcpSocket> socket;
+        ASSERT_EQ(socket.connect("127.0.0.1", "9125", {}), fr::Socket::Status::Success);
+        fr::ClientWebFrame frame;
+        while(socket.receive(frame) == fr::Socket::Status::Success && frame.get_opcode() == fr::WebFrame::Opcode::Ping)
+            ++pings;
+    });
+    fr::WebSocket<fr::TcpSocket> silent_client;
+
+    auto responsive = std::make_shared<fr::WebSocket<fr::TcpSocket>>();
+    auto silent = std::make_shared<fr::WebSocket<fr::TcpSocket>>();
+    ASSERT_EQ(listener.accept(*responsive), fr::Socket::Status::Success);
+    std::thread silent_connect([&]() {
+        ASSERT_EQ(silent_client.connect("127.0.0.1", "9125", {}), fr::Socket::Status::Success);
+    });
+    ASSERT_EQ(listener.accept(*silent), fr::Socket::Status::Success);
+    silent_connect.join();
+
+    fr::WebSocketKeepalive keepalive;
+    std::vector<std::pair<std::shared_ptr<fr::Socket>, fr::Socket::Status>> closed;
+    keepalive.set_close_handler([&](const std::shared_ptr<fr::Socket> &socket, fr::Socket::Status reason) {
+        closed.emplace_back(socket, reason);
+    });
+    fr::SocketSelector selector;
+    for(auto &socket : {responsive, silent})
+    {
+        socket->set_keepalive(std::chrono::milliseconds(50), 2);
+        keepalive.add(socket);
+        selector.add(socket, socket.get());
+    }
+    ASSERT_EQ(keepalive.size(), 2);
+
+    //Drive both from one loop, receiving pongs as they come in
+    auto start = std::chrono::steady_clock::now();
+    while(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(600))
+    {
+        for(auto &event : selector.wait(keepalive.time_until_next()))
+        {
+            auto *socket = static_cast<fr::WebSocket<fr::TcpSocket>*>(event.second);
+            fr::ServerWebFrame frame;
+            ASSERT_EQ(socket->receive(frame), fr::Socket::Status::Success);
+            ASSERT_EQ(frame.get_opcode(), fr::WebFrame::Opcode::Pong);
+        }
+        keepalive.run();
+    }
+
+    //The silent one's given up on after its third interval, and the other's still going
+    ASSERT_EQ(closed.size(), 1);
+    ASSERT_EQ(closed[0].first, silent);
+    ASSERT_EQ(closed[0].second, fr::Socket::Status::Timeout);
+    ASSERT_FALSE(silent->connected());
+    ASSERT_TRUE(responsive->connected());
+    ASSERT_GE(pings, 5);
+    ASSERT_EQ(keepalive.size(), 1);
+
+    //Connections drop out once they're gone
+    responsive->disconnect();
+    responsive_client.join();
+    responsive.reset();
+    keepalive.run(std::chrono::steady_clock::now() + std::chrono::seconds(1));
+    ASSERT_EQ(keepalive.size(), 0);
+    ASSERT_EQ(keepalive.time_until_next(), std::chrono::milliseconds(-1));
+}
+
+TEST(WebSocketKeepaliveTest, parse)
+{
+    fr::TcpListener listener;
+    ASSERT_EQ(listener.listen("9132"), fr::Socket::Status::Success);
+
+    std::atomic<size_t> pings(0);
+    std::atomic<bool> ponged(false);
+    std::thread client_thread([&]() {
+        fr::WebSocket<fr::TcpSocket> socket;
+        ASSERT_EQ(socket.connect("127.0.0.1", "9132", {}), fr::Socket::Status::Success);
+        fr::ClientWebFrame frame;
+        frame.set_opcode(fr::WebFrame::Opcode::Ping);
+        frame.set_payload("hello");
+        ASSERT_EQ(socket.send(frame), fr::Socket::Status::Success);
+        while(socket.receive(frame) == fr::Socket::Status::Success)
+        {
+            if(frame.get_opcode() == fr::WebFrame::Opcode::Ping)
+                ++pings;
+            else if(frame.get_opcode() == fr::WebFrame::Opcode::Pong && frame.get_payload() == "hello")
+                ponged = true;
+        }
+    });
+
+    auto socket = std::make_shared<fr::WebSocket<fr::TcpSocket>>();
+    ASSERT_EQ(listener.accept(*socket), fr::Socket::Status::Success);
+    socket->set_keepalive(std::chrono::milliseconds(50), 2);
+    fr::SocketSelector selector;
+    selector.add(socket, socket.get());
+
+    //Receive the data ourselves, and parse it through the socket, so that pongs keep it alive
+    size_t pongs = 0;
+    fr::ServerWebFrame frame;
+    auto start = std::chrono::steady_clock::now();
+    while(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(400))
+    {
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(socket->get_keepalive_deadline() - std::chrono::steady_clock::now());
+        for(auto &event : selector.wait(std::max(wait, std::chrono::milliseconds(0)) + std::chrono::milliseconds(1)))
+        {
+            char buffer[RECV_CHUNK_SIZE];
+            size_t received = 0;
+            ASSERT_EQ(static_cast<fr::Socket*>(event.second)->receive_raw(buffer, sizeof(buffer), received), fr::Socket::Status::Success);
+            for(size_t offset = 0, consumed = 0; offset < received; offset += consumed)
+            {
+                auto status = socket->parse(frame, buffer + offset, received - offset, consumed);
+                if(status == fr::Socket::Status::Success && frame.get_opcode() == fr::WebFrame::Opcode::Pong)
+                {
+                    ++pongs;
+                }
+                else if(status != fr::Socket::Status::Success)
+                {
+                    ASSERT_EQ(status, fr::Socket::Status::NotEnoughData);
+                }
+            }
+        }
+        ASSERT_EQ(socket->check_keepalive(), fr::Socket::Status::Success);
+    }
+
+    //The client's ping was answered, as receive() would have done
+    ASSERT_TRUE(socket->connected());
+    ASSERT_GE(pongs, 5);
+    socket->disconnect();
+    client_thread.join();
+    ASSERT_TRUE(ponged);
+    ASSERT_GE(pings, pongs);
+}
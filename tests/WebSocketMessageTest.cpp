@@ -0,0 +1,230 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <frnetlib/WebSocketMessage.h>
+#include <frnetlib/TcpSocket.h>
+#include <frnetlib/TcpListener.h>
+
+namespace
+{
+    std::string make_payload(size_t size)
+    {
+        std::string payload(size, '\0');
+        for(size_t a = 0; a < size; ++a)
+            payload[a] = (char)(a % 241);
+        return payload;
+    }
+}
+
+TEST(WebSocketMessageTest, fragmentation)
+{
+    fr::TcpListener listener;
+    ASSERT_EQ(listener.listen("9118"), fr::Socket::Status::Success);
+    std::string payload = make_payload(250000);
+
+    std::thread client_thread([&]() {
+        fr::TcpSocket socket;
+        ASSERT_EQ(socket.connect("127.0.0.1", "9118", {}), fr::Socket::Status::Success);
+        fr::ClientWebSocketMessage message(fr::WebFrame::Opcode::Binary);
+        message.set_payload(payload);
+        message.set_fragment_size(100000);
+        ASSERT_EQ(socket.send(message), fr::Socket::Status::Success);
+
+        //Other frames can go between the fragments
+        size_t offset = 0;
+        ASSERT_EQ(message.send_fragment(&socket, offset), fr::Socket::Status::Success);
+        ASSERT_EQ(offset, 100000);
+        fr::ClientWebFrame ping;
+        ping.set_opcode(fr::WebFrame::Opcode::Ping);
+        ping.set_payload("ping");
+        ASSERT_EQ(socket.send(ping), fr::Socket::Status::Success);
+        while(offset < payload.size())
+            ASSERT_EQ(message.send_fragment(&socket, offset), fr::Socket::Status::Success);
+
+        //An empty message still takes a frame
+        fr::ClientWebSocketMessage empty;
+        ASSERT_EQ(socket.send(empty), fr::Socket::Status::Success);
+    });
+
+    fr::TcpSocket socket;
+    ASSERT_EQ(listener.accept(socket), fr::Socket::Status::Success);
+
+    //The first message arrives in three frames
+    std::vector<std::pair<fr::WebFrame::Opcode, size_t>> expected = {{fr::WebFrame::Opcode::Binary, 100000}, {fr::WebFrame::Opcode::Continuation, 100000}, {fr::WebFrame::Opcode::Continuation, 50000}};
+    for(size_t a = 0; a < expected.size(); ++a)
+    {
+        fr::ServerWebFrame frame;
+        ASSERT_EQ(socket.receive(frame), fr::Socket::Status::Success);
+        ASSERT_EQ(frame.get_opcode(), expected[a].first);
+        ASSERT_EQ(frame.get_payload().size(), expected[a].second);
+        ASSERT_EQ(frame.is_final(), a == expected.size() - 1);
+    }
+
+    //The second one's interrupted by a ping, which comes out first
+    fr::ServerWebSocketMessage message;
+    message.reserve(payload.size());
+    ASSERT_EQ(socket.receive(message), fr::Socket::Status::Success);
+    ASSERT_EQ(message.get_opcode(), fr::WebFrame::Opcode::Ping);
+    ASSERT_EQ(message.get_payload(), "ping");
+    ASSERT_EQ(socket.receive(message), fr::Socket::Status::Success);
+    ASSERT_EQ(message.get_opcode(), fr::WebFrame::Opcode::Binary);
+    ASSERT_EQ(message.get_payload(), payload);
+
+    ASSERT_EQ(socket.receive(message), fr::Socket::Status::Success);
+    ASSERT_EQ(message.get_opcode(), fr::WebFrame::Opcode::Text);
+    ASSERT_EQ(message.get_payload(), "");
+    client_thread.join();
+}
+
+TEST(WebSocketMessageTest, payload_sink)
+{
+    fr::TcpListener listener;
+    ASSERT_EQ(listener.listen("9119"), fr::Socket::Status::Success);
+    std::string payload = make_payload(1000000);
+
+    std::thread server_thread([&]() {
+        fr::TcpSocket socket;
+        ASSERT_EQ(listener.accept(socket), fr::Socket::Status::Success);
+        fr::ServerWebSocketMessage message;
+        message.set_payload(payload);
+        message.set_fragment_size(4096);
+        ASSERT_EQ(socket.send(message), fr::Socket::Status::Success);
+        ASSERT_EQ(socket.send(message), fr::Socket::Status::Success);
+    });
+
+    fr::TcpSocket socket;
+    ASSERT_EQ(socket.connect("127.0.0.1", "9119", {}), fr::Socket::Status::Success);
+
+    //The payload is streamed out a fragment at a time, rather than being collected
+    fr::ClientWebSocketMessage message;
+    std::string streamed;
+    size_t largest_part = 0;
+    message.set_payload_sink([&](const char *data, size_t size) {
+        streamed.append(data, size);
+        largest_part = std::max(largest_part, size);
+        return true;
+    });
+    ASSERT_EQ(socket.receive(message), fr::Socket::Status::Success);
+    ASSERT_EQ(message.get_payload(), "");
+    ASSERT_EQ(streamed, payload);
+    ASSERT_EQ(largest_part, 4096);
+
+    //Without a sink, the message as a whole is limited
+    message.set_payload_sink({});
+    message.set_max_size(500000);
+    ASSERT_EQ(socket.receive(message), fr::Socket::Status::MaxPacketSizeExceeded);
+    server_thread.join();
+}
+
+TEST(WebSocketMessageTest, oversized_frames)
+{
+    fr::TcpListener listener;
+    ASSERT_EQ(listener.listen("9127"), fr::Socket::Status::Success);
+    std::string payload = make_payload(300000);
+
+    std::thread server_thread([&]() {
+        fr::TcpSocket socket;
+        ASSERT_EQ(listener.accept(socket), fr::Socket::Status::Success);
+        fr::ServerWebSocketMessage message;
+        message.set_payload(payload);
+        message.set_fragment_size(payload.size());
+        ASSERT_EQ(socket.send(message), fr::Socket::Status::Success);
+
+        //Headers which claim 2^62 byte payloads, without any payload following them
+        const char header[] = {(char)0x82, 0x7F, 0x40, 0, 0, 0, 0, 0, 0, 0};
+        for(size_t a = 0; a < 2; ++a)
+        {
+            size_t sent = 0;
+            ASSERT_EQ(socket.send_raw(header, sizeof(header), sent), fr::Socket::Status::Success);
+        }
+    });
+
+    fr::TcpSocket socket;
+    ASSERT_EQ(socket.connect("127.0.0.1", "9127", {}), fr::Socket::Status::Success);
+
+    //A sink gets large frames in pieces, as they arrive
+    fr::ClientWebSocketMessage message;
+    std::string streamed;
+    size_t largest_part = 0;
+    message.set_payload_sink([&](const char *data, size_t size) {
+        streamed.append(data, size);
+        largest_part = std::max(largest_part, size);
+        return true;
+    });
+    ASSERT_EQ(socket.receive(message), fr::Socket::Status::Success);
+    ASSERT_EQ(streamed, payload);
+    ASSERT_LE(largest_part, 65536);
+
+    //And frames over the limit are turned away before anything's allocated for them, with or without a sink
+    message.set_max_size(1024 * 1024);
+    ASSERT_EQ(socket.receive(message), fr::Socket::Status::MaxPacketSizeExceeded);
+    message.set_payload_sink({});
+    ASSERT_EQ(socket.receive(message), fr::Socket::Status::MaxPacketSizeExceeded);
+    server_thread.join();
+}
+
+TEST(WebSocketMessageTest, parse)
+{
+    //Collect the frames of a fragmented message with a ping in the middle
+    std::string payload = make_payload(10000);
+    std::string stream;
+    {
+        fr::TcpListener listener;
+        ASSERT_EQ(listener.listen("9120"), fr::Socket::Status::Success);
+        std::thread client_thread([&]() {
+            fr::TcpSocket socket;
+            ASSERT_EQ(socket.connect("127.0.0.1", "9120", {}), fr::Socket::Status::Success);
+            fr::ClientWebSocketMessage message;
+            message.set_payload(payload);
+            message.set_fragment_size(3000);
+            size_t offset = 0;
+            ASSERT_EQ(message.send_fragment(&socket, offset), fr::Socket::Status::Success);
+            fr::ClientWebFrame ping;
+            ping.set_opcode(fr::WebFrame::Opcode::Ping);
+            ASSERT_EQ(socket.send(ping), fr::Socket::Status::Success);
+            while(offset < payload.size())
+                ASSERT_EQ(message.send_fragment(&socket, offset), fr::Socket::Status::Success);
+        });
+        fr::TcpSocket socket;
+        ASSERT_EQ(listener.accept(socket), fr::Socket::Status::Success);
+        client_thread.join();
+        char buffer[65536];
+        size_t received = 0;
+        while(socket.receive_raw(buffer, sizeof(buffer), received) == fr::Socket::Status::Success)
+            stream.append(buffer, received);
+    }
+
+    //And feed them in a byte at a time
+    fr::ServerWebSocketMessage message;
+    std::vector<std::pair<fr::WebFrame::Opcode, std::string>> messages;
+    for(size_t a = 0; a < stream.size(); ++a)
+    {
+        size_t consumed = 0;
+        auto status = message.parse(&stream[a], 1, consumed);
+        ASSERT_EQ(consumed, 1);
+        if(status == fr::Socket::Status::Success)
+            messages.emplace_back(message.get_opcode(), message.get_payload());
+        else
+            ASSERT_EQ(status, fr::Socket::Status::NotEnoughData);
+    }
+    ASSERT_EQ(messages.size(), 2);
+    ASSERT_EQ(messages[0].first, fr::WebFrame::Opcode::Ping);
+    ASSERT_EQ(messages[1].first, fr::WebFrame::Opcode::Text);
+    ASSERT_EQ(messages[1].second, payload);
+
+    //The smaller of the message's limit and the one passed to parse() applies to the whole message
+    fr::ServerWebSocketMessage limited;
+    limited.set_max_size(20000);
+    auto status = fr::Socket::Status::Success;
+    for(size_t offset = 0, used = 0; offset < stream.size() && status == fr::Socket::Status::Success; offset += used)
+        status = limited.parse(stream.data() + offset, stream.size() - offset, used, nullptr, 5000);
+    ASSERT_EQ(status, fr::Socket::Status::MaxPacketSizeExceeded);
+
+    //A continuation with nothing to continue. The last frame is 1000 bytes, with an 8 byte header.
+    fr::ServerWebSocketMessage out_of_order;
+    size_t consumed = 0;
+    ASSERT_EQ(out_of_order.parse(stream.data() + stream.size() - 1008, 1008, consumed), fr::Socket::Status::Error);
+}
@@ -0,0 +1,194 @@
+//
+// Created by fred on 19/10/26.
+//
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <map>
+#include <frnetlib/WebSocket.h>
+#include <frnetlib/TcpSocket.h>
+#include <frnetlib/TcpListener.h>
+#include <frnetlib/SocketSelector.h>
+
+TEST(WebSocketTest, async_handshake)
+{
+    fr::TcpListener listener;
+    ASSERT_EQ(listener.listen("9117"), fr::Socket::Status::Success);
+
+    //A client which never says anything, which mustn't hold up the others
+    fr::TcpSocket silent;
+    ASSERT_EQ(silent.connect("127.0.0.1", "9117", {}), fr::Socket::Status::Success);
+
+    //A client which isn't speaking WebSocket
+    std::thread http_client([]() {
+        fr::TcpSocket socket;
+        ASSERT_EQ(socket.connect("127.0.0.1", "9117", {}), fr::Socket::Status::Success);
+        fr::HttpRequest request;
+        ASSERT_EQ(socket.send(request), fr::Socket::Status::Success);
+        char buffer[16];
+        size_t received = 0;
+        ASSERT_NE(socket.receive_raw(buffer, sizeof(buffer), received), fr::Socket::Status::Success);
+    });
+
+    std::thread websocket_client([]() {
+        fr::WebSocket<fr::TcpSocket> socket;
+        ASSERT_EQ(socket.connect("127.0.0.1", "9117", {}), fr::Socket::Status::Success);
+        fr::ClientWebFrame frame;
+        frame.set_payload("hello");
+        ASSERT_EQ(socket.send(frame), fr::Socket::Status::Success);
+    });
+
+    //Each accept returns straight away, without waiting for the client's upgrade request
+    fr::SocketSelector selector;
+    std::vector<std::shared_ptr<fr::WebSocket<fr::TcpSocket>>> sockets;
+    auto start = std::chrono::steady_clock::now();
+    for(size_t a = 0; a < 3; ++a)
+    {
+        auto socket = std::make_shared<fr::WebSocket<fr::TcpSocket>>();
+        socket->set_async_handshake(true);
+        socket->set_handshake_timeout(std::chrono::milliseconds(500));
+        ASSERT_EQ(listener.accept(*socket), fr::Socket::Status::Success);
+        ASSERT_TRUE(socket->is_handshake_pending());
+        ASSERT_FALSE(socket->get_blocking());
+        selector.add(socket, socket.get());
+        sockets.emplace_back(std::move(socket));
+    }
+
+    //Drive the handshakes from one thread, until each one finishes one way or another
+    std::map<fr::Socket::Status, size_t> results;
+    fr::WebSocket<fr::TcpSocket> *upgraded = nullptr;
+    while(results.size() < 3 && std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+    {
+        selector.wait(std::chrono::milliseconds(50));
+        for(auto &socket : sockets)
+        {
+            if(!socket->is_handshake_pending())
+                continue;
+            auto status = socket->continue_handshake();
+            if(status == fr::Socket::Status::NotEnoughData)
+                continue;
+            selector.remove(socket);
+            ++results[status];
+            if(status == fr::Socket::Status::Success)
+                upgraded = socket.get();
+        }
+    }
+    ASSERT_EQ(results[fr::Socket::Status::Success], 1);
+    ASSERT_EQ(results[fr::Socket::Status::HandshakeFailed], 1);
+    ASSERT_EQ(results[fr::Socket::Status::Timeout], 1);
+    ASSERT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(500));
+
+    //The upgraded connection works as usual
+    ASSERT_NE(upgraded, nullptr);
+    ASSERT_EQ(upgraded->set_blocking(true), fr::Socket::Status::Success);
+    fr::ServerWebFrame frame;
+    ASSERT_EQ(upgraded->receive(frame), fr::Socket::Status::Success);
+    ASSERT_EQ(frame.get_payload(), "hello");
+
+    for(auto &socket : sockets)
+        ASSERT_EQ(socket->connected(), socket.get() == upgraded);
+    http_client.join();
+    websocket_client.join();
+}
+
+TEST(WebSocketTest, auto_pong)
+{
+    fr::TcpListener listener;
+    ASSERT_EQ(listener.listen("9124"), fr::Socket::Status::Success);
+
+    std::thread client_thread([]() {
+        fr::WebSocket<fr::TcpSocket> socket;
+        ASSERT_EQ(socket.connect("127.0.0.1", "9124", {}), fr::Socket::Status::Success);
+        fr::ClientWebFrame frame;
+        frame.set_payload("ready");
+        ASSERT_EQ(socket.send(frame), fr::Socket::Status::Success);
+
+        //Pings are still handed back, after being answered
+        ASSERT_EQ(socket.receive(frame), fr::Socket::Status::Success);
+        ASSERT_EQ(frame.get_opcode(), fr::WebFrame::Opcode::Ping);
+        fr::ClientWebSocketMessage message;
+        ASSERT_EQ(socket.receive(message), fr::Socket::Status::Success);
+        ASSERT_EQ(message.get_opcode(), fr::WebFrame::Opcode::Ping);
+        ASSERT_EQ(message.get_payload(), "second");
+
+        //Unless they're turned off
+        socket.set_auto_pong(false);
+        ASSERT_EQ(socket.receive(frame), fr::Socket::Status::Success);
+        ASSERT_EQ(frame.get_opcode(), fr::WebFrame::Opcode::Ping);
+        frame.set_opcode(fr::WebFrame::Opcode::Text);
+        frame.set_payload("done");
+        ASSERT_EQ(socket.send(frame), fr::Socket::Status::Success);
+    });
+
+    fr::WebSocket<fr::TcpSocket> socket;
+    ASSERT_EQ(listener.accept(socket), fr::Socket::Status::Success);
+    fr::ServerWebFrame ready;
+    ASSERT_EQ(socket.receive(ready), fr::Socket::Status::Success);
+    for(auto &payload : {"first", "second", "third"})
+    {
+        fr::ServerWebFrame ping;
+        ping.set_opcode(fr::WebFrame::Opcode::Ping);
+        ping.set_payload(payload);
+        ASSERT_EQ(socket.send(ping), fr::Socket::Status::Success);
+    }
+
+    std::vector<std::string> expected = {"first", "second"};
+    for(auto &payload : expected)
+    {
+        fr::ServerWebFrame pong;
+        ASSERT_EQ(socket.receive(pong), fr::Socket::Status::Success);
+        ASSERT_EQ(pong.get_opcode(), fr::WebFrame::Opcode::Pong);
+        ASSERT_EQ(pong.get_payload(), payload);
+    }
+    fr::ServerWebFrame frame;
+    ASSERT_EQ(socket.receive(frame), fr::Socket::Status::Success);
+    ASSERT_EQ(frame.get_payload(), "done");
+    client_thread.join();
+}
+
+TEST(WebSocketTest, invalid_utf8)
+{
+    fr::TcpListener listener;
+    ASSERT_EQ(listener.listen("9126"), fr::Socket::Status::Success);
+
+    std::thread client_thread([]() {
+        fr::WebSocket<fr::TcpSocket> socket;
+        ASSERT_EQ(socket.connect("127.0.0.1", "9126", {}), fr::Socket::Status::Success);
+
+        //Characters can be split between fragments, but surrogates aren't allowed
+        std::vector<std::pair<fr::WebFrame::Opcode, std::string>> fragments = {
+                {fr::WebFrame::Opcode::Text, "caf\xC3"},
+                {fr::WebFrame::Opcode::Continuation, "\xA9"},
+                {fr::WebFrame::Opcode::Text, "ok \xED"},
+                {fr::WebFrame::Opcode::Continuation, "\xA0\x80"},
+        };
+        for(size_t a = 0; a < fragments.size(); ++a)
+        {
+            fr::ClientWebFrame frame;
+            frame.set_opcode(fragments[a].first);
+            frame.set_payload(fragments[a].second);
+            frame.set_final(a % 2 == 1);
+            ASSERT_EQ(socket.send(frame), fr::Socket::Status::Success);
+        }
+
+        //The server gives up with code 1007
+        fr::ClientWebFrame frame;
+        ASSERT_EQ(socket.receive(frame), fr::Socket::Status::Success);
+        ASSERT_EQ(frame.get_opcode(), fr::WebFrame::Opcode::Disconnect);
+        ASSERT_EQ(frame.get_payload(), "\x03\xEF");
+    });
+
+    fr::WebSocket<fr::TcpSocket> socket;
+    socket.set_validate_utf8(true);
+    ASSERT_EQ(listener.accept(socket), fr::Socket::Status::Success);
+    fr::ServerWebSocketMessage message;
+    ASSERT_EQ(socket.receive(message), fr::Socket::Status::Success);
+    ASSERT_EQ(message.get_payload(), "caf\xC3\xA9");
+
+    //Text's also checked a frame at a time
+    fr::ServerWebFrame frame;
+    ASSERT_EQ(socket.receive(frame), fr::Socket::Status::Success);
+    ASSERT_EQ(socket.receive(frame), fr::Socket::Status::InvalidPayload);
+    ASSERT_FALSE(socket.connected());
+    client_thread.join();
+}